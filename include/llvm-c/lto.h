@@ -40,7 +40,7 @@ typedef bool lto_bool_t;
  * @{
  */
 
-#define LTO_API_VERSION 10
+#define LTO_API_VERSION 11
 
 /**
  * \since prior to LTO_API_VERSION=3
@@ -376,6 +376,18 @@ extern void
 lto_codegen_set_cpu(lto_code_gen_t cg, const char *cpu);
 
 
+/**
+ * Sets the number of code generation units that
+ * lto_codegen_compile_to_files() splits the optimized code into. Each unit is
+ * compiled on its own thread into its own native object file. The default is
+ * one.
+ *
+ * \since LTO_API_VERSION=11
+ */
+extern void
+lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned parallelism);
+
+
 /**
  * Sets the location of the assembler tool to run. If not set, libLTO
  * will use gcc to invoke the assembler.
@@ -436,6 +448,20 @@ lto_codegen_compile(lto_code_gen_t cg, size_t* length);
 extern lto_bool_t
 lto_codegen_compile_to_file(lto_code_gen_t cg, const char** name);
 
+/**
+ * Generates code for all added modules into one native object file per code
+ * generation unit (see lto_codegen_set_parallelism()). The units are compiled
+ * in parallel. The names of the files are written to names, and their number
+ * to count. The array of names is owned by the lto_code_gen_t and will be
+ * freed when lto_codegen_dispose() is called, or
+ * lto_codegen_compile_to_files() is called again. Returns true on error.
+ *
+ * \since LTO_API_VERSION=11
+ */
+extern lto_bool_t
+lto_codegen_compile_to_files(lto_code_gen_t cg, const char ***names,
+                             unsigned *count);
+
 
 /**
  * Sets options to help debug codegen bugs.
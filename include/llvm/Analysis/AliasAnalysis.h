@@ -562,6 +562,25 @@ public:
     copyValue(Old, New);
     deleteValue(Old);
   }
+
+  //===--------------------------------------------------------------------===//
+  /// Methods that clients making many queries on a function can call to let
+  /// alias analyses remember the results of queries, and of the work behind
+  /// them, from one query to the next.  In between, the client may only change
+  /// the program in ways that keep earlier results correct: deleting values,
+  /// replacing values with equivalent ones, and adding the escaping uses it
+  /// reports through addEscapingUse.  Calls may be nested.
+  ///
+
+  /// beginQueryCaching - Start a run of queries whose results may be cached.
+  ///
+  virtual void beginQueryCaching();
+
+  /// endQueryCaching - End the run of queries started by the matching call to
+  /// beginQueryCaching.  The cached results are dropped when the outermost
+  /// run ends.
+  ///
+  virtual void endQueryCaching();
 };
 
 // Specialize DenseMapInfo for Location.
@@ -0,0 +1,294 @@
+//===- llvm/Analysis/MemorySSA.h - Memory SSA form --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the MemorySSA analysis pass, which puts the memory
+// operations of a function in SSA form: the whole of memory is treated as a
+// single variable that is defined by every instruction that may write memory
+// (a MemoryDef), read by every instruction that may only read it (a
+// MemoryUse), and merged at control flow joins (a MemoryPhi). Every access
+// points at the access defining the memory it sees, so the accesses form
+// use-def chains that clients walk instead of scanning instructions.
+//
+// These chains are imprecise on purpose: a MemoryUse points at the closest
+// MemoryDef above it, whatever that def writes. The MemorySSAWalker uses alias
+// analysis to skip the defs that do not clobber a given location.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_MEMORYSSA_H
+#define LLVM_ANALYSIS_MEMORYSSA_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/iterator_range.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Pass.h"
+#include <memory>
+
+namespace llvm {
+
+class BasicBlock;
+class DominatorTree;
+class Function;
+class Instruction;
+class MemorySSA;
+class MemorySSAWalker;
+class raw_ostream;
+
+/// MemoryAccess - The base class of the nodes of MemorySSA.
+class MemoryAccess {
+public:
+  enum AccessKind { MemoryUseKind, MemoryDefKind, MemoryPhiKind };
+
+  virtual ~MemoryAccess() {}
+
+  AccessKind getKind() const { return Kind; }
+
+  /// getBlock - Return the block the access lives in.
+  BasicBlock *getBlock() const { return Block; }
+
+  /// The accesses whose defining access, or one of whose incoming values, is
+  /// this access. The order of the users is unspecified.
+  typedef SmallPtrSet<MemoryAccess *, 4>::const_iterator user_iterator;
+  user_iterator user_begin() const { return Users.begin(); }
+  user_iterator user_end() const { return Users.end(); }
+  iterator_range<user_iterator> users() const {
+    return iterator_range<user_iterator>(user_begin(), user_end());
+  }
+  bool use_empty() const { return Users.empty(); }
+
+  virtual void print(raw_ostream &OS) const = 0;
+  void dump() const;
+
+protected:
+  MemoryAccess(AccessKind Kind, BasicBlock *BB) : Kind(Kind), Block(BB) {}
+
+  void addUser(MemoryAccess *User) { Users.insert(User); }
+  void removeUser(MemoryAccess *User) { Users.erase(User); }
+
+private:
+  MemoryAccess(const MemoryAccess &) LLVM_DELETED_FUNCTION;
+  void operator=(const MemoryAccess &) LLVM_DELETED_FUNCTION;
+
+  AccessKind Kind;
+  BasicBlock *Block;
+  SmallPtrSet<MemoryAccess *, 4> Users;
+
+  friend class MemoryPhi;
+  friend class MemorySSA;
+  friend class MemoryUseOrDef;
+};
+
+inline raw_ostream &operator<<(raw_ostream &OS, const MemoryAccess &MA) {
+  MA.print(OS);
+  return OS;
+}
+
+/// MemoryUseOrDef - The common part of MemoryUse and MemoryDef: an access
+/// made by an instruction, which sees the memory of its defining access.
+class MemoryUseOrDef : public MemoryAccess {
+public:
+  /// getMemoryInst - Return the instruction making the access, null for the
+  /// live-on-entry definition.
+  Instruction *getMemoryInst() const { return MemoryInst; }
+
+  /// getDefiningAccess - Return the MemoryDef or MemoryPhi the access sees,
+  /// null for the live-on-entry definition.
+  MemoryAccess *getDefiningAccess() const { return DefiningAccess; }
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryUseKind || MA->getKind() == MemoryDefKind;
+  }
+
+protected:
+  MemoryUseOrDef(AccessKind Kind, Instruction *MI, BasicBlock *BB)
+      : MemoryAccess(Kind, BB), MemoryInst(MI), DefiningAccess(nullptr) {}
+  ~MemoryUseOrDef() { setDefiningAccess(nullptr); }
+
+  void setDefiningAccess(MemoryAccess *DA) {
+    if (DefiningAccess)
+      DefiningAccess->removeUser(this);
+    DefiningAccess = DA;
+    if (DA)
+      DA->addUser(this);
+  }
+
+private:
+  Instruction *MemoryInst;
+  MemoryAccess *DefiningAccess;
+
+  friend class MemorySSA;
+};
+
+/// MemoryUse - An instruction which may read memory but does not write it.
+class MemoryUse : public MemoryUseOrDef {
+public:
+  MemoryUse(Instruction *MI, BasicBlock *BB)
+      : MemoryUseOrDef(MemoryUseKind, MI, BB) {}
+
+  void print(raw_ostream &OS) const override;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryUseKind;
+  }
+};
+
+/// MemoryDef - An instruction which may write memory, or the definition of
+/// the memory live on entry to the function.
+class MemoryDef : public MemoryUseOrDef {
+public:
+  MemoryDef(Instruction *MI, BasicBlock *BB, unsigned ID)
+      : MemoryUseOrDef(MemoryDefKind, MI, BB), ID(ID) {}
+
+  /// getID - Return the number identifying the definition in printed output.
+  unsigned getID() const { return ID; }
+
+  void print(raw_ostream &OS) const override;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryDefKind;
+  }
+
+private:
+  unsigned ID;
+};
+
+/// MemoryPhi - The merge of the memory definitions reaching a block with
+/// several predecessors.
+class MemoryPhi : public MemoryAccess {
+public:
+  MemoryPhi(BasicBlock *BB, unsigned ID)
+      : MemoryAccess(MemoryPhiKind, BB), ID(ID) {}
+  ~MemoryPhi();
+
+  unsigned getID() const { return ID; }
+
+  unsigned getNumIncomingValues() const { return Incoming.size(); }
+  MemoryAccess *getIncomingValue(unsigned I) const {
+    return Incoming[I].second;
+  }
+  BasicBlock *getIncomingBlock(unsigned I) const { return Incoming[I].first; }
+
+  void addIncoming(MemoryAccess *MA, BasicBlock *BB);
+  void setIncomingValue(unsigned I, MemoryAccess *MA);
+
+  void print(raw_ostream &OS) const override;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == MemoryPhiKind;
+  }
+
+private:
+  bool hasIncomingValue(const MemoryAccess *MA) const;
+
+  unsigned ID;
+  SmallVector<std::pair<BasicBlock *, MemoryAccess *>, 4> Incoming;
+
+  friend class MemorySSA;
+};
+
+/// MemorySSA - The analysis pass building the memory SSA form of a function.
+///
+/// Only blocks reachable from the entry get accesses. The form stays valid
+/// across the updates below, so that the passes using it can keep it current
+/// as they transform the function instead of recomputing it.
+class MemorySSA : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  MemorySSA();
+  ~MemorySSA();
+
+  /// getMemoryAccess - Return the MemoryUse or MemoryDef of \p I, or null if
+  /// \p I does not access memory or is unreachable.
+  MemoryUseOrDef *getMemoryAccess(const Instruction *I) const {
+    return InstructionAccesses.lookup(I);
+  }
+
+  /// getMemoryAccess - Return the MemoryPhi of \p BB, or null if it has none.
+  MemoryPhi *getMemoryAccess(const BasicBlock *BB) const {
+    return BlockPhis.lookup(BB);
+  }
+
+  /// getLiveOnEntryDef - Return the definition of the memory on entry to the
+  /// function, which dominates all the other accesses.
+  MemoryDef *getLiveOnEntryDef() const { return LiveOnEntryDef.get(); }
+  bool isLiveOnEntryDef(const MemoryAccess *MA) const {
+    return MA == LiveOnEntryDef.get();
+  }
+
+  /// getWalker - Return the walker answering clobber queries on this form.
+  MemorySSAWalker *getWalker() const { return Walker.get(); }
+
+  /// removeMemoryAccess - Remove \p MA, which must not be a MemoryPhi, from
+  /// the form before its instruction is erased. Its users are given its
+  /// defining access.
+  void removeMemoryAccess(MemoryUseOrDef *MA);
+
+  /// replaceMemoryInstruction - Give the access of \p From to \p To, which
+  /// takes its place in the function. \p To must not write memory unless
+  /// \p From does. Nothing is done if \p From is unreachable.
+  void replaceMemoryInstruction(Instruction *From, Instruction *To);
+
+  bool runOnFunction(Function &F) override;
+  void releaseMemory() override;
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
+  void print(raw_ostream &OS, const Module *M = nullptr) const override;
+  void verifyAnalysis() const override;
+
+private:
+  void placePHINodes(const SmallPtrSetImpl<BasicBlock *> &DefBlocks,
+                     SmallPtrSetImpl<BasicBlock *> &PhiBlocks);
+  void renamePass(DenseMap<BasicBlock *, MemoryAccess *> &BlockExits);
+
+  Function *F;
+  DominatorTree *DT;
+  unsigned NextID;
+  std::unique_ptr<MemoryDef> LiveOnEntryDef;
+  DenseMap<const Instruction *, MemoryUseOrDef *> InstructionAccesses;
+  DenseMap<const BasicBlock *, MemoryPhi *> BlockPhis;
+  std::unique_ptr<MemorySSAWalker> Walker;
+};
+
+/// MemorySSAWalker - Answers which access clobbers a memory location, walking
+/// the use-def chains of MemorySSA with alias analysis. At a MemoryPhi, the
+/// walk follows every incoming value and returns their common clobber if they
+/// agree, and the phi itself otherwise.
+class MemorySSAWalker {
+public:
+  MemorySSAWalker(MemorySSA &MSSA, AliasAnalysis &AA) : MSSA(MSSA), AA(AA) {}
+
+  /// getClobberingMemoryAccess - Return the closest access above the access
+  /// of \p I which may clobber the memory \p I reads or writes. The result is
+  /// the live-on-entry definition if nothing does, and null if \p I has no
+  /// access. Results are cached until the form is updated.
+  MemoryAccess *getClobberingMemoryAccess(const Instruction *I);
+
+  /// getClobberingMemoryAccess - Return the closest access at or above
+  /// \p Start which may write \p Loc.
+  MemoryAccess *getClobberingMemoryAccess(MemoryAccess *Start,
+                                          const AliasAnalysis::Location &Loc);
+
+  /// invalidateInfo - Forget the cached results, after an update of the form.
+  void invalidateInfo() { CachedClobbers.clear(); }
+
+private:
+  struct Query;
+  MemoryAccess *walk(MemoryAccess *Start, const Query &Q,
+                     DenseMap<const MemoryPhi *, MemoryAccess *> &PhiResults);
+  bool clobbers(const MemoryDef *Def, const Query &Q);
+
+  MemorySSA &MSSA;
+  AliasAnalysis &AA;
+  DenseMap<const Instruction *, MemoryAccess *> CachedClobbers;
+};
+
+} // end namespace llvm
+
+#endif
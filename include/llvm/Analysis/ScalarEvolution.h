@@ -23,6 +23,8 @@
 
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/ConstantRange.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
@@ -71,6 +73,10 @@ namespace llvm {
     unsigned short SubclassData;
 
   private:
+    /// ExpressionSize - The number of nodes of the expression counted as a
+    /// tree, saturating at the largest unsigned short.
+    const unsigned short ExpressionSize;
+
     SCEV(const SCEV &) LLVM_DELETED_FUNCTION;
     void operator=(const SCEV &) LLVM_DELETED_FUNCTION;
 
@@ -98,11 +104,18 @@ namespace llvm {
                        FlagNSW     = (1 << 2),   // No signed wrap.
                        NoWrapMask  = (1 << 3) -1 };
 
-    explicit SCEV(const FoldingSetNodeIDRef ID, unsigned SCEVTy) :
-      FastID(ID), SCEVType(SCEVTy), SubclassData(0) {}
+    explicit SCEV(const FoldingSetNodeIDRef ID, unsigned SCEVTy,
+                  unsigned short ExpressionSize = 1) :
+      FastID(ID), SCEVType(SCEVTy), SubclassData(0),
+      ExpressionSize(ExpressionSize) {}
 
     unsigned getSCEVType() const { return SCEVType; }
 
+    /// getExpressionSize - Return the number of nodes of this expression,
+    /// counting shared subexpressions once per use. This is how ScalarEvolution
+    /// measures expressions against its size budget.
+    unsigned short getExpressionSize() const { return ExpressionSize; }
+
     /// getType - Return the LLVM type of this SCEV expression.
     ///
     Type *getType() const;
@@ -379,6 +392,11 @@ namespace llvm {
     DenseMap<const SCEV *,
              SmallVector<std::pair<const Loop *, const SCEV *>, 2> > ValuesAtScopes;
 
+    /// ValuesAtScopesUsers - The expressions which have an entry for each loop
+    /// in ValuesAtScopes, so that forgetLoop can drop them.
+    DenseMap<const Loop *, SmallSetVector<const SCEV *, 4> >
+      ValuesAtScopesUsers;
+
     /// LoopDispositions - Memoized computeLoopDisposition results.
     DenseMap<const SCEV *,
              SmallVector<std::pair<const Loop *, LoopDisposition>, 2> > LoopDispositions;
@@ -423,6 +441,27 @@ namespace llvm {
     /// Analyze the expression.
     const SCEV *createSCEV(Value *V);
 
+    /// CreateSCEVDepth - The number of calls to createSCEV in progress. Past
+    /// the depth budget, values are not analyzed and become SCEVUnknowns.
+    unsigned CreateSCEVDepth;
+
+    /// CreateSCEVTruncated - Whether the expression being built depends on a
+    /// value that was left unknown past the depth budget.
+    bool CreateSCEVTruncated;
+
+    /// TruncatedValues - The values whose expression depends on the depth
+    /// budget. They are only cached until the outermost getSCEV returns, so
+    /// that the result of a query does not depend on the queries before it.
+    SmallPtrSet<Value *, 8> TruncatedValues;
+
+    /// forgetValuesAtScope - Drop the ValuesAtScopes entries computed for the
+    /// scope of the loop L.
+    void forgetValuesAtScope(const Loop *L);
+
+    /// updateCacheStatistics - Record the sizes of the caches, before they are
+    /// released.
+    void updateCacheStatistics() const;
+
     /// createNodeForPHI - Provide the special handling we need to analyze PHI
     /// SCEVs.
     const SCEV *createNodeForPHI(PHINode *PN);
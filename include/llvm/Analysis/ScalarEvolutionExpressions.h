@@ -32,6 +32,16 @@ namespace llvm {
     scUnknown, scCouldNotCompute
   };
 
+  /// computeExpressionSize - Return the size, as returned by
+  /// SCEV::getExpressionSize, of an expression with the given operands.
+  inline unsigned short computeExpressionSize(const SCEV *const *Ops,
+                                              size_t N) {
+    unsigned Size = 1;
+    for (size_t i = 0; i != N && Size < 0xffff; ++i)
+      Size += Ops[i]->getExpressionSize();
+    return Size < 0xffff ? Size : 0xffff;
+  }
+
   //===--------------------------------------------------------------------===//
   /// SCEVConstant - This class represents a constant integer value.
   ///
@@ -142,7 +152,8 @@ namespace llvm {
 
     SCEVNAryExpr(const FoldingSetNodeIDRef ID,
                  enum SCEVTypes T, const SCEV *const *O, size_t N)
-      : SCEV(ID, T), Operands(O), NumOperands(N) {}
+      : SCEV(ID, T, computeExpressionSize(O, N)), Operands(O),
+        NumOperands(N) {}
 
   public:
     size_t getNumOperands() const { return NumOperands; }
@@ -254,7 +265,12 @@ namespace llvm {
     const SCEV *LHS;
     const SCEV *RHS;
     SCEVUDivExpr(const FoldingSetNodeIDRef ID, const SCEV *lhs, const SCEV *rhs)
-      : SCEV(ID, scUDivExpr), LHS(lhs), RHS(rhs) {}
+      : SCEV(ID, scUDivExpr, computeSize(lhs, rhs)), LHS(lhs), RHS(rhs) {}
+
+    static unsigned short computeSize(const SCEV *LHS, const SCEV *RHS) {
+      const SCEV *Ops[] = { LHS, RHS };
+      return computeExpressionSize(Ops, 2);
+    }
 
   public:
     const SCEV *getLHS() const { return LHS; }
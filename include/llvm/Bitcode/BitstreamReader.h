@@ -144,6 +144,13 @@ public:
     assert(!hasBlockInfoRecords());
     BlockInfoRecords = std::move(Other.BlockInfoRecords);
   }
+
+  /// Copies the block info of the other bitstream reader.
+  ///
+  /// The abbreviations are duplicated rather than shared, because their
+  /// reference counts are not thread safe: cursors of the two readers may then
+  /// be used from different threads.
+  void copyBlockInfo(const BitstreamReader &Other);
 };
 
 
@@ -48,9 +48,12 @@ namespace llvm {
   std::string getBitcodeTargetTriple(MemoryBufferRef Buffer,
                                      LLVMContext &Context);
 
-  /// Read the specified bitcode file, returning the module.
+  /// Read the specified bitcode file, returning the module. If \p ThreadCount
+  /// is not 1, the function bodies are decoded on that many threads, zero
+  /// meaning one per hardware thread, before the IR is built from them.
   ErrorOr<Module *> parseBitcodeFile(MemoryBufferRef Buffer,
-                                     LLVMContext &Context);
+                                     LLVMContext &Context,
+                                     unsigned ThreadCount = 1);
 
   /// WriteBitcodeToFile - Write the specified module to the specified
   /// raw output stream.  For streams where it matters, the given stream
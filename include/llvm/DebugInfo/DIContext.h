@@ -134,6 +134,10 @@ public:
       uint64_t Size, DILineInfoSpecifier Specifier = DILineInfoSpecifier()) = 0;
   virtual DIInliningInfo getInliningInfoForAddress(uint64_t Address,
       DILineInfoSpecifier Specifier = DILineInfoSpecifier()) = 0;
+
+  /// Limit the number of compilation units whose lookup data is kept in
+  /// memory between address queries. Zero, the default, keeps everything.
+  virtual void setMaxResidentUnits(unsigned Max) {}
 private:
   const DIContextKind Kind;
 };
@@ -117,6 +117,9 @@ class ExecutionEngine {
   /// Whether lazy JIT compilation is enabled.
   bool CompilingLazily;
 
+  /// Whether MCJIT compiles the functions through stubs on their first call.
+  bool LazyFunctionStubs;
+
   /// Whether JIT compilation of external global variables is allowed.
   bool GVCompilationDisabled;
 
@@ -244,6 +247,21 @@ public:
   /// This method has no effect for the interpeter.
   virtual void generateCodeForModule(Module *M) {}
 
+  /// generateCodeForPendingModules - Run code generation for all the modules
+  /// that have been added but not loaded yet, compiling up to \p ThreadCount
+  /// of them at a time, and load them into memory as generateCodeForModule
+  /// does.  A count of zero means one thread per hardware thread.
+  ///
+  /// An LLVMContext may only be used by one thread at a time, so of the
+  /// modules that share a context, all but the first are written to bitcode
+  /// on the calling thread and compiled from a copy read back into a context
+  /// of its own.  Their data layout is set before they are copied.  Loading
+  /// the objects and applying relocations always happen on the calling
+  /// thread.
+  ///
+  /// This method has no effect for the interpeter.
+  virtual void generateCodeForPendingModules(unsigned ThreadCount = 0) {}
+
   /// finalizeObject - ensure the module is fully processed and is usable.
   ///
   /// It is the user-level function for completing the process of making the
@@ -425,6 +443,38 @@ public:
     return CompilingLazily;
   }
 
+  /// setLazyFunctionStubs - When on (it is off by default), MCJIT emits, for
+  /// every function of a module, a stub that calls the function through a
+  /// pointer, and the local symbols of the module become hidden global ones.
+  /// The pointer is a global variable named after the function, with the
+  /// suffix ".slot".  The first call compiles the function in a module of its
+  /// own and updates the pointer, so that later calls go straight to the
+  /// compiled code.  The modules are then not compiled on several threads by
+  /// generateCodeForPendingModules.  Functions are compiled eagerly when the
+  /// engine has an object cache or uses the small code model.
+  ///
+  /// A function is compiled on the thread that first calls its stub, in the
+  /// LLVMContext of its module.  An LLVMContext may not be used by several
+  /// threads at once, so while a stub may be called, no other thread may use
+  /// that context, nor any module or type in it, without holding the JIT's
+  /// lock (ExecutionEngine::lock).  Stubs may be called from several threads
+  /// at once; concurrent first calls compile the function once.
+  void setLazyFunctionStubs(bool Enabled) {
+    LazyFunctionStubs = Enabled;
+  }
+  bool hasLazyFunctionStubs() const {
+    return LazyFunctionStubs;
+  }
+
+  /// setTieredCompilation - When \p HotCallCount is not zero, functions
+  /// compiled through lazy stubs are first compiled without optimization and
+  /// with a call counter.  Once a function has been called \p HotCallCount
+  /// times, it is compiled again with the optimization level of the engine on
+  /// a background thread, and its stub switches to the new code when it is
+  /// ready.  The IR of the modules must not be modified while this may
+  /// happen.  Only MCJIT supports tiered compilation.
+  virtual void setTieredCompilation(unsigned HotCallCount) {}
+
   /// DisableGVCompilation - If called, the JIT will abort if it's asked to
   /// allocate space and populate a GlobalVariable that is not internal to
   /// the module.
@@ -502,6 +552,7 @@ private:
   std::string MCPU;
   SmallVector<std::string, 4> MAttrs;
   bool VerifyModules;
+  bool LazyFunctionStubs;
 
   /// InitEngine - Does the common initialization of default options.
   void InitEngine();
@@ -600,6 +651,14 @@ public:
     return *this;
   }
 
+  /// setLazyFunctionStubs - Set whether MCJIT compiles functions through
+  /// stubs on their first call.  This option defaults to false.  See
+  /// ExecutionEngine::setLazyFunctionStubs.
+  EngineBuilder &setLazyFunctionStubs(bool Enabled) {
+    LazyFunctionStubs = Enabled;
+    return *this;
+  }
+
   /// setMAttrs - Set cpu-specific attributes.
   template<typename StringSequence>
   EngineBuilder &setMAttrs(const StringSequence &mattrs) {
@@ -0,0 +1,82 @@
+//===- FileObjectCache.h - On-disk object cache for MCJIT -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares FileObjectCache, an ObjectCache that keeps the objects
+// compiled by MCJIT in a directory, so that they can be reused by later runs.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/Mutex.h"
+#include <memory>
+#include <string>
+
+namespace llvm {
+
+class LockFileManager;
+class TargetMachine;
+
+/// An ObjectCache storing objects in a directory on disk.
+///
+/// Objects are keyed by a hash of the bitcode of their module and of the
+/// configuration of the TargetMachine they are compiled with, so an entry is
+/// only reused for an identical module compiled for the same target, CPU,
+/// features, optimization level, relocation model and code model. Module
+/// identifiers play no part in the key.
+///
+/// Entries are written to a temporary file which is then renamed into place,
+/// so readers never see partial objects. When several processes need the
+/// same missing entry, a LockFileManager lets one of them compile it while
+/// the others wait and then load the result.
+///
+/// If a size limit is set, the least recently used entries are deleted after
+/// a new one is written until the total size of the entries fits the limit.
+class FileObjectCache : public ObjectCache {
+  FileObjectCache(const FileObjectCache &) LLVM_DELETED_FUNCTION;
+  void operator=(const FileObjectCache &) LLVM_DELETED_FUNCTION;
+
+public:
+  /// Create a cache in \p CacheDir, which is created if needed, for objects
+  /// compiled by \p TM.
+  FileObjectCache(StringRef CacheDir, const TargetMachine &TM);
+  ~FileObjectCache();
+
+  /// Limit the total size of the entries of the cache to \p Bytes. Zero, the
+  /// default, means no limit.
+  void setMaxSize(uint64_t Bytes) { MaxSize = Bytes; }
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+  /// Return the path of the entry holding the object for \p M.
+  std::string getEntryPath(const Module &M) const;
+
+private:
+  std::unique_ptr<MemoryBuffer> readEntry(StringRef Path) const;
+  void prune();
+
+  std::string CacheDir;
+  /// The configuration of the TargetMachine, part of every key.
+  std::string TargetKey;
+  uint64_t MaxSize;
+
+  sys::Mutex Lock;
+  /// The entry paths computed by getObject, for notifyObjectCompiled.
+  DenseMap<const Module *, std::string> EntryPaths;
+  /// Locks on the entries this cache is expected to write.
+  DenseMap<const Module *, LockFileManager *> EntryLocks;
+};
+
+} // end namespace llvm
+
+#endif
@@ -15,10 +15,12 @@
 #ifndef LLVM_EXECUTIONENGINE_SECTIONMEMORYMANAGER_H
 #define LLVM_EXECUTIONENGINE_SECTIONMEMORYMANAGER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Memory.h"
+#include <map>
 
 namespace llvm {
 /// This is a simple memory manager which implements the methods called by
@@ -34,14 +36,64 @@ namespace llvm {
 /// in the JITed object.  Permissions can be applied either by calling
 /// MCJIT::finalizeObject or by calling SectionMemoryManager::finalizeMemory
 /// directly.  Clients of MCJIT should call MCJIT::finalizeObject.
+///
+/// Memory is obtained from the system in slabs and handed out in runs of
+/// pages. Clients that discard the code they load, such as long running JIT
+/// services, can group the sections of each object or module in an allocation
+/// set and release the set when the code is no longer used. The pages of a set
+/// are not shared with any other set, so they can be reused for new sections
+/// while the code of the other sets keeps running.
 class SectionMemoryManager : public RTDyldMemoryManager {
   SectionMemoryManager(const SectionMemoryManager&) LLVM_DELETED_FUNCTION;
   void operator=(const SectionMemoryManager&) LLVM_DELETED_FUNCTION;
 
 public:
-  SectionMemoryManager() { }
+  /// Identifies a group of sections whose memory is released together.
+  typedef unsigned AllocationSetID;
+
+  /// Statistics about the memory of a SectionMemoryManager.
+  struct Statistics {
+    Statistics()
+        : NumSlabs(0), SlabBytes(0), PageBytes(0), SectionBytes(0),
+          ReleasedBytes(0) {}
+
+    /// The number of slabs mapped from the system, and their total size.
+    unsigned NumSlabs;
+    uint64_t SlabBytes;
+    /// The size of the pages held by the allocation sets not released yet.
+    uint64_t PageBytes;
+    /// The size requested for the sections of these allocation sets.
+    uint64_t SectionBytes;
+    /// The size of all the pages released so far.
+    uint64_t ReleasedBytes;
+  };
+
+  /// Create a memory manager mapping memory from the system in slabs of at
+  /// least \p SlabSize bytes, or of just the size each allocation needs if
+  /// \p SlabSize is zero. If \p HugePagesForCode is true, the slabs for code
+  /// are backed by huge pages where the system allows it, which is only
+  /// worthwhile with slabs of several megabytes.
+  explicit SectionMemoryManager(uintptr_t SlabSize = 0,
+                                bool HugePagesForCode = false)
+      : SlabSize(SlabSize), HugePagesForCode(HugePagesForCode),
+        CurrentSet(0), NextSet(1) {}
   virtual ~SectionMemoryManager();
 
+  /// \brief Start a new allocation set, which the sections allocated from now
+  /// on belong to, and return its ID.
+  ///
+  /// The sections allocated before the first call belong to an initial set.
+  AllocationSetID startAllocationSet();
+
+  /// \brief Release the memory of the sections of allocation set \p ID, so
+  /// that it can be reused for new sections.
+  ///
+  /// None of the code or data of the set may be in use anymore.
+  void releaseAllocationSet(AllocationSetID ID);
+
+  /// \brief Return statistics about the memory of this memory manager.
+  const Statistics &getStatistics() const { return Stats; }
+
   /// \brief Allocates a memory block of (at least) the given size suitable for
   /// executable code.
   ///
@@ -84,20 +136,44 @@ public:
 
 private:
   struct MemoryGroup {
+      /// The slabs mapped from the system.
       SmallVector<sys::MemoryBlock, 16> AllocatedMem;
+      /// The free space left in the pages of the current allocation set.
       SmallVector<sys::MemoryBlock, 16> FreeMem;
+      /// The pages allocated since memory was last finalized.
+      SmallVector<sys::MemoryBlock, 16> PendingMem;
+      /// The runs of free pages of the slabs, by start address. Free pages are
+      /// always read-write.
+      std::map<uintptr_t, uintptr_t> FreePages;
       sys::MemoryBlock Near;
   };
 
+  struct AllocationSet {
+    AllocationSet() : SectionBytes(0) {}
+    SmallVector<std::pair<MemoryGroup *, sys::MemoryBlock>, 4> Pages;
+    uint64_t SectionBytes;
+  };
+
   uint8_t *allocateSection(MemoryGroup &MemGroup, uintptr_t Size,
                            unsigned Alignment);
 
+  sys::MemoryBlock allocatePages(MemoryGroup &MemGroup, uintptr_t Size);
+  void releasePages(MemoryGroup &MemGroup, sys::MemoryBlock Pages);
+
   std::error_code applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                               unsigned Permissions);
 
+  uintptr_t SlabSize;
+  bool HugePagesForCode;
+
   MemoryGroup CodeMem;
   MemoryGroup RWDataMem;
   MemoryGroup RODataMem;
+
+  AllocationSetID CurrentSet;
+  AllocationSetID NextSet;
+  DenseMap<AllocationSetID, AllocationSet> AllocationSets;
+  Statistics Stats;
 };
 
 }
@@ -103,11 +103,22 @@ public:
   /// \brief Provide an overload for a Use.
   bool isReachableFromEntry(const Use &U) const;
 
+  /// \brief Update the tree after changes to the CFG.
+  ///
+  /// See DominatorTreeBase::applyUpdates. With -verify-dom-updates, the
+  /// updated tree is checked against a recalculated one.
+  void insertEdge(BasicBlock *From, BasicBlock *To);
+  void deleteEdge(BasicBlock *From, BasicBlock *To);
+  void applyUpdates(ArrayRef<UpdateType> Updates);
+
   /// \brief Verify the correctness of the domtree by re-computing it.
   ///
   /// This should only be used for debugging as it aborts the program if the
   /// verification fails.
   void verifyDomTree() const;
+
+private:
+  void verifyUpdates() const;
 };
 
 //===-------------------------------------
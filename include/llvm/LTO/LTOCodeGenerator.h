@@ -40,6 +40,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Linker/Linker.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Target/TargetOptions.h"
 #include <string>
 #include <vector>
@@ -73,6 +74,11 @@ struct LTOCodeGenerator {
   void setCpu(const char *mCpu) { MCpu = mCpu; }
   void setAttr(const char *mAttr) { MAttr = mAttr; }
 
+  // Set the number of code generation units that compile_to_files() splits
+  // the optimized merged module into. Each unit is compiled on its own thread
+  // into its own object file.
+  void setCodeGenParallelism(unsigned N) { Parallelism = N; }
+
   void addMustPreserveSymbol(const char *sym) { MustPreserveSymbols[sym] = 1; }
 
   // To pass options to the driver and optimization passes. These options are
@@ -114,6 +120,30 @@ struct LTOCodeGenerator {
                       bool disableGVNLoadPRE,
                       std::string &errMsg);
 
+  // As with compile_to_file(), but the merged module is compiled into one
+  // object file per code generation unit (see setCodeGenParallelism()). The
+  // paths to the object files are returned to the caller via "names", and
+  // their number via "count". The array of paths is owned by the
+  // LTOCodeGenerator. Return true on success.
+  //
+  // NOTE that, as with compile_to_file(), it is up to the linker to remove
+  //  the intermediate object files.
+  bool compile_to_files(const char ***names, unsigned *count,
+                        bool disableOpt,
+                        bool disableInline,
+                        bool disableGVNLoadPRE,
+                        std::string &errMsg);
+
+  // Optimize the merged module, split it into as many code generation units
+  // as there are streams in "outs" and write the object file for the i-th
+  // unit to outs[i]. The units are compiled in parallel, each in its own
+  // LLVMContext. Return true on success.
+  bool compileParallel(ArrayRef<raw_ostream *> outs,
+                       bool disableOpt,
+                       bool disableInline,
+                       bool disableGVNLoadPRE,
+                       std::string &errMsg);
+
   void setDiagnosticHandler(lto_diagnostic_handler_t, void *);
 
 private:
@@ -121,6 +151,10 @@ private:
 
   bool generateObjectFile(raw_ostream &out, bool disableOpt, bool disableInline,
                           bool disableGVNLoadPRE, std::string &errMsg);
+  bool optimize(bool disableOpt, bool disableInline, bool disableGVNLoadPRE,
+                std::string &errMsg);
+  bool compilePartition(StringRef bitcode, raw_ostream &out,
+                        std::string &errMsg);
   void applyScopeRestrictions();
   void applyRestriction(GlobalValue &GV, ArrayRef<StringRef> Libcalls,
                         std::vector<const char *> &MustPreserveList,
@@ -132,6 +166,9 @@ private:
 
   void DiagnosticHandler2(const DiagnosticInfo &DI);
 
+  static void PartitionDiagnosticHandler(const DiagnosticInfo &DI,
+                                         void *Context);
+
   typedef StringMap<uint8_t> StringSet;
 
   LLVMContext &Context;
@@ -147,9 +184,13 @@ private:
   std::string MCpu;
   std::string MAttr;
   std::string NativeObjectPath;
+  std::vector<std::string> NativeObjectPaths;
+  std::vector<const char *> NativeObjectPathPtrs;
   TargetOptions Options;
+  unsigned Parallelism;
   lto_diagnostic_handler_t DiagHandler;
   void *DiagContext;
+  sys::Mutex DiagMutex;
 };
 }
 #endif
@@ -10,7 +10,10 @@
 #ifndef LLVM_LINKER_LINKER_H
 #define LLVM_LINKER_LINKER_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/TinyPtrVector.h"
 #include <string>
 
 namespace llvm {
@@ -32,6 +35,33 @@ class Linker {
       PreserveSource = 1 // Preserve the source module.
     };
 
+    /// \brief The identified struct types of the composite. The ones that have
+    /// a body are also indexed by a hash of their shape, so that the struct
+    /// types of every module linked in are only compared with plausible
+    /// candidates. The index lives as long as the Linker, so the hashes of the
+    /// composite types are computed once for all the modules linked in.
+    class IdentifiedStructTypeSet {
+    public:
+      void insert(StructType *Ty);
+      bool count(StructType *Ty) const { return Types.count(Ty); }
+
+      /// \brief Index \p Ty, which just got its body.
+      void addBody(StructType *Ty);
+
+      /// \brief Return the types with a body whose shape hash is \p Hash.
+      ArrayRef<StructType *> lookup(unsigned Hash) const;
+
+      /// \brief Hash the shape of \p Ty: its packing and element types, where
+      /// nested identified structs only contribute their own shape down to a
+      /// fixed depth. Isomorphic types have the same hash unless opaque
+      /// types are involved.
+      static unsigned getShapeHash(StructType *Ty);
+
+    private:
+      SmallPtrSet<StructType*, 32> Types;
+      DenseMap<unsigned, TinyPtrVector<StructType*> > TypesByShape;
+    };
+
     Linker(Module *M, bool SuppressWarnings=false);
     ~Linker();
 
@@ -48,12 +78,27 @@ class Linker {
       return linkInModule(Src, Linker::DestroySource, ErrorMsg);
     }
 
+    /// \brief Link into the composite only the definitions it needs from
+    /// \p Srcs, which are typically loaded lazily.
+    ///
+    /// The declarations of the composite are resolved by name against the
+    /// definitions of \p Srcs, preferring strong definitions and otherwise the
+    /// first input defining a name, and everything these definitions refer to
+    /// is followed in turn. Only the function bodies that are found to be
+    /// needed are materialized. As with members of an archive, a source that
+    /// provides any needed definition also brings its appending variables,
+    /// such as its global constructors, but no named metadata. The other
+    /// sources are not linked at all. Sources that are linked are destroyed.
+    /// Returns true on error.
+    bool linkInNeededDefinitions(ArrayRef<Module *> Srcs,
+                                 std::string *ErrorMsg);
+
     static bool LinkModules(Module *Dest, Module *Src, unsigned Mode,
                             std::string *ErrorMsg);
 
   private:
     Module *Composite;
-    SmallPtrSet<StructType*, 32> IdentifiedStructTypes;
+    IdentifiedStructTypeSet IdentifiedStructTypes;
 
     bool SuppressWarnings;
 };
@@ -909,6 +909,10 @@ private:
   /// By default it's 0, which means bundling is disabled.
   unsigned BundleAlignSize;
 
+  /// \brief The number of threads the object writer may use to encode
+  /// relocation sections. 1 keeps it serial, 0 uses all cores.
+  unsigned RelocationThreads;
+
   unsigned RelaxAll : 1;
   unsigned NoExecStack : 1;
   unsigned SubsectionsViaSymbols : 1;
@@ -952,13 +956,29 @@ private:
   bool fragmentNeedsRelaxation(const MCRelaxableFragment *IF,
                                const MCAsmLayout &Layout) const;
 
+  /// The fragments of a section whose size may still change during layout,
+  /// in layout order.
+  typedef std::vector<MCFragment *> RelaxationWorklist;
+
+  /// \brief Collect the fragments of the given section that may need
+  /// relaxation.
+  void buildRelaxationWorklist(MCSectionData &SD,
+                               RelaxationWorklist &Worklist) const;
+
   /// \brief Perform one layout iteration and return true if any offsets
   /// were adjusted.
-  bool layoutOnce(MCAsmLayout &Layout);
+  bool layoutOnce(MCAsmLayout &Layout,
+                  std::vector<RelaxationWorklist> &Worklists);
 
-  /// \brief Perform one layout iteration of the given section and return true
-  /// if any offsets were adjusted.
-  bool layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD);
+  /// \brief Perform one layout iteration of the section whose candidates for
+  /// relaxation are in \p Worklist and return true if any offsets were
+  /// adjusted. Fragments that reached their final size are dropped from the
+  /// worklist.
+  bool layoutSectionOnce(MCAsmLayout &Layout, RelaxationWorklist &Worklist);
+
+  /// \brief Relax the given fragment if needed and return true if its size
+  /// changed.
+  bool relaxFragment(MCAsmLayout &Layout, MCFragment &F);
 
   bool relaxInstruction(MCAsmLayout &Layout, MCRelaxableFragment &IF);
 
@@ -1059,6 +1079,9 @@ public:
   bool getNoExecStack() const { return NoExecStack; }
   void setNoExecStack(bool Value) { NoExecStack = Value; }
 
+  unsigned getRelocationThreads() const { return RelocationThreads; }
+  void setRelocationThreads(unsigned Value) { RelocationThreads = Value; }
+
   bool isBundlingEnabled() const {
     return BundleAlignSize != 0;
   }
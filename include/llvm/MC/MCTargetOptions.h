@@ -31,6 +31,8 @@ public:
   bool ShowMCInst : 1;
   bool AsmVerbose : 1;
   int DwarfVersion;
+  /// Number of threads encoding ELF relocation sections (0 = all cores).
+  unsigned MCRelocationThreads;
   MCTargetOptions();
 };
 
@@ -45,7 +47,8 @@ inline bool operator==(const MCTargetOptions &LHS, const MCTargetOptions &RHS) {
           ARE_EQUAL(ShowMCEncoding) &&
           ARE_EQUAL(ShowMCInst) &&
           ARE_EQUAL(AsmVerbose) &&
-          ARE_EQUAL(DwarfVersion));
+          ARE_EQUAL(DwarfVersion) &&
+          ARE_EQUAL(MCRelocationThreads));
 #undef ARE_EQUAL
 }
 
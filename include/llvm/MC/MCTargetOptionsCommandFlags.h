@@ -36,6 +36,12 @@ cl::opt<bool> RelaxAll("mc-relax-all",
 cl::opt<int> DwarfVersion("dwarf-version", cl::desc("Dwarf version"),
                           cl::init(0));
 
+cl::opt<unsigned>
+RelocationThreads("elf-relocation-threads", cl::Hidden, cl::init(1),
+                  cl::desc("Number of threads sorting and encoding the "
+                           "relocation sections of an ELF object "
+                           "(0 = all cores)"));
+
 cl::opt<bool> ShowMCInst("asm-show-inst",
                          cl::desc("Emit internal instruction representation to "
                                   "assembly file"));
@@ -47,6 +53,7 @@ static inline MCTargetOptions InitMCTargetOptionsFromFlags() {
   Options.MCRelaxAll = RelaxAll;
   Options.DwarfVersion = DwarfVersion;
   Options.ShowMCInst = ShowMCInst;
+  Options.MCRelocationThreads = RelocationThreads;
   return Options;
 }
 
@@ -14,6 +14,7 @@
 #ifndef LLVM_OBJECT_ARCHIVE_H
 #define LLVM_OBJECT_ARCHIVE_H
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Object/Binary.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -127,6 +128,9 @@ public:
     uint32_t SymbolIndex;
     uint32_t StringIndex; // Extra index to the string.
 
+    friend class Archive;
+    ErrorOr<uint32_t> getMemberOffset() const;
+
   public:
     bool operator ==(const Symbol &other) const {
       return (Parent == other.Parent) && (SymbolIndex == other.SymbolIndex);
@@ -190,6 +194,11 @@ public:
   // check if a symbol is in the archive
   child_iterator findSym(StringRef name) const;
 
+  /// Build a hash table of the archive symbol table. Once it is built, findSym
+  /// no longer walks the symbol table, which is worth it for clients looking
+  /// up many symbols in large archives.
+  void buildSymbolIndex();
+
   bool hasSymbolTable() const;
 
 private:
@@ -197,6 +206,11 @@ private:
   child_iterator StringTable;
   child_iterator FirstRegular;
   Kind Format;
+
+  /// Maps every symbol to the offset of the member defining it, or to the
+  /// error reading that offset, once buildSymbolIndex has been called.
+  StringMap<ErrorOr<uint32_t>> SymbolIndex;
+  bool HasSymbolIndex;
 };
 
 }
@@ -17,7 +17,11 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ProfileData/InstrProf.h"
+#include "llvm/Support/AlignOf.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Host.h"
 #include "llvm/Support/LineIterator.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/EndianStream.h"
@@ -208,8 +212,12 @@ enum class HashT : uint32_t;
 class InstrProfLookupTrait {
   std::vector<uint64_t> DataBuffer;
   IndexedInstrProf::HashT HashType;
+  uint64_t FormatVersion;
+  const unsigned char *Base;
 public:
-  InstrProfLookupTrait(IndexedInstrProf::HashT HashType) : HashType(HashType) {}
+  InstrProfLookupTrait(IndexedInstrProf::HashT HashType, uint64_t FormatVersion,
+                       const unsigned char *Base)
+      : HashType(HashType), FormatVersion(FormatVersion), Base(Base) {}
 
   struct data_type {
     data_type(StringRef Name, ArrayRef<uint64_t> Data)
@@ -241,14 +249,29 @@ public:
 
   data_type ReadData(StringRef K, const unsigned char *D, offset_type N) {
     DataBuffer.clear();
+    // Since version 3, the data is padded to start at an aligned offset.
+    if (FormatVersion >= 3) {
+      offset_type Padding = -(uint64_t)(D - Base) % sizeof(uint64_t);
+      if (Padding > N)
+        return data_type("", DataBuffer);
+      D += Padding;
+      N -= Padding;
+    }
     if (N % sizeof(uint64_t))
       // The data is corrupt, don't try to read it.
       return data_type("", DataBuffer);
 
-    using namespace support;
     // We just treat the data as opaque here. It's simpler to handle in
     // IndexedInstrProfReader.
     unsigned NumEntries = N / sizeof(uint64_t);
+    // If the data is aligned and in host byte order, refer to it in place.
+    if (sys::IsLittleEndianHost &&
+        reinterpret_cast<uintptr_t>(D) % alignOf<uint64_t>() == 0)
+      return data_type(K, makeArrayRef(
+                              reinterpret_cast<const uint64_t *>(D),
+                              NumEntries));
+
+    using namespace support;
     DataBuffer.reserve(NumEntries);
     for (unsigned I = 0; I < NumEntries; ++I)
       DataBuffer.push_back(endian::readNext<uint64_t, little, unaligned>(D));
@@ -273,6 +296,15 @@ private:
   uint64_t FormatVersion;
   /// The maximal execution count among all functions.
   uint64_t MaxFunctionCount;
+  /// The data of the functions looked up so far, by name. The data is empty
+  /// for functions that are not in the profile.
+  StringMap<ArrayRef<uint64_t>> FunctionDataCache;
+  /// Holds the data of FunctionDataCache that cannot refer to DataBuffer
+  /// directly, because it is misaligned or not in host byte order.
+  BumpPtrAllocator FunctionDataAllocator;
+
+  /// Find the data of the function FuncName, and cache it.
+  ArrayRef<uint64_t> getFunctionData(StringRef FuncName);
 
   IndexedInstrProfReader(const IndexedInstrProfReader &) LLVM_DELETED_FUNCTION;
   IndexedInstrProfReader &operator=(const IndexedInstrProfReader &)
@@ -292,6 +324,10 @@ public:
   /// Fill Counts with the profile data for the given function name.
   std::error_code getFunctionCounts(StringRef FuncName, uint64_t FuncHash,
                                     std::vector<uint64_t> &Counts);
+  /// Set Counts to the profile data for the given function name, without
+  /// copying it. Counts stays valid as long as the reader.
+  std::error_code getFunctionCounts(StringRef FuncName, uint64_t FuncHash,
+                                    ArrayRef<uint64_t> &Counts);
   /// Return the maximum of all known function counts.
   uint64_t getMaximumFunctionCount() { return MaxFunctionCount; }
 
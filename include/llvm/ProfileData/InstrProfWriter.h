@@ -17,6 +17,7 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ProfileData/InstrProf.h"
 #include "llvm/Support/DataTypes.h"
@@ -30,18 +31,31 @@ namespace llvm {
 class InstrProfWriter {
 public:
   typedef SmallDenseMap<uint64_t, std::vector<uint64_t>, 1> CounterData;
+  typedef StringMap<CounterData>::const_iterator const_iterator;
 private:
   StringMap<CounterData> FunctionData;
   uint64_t MaxFunctionCount;
 public:
   InstrProfWriter() : MaxFunctionCount(0) {}
 
-  /// Add function counts for the given function. If there are already counts
-  /// for this function and the hash and number of counts match, each counter is
-  /// summed.
+  /// Add function counts for the given function, each multiplied by
+  /// \p Weight. If there are already counts for this function and the hash and
+  /// number of counts match, each counter is summed.
   std::error_code addFunctionCounts(StringRef FunctionName,
                                     uint64_t FunctionHash,
-                                    ArrayRef<uint64_t> Counters);
+                                    ArrayRef<uint64_t> Counters,
+                                    uint64_t Weight = 1);
+  /// Add all the function counts of \p IPW, which is left empty. Records that
+  /// cannot be merged are reported to \p Warn and skipped.
+  void mergeRecordsFromWriter(
+      InstrProfWriter &IPW,
+      function_ref<void(StringRef FunctionName, uint64_t FunctionHash,
+                        std::error_code EC)> Warn);
+  /// Return the number of functions with counts in this writer.
+  size_t getNumFunctions() const { return FunctionData.size(); }
+  /// Iterate over the functions with counts, in no particular order.
+  const_iterator begin() const { return FunctionData.begin(); }
+  const_iterator end() const { return FunctionData.end(); }
   /// Ensure that all data is written to disk.
   void write(raw_fd_ostream &OS);
 };
@@ -18,6 +18,7 @@
 #ifndef LLVM_SUPPORT_GENERICDOMTREE_H
 #define LLVM_SUPPORT_GENERICDOMTREE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/GraphTraits.h"
@@ -570,6 +571,219 @@ public:
       this->Split<NodeT*, GraphTraits<NodeT*> >(*this, NewBB);
   }
 
+  /// UpdateKind - Whether an edge was inserted into or deleted from the CFG.
+  enum UpdateKind { Insert, Delete };
+
+  /// UpdateType - An edge of the CFG which was inserted or deleted, as given
+  /// to applyUpdates.
+  struct UpdateType {
+    UpdateKind Kind;
+    NodeT *From;
+    NodeT *To;
+
+    UpdateType(UpdateKind Kind, NodeT *From, NodeT *To)
+      : Kind(Kind), From(From), To(To) {}
+  };
+
+  /// insertEdge - Update the tree after the edge From -> To was inserted into
+  /// the CFG. To may be a block which was unreachable, or a new block.
+  void insertEdge(NodeT *From, NodeT *To) {
+    applyUpdates(UpdateType(Insert, From, To));
+  }
+
+  /// deleteEdge - Update the tree after the edge From -> To was deleted from
+  /// the CFG. The blocks which become unreachable are removed from the tree.
+  void deleteEdge(NodeT *From, NodeT *To) {
+    applyUpdates(UpdateType(Delete, From, To));
+  }
+
+  /// applyUpdates - Update the tree after the edges in Updates were inserted
+  /// into or deleted from the CFG, which must reflect all of them already.
+  ///
+  /// Only the dominators of the blocks in the subtree of the nearest common
+  /// dominator of the updated edges can change, and only edges from outside
+  /// of the subtree to its root can enter it. The immediate dominators of the
+  /// subtree, together with the blocks which become reachable, are computed
+  /// again with the iterative algorithm of Cooper, Harvey and Kennedy, so the
+  /// cost of an update is linear in the size of that subtree rather than of
+  /// the function. Giving all the edges changed by a transformation at once
+  /// visits the subtree once. Post-dominator trees are recalculated.
+  void applyUpdates(ArrayRef<UpdateType> Updates) {
+    if (Updates.empty())
+      return;
+    if (this->IsPostDominators) {
+      recalculate(*Updates[0].From->getParent());
+      return;
+    }
+
+    typedef GraphTraits<NodeT*> GraphT;
+    typedef typename GraphT::ChildIteratorType ChildIteratorType;
+
+    // A single update often changes nothing: an inserted edge whose target is
+    // already dominated by the nearest common dominator of its ends, or a
+    // deleted edge to a block dominating its source.
+    if (Updates.size() == 1) {
+      DomTreeNodeBase<NodeT> *FromNode = getNode(Updates[0].From);
+      DomTreeNodeBase<NodeT> *ToNode = getNode(Updates[0].To);
+      if (!FromNode || (!ToNode && Updates[0].Kind == Delete))
+        return;
+      if (ToNode) {
+        DomTreeNodeBase<NodeT> *NCD =
+          getNode(findNearestCommonDominator(Updates[0].From, Updates[0].To));
+        if (NCD == ToNode ||
+            (Updates[0].Kind == Insert && NCD == ToNode->getIDom()))
+          return;
+      }
+    }
+
+    // Find the root of the subtree to compute again, and the blocks which were
+    // unreachable and become reachable. An edge from an unreachable block can
+    // only matter if another update makes the block reachable, and it is then
+    // found while walking the blocks which become reachable.
+    DomTreeNodeBase<NodeT> *Top = nullptr;
+    SmallVector<NodeT*, 8> NewBlocks;
+    SmallPtrSet<NodeT*, 8> IsNewBlock;
+    for (unsigned i = 0, e = Updates.size(); i != e; ++i) {
+      DomTreeNodeBase<NodeT> *FromNode = getNode(Updates[i].From);
+      if (!FromNode)
+        continue;
+      Top = getNearestCommonDominator(Top, FromNode);
+      if (DomTreeNodeBase<NodeT> *ToNode = getNode(Updates[i].To))
+        Top = getNearestCommonDominator(Top, ToNode);
+      else if (Updates[i].Kind == Insert && IsNewBlock.insert(Updates[i].To))
+        NewBlocks.push_back(Updates[i].To);
+    }
+    if (!Top)
+      return;
+
+    // The blocks reachable from the new ones may have edges back into the
+    // tree, which can change the dominators of their targets too.
+    for (unsigned i = 0; i != NewBlocks.size(); ++i)
+      for (ChildIteratorType SI = GraphT::child_begin(NewBlocks[i]),
+             SE = GraphT::child_end(NewBlocks[i]); SI != SE; ++SI) {
+        NodeT *Succ = *SI;
+        if (DomTreeNodeBase<NodeT> *SuccNode = getNode(Succ))
+          Top = getNearestCommonDominator(Top, SuccNode);
+        else if (IsNewBlock.insert(Succ))
+          NewBlocks.push_back(Succ);
+      }
+
+    // Number the blocks reachable from Top in postorder, without leaving the
+    // old subtree of Top and the new blocks: edges from elsewhere can only
+    // reach Top. The blocks of the subtree which are not reached become
+    // unreachable, and their successors outside of the subtree lose a
+    // predecessor, so Top is widened until it dominates them.
+    NodeT *TopBB;
+    SmallVector<DomTreeNodeBase<NodeT>*, 32> Subtree;
+    SmallPtrSet<NodeT*, 32> InSubtree;
+    DenseMap<NodeT*, unsigned> PostNumber;
+    SmallVector<NodeT*, 32> PostOrder;
+    SmallVector<std::pair<NodeT*, ChildIteratorType>, 32> DFSStack;
+    while (true) {
+      Subtree.clear();
+      InSubtree.clear();
+      Subtree.push_back(Top);
+      for (unsigned i = 0; i != Subtree.size(); ++i) {
+        InSubtree.insert(Subtree[i]->getBlock());
+        Subtree.append(Subtree[i]->begin(), Subtree[i]->end());
+      }
+
+      TopBB = Top->getBlock();
+      PostNumber.clear();
+      PostOrder.clear();
+      PostNumber[TopBB] = ~0U;
+      DFSStack.push_back(std::make_pair(TopBB, GraphT::child_begin(TopBB)));
+      while (!DFSStack.empty()) {
+        NodeT *BB = DFSStack.back().first;
+        ChildIteratorType &SI = DFSStack.back().second;
+        if (SI == GraphT::child_end(BB)) {
+          PostNumber[BB] = PostOrder.size();
+          PostOrder.push_back(BB);
+          DFSStack.pop_back();
+          continue;
+        }
+        NodeT *Succ = *SI;
+        ++SI;
+        if ((InSubtree.count(Succ) || IsNewBlock.count(Succ)) &&
+            PostNumber.insert(std::make_pair(Succ, ~0U)).second)
+          DFSStack.push_back(std::make_pair(Succ, GraphT::child_begin(Succ)));
+      }
+
+      DomTreeNodeBase<NodeT> *NewTop = Top;
+      for (unsigned i = 0, e = Subtree.size(); i != e; ++i) {
+        NodeT *BB = Subtree[i]->getBlock();
+        if (PostNumber.count(BB))
+          continue;
+        for (ChildIteratorType SI = GraphT::child_begin(BB),
+               SE = GraphT::child_end(BB); SI != SE; ++SI)
+          if (!InSubtree.count(*SI))
+            if (DomTreeNodeBase<NodeT> *SuccNode = getNode(*SI))
+              NewTop = getNearestCommonDominator(NewTop, SuccNode);
+      }
+      if (NewTop == Top)
+        break;
+      Top = NewTop;
+    }
+
+    // Compute the immediate dominators in reverse postorder until they settle.
+    DenseMap<NodeT*, NodeT*> NewIDoms;
+    NewIDoms[TopBB] = TopBB;
+    bool Changed = true;
+    while (Changed) {
+      Changed = false;
+      for (unsigned i = PostOrder.size() - 1; i-- != 0;) {
+        NodeT *BB = PostOrder[i];
+        NodeT *NewIDom = nullptr;
+        typedef GraphTraits<Inverse<NodeT*> > InvTraits;
+        for (typename InvTraits::ChildIteratorType
+               PI = InvTraits::child_begin(BB), PE = InvTraits::child_end(BB);
+             PI != PE; ++PI) {
+          NodeT *Pred = *PI;
+          if (!NewIDoms.count(Pred))
+            continue;
+          if (!NewIDom) {
+            NewIDom = Pred;
+            continue;
+          }
+          // Walk up from both blocks to their nearest common dominator.
+          while (Pred != NewIDom) {
+            while (PostNumber[Pred] < PostNumber[NewIDom])
+              Pred = NewIDoms[Pred];
+            while (PostNumber[NewIDom] < PostNumber[Pred])
+              NewIDom = NewIDoms[NewIDom];
+          }
+        }
+        NodeT *&IDom = NewIDoms[BB];
+        if (IDom != NewIDom) {
+          IDom = NewIDom;
+          Changed = true;
+        }
+      }
+    }
+
+    // Update the tree in reverse postorder, so that every new block gets its
+    // node after the node of its immediate dominator.
+    DFSInfoValid = false;
+    for (unsigned i = PostOrder.size() - 1; i-- != 0;) {
+      NodeT *BB = PostOrder[i];
+      DomTreeNodeBase<NodeT> *IDomNode = getNode(NewIDoms[BB]);
+      if (DomTreeNodeBase<NodeT> *Node = getNode(BB)) {
+        if (Node->getIDom() != IDomNode)
+          Node->setIDom(IDomNode);
+      } else {
+        addNewBlock(BB, NewIDoms[BB]);
+      }
+    }
+
+    // The blocks of the old subtree which were not reached are unreachable.
+    // Their children are unreachable too, and are erased first.
+    for (unsigned i = Subtree.size(); i-- != 0;) {
+      NodeT *BB = Subtree[i]->getBlock();
+      if (!PostNumber.count(BB))
+        eraseNode(BB);
+    }
+  }
+
   /// print - Convert to human readable form
   ///
   void print(raw_ostream &o) const {
@@ -668,6 +882,15 @@ protected:
     return IDoms.lookup(BB);
   }
 
+  /// getNearestCommonDominator - Return the nearest common dominator of the
+  /// nodes A, which may be null, and B.
+  DomTreeNodeBase<NodeT> *getNearestCommonDominator(DomTreeNodeBase<NodeT> *A,
+                                                    DomTreeNodeBase<NodeT> *B) {
+    if (!A)
+      return B;
+    return getNode(findNearestCommonDominator(A->getBlock(), B->getBlock()));
+  }
+
   inline void addRoot(NodeT* BB) {
     this->Roots.push_back(BB);
   }
@@ -47,7 +47,10 @@ namespace sys {
     enum ProtectionFlags {
       MF_READ  = 0x1000000,
       MF_WRITE = 0x2000000,
-      MF_EXEC  = 0x4000000
+      MF_EXEC  = 0x4000000,
+      /// A hint to back the memory with huge pages where the system allows
+      /// it. Only allocateMappedMemory takes it into account.
+      MF_HUGE_HINT = 0x0000001
     };
 
     /// This method allocates a block of memory that is suitable for loading
@@ -58,7 +61,8 @@ namespace sys {
     /// The actual allocated address is not guaranteed to be near the requested
     /// address.
     /// \p Flags is used to set the initial protection flags for the block
-    /// of the memory.
+    /// of the memory. With MF_HUGE_HINT, a large enough block is aligned to
+    /// the huge page size and the system is asked to back it with huge pages.
     /// \p EC [out] returns an object describing any error that occurs.
     ///
     /// This method may allocate more than the number of bytes requested.  The
@@ -0,0 +1,215 @@
+//===-- llvm/Support/ThreadPool.h - A work-stealing thread pool -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the llvm::ThreadPool class, a work-stealing pool of
+// worker threads, together with TaskGroup, which waits for a subset of the
+// tasks of a pool, and PerThreadAllocator, which gives every thread of a pool
+// its own bump allocator.
+//
+// Tools that let the user choose the number of threads should do so with a
+// -threads=N option, where N = 0 (the default) means one thread per hardware
+// thread, and pass N to the ThreadPool constructor unchanged.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/ThreadLocal.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace llvm {
+
+/// ThreadPool - A pool of worker threads running tasks asynchronously.
+///
+/// Every worker owns a queue of tasks. A task submitted by a worker goes to
+/// that worker's queue, which it runs in LIFO order so that nested parallelism
+/// stays cache friendly. Tasks submitted from other threads are distributed
+/// round-robin over the workers. A worker whose queue is empty steals the
+/// oldest task of another worker.
+///
+/// If LLVM is built without thread support, tasks run synchronously when they
+/// are submitted.
+class ThreadPool {
+public:
+  typedef std::function<void()> TaskTy;
+
+  /// Construct a pool with \p ThreadCount worker threads. A count of zero
+  /// means one worker per hardware thread.
+  explicit ThreadPool(unsigned ThreadCount = 0);
+
+  /// Wait for all the submitted tasks to finish, then join the workers.
+  ~ThreadPool();
+
+  /// Submit \p F, called with \p ArgList, to run asynchronously. The returned
+  /// future becomes ready, with the result of the call, once it has run.
+  template <typename Function, typename... Args>
+  std::future<typename std::result_of<Function(Args...)>::type>
+  async(Function &&F, Args &&... ArgList) {
+    typedef typename std::result_of<Function(Args...)>::type ResultTy;
+    auto Task = std::make_shared<std::packaged_task<ResultTy()>>(
+        std::bind(std::forward<Function>(F), std::forward<Args>(ArgList)...));
+    std::future<ResultTy> Future = Task->get_future();
+    enqueue([Task]() { (*Task)(); });
+    return Future;
+  }
+
+  /// Wait until all the tasks submitted so far have finished. This must not
+  /// be called from one of the workers of the pool; use a TaskGroup to wait
+  /// from within a task.
+  void wait();
+
+  /// If a task is waiting to run, run it on the calling thread and return
+  /// true. Return false if there is nothing to run.
+  bool runPendingTask();
+
+  /// Return the number of worker threads of the pool.
+  unsigned getThreadCount() const { return ThreadCount; }
+
+  /// Return a number identifying the calling thread within the pool: the
+  /// workers are numbered from 1 to getThreadCount(), and any other thread
+  /// gets 0.
+  unsigned getThreadIndex();
+
+private:
+  struct Worker {
+    unsigned Index;
+    std::mutex Lock;
+    std::deque<TaskTy> Tasks;
+  };
+
+  void enqueue(TaskTy Task);
+  bool popTask(unsigned Self, TaskTy &Task);
+  void finishTask();
+  void work(Worker &Self);
+
+  /// Run pending tasks on the calling thread until \p Done returns true,
+  /// blocking while there is nothing to run. \p Done is checked again
+  /// whenever a task of the pool finishes, with the queue lock held.
+  void runTasksUntil(const std::function<bool()> &Done);
+
+  friend class TaskGroup;
+
+  unsigned ThreadCount;
+
+#if LLVM_ENABLE_THREADS != 0
+  std::vector<std::unique_ptr<Worker>> Workers;
+  std::vector<std::thread> Threads;
+
+  /// The worker running on the current thread, if any.
+  sys::ThreadLocal<const Worker> CurrentWorker;
+
+  /// Protects QueuedTasks, ActiveTasks and EnableFlag, and goes with the
+  /// condition variables.
+  std::mutex QueueLock;
+  std::condition_variable QueueCondition;
+  std::condition_variable CompletionCondition;
+
+  /// Signalled when a task is queued or finishes while a thread is blocked in
+  /// runTasksUntil, of which there are WaitingHelpers.
+  std::condition_variable ProgressCondition;
+  unsigned WaitingHelpers;
+
+  /// Number of tasks sitting in the queues of the workers.
+  std::atomic<unsigned> QueuedTasks;
+
+  /// Number of tasks submitted but not finished yet.
+  unsigned ActiveTasks;
+
+  /// Worker whose queue receives the next task submitted from outside.
+  std::atomic<unsigned> NextWorker;
+
+  /// Cleared by the destructor to tell the workers to exit.
+  bool EnableFlag;
+#endif
+};
+
+/// TaskGroup - A set of tasks that run on a ThreadPool and can be waited for
+/// independently of the other tasks of the pool. Unlike ThreadPool::wait(),
+/// sync() may be called from within a task: while it waits, the calling
+/// thread runs pending tasks of the pool, so nested groups do not deadlock.
+class TaskGroup {
+public:
+  explicit TaskGroup(ThreadPool &Pool) : Pool(Pool), PendingTasks(0) {}
+
+  /// Wait for the tasks of the group to finish.
+  ~TaskGroup() { sync(); }
+
+  /// Run \p F asynchronously as part of this group.
+  void spawn(std::function<void()> F);
+
+  /// Wait until all the tasks spawned in this group have finished.
+  void sync();
+
+private:
+  TaskGroup(const TaskGroup &) LLVM_DELETED_FUNCTION;
+  void operator=(const TaskGroup &) LLVM_DELETED_FUNCTION;
+
+  ThreadPool &Pool;
+  std::atomic<unsigned> PendingTasks;
+};
+
+/// PerThreadAllocator - One allocator for every thread of a ThreadPool, so
+/// that tasks can allocate without taking a lock. Memory handed out to any of
+/// the threads stays valid until the PerThreadAllocator is reset or destroyed.
+///
+/// Threads that are not workers of the pool share a single allocator, so only
+/// one of them may allocate at a time.
+template <typename AllocatorT = BumpPtrAllocator>
+class PerThreadAllocator {
+public:
+  explicit PerThreadAllocator(ThreadPool &Pool)
+      : Pool(Pool), NumAllocators(Pool.getThreadCount() + 1),
+        Allocators(new AllocatorT[NumAllocators]) {}
+
+  /// Return the allocator of the calling thread.
+  AllocatorT &get() { return Allocators[Pool.getThreadIndex()]; }
+
+  void *Allocate(size_t Size, size_t Alignment) {
+    return get().Allocate(Size, Alignment);
+  }
+
+  template <typename T> T *Allocate(size_t Num = 1) {
+    return get().template Allocate<T>(Num);
+  }
+
+  /// Release all the memory of all the threads. No task of the pool may be
+  /// using the allocator at this point.
+  void Reset() {
+    for (unsigned I = 0; I != NumAllocators; ++I)
+      Allocators[I].Reset();
+  }
+
+  size_t getTotalMemory() const {
+    size_t TotalMemory = 0;
+    for (unsigned I = 0; I != NumAllocators; ++I)
+      TotalMemory += Allocators[I].getTotalMemory();
+    return TotalMemory;
+  }
+
+private:
+  ThreadPool &Pool;
+  unsigned NumAllocators;
+  std::unique_ptr<AllocatorT[]> Allocators;
+};
+
+} // end namespace llvm
+
+#endif
@@ -150,6 +150,25 @@ public:
 
   /// populateModulePassManager - This sets up the primary pass manager.
   void populateModulePassManager(PassManagerBase &MPM);
+
+  /// Above -O0, populateModulePassManager adds the analyses of
+  /// populateAnalysisPasses followed by the four stages below, in order.
+  /// Clients running the CallGraph SCC stage themselves, as opt -threads
+  /// does, populate the stages separately; every pass manager they fill needs
+  /// populateAnalysisPasses first.
+  void populateAnalysisPasses(PassManagerBase &PM);
+  /// populateModuleSimplificationPasses - The interprocedural passes run
+  /// before the CallGraph SCC passes.
+  void populateModuleSimplificationPasses(PassManagerBase &MPM);
+  /// populateCGSCCPasses - The CallGraph SCC passes, the inliner among them.
+  void populateCGSCCPasses(PassManagerBase &MPM);
+  /// populateFunctionSimplificationPasses - The function passes run on every
+  /// SCC right after the CallGraph SCC passes.
+  void populateFunctionSimplificationPasses(PassManagerBase &PM);
+  /// populateModuleOptimizationPasses - The passes run once every SCC has
+  /// been simplified.
+  void populateModuleOptimizationPasses(PassManagerBase &MPM);
+
   void populateLTOPassManager(PassManagerBase &PM, TargetMachine *TM = nullptr);
 };
 
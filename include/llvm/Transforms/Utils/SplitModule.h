@@ -0,0 +1,54 @@
+//===- SplitModule.h - Split a module into partitions -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the function llvm::SplitModule, which splits a module
+// into multiple linkable partitions. It can be used to implement parallel code
+// generation for link-time optimization.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+#define LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+
+#include <functional>
+#include <memory>
+
+namespace llvm {
+
+class Module;
+
+/// Split the module \p M into \p N linkable partitions. \p M is left
+/// unmodified; the function \p ModuleCallback is called N times, once for each
+/// partition, in partition order.
+///
+/// Every definition in \p M is placed into exactly one partition and is
+/// turned into a declaration in all of the others. Definitions are grouped so
+/// that each partition links on its own:
+///  - all members of a comdat end up in the same partition;
+///  - an alias ends up in the same partition as its aliasee.
+/// A local (internal or private) definition that ends up referenced from
+/// another partition is promoted to a hidden global with a name that is
+/// unique in \p M, in every partition. If \p PreserveLocals is set, locals are
+/// never promoted; instead each one ends up in the same partition as every
+/// definition that refers to it.
+/// Local unnamed_addr constants that do not refer to other globals are cheap
+/// to duplicate, so a copy of them is kept in every partition that uses them.
+/// The groups are then distributed over the partitions, largest first, to
+/// balance the number of instructions in each partition.
+///
+/// Linking the N partitions together gives a module that is equivalent to
+/// \p M, except for the linkage of the promoted locals.
+void SplitModule(const Module &M, unsigned N,
+                 std::function<void(std::unique_ptr<Module> MPart)>
+                     ModuleCallback,
+                 bool PreserveLocals = false);
+
+} // End llvm namespace
+
+#endif
@@ -82,6 +82,16 @@ void AliasAnalysis::addEscapingUse(Use &U) {
   AA->addEscapingUse(U);
 }
 
+void AliasAnalysis::beginQueryCaching() {
+  assert(AA && "AA didn't call InitializeAliasAnalysis in its run method!");
+  AA->beginQueryCaching();
+}
+
+void AliasAnalysis::endQueryCaching() {
+  assert(AA && "AA didn't call InitializeAliasAnalysis in its run method!");
+  AA->endQueryCaching();
+}
+
 
 AliasAnalysis::ModRefResult
 AliasAnalysis::getModRefInfo(ImmutableCallSite CS,
@@ -16,6 +16,7 @@
 #include "llvm/Analysis/Passes.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AssumptionTracker.h"
 #include "llvm/Analysis/CFG.h"
@@ -36,12 +37,20 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include <algorithm>
 using namespace llvm;
 
+#define DEBUG_TYPE "basicaa"
+
+STATISTIC(NumQueryCacheHits, "Number of alias queries answered from the cache");
+STATISTIC(NumQueryCacheMisses, "Number of alias queries missing the cache");
+STATISTIC(NumGEPCacheHits, "Number of GEP decompositions found in the cache");
+STATISTIC(NumGEPCacheMisses, "Number of GEP decompositions missing the cache");
+
 /// Cutoff after which to stop analysing a set of phi nodes potentially involved
 /// in a cycle. Because we are analysing 'through' phi nodes we need to be
 /// careful with value equivalence. We use reachability to make sure a value
@@ -447,7 +456,8 @@ namespace {
   /// BasicAliasAnalysis - This is the primary alias analysis implementation.
   struct BasicAliasAnalysis : public ImmutablePass, public AliasAnalysis {
     static char ID; // Class identification, replacement for typeinfo
-    BasicAliasAnalysis() : ImmutablePass(ID) {
+    BasicAliasAnalysis()
+        : ImmutablePass(ID), QueryCachingDepth(0), QueryCacheStale(false) {
       initializeBasicAliasAnalysisPass(*PassRegistry::getPassRegistry());
     }
 
@@ -465,6 +475,20 @@ namespace {
       assert(AliasCache.empty() && "AliasCache must be cleared after use!");
       assert(notDifferentParent(LocA.Ptr, LocB.Ptr) &&
              "BasicAliasAnalysis doesn't support interprocedural queries.");
+      LocPair Locs(LocA, LocB);
+      if (QueryCachingDepth) {
+        if (QueryCacheStale)
+          flushQueryCache();
+        if (Locs.first.Ptr > Locs.second.Ptr)
+          std::swap(Locs.first, Locs.second);
+        DenseMap<LocPair, AliasResult>::iterator I = QueryCache.find(Locs);
+        if (I != QueryCache.end()) {
+          ++NumQueryCacheHits;
+          return I->second;
+        }
+        ++NumQueryCacheMisses;
+      }
+
       AliasResult Alias = aliasCheck(LocA.Ptr, LocA.Size, LocA.AATags,
                                      LocB.Ptr, LocB.Size, LocB.AATags);
       // AliasCache rarely has more than 1 or 2 elements, always use
@@ -473,9 +497,33 @@ namespace {
       // FIXME: This should really be shrink_to_inline_capacity_and_clear().
       AliasCache.shrink_and_clear();
       VisitedPhiBBs.clear();
+
+      if (QueryCachingDepth) {
+        trackQueryCacheValue(LocA.Ptr);
+        trackQueryCacheValue(LocB.Ptr);
+        QueryCache[Locs] = Alias;
+      }
       return Alias;
     }
 
+    void addEscapingUse(Use &U) override {
+      // A new escaping use can make pointers which did not alias alias.
+      QueryCacheStale = true;
+      AliasAnalysis::addEscapingUse(U);
+    }
+
+    void beginQueryCaching() override {
+      ++QueryCachingDepth;
+      AliasAnalysis::beginQueryCaching();
+    }
+
+    void endQueryCaching() override {
+      assert(QueryCachingDepth && "Unbalanced endQueryCaching!");
+      if (!--QueryCachingDepth)
+        flushQueryCache();
+      AliasAnalysis::endQueryCaching();
+    }
+
     ModRefResult getModRefInfo(ImmutableCallSite CS,
                                const Location &Loc) override;
 
@@ -514,6 +562,64 @@ namespace {
     typedef SmallDenseMap<LocPair, AliasResult, 8> AliasCacheTy;
     AliasCacheTy AliasCache;
 
+    /// QueryCacheVH - Marks the query caches stale when a value they refer to
+    /// is deleted or replaced, so that its entries are not mistaken for
+    /// entries of a new value allocated at the same address.
+    class QueryCacheVH : public CallbackVH {
+      BasicAliasAnalysis *BAA;
+
+      void deleted() override {
+        BAA->QueryCacheStale = true;
+        setValPtr(nullptr);
+      }
+      void allUsesReplacedWith(Value *) override {
+        BAA->QueryCacheStale = true;
+      }
+
+    public:
+      QueryCacheVH(const Value *V, BasicAliasAnalysis *BAA)
+          : CallbackVH(const_cast<Value *>(V)), BAA(BAA) {}
+    };
+
+    /// DecomposedGEP - The result of DecomposeGEPExpression on a pointer.
+    struct DecomposedGEP {
+      const Value *Base;
+      int64_t Offset;
+      SmallVector<VariableGEPIndex, 4> VarIndices;
+      bool MaxLookupReached;
+    };
+
+    /// The number of nested beginQueryCaching calls. While it is non-zero,
+    /// the results of queries and of GEP decompositions are kept in
+    /// QueryCache and GEPCache.
+    unsigned QueryCachingDepth;
+    /// Set when a value the caches refer to changes; the caches are flushed
+    /// before the next query.
+    bool QueryCacheStale;
+    DenseMap<LocPair, AliasResult> QueryCache;
+    DenseMap<const Value *, DecomposedGEP> GEPCache;
+    DenseMap<const Value *, QueryCacheVH> QueryCacheHandles;
+
+    void trackQueryCacheValue(const Value *V) {
+      if (!QueryCacheHandles.count(V))
+        QueryCacheHandles.insert(std::make_pair(V, QueryCacheVH(V, this)));
+    }
+
+    void flushQueryCache() {
+      QueryCache.clear();
+      GEPCache.clear();
+      QueryCacheHandles.clear();
+      QueryCacheStale = false;
+    }
+
+    /// decomposeGEPExpression - Call DecomposeGEPExpression, or reuse its
+    /// result for V while query caching is enabled.
+    const Value *
+    decomposeGEPExpression(const Value *V, int64_t &BaseOffs,
+                           SmallVectorImpl<VariableGEPIndex> &VarIndices,
+                           bool &MaxLookupReached, AssumptionTracker *AT,
+                           DominatorTree *DT);
+
     /// \brief Track phi nodes we have visited. When interpret "Value" pointer
     /// equality as value equality we need to make sure that the "Value" is not
     /// part of a cycle. Otherwise, two uses could come from different
@@ -921,11 +1027,11 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
         bool GEP2MaxLookupReached;
         SmallVector<VariableGEPIndex, 4> GEP2VariableIndices;
         const Value *GEP2BasePtr =
-          DecomposeGEPExpression(GEP2, GEP2BaseOffset, GEP2VariableIndices,
-                                 GEP2MaxLookupReached, DL, AT, DT);
+          decomposeGEPExpression(GEP2, GEP2BaseOffset, GEP2VariableIndices,
+                                 GEP2MaxLookupReached, AT, DT);
         const Value *GEP1BasePtr =
-          DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices,
-                                 GEP1MaxLookupReached, DL, AT, DT);
+          decomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices,
+                                 GEP1MaxLookupReached, AT, DT);
         // DecomposeGEPExpression and GetUnderlyingObject should return the
         // same result except when DecomposeGEPExpression has no DataLayout.
         if (GEP1BasePtr != UnderlyingV1 || GEP2BasePtr != UnderlyingV2) {
@@ -953,15 +1059,15 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
     // exactly, see if the computed offset from the common pointer tells us
     // about the relation of the resulting pointer.
     const Value *GEP1BasePtr =
-      DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices,
-                             GEP1MaxLookupReached, DL, AT, DT);
+      decomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices,
+                             GEP1MaxLookupReached, AT, DT);
 
     int64_t GEP2BaseOffset;
     bool GEP2MaxLookupReached;
     SmallVector<VariableGEPIndex, 4> GEP2VariableIndices;
     const Value *GEP2BasePtr =
-      DecomposeGEPExpression(GEP2, GEP2BaseOffset, GEP2VariableIndices,
-                             GEP2MaxLookupReached, DL, AT, DT);
+      decomposeGEPExpression(GEP2, GEP2BaseOffset, GEP2VariableIndices,
+                             GEP2MaxLookupReached, AT, DT);
 
     // DecomposeGEPExpression and GetUnderlyingObject should return the
     // same result except when DecomposeGEPExpression has no DataLayout.
@@ -999,8 +1105,8 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
       return R;
 
     const Value *GEP1BasePtr =
-      DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices,
-                             GEP1MaxLookupReached, DL, AT, DT);
+      decomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices,
+                             GEP1MaxLookupReached, AT, DT);
 
     // DecomposeGEPExpression and GetUnderlyingObject should return the
     // same result except when DecomposeGEPExpression has no DataLayout.
@@ -1243,6 +1349,12 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
   // Figure out what objects these things are pointing to if we can.
   const Value *O1 = GetUnderlyingObject(V1, DL, MaxLookupSearchDepth);
   const Value *O2 = GetUnderlyingObject(V2, DL, MaxLookupSearchDepth);
+  if (QueryCachingDepth) {
+    trackQueryCacheValue(V1);
+    trackQueryCacheValue(V2);
+    trackQueryCacheValue(O1);
+    trackQueryCacheValue(O2);
+  }
 
   // Null values in the default address space don't point to any object, so they
   // don't alias any other pointer.
@@ -1356,6 +1468,36 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
   return AliasCache[Locs] = Result;
 }
 
+const Value *BasicAliasAnalysis::decomposeGEPExpression(
+    const Value *V, int64_t &BaseOffs,
+    SmallVectorImpl<VariableGEPIndex> &VarIndices, bool &MaxLookupReached,
+    AssumptionTracker *AT, DominatorTree *DT) {
+  if (!QueryCachingDepth)
+    return DecomposeGEPExpression(V, BaseOffs, VarIndices, MaxLookupReached,
+                                  DL, AT, DT);
+
+  assert(VarIndices.empty() && "Cannot merge into a cached decomposition!");
+  std::pair<DenseMap<const Value *, DecomposedGEP>::iterator, bool> Inserted =
+      GEPCache.insert(std::make_pair(V, DecomposedGEP()));
+  DecomposedGEP &Entry = Inserted.first->second;
+  if (Inserted.second) {
+    ++NumGEPCacheMisses;
+    Entry.Base = DecomposeGEPExpression(V, Entry.Offset, Entry.VarIndices,
+                                        Entry.MaxLookupReached, DL, AT, DT);
+    trackQueryCacheValue(V);
+    trackQueryCacheValue(Entry.Base);
+    for (unsigned i = 0, e = Entry.VarIndices.size(); i != e; ++i)
+      trackQueryCacheValue(Entry.VarIndices[i].V);
+  } else {
+    ++NumGEPCacheHits;
+  }
+
+  BaseOffs = Entry.Offset;
+  VarIndices.append(Entry.VarIndices.begin(), Entry.VarIndices.end());
+  MaxLookupReached = Entry.MaxLookupReached;
+  return Entry.Base;
+}
+
 bool BasicAliasAnalysis::isValueEqualInPotentialCycles(const Value *V,
                                                        const Value *V2) {
   if (V != V2)
@@ -10,6 +10,7 @@
 #include "llvm/Analysis/LazyCallGraph.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/PassManager.h"
@@ -47,6 +48,14 @@ static void findCallees(
       continue;
     }
 
+    // The block operand of a blockaddress is not a constant; only its
+    // function is an edge.
+    if (BlockAddress *BA = dyn_cast<BlockAddress>(C)) {
+      if (Visited.insert(BA->getFunction()))
+        Worklist.push_back(BA->getFunction());
+      continue;
+    }
+
     for (Value *Op : C->operand_values())
       if (Visited.insert(cast<Constant>(Op)))
         Worklist.push_back(cast<Constant>(Op));
@@ -0,0 +1,470 @@
+//===- MemorySSA.cpp - Memory SSA form ------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the MemorySSA analysis pass and its walker. The form is
+// built like the SSA form of a promoted alloca: MemoryPhis go in the iterated
+// dominance frontier of the blocks with MemoryDefs, then a walk of the
+// dominator tree links every access to the definition reaching it.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include <queue>
+using namespace llvm;
+
+#define DEBUG_TYPE "memoryssa"
+
+STATISTIC(NumMemoryDefs, "Number of MemoryDefs built");
+STATISTIC(NumMemoryUses, "Number of MemoryUses built");
+STATISTIC(NumMemoryPhis, "Number of MemoryPhis built");
+STATISTIC(NumClobberQueries, "Number of clobber queries");
+STATISTIC(NumCachedClobbers, "Number of clobber queries answered from cache");
+
+char MemorySSA::ID = 0;
+INITIALIZE_PASS_BEGIN(MemorySSA, "memoryssa", "Memory SSA", false, true)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_END(MemorySSA, "memoryssa", "Memory SSA", false, true)
+
+//===----------------------------------------------------------------------===//
+// MemoryAccess implementation
+//===----------------------------------------------------------------------===//
+
+static void printAccessID(raw_ostream &OS, const MemoryAccess *MA) {
+  if (!MA)
+    OS << "null";
+  else if (const MemoryPhi *Phi = dyn_cast<MemoryPhi>(MA))
+    OS << Phi->getID();
+  else if (unsigned ID = cast<MemoryDef>(MA)->getID())
+    OS << ID;
+  else
+    OS << "liveOnEntry";
+}
+
+void MemoryAccess::dump() const {
+  print(dbgs());
+  dbgs() << '\n';
+}
+
+void MemoryUse::print(raw_ostream &OS) const {
+  OS << "MemoryUse(";
+  printAccessID(OS, getDefiningAccess());
+  OS << ')';
+}
+
+void MemoryDef::print(raw_ostream &OS) const {
+  OS << getID() << " = MemoryDef(";
+  printAccessID(OS, getDefiningAccess());
+  OS << ')';
+}
+
+MemoryPhi::~MemoryPhi() {
+  for (unsigned I = 0, E = Incoming.size(); I != E; ++I)
+    Incoming[I].second->removeUser(this);
+}
+
+bool MemoryPhi::hasIncomingValue(const MemoryAccess *MA) const {
+  for (unsigned I = 0, E = Incoming.size(); I != E; ++I)
+    if (Incoming[I].second == MA)
+      return true;
+  return false;
+}
+
+void MemoryPhi::addIncoming(MemoryAccess *MA, BasicBlock *BB) {
+  Incoming.push_back(std::make_pair(BB, MA));
+  MA->addUser(this);
+}
+
+void MemoryPhi::setIncomingValue(unsigned I, MemoryAccess *MA) {
+  MemoryAccess *Old = Incoming[I].second;
+  Incoming[I].second = MA;
+  if (!hasIncomingValue(Old))
+    Old->removeUser(this);
+  MA->addUser(this);
+}
+
+void MemoryPhi::print(raw_ostream &OS) const {
+  OS << getID() << " = MemoryPhi(";
+  for (unsigned I = 0, E = Incoming.size(); I != E; ++I) {
+    if (I)
+      OS << ',';
+    OS << '{';
+    Incoming[I].first->printAsOperand(OS, false);
+    OS << ',';
+    printAccessID(OS, Incoming[I].second);
+    OS << '}';
+  }
+  OS << ')';
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSA implementation
+//===----------------------------------------------------------------------===//
+
+MemorySSA::MemorySSA() : FunctionPass(ID), F(nullptr), DT(nullptr), NextID(0) {
+  initializeMemorySSAPass(*PassRegistry::getPassRegistry());
+}
+
+MemorySSA::~MemorySSA() { releaseMemory(); }
+
+void MemorySSA::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesAll();
+  AU.addRequiredTransitive<DominatorTreeWrapperPass>();
+  AU.addRequiredTransitive<AliasAnalysis>();
+}
+
+void MemorySSA::releaseMemory() {
+  // Drop the links between the accesses first, so that they can be deleted in
+  // any order.
+  for (auto &I : InstructionAccesses)
+    I.second->DefiningAccess = nullptr;
+  for (auto &I : BlockPhis)
+    I.second->Incoming.clear();
+  if (LiveOnEntryDef)
+    LiveOnEntryDef->Users.clear();
+
+  for (auto &I : InstructionAccesses)
+    delete I.second;
+  for (auto &I : BlockPhis)
+    delete I.second;
+  InstructionAccesses.clear();
+  BlockPhis.clear();
+  LiveOnEntryDef.reset();
+  Walker.reset();
+  F = nullptr;
+}
+
+bool MemorySSA::runOnFunction(Function &Fn) {
+  F = &Fn;
+  DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  Walker.reset(new MemorySSAWalker(*this, getAnalysis<AliasAnalysis>()));
+  LiveOnEntryDef.reset(new MemoryDef(nullptr, &F->getEntryBlock(), 0));
+  NextID = 1;
+
+  SmallPtrSet<BasicBlock *, 32> DefBlocks;
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB) {
+    if (!DT->isReachableFromEntry(BB))
+      continue;
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+      if (I->mayWriteToMemory()) {
+        DefBlocks.insert(BB);
+        break;
+      }
+  }
+
+  SmallPtrSet<BasicBlock *, 32> PhiBlocks;
+  placePHINodes(DefBlocks, PhiBlocks);
+
+  // Create the accesses in program order, so that their numbers read well.
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB) {
+    if (!DT->isReachableFromEntry(BB))
+      continue;
+    if (PhiBlocks.count(BB)) {
+      BlockPhis[BB] = new MemoryPhi(BB, NextID++);
+      ++NumMemoryPhis;
+    }
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      if (I->mayWriteToMemory()) {
+        InstructionAccesses[I] = new MemoryDef(I, BB, NextID++);
+        ++NumMemoryDefs;
+      } else if (I->mayReadFromMemory()) {
+        InstructionAccesses[I] = new MemoryUse(I, BB);
+        ++NumMemoryUses;
+      }
+    }
+  }
+
+  DenseMap<BasicBlock *, MemoryAccess *> BlockExits;
+  renamePass(BlockExits);
+
+  // Fill in the phis in predecessor order. Memory coming from unreachable
+  // predecessors is unknown.
+  for (auto &I : BlockPhis) {
+    BasicBlock *BB = I.second->getBlock();
+    for (pred_iterator PI = pred_begin(BB), PE = pred_end(BB); PI != PE; ++PI) {
+      MemoryAccess *Exit = BlockExits.lookup(*PI);
+      I.second->addIncoming(Exit ? Exit : LiveOnEntryDef.get(), *PI);
+    }
+  }
+
+  return false;
+}
+
+/// placePHINodes - Compute the iterated dominance frontier of \p DefBlocks,
+/// the blocks which need a MemoryPhi.
+void MemorySSA::placePHINodes(const SmallPtrSetImpl<BasicBlock *> &DefBlocks,
+                              SmallPtrSetImpl<BasicBlock *> &PhiBlocks) {
+  DenseMap<DomTreeNode *, unsigned> DomLevels;
+  SmallVector<DomTreeNode *, 32> Worklist;
+  DomTreeNode *Root = DT->getRootNode();
+  DomLevels[Root] = 0;
+  Worklist.push_back(Root);
+  while (!Worklist.empty()) {
+    DomTreeNode *Node = Worklist.pop_back_val();
+    unsigned ChildLevel = DomLevels[Node] + 1;
+    for (DomTreeNode::iterator CI = Node->begin(), CE = Node->end(); CI != CE;
+         ++CI) {
+      DomLevels[*CI] = ChildLevel;
+      Worklist.push_back(*CI);
+    }
+  }
+
+  // Use a priority queue keyed on dominator tree level so that inserted nodes
+  // are handled from the bottom of the dominator tree upwards.
+  typedef std::pair<DomTreeNode *, unsigned> DomTreeNodePair;
+  typedef std::priority_queue<DomTreeNodePair, SmallVector<DomTreeNodePair, 32>,
+                              less_second> IDFPriorityQueue;
+  IDFPriorityQueue PQ;
+  for (BasicBlock *BB : DefBlocks)
+    if (DomTreeNode *Node = DT->getNode(BB))
+      PQ.push(std::make_pair(Node, DomLevels[Node]));
+
+  SmallPtrSet<DomTreeNode *, 32> Visited;
+  while (!PQ.empty()) {
+    DomTreeNodePair RootPair = PQ.top();
+    PQ.pop();
+    DomTreeNode *Root = RootPair.first;
+    unsigned RootLevel = RootPair.second;
+
+    Worklist.clear();
+    Worklist.push_back(Root);
+    while (!Worklist.empty()) {
+      DomTreeNode *Node = Worklist.pop_back_val();
+      BasicBlock *BB = Node->getBlock();
+      for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE;
+           ++SI) {
+        DomTreeNode *SuccNode = DT->getNode(*SI);
+        if (SuccNode->getIDom() == Node)
+          continue;
+        unsigned SuccLevel = DomLevels[SuccNode];
+        if (SuccLevel > RootLevel)
+          continue;
+        if (!Visited.insert(SuccNode))
+          continue;
+
+        BasicBlock *SuccBB = SuccNode->getBlock();
+        PhiBlocks.insert(SuccBB);
+        if (!DefBlocks.count(SuccBB))
+          PQ.push(std::make_pair(SuccNode, SuccLevel));
+      }
+
+      for (DomTreeNode::iterator CI = Node->begin(), CE = Node->end(); CI != CE;
+           ++CI)
+        if (!Visited.count(*CI))
+          Worklist.push_back(*CI);
+    }
+  }
+}
+
+/// renamePass - Walk the dominator tree, linking every access to the
+/// definition reaching it and recording in \p BlockExits the definition
+/// reaching the end of each block.
+void MemorySSA::renamePass(
+    DenseMap<BasicBlock *, MemoryAccess *> &BlockExits) {
+  SmallVector<std::pair<DomTreeNode *, MemoryAccess *>, 32> Worklist;
+  Worklist.push_back(std::make_pair(DT->getRootNode(), LiveOnEntryDef.get()));
+  while (!Worklist.empty()) {
+    DomTreeNode *Node = Worklist.back().first;
+    MemoryAccess *Incoming = Worklist.back().second;
+    Worklist.pop_back();
+
+    BasicBlock *BB = Node->getBlock();
+    if (MemoryPhi *Phi = BlockPhis.lookup(BB))
+      Incoming = Phi;
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I)
+      if (MemoryUseOrDef *MA = InstructionAccesses.lookup(I)) {
+        MA->setDefiningAccess(Incoming);
+        if (isa<MemoryDef>(MA))
+          Incoming = MA;
+      }
+
+    BlockExits[BB] = Incoming;
+
+    for (DomTreeNode::iterator CI = Node->begin(), CE = Node->end(); CI != CE;
+         ++CI)
+      Worklist.push_back(std::make_pair(*CI, Incoming));
+  }
+}
+
+void MemorySSA::removeMemoryAccess(MemoryUseOrDef *MA) {
+  MemoryAccess *NewDef = MA->getDefiningAccess();
+  SmallVector<MemoryAccess *, 8> Users(MA->user_begin(), MA->user_end());
+  for (MemoryAccess *User : Users) {
+    if (MemoryUseOrDef *UD = dyn_cast<MemoryUseOrDef>(User)) {
+      UD->setDefiningAccess(NewDef);
+      continue;
+    }
+    MemoryPhi *Phi = cast<MemoryPhi>(User);
+    for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I)
+      if (Phi->getIncomingValue(I) == MA)
+        Phi->setIncomingValue(I, NewDef);
+  }
+
+  InstructionAccesses.erase(MA->getMemoryInst());
+  delete MA;
+  Walker->invalidateInfo();
+}
+
+void MemorySSA::replaceMemoryInstruction(Instruction *From, Instruction *To) {
+  MemoryUseOrDef *MA = InstructionAccesses.lookup(From);
+  if (!MA)
+    return;
+  assert((isa<MemoryDef>(MA) || !To->mayWriteToMemory()) &&
+         "A MemoryUse cannot become a MemoryDef!");
+  assert(To->getParent() == MA->getBlock() && "Instruction moved!");
+  InstructionAccesses.erase(From);
+  MA->MemoryInst = To;
+  InstructionAccesses[To] = MA;
+  Walker->invalidateInfo();
+}
+
+void MemorySSA::print(raw_ostream &OS, const Module *) const {
+  if (!F)
+    return;
+
+  // Print the function with every access as a comment above its instruction.
+  for (Function::const_iterator BB = F->begin(), E = F->end(); BB != E; ++BB) {
+    BB->printAsOperand(OS, false);
+    OS << ":\n";
+    if (MemoryPhi *Phi = getMemoryAccess(BB))
+      OS << "; " << *Phi << '\n';
+    for (BasicBlock::const_iterator I = BB->begin(), IE = BB->end(); I != IE;
+         ++I) {
+      if (MemoryUseOrDef *MA = getMemoryAccess(I))
+        OS << "; " << *MA << '\n';
+      OS << *I << '\n';
+    }
+  }
+}
+
+void MemorySSA::verifyAnalysis() const {
+  for (auto &I : InstructionAccesses) {
+    assert(I.second->getMemoryInst() == I.first && "Access moved!");
+    assert(I.second->getDefiningAccess() && "Access without definition!");
+    (void)I;
+  }
+  for (auto &I : BlockPhis) {
+    assert(I.second->getNumIncomingValues() ==
+               (unsigned)std::distance(pred_begin(I.first), pred_end(I.first)) &&
+           "Phi without an incoming value for every edge!");
+    (void)I;
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSAWalker implementation
+//===----------------------------------------------------------------------===//
+
+struct MemorySSAWalker::Query {
+  Query() : Call(nullptr) {}
+
+  /// The call site whose memory the query is about, or null if the query is
+  /// about a location.
+  const Instruction *Call;
+  AliasAnalysis::Location Loc;
+};
+
+bool MemorySSAWalker::clobbers(const MemoryDef *Def, const Query &Q) {
+  Instruction *DefInst = Def->getMemoryInst();
+  if (!Q.Call)
+    return AA.getModRefInfo(DefInst, Q.Loc) & AliasAnalysis::Mod;
+
+  ImmutableCallSite CS(Q.Call);
+  if (ImmutableCallSite DefCS = DefInst)
+    return AA.getModRefInfo(DefCS, CS) != AliasAnalysis::NoModRef;
+  if (StoreInst *SI = dyn_cast<StoreInst>(DefInst))
+    return AA.getModRefInfo(CS, AA.getLocation(SI)) !=
+           AliasAnalysis::NoModRef;
+  return true;
+}
+
+MemoryAccess *
+MemorySSAWalker::walk(MemoryAccess *Start, const Query &Q,
+                      DenseMap<const MemoryPhi *, MemoryAccess *> &PhiResults) {
+  MemoryAccess *Cur = Start;
+  while (MemoryDef *Def = dyn_cast<MemoryDef>(Cur)) {
+    if (MSSA.isLiveOnEntryDef(Def) || clobbers(Def, Q))
+      return Def;
+    Cur = Def->getDefiningAccess();
+  }
+
+  // Follow every incoming value of the phi. A phi still being walked is part
+  // of a cycle, which adds no clobber of its own.
+  MemoryPhi *Phi = cast<MemoryPhi>(Cur);
+  auto Inserted = PhiResults.insert(std::make_pair(Phi, nullptr));
+  if (!Inserted.second)
+    return Inserted.first->second;
+
+  MemoryAccess *Result = nullptr;
+  for (unsigned I = 0, E = Phi->getNumIncomingValues(); I != E; ++I) {
+    MemoryAccess *Clobber = walk(Phi->getIncomingValue(I), Q, PhiResults);
+    if (!Clobber || Clobber == Result)
+      continue;
+    if (Result) {
+      // The paths disagree: the phi is the clobber.
+      Result = Phi;
+      break;
+    }
+    Result = Clobber;
+  }
+  if (!Result)
+    Result = Phi;
+  PhiResults[Phi] = Result;
+  return Result;
+}
+
+MemoryAccess *
+MemorySSAWalker::getClobberingMemoryAccess(const Instruction *I) {
+  MemoryUseOrDef *MA = MSSA.getMemoryAccess(I);
+  if (!MA)
+    return nullptr;
+
+  ++NumClobberQueries;
+  MemoryAccess *&Cached = CachedClobbers[I];
+  if (Cached) {
+    ++NumCachedClobbers;
+    return Cached;
+  }
+
+  Query Q;
+  if (const LoadInst *LI = dyn_cast<LoadInst>(I)) {
+    Q.Loc = AA.getLocation(LI);
+  } else if (const StoreInst *SI = dyn_cast<StoreInst>(I)) {
+    Q.Loc = AA.getLocation(SI);
+  } else if (const VAArgInst *VI = dyn_cast<VAArgInst>(I)) {
+    Q.Loc = AA.getLocation(VI);
+  } else if (isa<CallInst>(I) || isa<InvokeInst>(I)) {
+    Q.Call = I;
+  } else {
+    // Fences and atomic read-modify-writes depend on everything before them.
+    return Cached = MA->getDefiningAccess();
+  }
+
+  DenseMap<const MemoryPhi *, MemoryAccess *> PhiResults;
+  return Cached = walk(MA->getDefiningAccess(), Q, PhiResults);
+}
+
+MemoryAccess *
+MemorySSAWalker::getClobberingMemoryAccess(MemoryAccess *Start,
+                                           const AliasAnalysis::Location &Loc) {
+  ++NumClobberQueries;
+  Query Q;
+  Q.Loc = Loc;
+  DenseMap<const MemoryPhi *, MemoryAccess *> PhiResults;
+  return walk(Start, Q, PhiResults);
+}
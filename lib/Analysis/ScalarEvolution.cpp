@@ -99,6 +99,28 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumSCEVCacheHits,
+          "Number of getSCEV queries answered from the cache");
+STATISTIC(NumSCEVsCreated,
+          "Number of values analyzed by createSCEV");
+STATISTIC(NumSCEVAtScopeCacheHits,
+          "Number of getSCEVAtScope queries answered from the cache");
+STATISTIC(NumSCEVAtScopeComputed,
+          "Number of getSCEVAtScope queries computed");
+STATISTIC(NumBackedgeTakenCacheHits,
+          "Number of backedge-taken count queries answered from the cache");
+STATISTIC(NumDepthBudgetExceeded,
+          "Number of values not analyzed past the depth budget");
+STATISTIC(NumSizeBudgetExceeded,
+          "Number of expressions dropped for exceeding the size budget");
+STATISTIC(MaxUniqueSCEVs,
+          "Largest number of unique expressions built for a function");
+STATISTIC(MaxValueExprMapSize,
+          "Largest number of values with a cached expression in a function");
+STATISTIC(MaxValuesAtScopesSize,
+          "Largest number of expressions with cached values at scopes");
+STATISTIC(MaxSCEVAllocatorKBytes,
+          "Largest memory allocated for expressions of a function (KB)");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -107,6 +129,18 @@ MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
                                  "derived loop"),
                         cl::init(100));
 
+static cl::opt<unsigned>
+MaxSCEVCreationDepth("scalar-evolution-max-depth", cl::Hidden,
+                     cl::desc("Maximum depth of the values SCEV analyzes "
+                              "recursively before treating them as unknown"),
+                     cl::init(1024));
+
+static cl::opt<unsigned>
+MaxSCEVExpressionSize("scalar-evolution-max-expr-size", cl::Hidden,
+                      cl::desc("Maximum size of the expression SCEV builds "
+                               "for a value before treating it as unknown"),
+                      cl::init(4096));
+
 // FIXME: Enable this with XDEBUG when the test suite is clean.
 static cl::opt<bool>
 VerifySCEV("verify-scev",
@@ -334,7 +368,7 @@ ScalarEvolution::getConstant(Type *Ty, uint64_t V, bool isSigned) {
 
 SCEVCastExpr::SCEVCastExpr(const FoldingSetNodeIDRef ID,
                            unsigned SCEVTy, const SCEV *op, Type *ty)
-  : SCEV(ID, SCEVTy), Op(op), Ty(ty) {}
+  : SCEV(ID, SCEVTy, computeExpressionSize(&op, 1)), Op(op), Ty(ty) {}
 
 SCEVTruncateExpr::SCEVTruncateExpr(const FoldingSetNodeIDRef ID,
                                    const SCEV *op, Type *ty)
@@ -2843,18 +2877,61 @@ const SCEV *ScalarEvolution::getSCEV(Value *V) {
   ValueExprMapType::iterator I = ValueExprMap.find_as(V);
   if (I != ValueExprMap.end()) {
     const SCEV *S = I->second;
-    if (checkValidity(S))
+    if (checkValidity(S)) {
+      ++NumSCEVCacheHits;
+      if (CreateSCEVDepth && TruncatedValues.count(V))
+        CreateSCEVTruncated = true;
       return S;
-    else
-      ValueExprMap.erase(I);
+    }
+    ValueExprMap.erase(I);
+  }
+
+  // Past the depth budget, stop recursing into the operands of V: on deeply
+  // nested expressions the recursion would exhaust the stack, and the caches
+  // would grow with every level.
+  bool OuterTruncated = CreateSCEVTruncated;
+  CreateSCEVTruncated = false;
+  const SCEV *S;
+  if (CreateSCEVDepth >= MaxSCEVCreationDepth) {
+    ++NumDepthBudgetExceeded;
+    S = getUnknown(V);
+    CreateSCEVTruncated = true;
+  } else {
+    ++NumSCEVsCreated;
+    ++CreateSCEVDepth;
+    S = createSCEV(V);
+    --CreateSCEVDepth;
+
+    // An expression over the size budget costs more to build on and to
+    // simplify than it is worth. PHIs are exempt, as createNodeForPHI has
+    // already recorded the recurrence it built for them.
+    if (S->getExpressionSize() > MaxSCEVExpressionSize && !isa<PHINode>(V)) {
+      ++NumSizeBudgetExceeded;
+      S = getUnknown(V);
+    }
   }
-  const SCEV *S = createSCEV(V);
 
   // The process of creating a SCEV for V may have caused other SCEVs
   // to have been created, so it's necessary to insert the new entry
   // from scratch, rather than trying to remember the insert position
   // above.
   ValueExprMap.insert(std::make_pair(SCEVCallbackVH(V, this), S));
+
+  // An expression cut short by the depth budget depends on how deep V was
+  // reached. Keep it for the rest of this query only; a later query starting
+  // closer to V will analyze it further.
+  if (CreateSCEVTruncated)
+    TruncatedValues.insert(V);
+  CreateSCEVTruncated |= OuterTruncated;
+  if (CreateSCEVDepth == 0 && !TruncatedValues.empty()) {
+    for (Value *TV : TruncatedValues) {
+      ValueExprMapType::iterator TI = ValueExprMap.find_as(TV);
+      if (TI != ValueExprMap.end())
+        ValueExprMap.erase(TI);
+    }
+    TruncatedValues.clear();
+    CreateSCEVTruncated = false;
+  }
   return S;
 }
 
@@ -4196,8 +4273,10 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   // backedge-taken count, which could result in infinite recursion.
   std::pair<DenseMap<const Loop *, BackedgeTakenInfo>::iterator, bool> Pair =
     BackedgeTakenCounts.insert(std::make_pair(L, BackedgeTakenInfo()));
-  if (!Pair.second)
+  if (!Pair.second) {
+    ++NumBackedgeTakenCacheHits;
     return Pair.first->second;
+  }
 
   // ComputeBackedgeTakenCount may allocate memory for its result. Inserting it
   // into the BackedgeTakenCounts map transfers ownership. Otherwise, the result
@@ -4294,12 +4373,42 @@ void ScalarEvolution::forgetLoop(const Loop *L) {
     PushDefUseChildren(I, Worklist);
   }
 
+  // Drop the values computed at the scope of the loop, which is how the
+  // memory of a loop nest is given back without recomputing the function.
+  forgetValuesAtScope(L);
+
   // Forget all contained loops too, to avoid dangling entries in the
   // ValuesAtScopes map.
   for (Loop::iterator I = L->begin(), E = L->end(); I != E; ++I)
     forgetLoop(*I);
 }
 
+void ScalarEvolution::forgetValuesAtScope(const Loop *L) {
+  DenseMap<const Loop *, SmallSetVector<const SCEV *, 4> >::iterator Users =
+    ValuesAtScopesUsers.find(L);
+  if (Users == ValuesAtScopesUsers.end())
+    return;
+
+  for (const SCEV *S : Users->second) {
+    DenseMap<const SCEV *,
+             SmallVector<std::pair<const Loop *, const SCEV *>, 2> >::iterator
+      VI = ValuesAtScopes.find(S);
+    // forgetMemoizedResults may have dropped the expression already.
+    if (VI == ValuesAtScopes.end())
+      continue;
+    SmallVectorImpl<std::pair<const Loop *, const SCEV *> > &Values =
+      VI->second;
+    for (unsigned u = 0; u != Values.size(); ++u)
+      if (Values[u].first == L) {
+        Values.erase(Values.begin() + u);
+        break;
+      }
+    if (Values.empty())
+      ValuesAtScopes.erase(VI);
+  }
+  ValuesAtScopesUsers.erase(Users);
+}
+
 /// forgetValue - This method should be called by the client when it has
 /// changed a value in a way that may effect its value, or which may
 /// disconnect it from a def-use chain linking it to a loop.
@@ -5243,10 +5352,15 @@ const SCEV *ScalarEvolution::getSCEVAtScope(const SCEV *V, const Loop *L) {
   // Check to see if we've folded this expression at this loop before.
   SmallVector<std::pair<const Loop *, const SCEV *>, 2> &Values = ValuesAtScopes[V];
   for (unsigned u = 0; u < Values.size(); u++) {
-    if (Values[u].first == L)
+    if (Values[u].first == L) {
+      ++NumSCEVAtScopeCacheHits;
       return Values[u].second ? Values[u].second : V;
+    }
   }
+  ++NumSCEVAtScopeComputed;
   Values.push_back(std::make_pair(L, static_cast<const SCEV *>(nullptr)));
+  if (L)
+    ValuesAtScopesUsers[L].insert(V);
   // Otherwise compute it.
   const SCEV *C = computeSCEVAtScope(V, L);
   SmallVector<std::pair<const Loop *, const SCEV *>, 2> &Values2 = ValuesAtScopes[V];
@@ -7648,7 +7762,8 @@ ScalarEvolution::SCEVCallbackVH::SCEVCallbackVH(Value *V, ScalarEvolution *se)
 
 ScalarEvolution::ScalarEvolution()
   : FunctionPass(ID), ValuesAtScopes(64), LoopDispositions(64),
-    BlockDispositions(64), FirstUnknown(nullptr) {
+    BlockDispositions(64), CreateSCEVDepth(0), CreateSCEVTruncated(false),
+    FirstUnknown(nullptr) {
   initializeScalarEvolutionPass(*PassRegistry::getPassRegistry());
 }
 
@@ -7663,7 +7778,21 @@ bool ScalarEvolution::runOnFunction(Function &F) {
   return false;
 }
 
+void ScalarEvolution::updateCacheStatistics() const {
+  if (UniqueSCEVs.size() > MaxUniqueSCEVs)
+    MaxUniqueSCEVs = UniqueSCEVs.size();
+  if (ValueExprMap.size() > MaxValueExprMapSize)
+    MaxValueExprMapSize = ValueExprMap.size();
+  if (ValuesAtScopes.size() > MaxValuesAtScopesSize)
+    MaxValuesAtScopesSize = ValuesAtScopes.size();
+  unsigned KBytes = SCEVAllocator.getTotalMemory() / 1024;
+  if (KBytes > MaxSCEVAllocatorKBytes)
+    MaxSCEVAllocatorKBytes = KBytes;
+}
+
 void ScalarEvolution::releaseMemory() {
+  updateCacheStatistics();
+
   // Iterate through all the SCEVUnknown instances and call their
   // destructors, so that they release their references to their values.
   for (SCEVUnknown *U = FirstUnknown; U; U = U->Next)
@@ -7685,6 +7814,8 @@ void ScalarEvolution::releaseMemory() {
   BackedgeTakenCounts.clear();
   ConstantEvolutionLoopExitValue.clear();
   ValuesAtScopes.clear();
+  ValuesAtScopesUsers.clear();
+  TruncatedValues.clear();
   LoopDispositions.clear();
   BlockDispositions.clear();
   UnsignedRanges.clear();
@@ -8007,7 +8138,25 @@ bool ScalarEvolution::hasOperand(const SCEV *S, const SCEV *Op) const {
 }
 
 void ScalarEvolution::forgetMemoizedResults(const SCEV *S) {
-  ValuesAtScopes.erase(S);
+  // Drop S from the users of the loops it has values at, so that the lists
+  // do not outgrow ValuesAtScopes.
+  DenseMap<const SCEV *,
+           SmallVector<std::pair<const Loop *, const SCEV *>, 2> >::iterator
+    VI = ValuesAtScopes.find(S);
+  if (VI != ValuesAtScopes.end()) {
+    for (const auto &LS : VI->second) {
+      if (!LS.first)
+        continue;
+      DenseMap<const Loop *, SmallSetVector<const SCEV *, 4> >::iterator
+        Users = ValuesAtScopesUsers.find(LS.first);
+      if (Users == ValuesAtScopesUsers.end())
+        continue;
+      Users->second.remove(S);
+      if (Users->second.empty())
+        ValuesAtScopesUsers.erase(Users);
+    }
+    ValuesAtScopes.erase(VI);
+  }
   LoopDispositions.erase(S);
   BlockDispositions.erase(S);
   UnsignedRanges.erase(S);
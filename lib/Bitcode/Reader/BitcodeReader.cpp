@@ -11,6 +11,7 @@
 #include "BitcodeReader.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Bitcode/LLVMBitCodes.h"
 #include "llvm/IR/AutoUpgrade.h"
 #include "llvm/IR/Constants.h"
@@ -24,13 +25,127 @@
 #include "llvm/Support/DataStream.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
+#define DEBUG_TYPE "bitcode-reader"
+
+STATISTIC(NumDecodedWindows,
+          "Number of windows of function bodies decoded ahead");
+
+/// The number of function bodies per thread decoded ahead of the one being
+/// materialized.
+static const unsigned DecodeWindowPerThread = 8;
+
 enum {
   SWITCH_INST_MAGIC = 0x4B5 // May 2012 => 1205 => Hex
 };
 
+//===----------------------------------------------------------------------===//
+// BitcodeCursor implementation
+//===----------------------------------------------------------------------===//
+
+void DecodedBlock::decode(BitstreamCursor &Cursor, unsigned BlockID) {
+  Entry E = { BitstreamEntry::Error, 0, 0, 0 };
+  if (Cursor.EnterSubBlock(BlockID)) {
+    Entries.push_back(E);
+    return;
+  }
+
+  SmallVector<uint64_t, 64> Record;
+  unsigned Depth = 1;
+  while (Depth) {
+    BitstreamEntry Entry = Cursor.advance();
+    E.Kind = Entry.Kind;
+    E.ID = Entry.ID;
+    E.OpsBegin = E.OpsEnd = Ops.size();
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      Entries.push_back(E);
+      return;
+    case BitstreamEntry::EndBlock:
+      Entries.push_back(E);
+      --Depth;
+      break;
+    case BitstreamEntry::SubBlock:
+      Entries.push_back(E);
+      if (Cursor.EnterSubBlock(Entry.ID)) {
+        E.Kind = BitstreamEntry::Error;
+        Entries.push_back(E);
+        return;
+      }
+      ++Depth;
+      break;
+    case BitstreamEntry::Record:
+      Record.clear();
+      E.ID = Cursor.readRecord(Entry.ID, Record);
+      Ops.insert(Ops.end(), Record.begin(), Record.end());
+      E.OpsEnd = Ops.size();
+      Entries.push_back(E);
+      break;
+    }
+  }
+}
+
+BitstreamEntry BitcodeCursor::advance(unsigned Flags) {
+  if (!Replay)
+    return Stream.advance(Flags);
+  if (Pos == Replay->Entries.size())
+    return BitstreamEntry::getError();
+
+  const DecodedBlock::Entry &E = Replay->Entries[Pos++];
+  switch (E.Kind) {
+  default:
+    return BitstreamEntry::getError();
+  case BitstreamEntry::EndBlock:
+    // Go back to the bitstream once the replayed block is left.
+    if (--Depth == 0)
+      Replay = nullptr;
+    return BitstreamEntry::getEndBlock();
+  case BitstreamEntry::SubBlock:
+    return BitstreamEntry::getSubBlock(E.ID);
+  case BitstreamEntry::Record:
+    CurRecord = &E;
+    return BitstreamEntry::getRecord(bitc::FIRST_APPLICATION_ABBREV);
+  }
+}
+
+bool BitcodeCursor::SkipBlock() {
+  if (!Replay)
+    return Stream.SkipBlock();
+
+  // Skip the entries of the sub-block just returned by advance().
+  unsigned SkipDepth = 1;
+  while (Pos != Replay->Entries.size()) {
+    const DecodedBlock::Entry &E = Replay->Entries[Pos++];
+    if (E.Kind == BitstreamEntry::Error)
+      return true;
+    if (E.Kind == BitstreamEntry::SubBlock)
+      ++SkipDepth;
+    else if (E.Kind == BitstreamEntry::EndBlock && --SkipDepth == 0)
+      return false;
+  }
+  return true;
+}
+
+unsigned BitcodeCursor::ReadCode() {
+  if (!Replay)
+    return Stream.ReadCode();
+  BitstreamEntry Entry = advance();
+  return Entry.Kind == BitstreamEntry::Record ? Entry.ID : 0;
+}
+
+unsigned BitcodeCursor::readRecord(unsigned AbbrevID,
+                                   SmallVectorImpl<uint64_t> &Vals) {
+  if (!Replay)
+    return Stream.readRecord(AbbrevID, Vals);
+  assert(CurRecord && "No record to read");
+  Vals.append(Replay->Ops.begin() + CurRecord->OpsBegin,
+              Replay->Ops.begin() + CurRecord->OpsEnd);
+  return CurRecord->ID;
+}
+
 std::error_code BitcodeReader::materializeForwardReferencedFunctions() {
   if (WillMaterializeAllForwardRefs)
     return std::error_code();
@@ -3300,10 +3415,21 @@ std::error_code BitcodeReader::Materialize(GlobalValue *GV) {
     if (std::error_code EC = FindFunctionInStream(F, DFII))
       return EC;
 
-  // Move the bit stream to the saved position of the deferred function body.
-  Stream.JumpToBit(DFII->second);
+  // Replay the body if it was decoded ahead of time, otherwise move the bit
+  // stream to its saved position.
+  auto DBI = DecodedBodies.find(F);
+  std::unique_ptr<DecodedBlock> Decoded;
+  if (DBI != DecodedBodies.end()) {
+    Decoded = std::move(DBI->second);
+    DecodedBodies.erase(DBI);
+    Stream.replay(*Decoded);
+  } else {
+    Stream.JumpToBit(DFII->second);
+  }
 
-  if (std::error_code EC = ParseFunctionBody(F))
+  std::error_code EC = ParseFunctionBody(F);
+  Stream.stopReplay();
+  if (EC)
     return EC;
 
   // Upgrade any old intrinsic calls in the function.
@@ -3323,6 +3449,77 @@ std::error_code BitcodeReader::Materialize(GlobalValue *GV) {
   return materializeForwardReferencedFunctions();
 }
 
+/// decodeFunctionBodies - Start decoding the bodies of Fns on Pool, into
+/// Blocks. Every task reads a share of the bodies through its own
+/// BitstreamReader, since abbreviations cannot be shared between threads.
+void BitcodeReader::decodeFunctionBodies(
+    ThreadPool &Pool, ArrayRef<Function *> Fns,
+    std::vector<std::unique_ptr<DecodedBlock>> &Blocks) {
+  StreamableMemoryObject &Bytes = StreamFile->getBitcodeBytes();
+  const unsigned char *Start = Bytes.getPointer(0, Bytes.getExtent());
+  const unsigned char *End = Start + Bytes.getExtent();
+
+  unsigned NumTasks = std::min<size_t>(Fns.size(), Pool.getThreadCount());
+  std::vector<std::vector<std::pair<uint64_t, DecodedBlock *>>> Shares(
+      NumTasks);
+  for (size_t I = 0, E = Fns.size(); I != E; ++I) {
+    Blocks.push_back(std::unique_ptr<DecodedBlock>(new DecodedBlock()));
+    Shares[I % NumTasks].push_back(
+        std::make_pair(DeferredFunctionInfo[Fns[I]], Blocks.back().get()));
+  }
+  BitstreamReader *BlockInfo = StreamFile.get();
+  for (auto &Share : Shares)
+    Pool.async([Start, End, BlockInfo, Share] {
+      BitstreamReader Reader(Start, End);
+      Reader.copyBlockInfo(*BlockInfo);
+      BitstreamCursor Cursor(Reader);
+      for (const auto &Body : Share) {
+        Cursor.JumpToBit(Body.first);
+        Body.second->decode(Cursor, bitc::FUNCTION_BLOCK_ID);
+      }
+    });
+  ++NumDecodedWindows;
+}
+
+/// materializeFunctionsInParallel - Materialize the functions still to be
+/// read, in module order, while the bodies of the next ones are decoded on
+/// other threads. Only two windows of decoded bodies exist at a time, so the
+/// memory they take does not grow with the size of the module.
+std::error_code BitcodeReader::materializeFunctionsInParallel() {
+  std::vector<Function *> Pending;
+  for (Function &F : *TheModule)
+    if (F.isMaterializable())
+      Pending.push_back(&F);
+
+  // The decoding tasks write to the blocks of Next, so the pool has to go
+  // away first.
+  std::vector<std::unique_ptr<DecodedBlock>> Next;
+  ThreadPool Pool(DecodeThreadCount);
+  size_t Window = DecodeWindowPerThread * Pool.getThreadCount();
+  ArrayRef<Function *> Fns(Pending);
+  decodeFunctionBodies(Pool, Fns.slice(0, std::min(Window, Fns.size())), Next);
+
+  for (size_t Begin = 0, E = Fns.size(); Begin < E; Begin += Window) {
+    Pool.wait();
+    size_t End = std::min(Begin + Window, E);
+    for (size_t I = Begin; I != End; ++I)
+      DecodedBodies[Fns[I]] = std::move(Next[I - Begin]);
+    Next.clear();
+    if (End != E)
+      decodeFunctionBodies(Pool, Fns.slice(End, std::min(Window, E - End)),
+                           Next);
+
+    for (size_t I = Begin; I != End; ++I)
+      if (Fns[I]->isMaterializable())
+        if (std::error_code EC = Materialize(Fns[I]))
+          return EC;
+    // Drop the bodies of the functions that were materialized early, through
+    // a block address.
+    DecodedBodies.clear();
+  }
+  return std::error_code();
+}
+
 bool BitcodeReader::isDematerializable(const GlobalValue *GV) const {
   const Function *F = dyn_cast<Function>(GV);
   if (!F || F->isDeclaration())
@@ -3357,11 +3554,16 @@ std::error_code BitcodeReader::MaterializeModule(Module *M) {
 
   // Iterate over the module, deserializing any functions that are still on
   // disk.
-  for (Module::iterator F = TheModule->begin(), E = TheModule->end();
-       F != E; ++F) {
-    if (F->isMaterializable()) {
-      if (std::error_code EC = Materialize(F))
-        return EC;
+  if (DecodeThreadCount != 1 && !LazyStreamer) {
+    if (std::error_code EC = materializeFunctionsInParallel())
+      return EC;
+  } else {
+    for (Module::iterator F = TheModule->begin(), E = TheModule->end();
+         F != E; ++F) {
+      if (F->isMaterializable()) {
+        if (std::error_code EC = Materialize(F))
+          return EC;
+      }
     }
   }
   // At this point, if there are any function bodies, the current bit is
@@ -3567,13 +3769,16 @@ Module *llvm::getStreamedBitcodeModule(const std::string &name,
 }
 
 ErrorOr<Module *> llvm::parseBitcodeFile(MemoryBufferRef Buffer,
-                                         LLVMContext &Context) {
+                                         LLVMContext &Context,
+                                         unsigned ThreadCount) {
   std::unique_ptr<MemoryBuffer> Buf = MemoryBuffer::getMemBuffer(Buffer, false);
   ErrorOr<Module *> ModuleOrErr =
       getLazyBitcodeModuleImpl(std::move(Buf), Context, true);
   if (!ModuleOrErr)
     return ModuleOrErr;
   Module *M = ModuleOrErr.get();
+  static_cast<BitcodeReader *>(M->getMaterializer())
+      ->setDecodeThreadCount(ThreadCount);
   // Read in the entire module, and destroy the BitcodeReader.
   if (std::error_code EC = M->materializeAllPermanently()) {
     delete M;
@@ -14,6 +14,7 @@
 #ifndef LLVM_LIB_BITCODE_READER_BITCODEREADER_H
 #define LLVM_LIB_BITCODE_READER_BITCODEREADER_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Bitcode/BitstreamReader.h"
 #include "llvm/Bitcode/LLVMBitCodes.h"
@@ -23,6 +24,7 @@
 #include "llvm/IR/Type.h"
 #include "llvm/IR/ValueHandle.h"
 #include <deque>
+#include <memory>
 #include <system_error>
 #include <vector>
 
@@ -30,6 +32,7 @@ namespace llvm {
   class Comdat;
   class MemoryBuffer;
   class LLVMContext;
+  class ThreadPool;
 
 //===----------------------------------------------------------------------===//
 //                          BitcodeReaderValueList Class
@@ -124,12 +127,119 @@ public:
   void AssignValue(Value *V, unsigned Idx);
 };
 
+//===----------------------------------------------------------------------===//
+//                          BitcodeCursor Class
+//===----------------------------------------------------------------------===//
+
+/// DecodedBlock - The entries of a block and of its sub-blocks, read ahead of
+/// time with the abbreviations expanded. Decoding does not touch the
+/// LLVMContext, so the bodies of different functions can be decoded on
+/// different threads before the IR is built from them.
+struct DecodedBlock {
+  struct Entry {
+    unsigned Kind;     // A BitstreamEntry kind.
+    unsigned ID;       // Block ID of a SubBlock, code of a Record.
+    unsigned OpsBegin; // The operands of a Record, in Ops.
+    unsigned OpsEnd;
+  };
+  std::vector<Entry> Entries;
+  std::vector<uint64_t> Ops;
+
+  /// decode - Read the block with ID \p BlockID that \p Cursor is about to
+  /// enter, up to and including its END_BLOCK. Errors are recorded as an
+  /// Error entry, which ends the block.
+  void decode(BitstreamCursor &Cursor, unsigned BlockID);
+};
+
+/// BitcodeCursor - A BitstreamCursor which can also replay a DecodedBlock, so
+/// that the parsing code does not need to know whether a function body is read
+/// from the bitstream or was decoded ahead of time. Only the operations used
+/// inside function blocks are supported while replaying.
+class BitcodeCursor {
+  BitstreamCursor Stream;
+  const DecodedBlock *Replay;
+  unsigned Pos;   // Next entry of Replay.
+  unsigned Depth; // Blocks of Replay entered and not left yet.
+  const DecodedBlock::Entry *CurRecord;
+
+public:
+  BitcodeCursor() : Replay(nullptr), Pos(0), Depth(0), CurRecord(nullptr) {}
+
+  void init(BitstreamReader &R) { Stream.init(R); }
+
+  /// replay - Read the entries of \p Block instead of the bitstream until
+  /// the end of the block.
+  void replay(const DecodedBlock &Block) {
+    Replay = &Block;
+    Pos = Depth = 0;
+    CurRecord = nullptr;
+  }
+  void stopReplay() { Replay = nullptr; }
+
+  bool AtEndOfStream() {
+    assert(!Replay && "Not supported while replaying");
+    return Stream.AtEndOfStream();
+  }
+  uint64_t GetCurrentBitNo() const {
+    assert(!Replay && "Not supported while replaying");
+    return Stream.GetCurrentBitNo();
+  }
+  void JumpToBit(uint64_t BitNo) {
+    assert(!Replay && "Not supported while replaying");
+    Stream.JumpToBit(BitNo);
+  }
+  uint32_t Read(unsigned NumBits) {
+    assert(!Replay && "Not supported while replaying");
+    return Stream.Read(NumBits);
+  }
+  unsigned getAbbrevIDWidth() const {
+    assert(!Replay && "Not supported while replaying");
+    return Stream.getAbbrevIDWidth();
+  }
+  bool ReadBlockInfoBlock() {
+    assert(!Replay && "Not supported while replaying");
+    return Stream.ReadBlockInfoBlock();
+  }
+  void skipRecord(unsigned AbbrevID) {
+    assert(!Replay && "Not supported while replaying");
+    Stream.skipRecord(AbbrevID);
+  }
+
+  bool EnterSubBlock(unsigned BlockID) {
+    if (!Replay)
+      return Stream.EnterSubBlock(BlockID);
+    if (Pos == Replay->Entries.size() ||
+        Replay->Entries[Pos].Kind == BitstreamEntry::Error)
+      return true;
+    ++Depth;
+    return false;
+  }
+
+  bool SkipBlock();
+
+  BitstreamEntry advance(unsigned Flags = 0);
+
+  BitstreamEntry advanceSkippingSubblocks(unsigned Flags = 0) {
+    while (1) {
+      BitstreamEntry Entry = advance(Flags);
+      if (Entry.Kind != BitstreamEntry::SubBlock)
+        return Entry;
+      if (SkipBlock())
+        return BitstreamEntry::getError();
+    }
+  }
+
+  unsigned ReadCode();
+
+  unsigned readRecord(unsigned AbbrevID, SmallVectorImpl<uint64_t> &Vals);
+};
+
 class BitcodeReader : public GVMaterializer {
   LLVMContext &Context;
   Module *TheModule;
   std::unique_ptr<MemoryBuffer> Buffer;
   std::unique_ptr<BitstreamReader> StreamFile;
-  BitstreamCursor Stream;
+  BitcodeCursor Stream;
   DataStreamer *LazyStreamer;
   uint64_t NextUnreadBit;
   bool SeenValueSymbolTable;
@@ -180,6 +290,14 @@ class BitcodeReader : public GVMaterializer {
   /// stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
 
+  /// DecodeThreadCount - The number of threads decoding function bodies ahead
+  /// of MaterializeModule, 1 to decode them as they are materialized.
+  unsigned DecodeThreadCount;
+
+  /// DecodedBodies - Function bodies decoded ahead of time, which Materialize
+  /// replays rather than reading the bitstream.
+  DenseMap<Function *, std::unique_ptr<DecodedBlock>> DecodedBodies;
+
   /// These are basic blocks forward-referenced by block addresses.  They are
   /// inserted lazily into functions when they're loaded.  The basic block ID is
   /// its index into the vector.
@@ -208,13 +326,13 @@ public:
   explicit BitcodeReader(MemoryBuffer *buffer, LLVMContext &C)
       : Context(C), TheModule(nullptr), Buffer(buffer), LazyStreamer(nullptr),
         NextUnreadBit(0), SeenValueSymbolTable(false), ValueList(C),
-        MDValueList(C), SeenFirstFunctionBody(false), UseRelativeIDs(false),
-        WillMaterializeAllForwardRefs(false) {}
+        MDValueList(C), SeenFirstFunctionBody(false), DecodeThreadCount(1),
+        UseRelativeIDs(false), WillMaterializeAllForwardRefs(false) {}
   explicit BitcodeReader(DataStreamer *streamer, LLVMContext &C)
       : Context(C), TheModule(nullptr), Buffer(nullptr), LazyStreamer(streamer),
         NextUnreadBit(0), SeenValueSymbolTable(false), ValueList(C),
-        MDValueList(C), SeenFirstFunctionBody(false), UseRelativeIDs(false),
-        WillMaterializeAllForwardRefs(false) {}
+        MDValueList(C), SeenFirstFunctionBody(false), DecodeThreadCount(1),
+        UseRelativeIDs(false), WillMaterializeAllForwardRefs(false) {}
   ~BitcodeReader() { FreeState(); }
 
   std::error_code materializeForwardReferencedFunctions();
@@ -229,6 +347,14 @@ public:
   std::error_code MaterializeModule(Module *M) override;
   void Dematerialize(GlobalValue *GV) override;
 
+  /// Decode the function bodies on \p ThreadCount threads when the whole
+  /// module is materialized. Zero means one thread per hardware thread. The
+  /// IR is still built on the calling thread, since the LLVMContext is not
+  /// thread safe.
+  void setDecodeThreadCount(unsigned ThreadCount) {
+    DecodeThreadCount = ThreadCount;
+  }
+
   /// @brief Main interface to parsing a bitcode buffer.
   /// @returns true if an error occurred.
   std::error_code ParseBitcodeInto(Module *M);
@@ -333,6 +459,9 @@ private:
   std::error_code ParseConstants();
   std::error_code RememberAndSkipFunctionBody();
   std::error_code ParseFunctionBody(Function *F);
+  void decodeFunctionBodies(ThreadPool &Pool, ArrayRef<Function *> Fns,
+                            std::vector<std::unique_ptr<DecodedBlock>> &Blocks);
+  std::error_code materializeFunctionsInParallel();
   std::error_code GlobalCleanup();
   std::error_code ResolveGlobalAndAliasInits();
   std::error_code ParseMetadata();
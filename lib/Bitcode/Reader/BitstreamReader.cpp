@@ -11,6 +11,22 @@
 
 using namespace llvm;
 
+//===----------------------------------------------------------------------===//
+//  BitstreamReader implementation
+//===----------------------------------------------------------------------===//
+
+void BitstreamReader::copyBlockInfo(const BitstreamReader &Other) {
+  assert(!hasBlockInfoRecords());
+  BlockInfoRecords = Other.BlockInfoRecords;
+  for (BlockInfo &Info : BlockInfoRecords)
+    for (BitCodeAbbrev *&Abbv : Info.Abbrevs) {
+      BitCodeAbbrev *Copy = new BitCodeAbbrev();
+      for (unsigned i = 0, e = Abbv->getNumOperandInfos(); i != e; ++i)
+        Copy->Add(Abbv->getOperandInfo(i));
+      Abbv = Copy;
+    }
+}
+
 //===----------------------------------------------------------------------===//
 //  BitstreamCursor implementation
 //===----------------------------------------------------------------------===//
@@ -24,6 +24,7 @@
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCContext.h"
 #include "llvm/MC/MCInstrInfo.h"
+#include "llvm/MC/MCObjectStreamer.h"
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/MC/MCSubtargetInfo.h"
 #include "llvm/PassManager.h"
@@ -204,6 +205,8 @@ bool LLVMTargetMachine::addPassesToEmitFile(PassManagerBase &PM,
     AsmStreamer.reset(getTarget().createMCObjectStreamer(
         getTargetTriple(), *Context, *MAB, Out, MCE, STI,
         Options.MCOptions.MCRelaxAll, Options.MCOptions.MCNoExecStack));
+    static_cast<MCObjectStreamer &>(*AsmStreamer).getAssembler()
+        .setRelocationThreads(Options.MCOptions.MCRelocationThreads);
     break;
   }
   case CGFT_Null:
@@ -258,6 +261,8 @@ bool LLVMTargetMachine::addPassesToEmitMC(PassManagerBase &PM,
   AsmStreamer.reset(getTarget().createMCObjectStreamer(
       getTargetTriple(), *Ctx, *MAB, Out, MCE, STI,
       Options.MCOptions.MCRelaxAll, Options.MCOptions.MCNoExecStack));
+  static_cast<MCObjectStreamer &>(*AsmStreamer).getAssembler()
+      .setRelocationThreads(Options.MCOptions.MCRelocationThreads);
 
   // Create the AsmPrinter, which takes ownership of AsmStreamer if successful.
   FunctionPass *Printer = getTarget().createAsmPrinter(*this, *AsmStreamer);
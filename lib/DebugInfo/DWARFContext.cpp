@@ -11,6 +11,7 @@
 #include "DWARFDebugArangeSet.h"
 
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Dwarf.h"
@@ -24,6 +25,8 @@ using namespace object;
 
 #define DEBUG_TYPE "dwarf"
 
+STATISTIC(NumUnitsEvicted, "Number of compile units evicted");
+
 typedef DWARFDebugLine::LineTable DWARFLineTable;
 typedef DILineInfoSpecifier::FileLineInfoKind FileLineInfoKind;
 typedef DILineInfoSpecifier::FunctionNameKind FunctionNameKind;
@@ -422,7 +425,36 @@ DWARFCompileUnit *DWARFContext::getCompileUnitForAddress(uint64_t Address) {
   // First, get the offset of the compile unit.
   uint32_t CUOffset = getDebugAranges()->findAddress(Address);
   // Retrieve the compile unit.
-  return getCompileUnitForOffset(CUOffset);
+  DWARFCompileUnit *CU = getCompileUnitForOffset(CUOffset);
+  if (CU)
+    touchUnit(CU);
+  return CU;
+}
+
+void DWARFContext::touchUnit(DWARFCompileUnit *CU) {
+  if (MaxResidentUnits == 0)
+    return;
+  auto I = ResidentUnitPositions.find(CU);
+  if (I != ResidentUnitPositions.end()) {
+    ResidentUnits.splice(ResidentUnits.begin(), ResidentUnits, I->second);
+    return;
+  }
+  ResidentUnits.push_front(CU);
+  ResidentUnitPositions[CU] = ResidentUnits.begin();
+  while (ResidentUnits.size() > MaxResidentUnits) {
+    DWARFCompileUnit *Victim = ResidentUnits.back();
+    ResidentUnits.pop_back();
+    ResidentUnitPositions.erase(Victim);
+    if (Line) {
+      unsigned stmtOffset =
+          Victim->getCompileUnitDIE()->getAttributeValueAsSectionOffset(
+              Victim, DW_AT_stmt_list, -1U);
+      if (stmtOffset != -1U)
+        Line->clearLineTable(stmtOffset);
+    }
+    Victim->releaseLookupData();
+    ++NumUnitsEvicted;
+  }
 }
 
 static bool getFileNameForUnit(DWARFCompileUnit *U,
@@ -17,9 +17,11 @@
 #include "DWARFDebugLoc.h"
 #include "DWARFDebugRangeList.h"
 #include "DWARFTypeUnit.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/DebugInfo/DIContext.h"
+#include <list>
 
 namespace llvm {
 
@@ -44,6 +46,13 @@ class DWARFContext : public DIContext {
   std::unique_ptr<DWARFDebugAbbrev> AbbrevDWO;
   std::unique_ptr<DWARFDebugLocDWO> LocDWO;
 
+  /// Compile units that answered address queries, most recently used first.
+  typedef std::list<DWARFCompileUnit *> UnitListTy;
+  UnitListTy ResidentUnits;
+  DenseMap<DWARFCompileUnit *, UnitListTy::iterator> ResidentUnitPositions;
+  /// Maximum size of ResidentUnits, or 0 for no limit.
+  unsigned MaxResidentUnits;
+
   DWARFContext(DWARFContext &) LLVM_DELETED_FUNCTION;
   DWARFContext &operator=(DWARFContext &) LLVM_DELETED_FUNCTION;
 
@@ -69,7 +78,7 @@ public:
     RelocAddrMap Relocs;
   };
 
-  DWARFContext() : DIContext(CK_DWARF) {}
+  DWARFContext() : DIContext(CK_DWARF), MaxResidentUnits(0) {}
 
   static bool classof(const DIContext *DICtx) {
     return DICtx->getKind() == CK_DWARF;
@@ -161,6 +170,14 @@ public:
   /// Get a pointer to a parsed line table corresponding to a compile unit.
   const DWARFDebugLine::LineTable *getLineTableForUnit(DWARFUnit *cu);
 
+  /// Limit the number of compile units whose line table and lookup data are
+  /// kept in memory between address queries. When the limit is exceeded, the
+  /// data of the least recently queried unit is released. Zero, the default,
+  /// keeps everything.
+  void setMaxResidentUnits(unsigned Max) override {
+    MaxResidentUnits = Max;
+  }
+
   DILineInfo getLineInfoForAddress(uint64_t Address,
       DILineInfoSpecifier Specifier = DILineInfoSpecifier()) override;
   DILineInfoTable getLineInfoForAddressRange(uint64_t Address, uint64_t Size,
@@ -207,6 +224,10 @@ private:
   /// Return the compile unit which contains instruction with provided
   /// address.
   DWARFCompileUnit *getCompileUnitForAddress(uint64_t Address);
+
+  /// Mark CU as the most recently queried unit, releasing the data of the
+  /// least recently queried ones if there are more than MaxResidentUnits.
+  void touchUnit(DWARFCompileUnit *CU);
 };
 
 /// DWARFContextInMemory is the simplest possible implementation of a
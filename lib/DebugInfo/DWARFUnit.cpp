@@ -9,14 +9,21 @@
 
 #include "DWARFUnit.h"
 #include "DWARFContext.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/DebugInfo/DWARFFormValue.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
 #include <cstdio>
+#include <set>
 
 using namespace llvm;
 using namespace dwarf;
 
+#define DEBUG_TYPE "dwarf"
+
+STATISTIC(NumSubprogramIndexes, "Number of subprogram indexes built");
+
 DWARFUnit::DWARFUnit(DWARFContext &DC, const DWARFDebugAbbrev *DA,
                      StringRef IS, StringRef RS, StringRef SS, StringRef SOS,
                      StringRef AOS, const RelocAddrMap *M, bool LE)
@@ -106,6 +113,8 @@ void DWARFUnit::clear() {
   RangeSectionBase = 0;
   AddrOffsetSectionBase = 0;
   clearDIEs(false);
+  SubprogramIndex.clear();
+  SubprogramIndexBuilt = false;
   DWO.reset();
 }
 
@@ -125,13 +134,14 @@ uint64_t DWARFUnit::getDWOId() {
       .getAttributeValueAsUnsignedConstant(this, DW_AT_GNU_dwo_id, FailValue);
 }
 
-void DWARFUnit::setDIERelations() {
-  if (DieArray.size() <= 1)
+void DWARFUnit::setDIERelations(
+    std::vector<DWARFDebugInfoEntryMinimal> &DIEs) {
+  if (DIEs.size() <= 1)
     return;
 
   std::vector<DWARFDebugInfoEntryMinimal *> ParentChain;
   DWARFDebugInfoEntryMinimal *SiblingChain = nullptr;
-  for (auto &DIE : DieArray) {
+  for (auto &DIE : DIEs) {
     if (SiblingChain) {
       SiblingChain->setSibling(&DIE);
     }
@@ -150,7 +160,7 @@ void DWARFUnit::setDIERelations() {
       ParentChain.pop_back();
     }
   }
-  assert(SiblingChain == nullptr || SiblingChain == &DieArray[0]);
+  assert(SiblingChain == nullptr || SiblingChain == &DIEs[0]);
   assert(ParentChain.empty());
 }
 
@@ -205,6 +215,29 @@ void DWARFUnit::extractDIEsToVector(
                     "bounds cu 0x%8.8x at 0x%8.8x'\n", getOffset(), DIEOffset);
 }
 
+void DWARFUnit::extractSubtree(
+    uint32_t DIEOffset, std::vector<DWARFDebugInfoEntryMinimal> &Dies) const {
+  Dies.clear();
+  uint32_t NextCUOffset = getNextUnitOffset();
+  DWARFDebugInfoEntryMinimal DIE;
+  uint32_t Depth = 0;
+
+  while (DIEOffset < NextCUOffset && DIE.extractFast(this, &DIEOffset)) {
+    Dies.push_back(DIE);
+    if (const DWARFAbbreviationDeclaration *AbbrDecl =
+            DIE.getAbbreviationDeclarationPtr()) {
+      if (AbbrDecl->hasChildren())
+        ++Depth;
+    } else if (Depth > 0) {
+      --Depth;
+    }
+    if (Depth == 0)
+      break;  // We are done with this subtree.
+  }
+
+  setDIERelations(Dies);
+}
+
 size_t DWARFUnit::extractDIEsIfNeeded(bool CUDieOnly) {
   if ((CUDieOnly && DieArray.size() > 0) ||
       DieArray.size() > 1)
@@ -231,7 +264,7 @@ size_t DWARFUnit::extractDIEsIfNeeded(bool CUDieOnly) {
     // skeleton CU DIE, so that DWARF users not aware of it are not broken.
   }
 
-  setDIERelations();
+  setDIERelations(DieArray);
   return DieArray.size();
 }
 
@@ -325,39 +358,109 @@ void DWARFUnit::collectAddressRanges(DWARFAddressRangesVector &CURanges) {
     clearDIEs(true);
 }
 
-const DWARFDebugInfoEntryMinimal *
-DWARFUnit::getSubprogramForAddress(uint64_t Address) {
-  extractDIEsIfNeeded(false);
-  for (const DWARFDebugInfoEntryMinimal &DIE : DieArray) {
-    if (DIE.isSubprogramDIE() &&
-        DIE.addressRangeContainsAddress(this, Address)) {
-      return &DIE;
+void DWARFUnit::buildSubprogramIndex() {
+  if (SubprogramIndexBuilt)
+    return;
+  SubprogramIndexBuilt = true;
+  ++NumSubprogramIndexes;
+
+  // Scan a temporary copy of the DIEs unless they are parsed already, so that
+  // only the ranges stay in memory.
+  extractDIEsIfNeeded(true);
+  std::vector<DWARFDebugInfoEntryMinimal> TmpDIEs;
+  if (DieArray.size() <= 1)
+    extractDIEsToVector(false, true, TmpDIEs);
+  const std::vector<DWARFDebugInfoEntryMinimal> &DIEs =
+      DieArray.size() > 1 ? DieArray : TmpDIEs;
+
+  struct Endpoint {
+    uint64_t Address;
+    uint32_t DIEOffset;
+    bool IsRangeStart;
+    bool operator<(const Endpoint &Other) const {
+      return Address < Other.Address;
+    }
+  };
+  std::vector<Endpoint> Endpoints;
+  for (const DWARFDebugInfoEntryMinimal &DIE : DIEs) {
+    if (!DIE.isSubprogramDIE())
+      continue;
+    for (const auto &R : DIE.getAddressRanges(this)) {
+      if (R.first >= R.second)
+        continue;
+      Endpoint Start = { R.first, DIE.getOffset(), true };
+      Endpoint End = { R.second, DIE.getOffset(), false };
+      Endpoints.push_back(Start);
+      Endpoints.push_back(End);
     }
   }
-  return nullptr;
+
+  // Split the ranges at every endpoint. Where subprograms overlap, the one
+  // that comes first in the unit wins, as it did with a linear search.
+  std::multiset<uint32_t> ValidDIEs;
+  std::sort(Endpoints.begin(), Endpoints.end());
+  uint64_t PrevAddress = -1ULL;
+  for (const Endpoint &E : Endpoints) {
+    if (PrevAddress < E.Address && !ValidDIEs.empty()) {
+      uint32_t DIEOffset = *ValidDIEs.begin();
+      if (!SubprogramIndex.empty() &&
+          SubprogramIndex.back().HighPC == PrevAddress &&
+          SubprogramIndex.back().DIEOffset == DIEOffset) {
+        SubprogramIndex.back().HighPC = E.Address;
+      } else {
+        SubprogramRange R = { PrevAddress, E.Address, DIEOffset };
+        SubprogramIndex.push_back(R);
+      }
+    }
+    if (E.IsRangeStart)
+      ValidDIEs.insert(E.DIEOffset);
+    else
+      ValidDIEs.erase(ValidDIEs.find(E.DIEOffset));
+    PrevAddress = E.Address;
+  }
+  SubprogramIndex.shrink_to_fit();
+}
+
+bool DWARFUnit::extractSubprogramForAddress(
+    uint64_t Address, std::vector<DWARFDebugInfoEntryMinimal> &DIEs) {
+  buildSubprogramIndex();
+  auto It = std::upper_bound(
+      SubprogramIndex.begin(), SubprogramIndex.end(), Address,
+      [](uint64_t Address, const SubprogramRange &R) {
+        return Address < R.LowPC;
+      });
+  if (It == SubprogramIndex.begin() || Address >= (--It)->HighPC)
+    return false;
+  extractSubtree(It->DIEOffset, DIEs);
+  return !DIEs.empty();
 }
 
 DWARFDebugInfoEntryInlinedChain
 DWARFUnit::getInlinedChainForAddress(uint64_t Address) {
   // First, find a subprogram that contains the given address (the root
-  // of inlined chain).
+  // of inlined chain). Only the subtree of that subprogram is parsed.
   const DWARFUnit *ChainCU = nullptr;
-  const DWARFDebugInfoEntryMinimal *SubprogramDIE =
-      getSubprogramForAddress(Address);
-  if (SubprogramDIE) {
+  std::vector<DWARFDebugInfoEntryMinimal> SubprogramDIEs;
+  if (extractSubprogramForAddress(Address, SubprogramDIEs)) {
     ChainCU = this;
   } else {
     // Try to look for subprogram DIEs in the DWO file.
     parseDWO();
-    if (DWO.get()) {
-      SubprogramDIE = DWO->getUnit()->getSubprogramForAddress(Address);
-      if (SubprogramDIE)
-        ChainCU = DWO->getUnit();
-    }
+    if (DWO.get() &&
+        DWO->getUnit()->extractSubprogramForAddress(Address, SubprogramDIEs))
+      ChainCU = DWO->getUnit();
   }
 
   // Get inlined chain rooted at this subprogram DIE.
-  if (!SubprogramDIE)
+  if (!ChainCU)
     return DWARFDebugInfoEntryInlinedChain();
-  return SubprogramDIE->getInlinedChainForAddress(ChainCU, Address);
+  return SubprogramDIEs[0].getInlinedChainForAddress(ChainCU, Address);
+}
+
+void DWARFUnit::releaseLookupData() {
+  clearDIEs(true);
+  std::vector<SubprogramRange> EmptyIndex;
+  SubprogramIndex.swap(EmptyIndex);
+  SubprogramIndexBuilt = false;
+  DWO.reset();
 }
@@ -50,6 +50,16 @@ class DWARFUnit {
   // The compile unit debug information entry items.
   std::vector<DWARFDebugInfoEntryMinimal> DieArray;
 
+  /// Address range covered by a subprogram DIE. The ranges of the index are
+  /// sorted and do not overlap.
+  struct SubprogramRange {
+    uint64_t LowPC;
+    uint64_t HighPC;
+    uint32_t DIEOffset;
+  };
+  std::vector<SubprogramRange> SubprogramIndex;
+  bool SubprogramIndexBuilt;
+
   class DWOHolder {
     object::OwningBinary<object::ObjectFile> DWOFile;
     std::unique_ptr<DWARFContext> DWOContext;
@@ -136,6 +146,11 @@ public:
   /// chain is valid as long as parsed compile unit DIEs are not cleared.
   DWARFDebugInfoEntryInlinedChain getInlinedChainForAddress(uint64_t Address);
 
+  /// releaseLookupData - Drop the DIEs (but the compile unit DIE), the
+  /// subprogram index and the .dwo file loaded to answer address queries.
+  /// They are rebuilt on the next query.
+  void releaseLookupData();
+
 private:
   /// Size in bytes of the .debug_info data associated with this compile unit.
   size_t getDebugInfoSize() const { return Length + 4 - getHeaderSize(); }
@@ -146,10 +161,14 @@ private:
   /// extractDIEsToVector - Appends all parsed DIEs to a vector.
   void extractDIEsToVector(bool AppendCUDie, bool AppendNonCUDIEs,
                            std::vector<DWARFDebugInfoEntryMinimal> &DIEs) const;
+  /// extractSubtree - Fills a vector with the DIE at offset DIEOffset and all
+  /// of its children, and sets their relations.
+  void extractSubtree(uint32_t DIEOffset,
+                      std::vector<DWARFDebugInfoEntryMinimal> &DIEs) const;
   /// setDIERelations - We read in all of the DIE entries into our flat list
   /// of DIE entries and now we need to go back through all of them and set the
   /// parent, sibling and child pointers for quick DIE navigation.
-  void setDIERelations();
+  static void setDIERelations(std::vector<DWARFDebugInfoEntryMinimal> &DIEs);
   /// clearDIEs - Clear parsed DIEs to keep memory usage low.
   void clearDIEs(bool KeepCUDie);
 
@@ -157,10 +176,16 @@ private:
   /// it was actually constructed.
   bool parseDWO();
 
-  /// getSubprogramForAddress - Returns subprogram DIE with address range
-  /// encompassing the provided address. The pointer is alive as long as parsed
-  /// compile unit DIEs are not cleared.
-  const DWARFDebugInfoEntryMinimal *getSubprogramForAddress(uint64_t Address);
+  /// buildSubprogramIndex - Collects the address ranges of all subprogram DIEs
+  /// of the unit if it hasn't already been done. The DIEs themselves are not
+  /// kept unless they were already parsed.
+  void buildSubprogramIndex();
+
+  /// extractSubprogramForAddress - Fills a vector with the subtree of the
+  /// subprogram DIE with address range encompassing the provided address.
+  /// Returns false if there is no such subprogram.
+  bool extractSubprogramForAddress(
+      uint64_t Address, std::vector<DWARFDebugInfoEntryMinimal> &DIEs);
 };
 
 }
@@ -58,6 +58,7 @@ ExecutionEngine::ExecutionEngine(std::unique_ptr<Module> M)
   : EEState(*this),
     LazyFunctionCreator(nullptr) {
   CompilingLazily         = false;
+  LazyFunctionStubs       = false;
   GVCompilationDisabled   = false;
   SymbolSearchingDisabled = false;
 
@@ -413,6 +414,7 @@ void EngineBuilder::InitEngine() {
 #else
   VerifyModules = false;
 #endif
+  LazyFunctionStubs = false;
 }
 
 ExecutionEngine *EngineBuilder::create(TargetMachine *TM) {
@@ -454,6 +456,7 @@ ExecutionEngine *EngineBuilder::create(TargetMachine *TM) {
                                       MCJMM ? MCJMM : JMM, std::move(TheTM));
     if (EE) {
       EE->setVerifyModules(VerifyModules);
+      EE->setLazyFunctionStubs(LazyFunctionStubs);
       return EE;
     }
   }
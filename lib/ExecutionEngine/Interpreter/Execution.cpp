@@ -13,6 +13,7 @@
 
 #include "Interpreter.h"
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/IntrinsicLowering.h"
 #include "llvm/IR/Constants.h"
@@ -38,8 +39,25 @@ static cl::opt<bool> PrintVolatile("interpreter-print-volatile", cl::Hidden,
 //                     Various Helper Functions
 //===----------------------------------------------------------------------===//
 
+// getCurrentInst - Return the lowered instruction that SF is executing.
+static const LoweredInst &getCurrentInst(ExecutionContext &SF) {
+  return SF.Info->Insts[SF.CurInst - 1];
+}
+
+// getBlockOperand - Return the index of the first instruction of the basic
+// block that is operand OpNo of LI.
+static unsigned getBlockOperand(const LoweredInst &LI, unsigned OpNo,
+                                ExecutionContext &SF) {
+  return SF.Info->Operands[LI.FirstOperand + OpNo];
+}
+
+// SetValue - Set the value of V, which must be the instruction that SF is
+// executing.
 static void SetValue(Value *V, GenericValue Val, ExecutionContext &SF) {
-  SF.Values[V] = Val;
+  const LoweredInst &LI = getCurrentInst(SF);
+  assert(LI.I == V && "Not the instruction being executed!");
+  (void)V;
+  SF.Values[LI.Result] = Val;
 }
 
 //===----------------------------------------------------------------------===//
@@ -277,8 +295,8 @@ static GenericValue executeICMP_SGE(GenericValue Src1, GenericValue Src2,
 void Interpreter::visitICmpInst(ICmpInst &I) {
   ExecutionContext &SF = ECStack.back();
   Type *Ty    = I.getOperand(0)->getType();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue R;   // Result
   
   switch (I.getPredicate()) {
@@ -609,8 +627,8 @@ static GenericValue executeFCMP_BOOL(GenericValue Src1, GenericValue Src2,
 void Interpreter::visitFCmpInst(FCmpInst &I) {
   ExecutionContext &SF = ECStack.back();
   Type *Ty    = I.getOperand(0)->getType();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue R;   // Result
   
   switch (I.getPredicate()) {
@@ -680,8 +698,8 @@ static GenericValue executeCmpInst(unsigned predicate, GenericValue Src1,
 void Interpreter::visitBinaryOperator(BinaryOperator &I) {
   ExecutionContext &SF = ECStack.back();
   Type *Ty    = I.getOperand(0)->getType();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue R;   // Result
 
   // First process vector operation
@@ -805,9 +823,9 @@ static GenericValue executeSelectInst(GenericValue Src1, GenericValue Src2,
 void Interpreter::visitSelectInst(SelectInst &I) {
   ExecutionContext &SF = ECStack.back();
   const Type * Ty = I.getOperand(0)->getType();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
-  GenericValue Src3 = getOperandValue(I.getOperand(2), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
+  GenericValue Src3 = getOperandValue(I, 2, SF);
   GenericValue R = executeSelectInst(Src1, Src2, Src3, Ty);
   SetValue(&I, R, SF);
 }
@@ -852,8 +870,12 @@ void Interpreter::popStackAndReturnValueToCaller(Type *RetTy,
       // Save result...
       if (!CallingSF.Caller.getType()->isVoidTy())
         SetValue(I, Result, CallingSF);
-      if (InvokeInst *II = dyn_cast<InvokeInst> (I))
-        SwitchToNewBasicBlock (II->getNormalDest (), CallingSF);
+      // The normal destination of an invoke is its next to last operand.
+      if (isa<InvokeInst>(I))
+        SwitchToNewBasicBlock(getBlockOperand(getCurrentInst(CallingSF),
+                                              I->getNumOperands() - 2,
+                                              CallingSF),
+                              CallingSF);
       CallingSF.Caller = CallSite();          // We returned from the call...
     }
   }
@@ -867,7 +889,7 @@ void Interpreter::visitReturnInst(ReturnInst &I) {
   // Save away the return value... (if we are not 'ret void')
   if (I.getNumOperands()) {
     RetTy  = I.getReturnValue()->getType();
-    Result = getOperandValue(I.getReturnValue(), SF);
+    Result = getOperandValue(I, 0, SF);
   }
 
   popStackAndReturnValueToCaller(RetTy, Result);
@@ -879,40 +901,40 @@ void Interpreter::visitUnreachableInst(UnreachableInst &I) {
 
 void Interpreter::visitBranchInst(BranchInst &I) {
   ExecutionContext &SF = ECStack.back();
-  BasicBlock *Dest;
+  const LoweredInst &LI = getCurrentInst(SF);
 
-  Dest = I.getSuccessor(0);          // Uncond branches have a fixed dest...
-  if (!I.isUnconditional()) {
-    Value *Cond = I.getCondition();
-    if (getOperandValue(Cond, SF).IntVal == 0) // If false cond...
-      Dest = I.getSuccessor(1);
-  }
-  SwitchToNewBasicBlock(Dest, SF);
+  // The operands of a conditional branch are its condition, then its false
+  // and true destinations; an unconditional one only has its destination.
+  unsigned Dest = I.getNumOperands() - 1;
+  if (!I.isUnconditional() &&
+      getOperandValue(LI, 0, SF).IntVal == 0) // If false cond...
+    Dest = 1;
+  SwitchToNewBasicBlock(getBlockOperand(LI, Dest, SF), SF);
 }
 
 void Interpreter::visitSwitchInst(SwitchInst &I) {
   ExecutionContext &SF = ECStack.back();
-  Value* Cond = I.getCondition();
-  Type *ElTy = Cond->getType();
-  GenericValue CondVal = getOperandValue(Cond, SF);
-
-  // Check to see if any of the cases match...
-  BasicBlock *Dest = nullptr;
-  for (SwitchInst::CaseIt i = I.case_begin(), e = I.case_end(); i != e; ++i) {
-    GenericValue CaseVal = getOperandValue(i.getCaseValue(), SF);
+  const LoweredInst &LI = getCurrentInst(SF);
+  Type *ElTy = I.getCondition()->getType();
+  GenericValue CondVal = getOperandValue(LI, 0, SF);
+
+  // The condition and the default destination are followed by the value and
+  // the destination of each case. Check to see if any of the cases match...
+  unsigned Dest = 1;   // No cases matched: use default
+  for (unsigned Op = 2, E = I.getNumOperands(); Op != E; Op += 2) {
+    GenericValue CaseVal = getOperandValue(LI, Op, SF);
     if (executeICMP_EQ(CondVal, CaseVal, ElTy).IntVal != 0) {
-      Dest = cast<BasicBlock>(i.getCaseSuccessor());
+      Dest = Op + 1;
       break;
     }
   }
-  if (!Dest) Dest = I.getDefaultDest();   // No cases matched: use default
-  SwitchToNewBasicBlock(Dest, SF);
+  SwitchToNewBasicBlock(getBlockOperand(LI, Dest, SF), SF);
 }
 
 void Interpreter::visitIndirectBrInst(IndirectBrInst &I) {
   ExecutionContext &SF = ECStack.back();
-  void *Dest = GVTOP(getOperandValue(I.getAddress(), SF));
-  SwitchToNewBasicBlock((BasicBlock*)Dest, SF);
+  void *Dest = GVTOP(getOperandValue(I, 0, SF));
+  SwitchToNewBasicBlock(SF.Info->BlockStarts[(BasicBlock*)Dest], SF);
 }
 
 
@@ -926,32 +948,29 @@ void Interpreter::visitIndirectBrInst(IndirectBrInst &I) {
 // their inputs.  If the input PHI node is updated before it is read, incorrect
 // results can happen.  Thus we use a two phase approach.
 //
-void Interpreter::SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF){
+void Interpreter::SwitchToNewBasicBlock(unsigned Dest, ExecutionContext &SF) {
+  const std::vector<LoweredInst> &Insts = SF.Info->Insts;
   BasicBlock *PrevBB = SF.CurBB;      // Remember where we came from...
-  SF.CurBB   = Dest;                  // Update CurBB to branch destination
-  SF.CurInst = SF.CurBB->begin();     // Update new instruction ptr...
+  SF.CurBB   = Insts[Dest].I->getParent(); // Update CurBB to branch destination
+  SF.CurInst = Dest;                  // Update new instruction index...
 
-  if (!isa<PHINode>(SF.CurInst)) return;  // Nothing fancy to do
+  if (!isa<PHINode>(Insts[Dest].I)) return;  // Nothing fancy to do
 
   // Loop over all of the PHI nodes in the current block, reading their inputs.
-  std::vector<GenericValue> ResultValues;
+  SmallVector<GenericValue, 8> ResultValues;
 
-  for (; PHINode *PN = dyn_cast<PHINode>(SF.CurInst); ++SF.CurInst) {
+  for (; PHINode *PN = dyn_cast<PHINode>(Insts[SF.CurInst].I); ++SF.CurInst) {
     // Search for the value corresponding to this previous bb...
     int i = PN->getBasicBlockIndex(PrevBB);
     assert(i != -1 && "PHINode doesn't contain entry for predecessor??");
-    Value *IncomingValue = PN->getIncomingValue(i);
 
     // Save the incoming value for this PHI node...
-    ResultValues.push_back(getOperandValue(IncomingValue, SF));
+    ResultValues.push_back(getOperandValue(Insts[SF.CurInst], i, SF));
   }
 
   // Now loop over all of the PHI nodes setting their values...
-  SF.CurInst = SF.CurBB->begin();
-  for (unsigned i = 0; isa<PHINode>(SF.CurInst); ++SF.CurInst, ++i) {
-    PHINode *PN = cast<PHINode>(SF.CurInst);
-    SetValue(PN, ResultValues[i], SF);
-  }
+  for (unsigned i = 0, e = ResultValues.size(); i != e; ++i)
+    SF.Values[Insts[Dest + i].Result] = ResultValues[i];
 }
 
 //===----------------------------------------------------------------------===//
@@ -965,7 +984,7 @@ void Interpreter::visitAllocaInst(AllocaInst &I) {
 
   // Get the number of elements being allocated by the array...
   unsigned NumElements = 
-    getOperandValue(I.getOperand(0), SF).IntVal.getZExtValue();
+    getOperandValue(I, 0, SF).IntVal.getZExtValue();
 
   unsigned TypeSize = (size_t)TD.getTypeAllocSize(Ty);
 
@@ -989,15 +1008,13 @@ void Interpreter::visitAllocaInst(AllocaInst &I) {
 
 // getElementOffset - The workhorse for getelementptr.
 //
-GenericValue Interpreter::executeGEPOperation(Value *Ptr, gep_type_iterator I,
+GenericValue Interpreter::executeGEPOperation(GenericValue Ptr,
+                                              gep_type_iterator I,
                                               gep_type_iterator E,
-                                              ExecutionContext &SF) {
-  assert(Ptr->getType()->isPointerTy() &&
-         "Cannot getElementOffset of a nonpointer type!");
-
+                                              const GenericValue *Indices) {
   uint64_t Total = 0;
 
-  for (; I != E; ++I) {
+  for (; I != E; ++I, ++Indices) {
     if (StructType *STy = dyn_cast<StructType>(*I)) {
       const StructLayout *SLO = TD.getStructLayout(STy);
 
@@ -1008,7 +1025,7 @@ GenericValue Interpreter::executeGEPOperation(Value *Ptr, gep_type_iterator I,
     } else {
       SequentialType *ST = cast<SequentialType>(*I);
       // Get the index number for the array... which must be long type...
-      GenericValue IdxGV = getOperandValue(I.getOperand(), SF);
+      const GenericValue &IdxGV = *Indices;
 
       int64_t Idx;
       unsigned BitWidth = 
@@ -1024,20 +1041,25 @@ GenericValue Interpreter::executeGEPOperation(Value *Ptr, gep_type_iterator I,
   }
 
   GenericValue Result;
-  Result.PointerVal = ((char*)getOperandValue(Ptr, SF).PointerVal) + Total;
+  Result.PointerVal = ((char*)Ptr.PointerVal) + Total;
   DEBUG(dbgs() << "GEP Index " << Total << " bytes.\n");
   return Result;
 }
 
 void Interpreter::visitGetElementPtrInst(GetElementPtrInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeGEPOperation(I.getPointerOperand(),
-                                   gep_type_begin(I), gep_type_end(I), SF), SF);
+  const LoweredInst &LI = getCurrentInst(SF);
+  SmallVector<GenericValue, 4> Indices;
+  for (unsigned i = 1, e = I.getNumOperands(); i != e; ++i)
+    Indices.push_back(getOperandValue(LI, i, SF));
+  SetValue(&I, executeGEPOperation(getOperandValue(LI, 0, SF),
+                                   gep_type_begin(I), gep_type_end(I),
+                                   Indices.data()), SF);
 }
 
 void Interpreter::visitLoadInst(LoadInst &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue SRC = getOperandValue(I.getPointerOperand(), SF);
+  GenericValue SRC = getOperandValue(I, 0, SF);
   GenericValue *Ptr = (GenericValue*)GVTOP(SRC);
   GenericValue Result;
   LoadValueFromMemory(Result, Ptr, I.getType());
@@ -1048,8 +1070,8 @@ void Interpreter::visitLoadInst(LoadInst &I) {
 
 void Interpreter::visitStoreInst(StoreInst &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Val = getOperandValue(I.getOperand(0), SF);
-  GenericValue SRC = getOperandValue(I.getPointerOperand(), SF);
+  GenericValue Val = getOperandValue(I, 0, SF);
+  GenericValue SRC = getOperandValue(I, 1, SF);
   StoreValueToMemory(Val, (GenericValue *)GVTOP(SRC),
                      I.getOperand(0)->getType());
   if (I.isVolatile() && PrintVolatile)
@@ -1079,7 +1101,8 @@ void Interpreter::visitCallSite(CallSite CS) {
     case Intrinsic::vaend:    // va_end is a noop for the interpreter
       return;
     case Intrinsic::vacopy:   // va_copy: dest = src
-      SetValue(CS.getInstruction(), getOperandValue(*CS.arg_begin(), SF), SF);
+      SetValue(CS.getInstruction(),
+               getOperandValue(*CS.getInstruction(), 0, SF), SF);
       return;
     default:
       // If it is an unknown intrinsic function, use the intrinsic lowering
@@ -1092,32 +1115,31 @@ void Interpreter::visitCallSite(CallSite CS) {
         --me;
       IL->LowerIntrinsicCall(cast<CallInst>(CS.getInstruction()));
 
-      // Restore the CurInst pointer to the first instruction newly inserted, if
-      // any.
-      if (atBegin) {
-        SF.CurInst = Parent->begin();
-      } else {
-        SF.CurInst = me;
-        ++SF.CurInst;
-      }
+      // Resume at the first instruction newly inserted, if any.
+      if (atBegin)
+        me = Parent->begin();
+      else
+        ++me;
+      relowerFunction(SF, me);
       return;
     }
 
 
   SF.Caller = CS;
+  const LoweredInst &LI = getCurrentInst(SF);
   std::vector<GenericValue> ArgVals;
   const unsigned NumArgs = SF.Caller.arg_size();
   ArgVals.reserve(NumArgs);
-  uint16_t pNum = 1;
-  for (CallSite::arg_iterator i = SF.Caller.arg_begin(),
-         e = SF.Caller.arg_end(); i != e; ++i, ++pNum) {
-    Value *V = *i;
-    ArgVals.push_back(getOperandValue(V, SF));
-  }
+  for (unsigned i = 0; i != NumArgs; ++i)
+    ArgVals.push_back(getOperandValue(LI, i, SF));
 
   // To handle indirect calls, we must get the pointer value from the argument
-  // and treat it as a function pointer.
-  GenericValue SRC = getOperandValue(SF.Caller.getCalledValue(), SF);
+  // and treat it as a function pointer. The callee is the last operand of a
+  // call, and is followed by the two destinations of an invoke.
+  unsigned CalleeOp = CS.getInstruction()->getNumOperands() - 1;
+  if (CS.isInvoke())
+    CalleeOp -= 2;
+  GenericValue SRC = getOperandValue(LI, CalleeOp, SF);
   callFunction((Function*)GVTOP(SRC), ArgVals);
 }
 
@@ -1135,8 +1157,8 @@ static unsigned getShiftAmount(uint64_t orgShiftAmount,
 
 void Interpreter::visitShl(BinaryOperator &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue Dest;
   const Type *Ty = I.getType();
 
@@ -1162,8 +1184,8 @@ void Interpreter::visitShl(BinaryOperator &I) {
 
 void Interpreter::visitLShr(BinaryOperator &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue Dest;
   const Type *Ty = I.getType();
 
@@ -1189,8 +1211,8 @@ void Interpreter::visitLShr(BinaryOperator &I) {
 
 void Interpreter::visitAShr(BinaryOperator &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue Dest;
   const Type *Ty = I.getType();
 
@@ -1214,10 +1236,9 @@ void Interpreter::visitAShr(BinaryOperator &I) {
   SetValue(&I, Dest, SF);
 }
 
-GenericValue Interpreter::executeTruncInst(Value *SrcVal, Type *DstTy,
-                                           ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
-  Type *SrcTy = SrcVal->getType();
+GenericValue Interpreter::executeTruncInst(GenericValue Src, Type *SrcTy,
+                                           Type *DstTy) {
+  GenericValue Dest;
   if (SrcTy->isVectorTy()) {
     Type *DstVecTy = DstTy->getScalarType();
     unsigned DBitWidth = cast<IntegerType>(DstVecTy)->getBitWidth();
@@ -1234,10 +1255,9 @@ GenericValue Interpreter::executeTruncInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeSExtInst(Value *SrcVal, Type *DstTy,
-                                          ExecutionContext &SF) {
-  const Type *SrcTy = SrcVal->getType();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeSExtInst(GenericValue Src, Type *SrcTy,
+                                          Type *DstTy) {
+  GenericValue Dest;
   if (SrcTy->isVectorTy()) {
     const Type *DstVecTy = DstTy->getScalarType();
     unsigned DBitWidth = cast<IntegerType>(DstVecTy)->getBitWidth();
@@ -1254,10 +1274,9 @@ GenericValue Interpreter::executeSExtInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeZExtInst(Value *SrcVal, Type *DstTy,
-                                          ExecutionContext &SF) {
-  const Type *SrcTy = SrcVal->getType();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeZExtInst(GenericValue Src, Type *SrcTy,
+                                          Type *DstTy) {
+  GenericValue Dest;
   if (SrcTy->isVectorTy()) {
     const Type *DstVecTy = DstTy->getScalarType();
     unsigned DBitWidth = cast<IntegerType>(DstVecTy)->getBitWidth();
@@ -1275,12 +1294,12 @@ GenericValue Interpreter::executeZExtInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeFPTruncInst(Value *SrcVal, Type *DstTy,
-                                             ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeFPTruncInst(GenericValue Src, Type *SrcTy,
+                                             Type *DstTy) {
+  GenericValue Dest;
 
-  if (SrcVal->getType()->getTypeID() == Type::VectorTyID) {
-    assert(SrcVal->getType()->getScalarType()->isDoubleTy() &&
+  if (SrcTy->getTypeID() == Type::VectorTyID) {
+    assert(SrcTy->getScalarType()->isDoubleTy() &&
            DstTy->getScalarType()->isFloatTy() &&
            "Invalid FPTrunc instruction");
 
@@ -1290,7 +1309,7 @@ GenericValue Interpreter::executeFPTruncInst(Value *SrcVal, Type *DstTy,
     for (unsigned i = 0; i < size; i++)
       Dest.AggregateVal[i].FloatVal = (float)Src.AggregateVal[i].DoubleVal;
   } else {
-    assert(SrcVal->getType()->isDoubleTy() && DstTy->isFloatTy() &&
+    assert(SrcTy->isDoubleTy() && DstTy->isFloatTy() &&
            "Invalid FPTrunc instruction");
     Dest.FloatVal = (float)Src.DoubleVal;
   }
@@ -1298,12 +1317,12 @@ GenericValue Interpreter::executeFPTruncInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeFPExtInst(Value *SrcVal, Type *DstTy,
-                                           ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeFPExtInst(GenericValue Src, Type *SrcTy,
+                                           Type *DstTy) {
+  GenericValue Dest;
 
-  if (SrcVal->getType()->getTypeID() == Type::VectorTyID) {
-    assert(SrcVal->getType()->getScalarType()->isFloatTy() &&
+  if (SrcTy->getTypeID() == Type::VectorTyID) {
+    assert(SrcTy->getScalarType()->isFloatTy() &&
            DstTy->getScalarType()->isDoubleTy() && "Invalid FPExt instruction");
 
     unsigned size = Src.AggregateVal.size();
@@ -1312,7 +1331,7 @@ GenericValue Interpreter::executeFPExtInst(Value *SrcVal, Type *DstTy,
     for (unsigned i = 0; i < size; i++)
       Dest.AggregateVal[i].DoubleVal = (double)Src.AggregateVal[i].FloatVal;
   } else {
-    assert(SrcVal->getType()->isFloatTy() && DstTy->isDoubleTy() &&
+    assert(SrcTy->isFloatTy() && DstTy->isDoubleTy() &&
            "Invalid FPExt instruction");
     Dest.DoubleVal = (double)Src.FloatVal;
   }
@@ -1320,10 +1339,9 @@ GenericValue Interpreter::executeFPExtInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeFPToUIInst(Value *SrcVal, Type *DstTy,
-                                            ExecutionContext &SF) {
-  Type *SrcTy = SrcVal->getType();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeFPToUIInst(GenericValue Src, Type *SrcTy,
+                                            Type *DstTy) {
+  GenericValue Dest;
 
   if (SrcTy->getTypeID() == Type::VectorTyID) {
     const Type *DstVecTy = DstTy->getScalarType();
@@ -1358,10 +1376,9 @@ GenericValue Interpreter::executeFPToUIInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeFPToSIInst(Value *SrcVal, Type *DstTy,
-                                            ExecutionContext &SF) {
-  Type *SrcTy = SrcVal->getType();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeFPToSIInst(GenericValue Src, Type *SrcTy,
+                                            Type *DstTy) {
+  GenericValue Dest;
 
   if (SrcTy->getTypeID() == Type::VectorTyID) {
     const Type *DstVecTy = DstTy->getScalarType();
@@ -1395,11 +1412,11 @@ GenericValue Interpreter::executeFPToSIInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeUIToFPInst(Value *SrcVal, Type *DstTy,
-                                            ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeUIToFPInst(GenericValue Src, Type *SrcTy,
+                                            Type *DstTy) {
+  GenericValue Dest;
 
-  if (SrcVal->getType()->getTypeID() == Type::VectorTyID) {
+  if (SrcTy->getTypeID() == Type::VectorTyID) {
     const Type *DstVecTy = DstTy->getScalarType();
     unsigned size = Src.AggregateVal.size();
     // the sizes of src and dst vectors must be equal
@@ -1427,11 +1444,11 @@ GenericValue Interpreter::executeUIToFPInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeSIToFPInst(Value *SrcVal, Type *DstTy,
-                                            ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeSIToFPInst(GenericValue Src, Type *SrcTy,
+                                            Type *DstTy) {
+  GenericValue Dest;
 
-  if (SrcVal->getType()->getTypeID() == Type::VectorTyID) {
+  if (SrcTy->getTypeID() == Type::VectorTyID) {
     const Type *DstVecTy = DstTy->getScalarType();
     unsigned size = Src.AggregateVal.size();
     // the sizes of src and dst vectors must be equal
@@ -1461,19 +1478,19 @@ GenericValue Interpreter::executeSIToFPInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executePtrToIntInst(Value *SrcVal, Type *DstTy,
-                                              ExecutionContext &SF) {
+GenericValue Interpreter::executePtrToIntInst(GenericValue Src, Type *SrcTy,
+                                              Type *DstTy) {
   uint32_t DBitWidth = cast<IntegerType>(DstTy)->getBitWidth();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
-  assert(SrcVal->getType()->isPointerTy() && "Invalid PtrToInt instruction");
+  GenericValue Dest;
+  assert(SrcTy->isPointerTy() && "Invalid PtrToInt instruction");
 
   Dest.IntVal = APInt(DBitWidth, (intptr_t) Src.PointerVal);
   return Dest;
 }
 
-GenericValue Interpreter::executeIntToPtrInst(Value *SrcVal, Type *DstTy,
-                                              ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeIntToPtrInst(GenericValue Src, Type *SrcTy,
+                                              Type *DstTy) {
+  GenericValue Dest;
   assert(DstTy->isPointerTy() && "Invalid PtrToInt instruction");
 
   uint32_t PtrSize = TD.getPointerSizeInBits();
@@ -1484,13 +1501,12 @@ GenericValue Interpreter::executeIntToPtrInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeBitCastInst(Value *SrcVal, Type *DstTy,
-                                             ExecutionContext &SF) {
+GenericValue Interpreter::executeBitCastInst(GenericValue Src, Type *SrcTy,
+                                             Type *DstTy) {
 
   // This instruction supports bitwise conversion of vectors to integers and
   // to vectors of other types (as long as they have the same size)
-  Type *SrcTy = SrcVal->getType();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+  GenericValue Dest;
 
   if ((SrcTy->getTypeID() == Type::VectorTyID) ||
       (DstTy->getTypeID() == Type::VectorTyID)) {
@@ -1653,62 +1669,74 @@ GenericValue Interpreter::executeBitCastInst(Value *SrcVal, Type *DstTy,
 
 void Interpreter::visitTruncInst(TruncInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeTruncInst(I.getOperand(0), I.getType(), SF), SF);
+  GenericValue Src = getOperandValue(I, 0, SF);
+  SetValue(&I, executeTruncInst(Src, I.getSrcTy(), I.getType()), SF);
 }
 
 void Interpreter::visitSExtInst(SExtInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeSExtInst(I.getOperand(0), I.getType(), SF), SF);
+  GenericValue Src = getOperandValue(I, 0, SF);
+  SetValue(&I, executeSExtInst(Src, I.getSrcTy(), I.getType()), SF);
 }
 
 void Interpreter::visitZExtInst(ZExtInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeZExtInst(I.getOperand(0), I.getType(), SF), SF);
+  GenericValue Src = getOperandValue(I, 0, SF);
+  SetValue(&I, executeZExtInst(Src, I.getSrcTy(), I.getType()), SF);
 }
 
 void Interpreter::visitFPTruncInst(FPTruncInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeFPTruncInst(I.getOperand(0), I.getType(), SF), SF);
+  GenericValue Src = getOperandValue(I, 0, SF);
+  SetValue(&I, executeFPTruncInst(Src, I.getSrcTy(), I.getType()), SF);
 }
 
 void Interpreter::visitFPExtInst(FPExtInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeFPExtInst(I.getOperand(0), I.getType(), SF), SF);
+  GenericValue Src = getOperandValue(I, 0, SF);
+  SetValue(&I, executeFPExtInst(Src, I.getSrcTy(), I.getType()), SF);
 }
 
 void Interpreter::visitUIToFPInst(UIToFPInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeUIToFPInst(I.getOperand(0), I.getType(), SF), SF);
+  GenericValue Src = getOperandValue(I, 0, SF);
+  SetValue(&I, executeUIToFPInst(Src, I.getSrcTy(), I.getType()), SF);
 }
 
 void Interpreter::visitSIToFPInst(SIToFPInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeSIToFPInst(I.getOperand(0), I.getType(), SF), SF);
+  GenericValue Src = getOperandValue(I, 0, SF);
+  SetValue(&I, executeSIToFPInst(Src, I.getSrcTy(), I.getType()), SF);
 }
 
 void Interpreter::visitFPToUIInst(FPToUIInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeFPToUIInst(I.getOperand(0), I.getType(), SF), SF);
+  GenericValue Src = getOperandValue(I, 0, SF);
+  SetValue(&I, executeFPToUIInst(Src, I.getSrcTy(), I.getType()), SF);
 }
 
 void Interpreter::visitFPToSIInst(FPToSIInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeFPToSIInst(I.getOperand(0), I.getType(), SF), SF);
+  GenericValue Src = getOperandValue(I, 0, SF);
+  SetValue(&I, executeFPToSIInst(Src, I.getSrcTy(), I.getType()), SF);
 }
 
 void Interpreter::visitPtrToIntInst(PtrToIntInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executePtrToIntInst(I.getOperand(0), I.getType(), SF), SF);
+  GenericValue Src = getOperandValue(I, 0, SF);
+  SetValue(&I, executePtrToIntInst(Src, I.getSrcTy(), I.getType()), SF);
 }
 
 void Interpreter::visitIntToPtrInst(IntToPtrInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeIntToPtrInst(I.getOperand(0), I.getType(), SF), SF);
+  GenericValue Src = getOperandValue(I, 0, SF);
+  SetValue(&I, executeIntToPtrInst(Src, I.getSrcTy(), I.getType()), SF);
 }
 
 void Interpreter::visitBitCastInst(BitCastInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeBitCastInst(I.getOperand(0), I.getType(), SF), SF);
+  GenericValue Src = getOperandValue(I, 0, SF);
+  SetValue(&I, executeBitCastInst(Src, I.getSrcTy(), I.getType()), SF);
 }
 
 #define IMPLEMENT_VAARG(TY) \
@@ -1719,7 +1747,7 @@ void Interpreter::visitVAArgInst(VAArgInst &I) {
 
   // Get the incoming valist parameter.  LLI treats the valist as a
   // (ec-stack-depth var-arg-index) pair.
-  GenericValue VAList = getOperandValue(I.getOperand(0), SF);
+  GenericValue VAList = getOperandValue(I, 0, SF);
   GenericValue Dest;
   GenericValue Src = ECStack[VAList.UIntPairVal.first]
                       .VarArgs[VAList.UIntPairVal.second];
@@ -1745,8 +1773,8 @@ void Interpreter::visitVAArgInst(VAArgInst &I) {
 
 void Interpreter::visitExtractElementInst(ExtractElementInst &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue Dest;
 
   Type *Ty = I.getType();
@@ -1783,9 +1811,9 @@ void Interpreter::visitInsertElementInst(InsertElementInst &I) {
   if(!(Ty->isVectorTy()) )
     llvm_unreachable("Unhandled dest type for insertelement instruction");
 
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
-  GenericValue Src3 = getOperandValue(I.getOperand(2), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
+  GenericValue Src3 = getOperandValue(I, 2, SF);
   GenericValue Dest;
 
   Type *TyContained = Ty->getContainedType(0);
@@ -1818,9 +1846,9 @@ void Interpreter::visitShuffleVectorInst(ShuffleVectorInst &I){
   if(!(Ty->isVectorTy()))
     llvm_unreachable("Unhandled dest type for shufflevector instruction");
 
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
-  GenericValue Src3 = getOperandValue(I.getOperand(2), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
+  GenericValue Src3 = getOperandValue(I, 2, SF);
   GenericValue Dest;
 
   // There is no need to check types of src1 and src2, because the compiled
@@ -1885,7 +1913,7 @@ void Interpreter::visitExtractValueInst(ExtractValueInst &I) {
   ExecutionContext &SF = ECStack.back();
   Value *Agg = I.getAggregateOperand();
   GenericValue Dest;
-  GenericValue Src = getOperandValue(Agg, SF);
+  GenericValue Src = getOperandValue(I, 0, SF);
 
   ExtractValueInst::idx_iterator IdxBegin = I.idx_begin();
   unsigned Num = I.getNumIndices();
@@ -1928,8 +1956,8 @@ void Interpreter::visitInsertValueInst(InsertValueInst &I) {
   ExecutionContext &SF = ECStack.back();
   Value *Agg = I.getAggregateOperand();
 
-  GenericValue Src1 = getOperandValue(Agg, SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue Dest = Src1; // Dest is a slightly changed Src1
 
   ExtractValueInst::idx_iterator IdxBegin = I.idx_begin();
@@ -1972,55 +2000,55 @@ void Interpreter::visitInsertValueInst(InsertValueInst &I) {
 
 GenericValue Interpreter::getConstantExprValue (ConstantExpr *CE,
                                                 ExecutionContext &SF) {
+  GenericValue Op0 = getOperandValue(CE->getOperand(0), SF);
+  Type * Ty = CE->getOperand(0)->getType();
   switch (CE->getOpcode()) {
   case Instruction::Trunc:
-      return executeTruncInst(CE->getOperand(0), CE->getType(), SF);
+      return executeTruncInst(Op0, Ty, CE->getType());
   case Instruction::ZExt:
-      return executeZExtInst(CE->getOperand(0), CE->getType(), SF);
+      return executeZExtInst(Op0, Ty, CE->getType());
   case Instruction::SExt:
-      return executeSExtInst(CE->getOperand(0), CE->getType(), SF);
+      return executeSExtInst(Op0, Ty, CE->getType());
   case Instruction::FPTrunc:
-      return executeFPTruncInst(CE->getOperand(0), CE->getType(), SF);
+      return executeFPTruncInst(Op0, Ty, CE->getType());
   case Instruction::FPExt:
-      return executeFPExtInst(CE->getOperand(0), CE->getType(), SF);
+      return executeFPExtInst(Op0, Ty, CE->getType());
   case Instruction::UIToFP:
-      return executeUIToFPInst(CE->getOperand(0), CE->getType(), SF);
+      return executeUIToFPInst(Op0, Ty, CE->getType());
   case Instruction::SIToFP:
-      return executeSIToFPInst(CE->getOperand(0), CE->getType(), SF);
+      return executeSIToFPInst(Op0, Ty, CE->getType());
   case Instruction::FPToUI:
-      return executeFPToUIInst(CE->getOperand(0), CE->getType(), SF);
+      return executeFPToUIInst(Op0, Ty, CE->getType());
   case Instruction::FPToSI:
-      return executeFPToSIInst(CE->getOperand(0), CE->getType(), SF);
+      return executeFPToSIInst(Op0, Ty, CE->getType());
   case Instruction::PtrToInt:
-      return executePtrToIntInst(CE->getOperand(0), CE->getType(), SF);
+      return executePtrToIntInst(Op0, Ty, CE->getType());
   case Instruction::IntToPtr:
-      return executeIntToPtrInst(CE->getOperand(0), CE->getType(), SF);
+      return executeIntToPtrInst(Op0, Ty, CE->getType());
   case Instruction::BitCast:
-      return executeBitCastInst(CE->getOperand(0), CE->getType(), SF);
-  case Instruction::GetElementPtr:
-    return executeGEPOperation(CE->getOperand(0), gep_type_begin(CE),
-                               gep_type_end(CE), SF);
+      return executeBitCastInst(Op0, Ty, CE->getType());
+  case Instruction::GetElementPtr: {
+    SmallVector<GenericValue, 4> Indices;
+    for (unsigned i = 1, e = CE->getNumOperands(); i != e; ++i)
+      Indices.push_back(getOperandValue(CE->getOperand(i), SF));
+    return executeGEPOperation(Op0, gep_type_begin(CE), gep_type_end(CE),
+                               Indices.data());
+  }
   case Instruction::FCmp:
   case Instruction::ICmp:
-    return executeCmpInst(CE->getPredicate(),
-                          getOperandValue(CE->getOperand(0), SF),
-                          getOperandValue(CE->getOperand(1), SF),
-                          CE->getOperand(0)->getType());
+    return executeCmpInst(CE->getPredicate(), Op0,
+                          getOperandValue(CE->getOperand(1), SF), Ty);
   case Instruction::Select:
-    return executeSelectInst(getOperandValue(CE->getOperand(0), SF),
-                             getOperandValue(CE->getOperand(1), SF),
-                             getOperandValue(CE->getOperand(2), SF),
-                             CE->getOperand(0)->getType());
+    return executeSelectInst(Op0, getOperandValue(CE->getOperand(1), SF),
+                             getOperandValue(CE->getOperand(2), SF), Ty);
   default :
     break;
   }
 
   // The cases below here require a GenericValue parameter for the result
   // so we initialize one, compute it and then return it.
-  GenericValue Op0 = getOperandValue(CE->getOperand(0), SF);
   GenericValue Op1 = getOperandValue(CE->getOperand(1), SF);
   GenericValue Dest;
-  Type * Ty = CE->getOperand(0)->getType();
   switch (CE->getOpcode()) {
   case Instruction::Add:  Dest.IntVal = Op0.IntVal + Op1.IntVal; break;
   case Instruction::Sub:  Dest.IntVal = Op0.IntVal - Op1.IntVal; break;
@@ -2054,15 +2082,103 @@ GenericValue Interpreter::getConstantExprValue (ConstantExpr *CE,
 }
 
 GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
-  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(V)) {
-    return getConstantExprValue(CE, SF);
-  } else if (Constant *CPV = dyn_cast<Constant>(V)) {
-    return getConstantValue(CPV);
-  } else if (GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
-    return PTOGV(getPointerToGlobal(GV));
-  } else {
-    return SF.Values[V];
+  Constant *CPV = cast<Constant>(V);
+
+  // Constants, including global addresses, are only evaluated once.
+  DenseMap<const Constant *, GenericValue>::iterator I =
+      ConstantValues.find(CPV);
+  if (I != ConstantValues.end())
+    return I->second;
+
+  GenericValue Val;
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(CPV))
+    Val = getConstantExprValue(CE, SF);
+  else
+    Val = getConstantValue(CPV);
+  ConstantValues[CPV] = Val;
+  return Val;
+}
+
+GenericValue Interpreter::getOperandValue(const LoweredInst &LI, unsigned OpNo,
+                                          ExecutionContext &SF) {
+  unsigned Operand = SF.Info->Operands[LI.FirstOperand + OpNo];
+  if (!(Operand & FunctionInfo::ConstantBit))
+    return SF.Values[Operand];
+
+  LoweredConstant &C =
+      SF.Info->Constants[Operand & ~FunctionInfo::ConstantBit];
+  if (!C.Evaluated) {
+    C.Val = getOperandValue(C.C, SF);
+    C.Evaluated = true;
+  }
+  return C.Val;
+}
+
+void FunctionInfo::lower(Function &F) {
+  Insts.clear();
+  Operands.clear();
+  Constants.clear();
+  BlockStarts.clear();
+
+  // The arguments come first, so that they are in the first slots.
+  for (Function::arg_iterator AI = F.arg_begin(), E = F.arg_end(); AI != E;
+       ++AI)
+    getSlot(AI);
+
+  // Branches may go to later blocks, so find where each block starts first.
+  unsigned NumInsts = 0;
+  for (Function::iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB) {
+    BlockStarts[BB] = NumInsts;
+    NumInsts += BB->size();
+  }
+
+  DenseMap<Constant *, unsigned> ConstantIDs;
+  Insts.reserve(NumInsts);
+  for (Function::iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB)
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+      LoweredInst LI;
+      LI.I = I;
+      LI.Result = I->getType()->isVoidTy() ? ~0U : getSlot(I);
+      LI.FirstOperand = Operands.size();
+      for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+           ++OI) {
+        if (BasicBlock *Dest = dyn_cast<BasicBlock>(*OI)) {
+          Operands.push_back(BlockStarts[Dest]);
+        } else if (Constant *C = dyn_cast<Constant>(*OI)) {
+          std::pair<DenseMap<Constant *, unsigned>::iterator, bool> ID =
+              ConstantIDs.insert(std::make_pair(C, Constants.size()));
+          if (ID.second)
+            Constants.push_back(LoweredConstant(C));
+          Operands.push_back(ID.first->second | ConstantBit);
+        } else {
+          Operands.push_back(getSlot(*OI));
+        }
+      }
+      Insts.push_back(LI);
+    }
+}
+
+void Interpreter::relowerFunction(ExecutionContext &SF, Instruction *Next) {
+  FunctionInfo &Info = *SF.Info;
+  std::vector<LoweredInst> OldInsts;
+  OldInsts.swap(Info.Insts);
+  Info.Slots.erase(OldInsts[SF.CurInst - 1].I);
+  Info.lower(*SF.CurFunction);
+
+  DenseMap<const Instruction *, unsigned> NewIndices;
+  for (unsigned i = 0, e = Info.Insts.size(); i != e; ++i)
+    NewIndices[Info.Insts[i].I] = i;
+
+  // The other frames running this function are stopped in a call, which is
+  // still there. Give every frame room for the new values.
+  for (ExecutionContext &Frame : ECStack) {
+    if (Frame.Info != &Info)
+      continue;
+    Frame.Values.resize(Info.NumSlots);
+    if (&Frame != &SF)
+      Frame.CurInst = NewIndices[OldInsts[Frame.CurInst - 1].I] + 1;
   }
+  SF.CurInst = NewIndices[Next];
 }
 
 //===----------------------------------------------------------------------===//
@@ -2092,18 +2208,24 @@ void Interpreter::callFunction(Function *F,
 
   // Get pointers to first LLVM BB & Instruction in function.
   StackFrame.CurBB     = F->begin();
-  StackFrame.CurInst   = StackFrame.CurBB->begin();
+  StackFrame.CurInst   = 0;
+
+  // Make room for all the values of the function.
+  std::unique_ptr<FunctionInfo> &Info = FunctionInfos[F];
+  if (!Info)
+    Info.reset(new FunctionInfo(*F));
+  StackFrame.Info = Info.get();
+  StackFrame.Values.resize(Info->NumSlots);
 
   // Run through the function arguments and initialize their values...
   assert((ArgVals.size() == F->arg_size() ||
          (ArgVals.size() > F->arg_size() && F->getFunctionType()->isVarArg()))&&
          "Invalid number of values passed to function invocation!");
 
-  // Handle non-varargs arguments...
+  // Handle non-varargs arguments... They are in the first slots.
   unsigned i = 0;
-  for (Function::arg_iterator AI = F->arg_begin(), E = F->arg_end(); 
-       AI != E; ++AI, ++i)
-    SetValue(AI, ArgVals[i], StackFrame);
+  for (unsigned e = F->arg_size(); i != e; ++i)
+    StackFrame.Values[i] = ArgVals[i];
 
   // Handle varargs arguments...
   StackFrame.VarArgs.assign(ArgVals.begin()+i, ArgVals.end());
@@ -2114,7 +2236,7 @@ void Interpreter::run() {
   while (!ECStack.empty()) {
     // Interpret a single instruction & increment the "PC".
     ExecutionContext &SF = ECStack.back();  // Current stack frame
-    Instruction &I = *SF.CurInst++;         // Increment before execute
+    Instruction &I = *SF.Info->Insts[SF.CurInst++].I; // Increment first
 
     // Track the number of dynamic instructions executed.
     ++NumDynamicInsts;
@@ -2127,7 +2249,7 @@ DEBUG(
     if (!isa<CallInst>(I) && !isa<InvokeInst>(I) && 
         I.getType() != Type::VoidTy) {
       dbgs() << "  --> ";
-      const GenericValue &Val = SF.Values[&I];
+      const GenericValue &Val = SF.Values[getCurrentInst(SF).Result];
       switch (I.getType()->getTypeID()) {
       default: llvm_unreachable("Invalid GenericValue Type");
       case Type::VoidTyID:    dbgs() << "void"; break;
@@ -2144,4 +2266,7 @@ DEBUG(
     });
 #endif
   }
+
+  FunctionInfos.clear();
+  ConstantValues.clear();
 }
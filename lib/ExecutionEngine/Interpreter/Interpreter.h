@@ -14,6 +14,7 @@
 #ifndef LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 #define LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/IR/CallSite.h"
@@ -26,7 +27,6 @@
 namespace llvm {
 
 class IntrinsicLowering;
-struct FunctionInfo;
 template<typename T> class generic_gep_type_iterator;
 class ConstantExpr;
 typedef generic_gep_type_iterator<User::const_op_iterator> gep_type_iterator;
@@ -64,14 +64,69 @@ public:
 
 typedef std::vector<GenericValue> ValuePlaneTy;
 
+// LoweredInst struct - An instruction of a lowered function, with the slot
+// its value is kept in and the position of its operands in the operand array
+// of the function.
+//
+struct LoweredInst {
+  Instruction *I;
+  unsigned Result;       // The slot of the value of I, if it has one
+  unsigned FirstOperand; // The index of the first operand of I
+};
+
+// LoweredConstant struct - A constant used by a lowered function. It is
+// evaluated the first time it is read.
+//
+struct LoweredConstant {
+  Constant *C;
+  bool Evaluated;
+  GenericValue Val;
+
+  explicit LoweredConstant(Constant *C) : C(C), Evaluated(false) {}
+};
+
+// FunctionInfo struct - This struct holds a function lowered for execution.
+// The instructions of the function are laid out in an array, block by block,
+// and the operands of each instruction are resolved once: a value of the
+// function becomes the index of its slot in the stack frame, a constant the
+// index of its entry in Constants with ConstantBit set, and a basic block the
+// index of its first instruction. A function is lowered the first time it is
+// called, and again when intrinsic lowering changes it; the values keep their
+// slots then.
+//
+struct FunctionInfo {
+  static const unsigned ConstantBit = 1U << 31;
+
+  std::vector<LoweredInst> Insts;
+  std::vector<unsigned> Operands;
+  std::vector<LoweredConstant> Constants;
+  DenseMap<const BasicBlock *, unsigned> BlockStarts;
+  DenseMap<const Value *, unsigned> Slots;
+  unsigned NumSlots;
+
+  explicit FunctionInfo(Function &F) : NumSlots(0) { lower(F); }
+
+  void lower(Function &F);
+
+  unsigned getSlot(const Value *V) {
+    std::pair<DenseMap<const Value *, unsigned>::iterator, bool> Slot =
+        Slots.insert(std::make_pair(V, NumSlots));
+    if (Slot.second)
+      ++NumSlots;
+    return Slot.first->second;
+  }
+};
+
 // ExecutionContext struct - This struct represents one stack frame currently
 // executing.
 //
 struct ExecutionContext {
   Function             *CurFunction;// The currently executing function
   BasicBlock           *CurBB;      // The currently executing BB
-  BasicBlock::iterator  CurInst;    // The next instruction to execute
-  std::map<Value *, GenericValue> Values; // LLVM values used in this invocation
+  unsigned              CurInst;    // The index of the next instruction to
+                                    // execute in Info->Insts
+  FunctionInfo         *Info;       // CurFunction, lowered
+  ValuePlaneTy          Values;     // LLVM values used in this invocation
   std::vector<GenericValue>  VarArgs; // Values passed through an ellipsis
   CallSite             Caller;     // Holds the call that called subframes.
                                    // NULL if main func or debugger invoked fn
@@ -93,6 +148,12 @@ class Interpreter : public ExecutionEngine, public InstVisitor<Interpreter> {
   // registered with the atexit() library function.
   std::vector<Function*> AtExitHandlers;
 
+  // The functions called so far, lowered, and the values of the constants used
+  // so far. Both are dropped when the stack empties, as the IR may change
+  // between two runs.
+  DenseMap<const Function *, std::unique_ptr<FunctionInfo>> FunctionInfos;
+  DenseMap<const Constant *, GenericValue> ConstantValues;
+
 public:
   explicit Interpreter(std::unique_ptr<Module> M);
   ~Interpreter();
@@ -193,14 +254,19 @@ public:
   }
 
 private:  // Helper functions
-  GenericValue executeGEPOperation(Value *Ptr, gep_type_iterator I,
-                                   gep_type_iterator E, ExecutionContext &SF);
+  GenericValue executeGEPOperation(GenericValue Ptr, gep_type_iterator I,
+                                   gep_type_iterator E,
+                                   const GenericValue *Indices);
 
   // SwitchToNewBasicBlock - Start execution in a new basic block and run any
   // PHI nodes in the top of the block.  This is used for intraprocedural
   // control flow.
   //
-  void SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF);
+  void SwitchToNewBasicBlock(unsigned Dest, ExecutionContext &SF);
+
+  // relowerFunction - Lower the function of SF again after the instruction
+  // it is executing was replaced, and resume SF at Next.
+  void relowerFunction(ExecutionContext &SF, Instruction *Next);
 
   void *getPointerToFunction(Function *F) override { return (void*)F; }
 
@@ -208,30 +274,29 @@ private:  // Helper functions
   void initializeExternalFunctions();
   GenericValue getConstantExprValue(ConstantExpr *CE, ExecutionContext &SF);
   GenericValue getOperandValue(Value *V, ExecutionContext &SF);
-  GenericValue executeTruncInst(Value *SrcVal, Type *DstTy,
-                                ExecutionContext &SF);
-  GenericValue executeSExtInst(Value *SrcVal, Type *DstTy,
-                               ExecutionContext &SF);
-  GenericValue executeZExtInst(Value *SrcVal, Type *DstTy,
+  // getOperandValue - Return the value of operand OpNo of LI, or of I, which
+  // must be the instruction being executed.
+  GenericValue getOperandValue(const LoweredInst &LI, unsigned OpNo,
                                ExecutionContext &SF);
-  GenericValue executeFPTruncInst(Value *SrcVal, Type *DstTy,
-                                  ExecutionContext &SF);
-  GenericValue executeFPExtInst(Value *SrcVal, Type *DstTy,
-                                ExecutionContext &SF);
-  GenericValue executeFPToUIInst(Value *SrcVal, Type *DstTy,
-                                 ExecutionContext &SF);
-  GenericValue executeFPToSIInst(Value *SrcVal, Type *DstTy,
-                                 ExecutionContext &SF);
-  GenericValue executeUIToFPInst(Value *SrcVal, Type *DstTy,
-                                 ExecutionContext &SF);
-  GenericValue executeSIToFPInst(Value *SrcVal, Type *DstTy,
-                                 ExecutionContext &SF);
-  GenericValue executePtrToIntInst(Value *SrcVal, Type *DstTy,
-                                   ExecutionContext &SF);
-  GenericValue executeIntToPtrInst(Value *SrcVal, Type *DstTy,
-                                   ExecutionContext &SF);
-  GenericValue executeBitCastInst(Value *SrcVal, Type *DstTy,
-                                  ExecutionContext &SF);
+  GenericValue getOperandValue(Instruction &I, unsigned OpNo,
+                               ExecutionContext &SF) {
+    const LoweredInst &LI = SF.Info->Insts[SF.CurInst - 1];
+    assert(LI.I == &I && "Not the instruction being executed!");
+    (void)I;
+    return getOperandValue(LI, OpNo, SF);
+  }
+  GenericValue executeTruncInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeSExtInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeZExtInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeFPTruncInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeFPExtInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeFPToUIInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeFPToSIInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeUIToFPInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeSIToFPInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executePtrToIntInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeIntToPtrInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeBitCastInst(GenericValue Src, Type *SrcTy, Type *DstTy);
   GenericValue executeCastOperation(Instruction::CastOps opcode, Value *SrcVal, 
                                     Type *Ty, ExecutionContext &SF);
   void popStackAndReturnValueToCaller(Type *RetTy, GenericValue Result);
@@ -0,0 +1,198 @@
+//===- FileObjectCache.cpp - On-disk object cache for MCJIT ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements FileObjectCache.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/FileObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+
+using namespace llvm;
+
+FileObjectCache::FileObjectCache(StringRef CacheDir, const TargetMachine &TM)
+    : CacheDir(CacheDir), MaxSize(0) {
+  sys::fs::create_directories(CacheDir);
+
+  raw_string_ostream OS(TargetKey);
+  OS << TM.getTargetTriple() << '\0' << TM.getTargetCPU() << '\0'
+     << TM.getTargetFeatureString() << '\0' << unsigned(TM.getOptLevel())
+     << '\0' << unsigned(TM.getRelocationModel()) << '\0'
+     << unsigned(TM.getCodeModel());
+}
+
+FileObjectCache::~FileObjectCache() {
+  // Let other processes waiting for entries that were never written go on.
+  for (auto &I : EntryLocks)
+    delete I.second;
+}
+
+std::string FileObjectCache::getEntryPath(const Module &M) const {
+  SmallString<0> Bitcode;
+  raw_svector_ostream OS(Bitcode);
+  WriteBitcodeToFile(&M, OS);
+  OS.flush();
+
+  MD5 Hash;
+  Hash.update(Bitcode);
+  Hash.update(TargetKey);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Key;
+  MD5::stringifyResult(Result, Key);
+
+  SmallString<128> Path(CacheDir);
+  sys::path::append(Path, Twine(Key) + ".o");
+  return Path.str();
+}
+
+std::unique_ptr<MemoryBuffer>
+FileObjectCache::readEntry(StringRef Path) const {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Entry =
+      MemoryBuffer::getFile(Path, -1, false);
+  if (!Entry)
+    return nullptr;
+
+  // Record the use of the entry for the eviction policy.
+  int FD;
+  if (!sys::fs::openFileForWrite(Path, FD, sys::fs::F_Append)) {
+    sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+    raw_fd_ostream Closer(FD, /*shouldClose=*/true);
+  }
+
+  // MCJIT may write into the buffer it is given, which must not be the
+  // mapped file.
+  return MemoryBuffer::getMemBufferCopy(Entry.get()->getBuffer());
+}
+
+std::unique_ptr<MemoryBuffer> FileObjectCache::getObject(const Module *M) {
+  std::string Path = getEntryPath(*M);
+  {
+    MutexGuard Locked(Lock);
+    EntryPaths[M] = Path;
+  }
+  if (std::unique_ptr<MemoryBuffer> Obj = readEntry(Path))
+    return Obj;
+
+  // The entry is missing. If another process is already compiling it, wait
+  // for that process rather than compiling the module a second time.
+  std::unique_ptr<LockFileManager> EntryLock(new LockFileManager(Path));
+  switch (EntryLock->getState()) {
+  case LockFileManager::LFS_Error:
+    return nullptr;
+  case LockFileManager::LFS_Shared:
+    if (EntryLock->waitForUnlock() != LockFileManager::Res_Success)
+      return nullptr;
+    return readEntry(Path);
+  case LockFileManager::LFS_Owned:
+    break;
+  }
+
+  // The entry may have been written while the lock was being acquired.
+  if (std::unique_ptr<MemoryBuffer> Obj = readEntry(Path))
+    return Obj;
+
+  // Hold the lock until the object is written by notifyObjectCompiled.
+  MutexGuard Locked(Lock);
+  LockFileManager *&Slot = EntryLocks[M];
+  delete Slot;
+  Slot = EntryLock.release();
+  return nullptr;
+}
+
+void FileObjectCache::notifyObjectCompiled(const Module *M,
+                                           MemoryBufferRef Obj) {
+  std::string Path;
+  {
+    MutexGuard Locked(Lock);
+    Path = EntryPaths.lookup(M);
+    EntryPaths.erase(M);
+  }
+  if (Path.empty())
+    Path = getEntryPath(*M);
+
+  // Write a temporary file and rename it, so that the entry appears
+  // atomically.
+  int FD;
+  SmallString<128> TempPath;
+  if (!sys::fs::createUniqueFile(Path + "-%%%%%%.tmp", FD, TempPath)) {
+    {
+      raw_fd_ostream OS(FD, /*shouldClose=*/true);
+      OS.write(Obj.getBufferStart(), Obj.getBufferSize());
+      OS.close();
+      if (OS.has_error())
+        OS.clear_error();
+      else if (!sys::fs::rename(TempPath.str(), Path))
+        TempPath.clear();
+    }
+    if (!TempPath.empty())
+      sys::fs::remove(TempPath.str());
+  }
+
+  LockFileManager *EntryLock;
+  {
+    MutexGuard Locked(Lock);
+    EntryLock = EntryLocks.lookup(M);
+    EntryLocks.erase(M);
+  }
+  delete EntryLock;
+
+  prune();
+}
+
+void FileObjectCache::prune() {
+  if (!MaxSize)
+    return;
+
+  struct Entry {
+    sys::TimeValue LastUse;
+    uint64_t Size;
+    std::string Path;
+  };
+  std::vector<Entry> Entries;
+  uint64_t TotalSize = 0;
+  std::error_code EC;
+  for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+       I.increment(EC)) {
+    if (sys::path::extension(I->path()) != ".o")
+      continue;
+    sys::fs::file_status Status;
+    if (I->status(Status))
+      continue;
+    Entry NewEntry = { Status.getLastModificationTime(), Status.getSize(),
+                       I->path() };
+    Entries.push_back(NewEntry);
+    TotalSize += Status.getSize();
+  }
+  if (TotalSize <= MaxSize)
+    return;
+
+  std::sort(Entries.begin(), Entries.end(),
+            [](const Entry &A, const Entry &B) {
+    return A.LastUse < B.LastUse;
+  });
+  for (const Entry &E : Entries) {
+    if (TotalSize <= MaxSize)
+      break;
+    if (!sys::fs::remove(E.Path))
+      TotalSize -= E.Size;
+  }
+}
@@ -15,23 +15,44 @@
 #include "llvm/ExecutionEngine/ObjectBuffer.h"
 #include "llvm/ExecutionEngine/ObjectImage.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/CallSite.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Mangler.h"
 #include "llvm/IR/Module.h"
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/Object/Archive.h"
 #include "llvm/PassManager.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Target/TargetLowering.h"
 #include "llvm/Target/TargetSubtargetInfo.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
 
 using namespace llvm;
 
+#define DEBUG_TYPE "mcjit"
+
+STATISTIC(NumLazyFunctions, "Number of functions compiled through their stub");
+STATISTIC(NumTierUps, "Number of functions compiled again once hot");
+STATISTIC(NumModulesCopied,
+          "Number of modules compiled in a context of their own");
+
 namespace {
 
 static struct RegisterJIT {
@@ -59,7 +80,8 @@ ExecutionEngine *MCJIT::createJIT(std::unique_ptr<Module> M,
 MCJIT::MCJIT(std::unique_ptr<Module> M, std::unique_ptr<TargetMachine> tm,
              RTDyldMemoryManager *MM)
     : ExecutionEngine(std::move(M)), TM(std::move(tm)), Ctx(nullptr),
-      MemMgr(this, MM), Dyld(&MemMgr), ObjCache(nullptr) {
+      MemMgr(this, MM), Dyld(&MemMgr), ObjCache(nullptr), NumLazyModules(0),
+      TierUpCallCount(0) {
   // FIXME: We are managing our modules, so we do not want the base class
   // ExecutionEngine to manage them as well. To avoid double destruction
   // of the first (and only) module added in ExecutionEngine constructor
@@ -78,6 +100,10 @@ MCJIT::MCJIT(std::unique_ptr<Module> M, std::unique_ptr<TargetMachine> tm,
 }
 
 MCJIT::~MCJIT() {
+  // Let the functions being optimized in the background finish.
+  if (TierUpPool)
+    TierUpPool->wait();
+
   MutexGuard locked(lock);
 
   Dyld.deregisterEHFrames();
@@ -115,6 +141,8 @@ void MCJIT::addObjectFile(object::OwningBinary<object::ObjectFile> Obj) {
 }
 
 void MCJIT::addArchive(object::OwningBinary<object::Archive> A) {
+  // Symbols are looked up in every archive each time one is unresolved.
+  A.getBinary()->buildSymbolIndex();
   Archives.push_back(std::move(A));
 }
 
@@ -129,10 +157,33 @@ std::unique_ptr<ObjectBufferStream> MCJIT::emitObject(Module *M) {
   // This must be a module which has already been added but not loaded to this
   // MCJIT instance, since these conditions are tested by our caller,
   // generateCodeForModule.
+  std::unique_ptr<ObjectBufferStream> CompiledObject =
+      compileModule(M, *TM, Ctx);
+
+  // If we have an object cache, tell it about the new object.
+  // Note that we're using the compiled image, not the loaded image (as below).
+  if (ObjCache) {
+    // MemoryBuffer is a thin wrapper around the actual memory, so it's OK
+    // to create a temporary object here and delete it after the call.
+    MemoryBufferRef MB = CompiledObject->getMemBuffer();
+    ObjCache->notifyObjectCompiled(M, MB);
+  }
 
+  return CompiledObject;
+}
+
+std::unique_ptr<TargetMachine>
+MCJIT::cloneTargetMachine(CodeGenOpt::Level OptLevel) {
+  return std::unique_ptr<TargetMachine>(TM->getTarget().createTargetMachine(
+      TM->getTargetTriple(), TM->getTargetCPU(), TM->getTargetFeatureString(),
+      TM->Options, TM->getRelocationModel(), TM->getCodeModel(), OptLevel));
+}
+
+std::unique_ptr<ObjectBufferStream>
+MCJIT::compileModule(Module *M, TargetMachine &TM, MCContext *&Ctx) {
   PassManager PM;
 
-  M->setDataLayout(TM->getSubtargetImpl()->getDataLayout());
+  M->setDataLayout(TM.getSubtargetImpl()->getDataLayout());
   PM.add(new DataLayoutPass(M));
 
   // The RuntimeDyld will take ownership of this shortly
@@ -140,8 +191,8 @@ std::unique_ptr<ObjectBufferStream> MCJIT::emitObject(Module *M) {
 
   // Turn the machine code intermediate representation into bytes in memory
   // that may be executed.
-  if (TM->addPassesToEmitMC(PM, Ctx, CompiledObject->getOStream(),
-                            !getVerifyModules())) {
+  if (TM.addPassesToEmitMC(PM, Ctx, CompiledObject->getOStream(),
+                           !getVerifyModules())) {
     report_fatal_error("Target does not support MC emission!");
   }
 
@@ -150,16 +201,320 @@ std::unique_ptr<ObjectBufferStream> MCJIT::emitObject(Module *M) {
   // Flush the output buffer to get the generated code into memory
   CompiledObject->flush();
 
-  // If we have an object cache, tell it about the new object.
-  // Note that we're using the compiled image, not the loaded image (as below).
-  if (ObjCache) {
-    // MemoryBuffer is a thin wrapper around the actual memory, so it's OK
-    // to create a temporary object here and delete it after the call.
-    MemoryBufferRef MB = CompiledObject->getMemBuffer();
-    ObjCache->notifyObjectCompiled(M, MB);
+  return CompiledObject;
+}
+
+void MCJIT::loadModuleObject(Module *M, std::unique_ptr<ObjectBuffer> Object) {
+  loadCompiledObject(std::move(Object));
+  OwnedModules.markModuleAsLoaded(M);
+}
+
+void MCJIT::loadCompiledObject(std::unique_ptr<ObjectBuffer> Object) {
+  // Load the object into the dynamic linker.
+  // MCJIT now owns the ObjectImage pointer (via its LoadedObjects list).
+  std::unique_ptr<ObjectImage> LoadedObject =
+      Dyld.loadObject(std::move(Object));
+  if (!LoadedObject)
+    report_fatal_error(Dyld.getErrorString());
+
+  // FIXME: Make this optional, maybe even move it to a JIT event listener
+  LoadedObject->registerWithDebugger();
+
+  NotifyObjectEmitted(*LoadedObject);
+
+  LoadedObjects.push_back(std::move(LoadedObject));
+}
+
+namespace {
+/// Declares the global values of a module in the module of a function
+/// compiled lazily, as they are referenced.
+class LazyFunctionMaterializer : public ValueMaterializer {
+  Module &Dst;
+
+public:
+  LazyFunctionMaterializer(Module &Dst) : Dst(Dst) {}
+
+  Value *materializeValueFor(Value *V) override {
+    GlobalValue *GV = dyn_cast<GlobalValue>(V);
+    if (!GV)
+      return nullptr;
+
+    PointerType *Ty = GV->getType();
+    if (FunctionType *FTy = dyn_cast<FunctionType>(Ty->getElementType())) {
+      Function *NewF = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                        GV->getName(), &Dst);
+      if (Function *F = dyn_cast<Function>(GV)) {
+        NewF->setAttributes(F->getAttributes());
+        NewF->setCallingConv(F->getCallingConv());
+      }
+      return NewF;
+    }
+
+    GlobalVariable *Src = dyn_cast<GlobalVariable>(GV);
+    return new GlobalVariable(
+        Dst, Ty->getElementType(), Src && Src->isConstant(),
+        GlobalValue::ExternalLinkage, nullptr, GV->getName(), nullptr,
+        Src ? Src->getThreadLocalMode() : GlobalValue::NotThreadLocal,
+        Ty->getAddressSpace());
+  }
+};
+}
+
+/// Return true if \p F can be called through a stub that forwards its
+/// arguments to the real function.
+static bool canCompileLazily(const Function &F) {
+  if (F.isDeclaration() || F.hasAvailableExternallyLinkage() || F.isVarArg() ||
+      F.hasFnAttribute(Attribute::Naked) ||
+      F.getAttributes().hasAttrSomewhere(Attribute::InAlloca))
+    return false;
+  // The blocks of the function must stay where blockaddress constants expect
+  // them.
+  for (const BasicBlock &BB : F)
+    if (BB.hasAddressTaken())
+      return false;
+  return true;
+}
+
+/// Make \p Caller tail call \p Callee with its own arguments and return the
+/// result.
+static void forwardCall(IRBuilder<> &Builder, Function *Caller,
+                        Value *Callee) {
+  SmallVector<Value *, 8> Args;
+  for (Argument &A : Caller->args())
+    Args.push_back(&A);
+  CallInst *CI = Builder.CreateCall(Callee, Args);
+  CI->setCallingConv(Caller->getCallingConv());
+  CI->setAttributes(Caller->getAttributes());
+  CI->setTailCall();
+  if (Caller->getReturnType()->isVoidTy())
+    Builder.CreateRetVoid();
+  else
+    Builder.CreateRet(CI);
+}
+
+static void *callCompileLazyFunction(MCJIT *JIT, Function *F, void **Slot) {
+  return JIT->compileLazyFunction(F, Slot);
+}
+
+/// Return a constant holding the host address \p P, with the type \p Ty.
+static Constant *getHostPointer(const void *P, Type *Ty) {
+  LLVMContext &Context = Ty->getContext();
+  Constant *Addr = ConstantInt::get(
+      Type::getIntNTy(Context, sizeof(void *) * 8), (uintptr_t)P);
+  return ConstantExpr::getIntToPtr(Addr, Ty);
+}
+
+std::unique_ptr<ObjectBufferStream> MCJIT::emitLazyStubs(Module *M) {
+  // Everything is cloned below, so there is no point in reading the bitcode
+  // lazily any more.
+  if (std::error_code EC = M->materializeAllPermanently())
+    report_fatal_error("Could not read the module: " + EC.message());
+
+  // The functions compiled later on their own refer to the local symbols of
+  // the module by name, so these must become unique global symbols. The new
+  // names are prefixed rather than suffixed, as a name such as .LC0 would
+  // otherwise stay an assembler-private label on ELF.
+  std::string Prefix = "__lazy" + utostr(NumLazyModules++) + ".";
+  auto Promote = [&](GlobalValue &GV) {
+    if (!GV.hasLocalLinkage())
+      return;
+    GV.setName(Prefix + GV.getName());
+    GV.setLinkage(GlobalValue::ExternalLinkage);
+    GV.setVisibility(GlobalValue::HiddenVisibility);
+  };
+  for (Function &F : *M)
+    Promote(F);
+  for (GlobalVariable &GV : M->globals())
+    Promote(GV);
+  for (GlobalAlias &GA : M->aliases())
+    Promote(GA);
+
+  ValueToValueMapTy VMap;
+  std::unique_ptr<Module> Stubs(CloneModule(M, VMap));
+  LLVMContext &Context = Stubs->getContext();
+  Type *Int8PtrTy = Type::getInt8PtrTy(Context);
+  Type *CallbackArgTys[] = { Int8PtrTy, Int8PtrTy, Int8PtrTy };
+  Constant *Callback = getHostPointer(
+      (const void *)&callCompileLazyFunction,
+      FunctionType::get(Int8PtrTy, CallbackArgTys, false)->getPointerTo());
+  const DataLayout *DL = TM->getSubtargetImpl()->getDataLayout();
+
+  for (Function &F : *M) {
+    if (!canCompileLazily(F))
+      continue;
+    Function *Stub = cast<Function>(VMap[&F]);
+    GlobalValue::LinkageTypes Linkage = Stub->getLinkage();
+    Stub->deleteBody();
+    Stub->setLinkage(Linkage);
+
+    // The resolver compiles the function, then calls it. It is called through
+    // the slot until the slot is updated with the address of the function.
+    // The slot can be looked up by name, as the function names are unique.
+    Function *Resolver =
+        Function::Create(F.getFunctionType(), GlobalValue::InternalLinkage,
+                         F.getName() + ".resolve", Stubs.get());
+    Resolver->setAttributes(F.getAttributes());
+    Resolver->setCallingConv(F.getCallingConv());
+    GlobalVariable *Slot = new GlobalVariable(
+        *Stubs, F.getType(), false, GlobalValue::ExternalLinkage, Resolver,
+        F.getName() + ".slot");
+    Slot->setVisibility(GlobalValue::HiddenVisibility);
+
+    IRBuilder<> Builder(BasicBlock::Create(Context, "", Resolver));
+    Value *Addr = Builder.CreateCall3(Callback, getHostPointer(this, Int8PtrTy),
+                                      getHostPointer(&F, Int8PtrTy),
+                                      Builder.CreateBitCast(Slot, Int8PtrTy));
+    forwardCall(Builder, Resolver, Builder.CreateBitCast(Addr, F.getType()));
+
+    Builder.SetInsertPoint(BasicBlock::Create(Context, "", Stub));
+    LoadInst *Target = Builder.CreateLoad(Slot);
+    Target->setAlignment(DL->getPointerABIAlignment());
+    Target->setAtomic(Unordered);
+    forwardCall(Builder, Stub, Target);
   }
 
-  return CompiledObject;
+  // The object cannot be cached: it holds addresses of this process.
+  return compileModule(Stubs.get(), *TM, Ctx);
+}
+
+void *MCJIT::compileFunctionBody(Function *F, const Twine &Name,
+                                 TargetMachine &FuncTM, void **Slot) {
+  Module *M = F->getParent();
+  std::unique_ptr<Module> FuncModule(new Module(
+      M->getModuleIdentifier() + ":" + F->getName().str(), F->getContext()));
+  FuncModule->setDataLayout(M->getDataLayout());
+  FuncModule->setTargetTriple(M->getTargetTriple());
+
+  Function *NewF = Function::Create(F->getFunctionType(),
+                                    GlobalValue::ExternalLinkage, Name,
+                                    FuncModule.get());
+
+  // Every global value is declared in the new module.
+  ValueToValueMapTy VMap;
+  Function::arg_iterator NewArg = NewF->arg_begin();
+  for (Argument &A : F->args())
+    VMap[&A] = NewArg++;
+  SmallVector<ReturnInst *, 4> Returns;
+  LazyFunctionMaterializer Materializer(*FuncModule);
+  CloneFunctionInto(NewF, F, VMap, /*ModuleLevelChanges=*/true, Returns, "",
+                    nullptr, nullptr, &Materializer);
+
+  // Recursive calls go straight to the new function. Any other use of the
+  // function keeps referring to its stub, whose address is the one the rest
+  // of the program sees.
+  if (Function *Self = FuncModule->getFunction(F->getName())) {
+    SmallVector<Use *, 4> Callees;
+    for (Use &U : Self->uses()) {
+      ImmutableCallSite CS(U.getUser());
+      if (CS && CS.isCallee(&U))
+        Callees.push_back(&U);
+    }
+    for (Use *U : Callees)
+      U->set(NewF);
+  }
+  NewF->setLinkage(GlobalValue::ExternalLinkage);
+  NewF->setVisibility(GlobalValue::HiddenVisibility);
+
+  if (Slot)
+    insertCallCounter(NewF, F, Slot);
+
+  MCContext *FuncCtx = nullptr;
+  loadCompiledObject(compileModule(FuncModule.get(), FuncTM, FuncCtx));
+  finalizeLoadedModules();
+
+  void *Addr = (void *)getExistingSymbolAddress(NewF->getName());
+  if (!Addr)
+    report_fatal_error("Could not compile function '" + F->getName() + "'");
+  return Addr;
+}
+
+static void callTierUpFunction(MCJIT *JIT, Function *F, void **Slot) {
+  JIT->tierUpFunction(F, Slot);
+}
+
+void MCJIT::insertCallCounter(Function *NewF, Function *F, void **Slot) {
+  Module &FuncModule = *NewF->getParent();
+  LLVMContext &Context = FuncModule.getContext();
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  GlobalVariable *Calls = new GlobalVariable(
+      FuncModule, Int32Ty, false, GlobalValue::InternalLinkage,
+      ConstantInt::get(Int32Ty, 0), NewF->getName() + ".calls");
+
+  // Count the call after the static allocas, which must stay in the entry
+  // block.
+  BasicBlock::iterator IP = NewF->getEntryBlock().getFirstInsertionPt();
+  while (isa<AllocaInst>(IP))
+    ++IP;
+  IRBuilder<> Builder(IP);
+  Value *Count = Builder.CreateAtomicRMW(AtomicRMWInst::Add, Calls,
+                                         Builder.getInt32(1), Monotonic);
+  Value *IsHot =
+      Builder.CreateICmpEQ(Count, Builder.getInt32(TierUpCallCount - 1));
+  TerminatorInst *Then = SplitBlockAndInsertIfThen(
+      IsHot, IP, false, MDBuilder(Context).createBranchWeights(1, 1000));
+
+  Type *Int8PtrTy = Builder.getInt8PtrTy();
+  Type *CallbackArgTys[] = { Int8PtrTy, Int8PtrTy, Int8PtrTy };
+  Constant *Callback = getHostPointer(
+      (const void *)&callTierUpFunction,
+      FunctionType::get(Builder.getVoidTy(), CallbackArgTys, false)
+          ->getPointerTo());
+  Builder.SetInsertPoint(Then);
+  Builder.CreateCall3(Callback, getHostPointer(this, Int8PtrTy),
+                      getHostPointer(F, Int8PtrTy),
+                      getHostPointer(Slot, Int8PtrTy));
+}
+
+/// Make the stub reading \p Slot call the code at \p Addr from now on.
+static void updateStubSlot(void **Slot, void *Addr) {
+  // The code must be complete before other threads can see the new address.
+  sys::MemoryFence();
+  *(void *volatile *)Slot = Addr;
+}
+
+void *MCJIT::compileLazyFunction(Function *F, void **Slot) {
+  MutexGuard locked(lock);
+
+  // Another thread may have gone through the stub at the same time.
+  if (void *Addr = LazyFunctionAddresses.lookup(F))
+    return Addr;
+
+  // In tiered mode, the first version of the function is compiled as fast as
+  // possible, and counts its calls.
+  void *Addr;
+  if (TierUpCallCount) {
+    if (!FastTM)
+      FastTM = cloneTargetMachine(CodeGenOpt::None);
+    Addr = compileFunctionBody(F, F->getName() + ".body", *FastTM, Slot);
+  } else {
+    Addr = compileFunctionBody(F, F->getName() + ".body", *TM, nullptr);
+  }
+
+  ++NumLazyFunctions;
+  DEBUG(dbgs() << "MCJIT: compiled '" << F->getName() << "' on first call\n");
+  LazyFunctionAddresses[F] = Addr;
+  updateStubSlot(Slot, Addr);
+  return Addr;
+}
+
+void MCJIT::setTieredCompilation(unsigned HotCallCount) {
+  MutexGuard locked(lock);
+  TierUpCallCount = HotCallCount;
+  if (TierUpCallCount && !TierUpPool)
+    TierUpPool.reset(new ThreadPool(1));
+}
+
+void MCJIT::tierUpFunction(Function *F, void **Slot) {
+  // The caller goes on with the unoptimized code, while the function is
+  // compiled again in the background.
+  ++NumTierUps;
+  DEBUG(dbgs() << "MCJIT: compiling '" << F->getName() << "' again\n");
+  TierUpPool->async([this, F, Slot] {
+    MutexGuard locked(lock);
+    void *Addr = compileFunctionBody(F, F->getName() + ".opt", *TM, nullptr);
+    LazyFunctionAddresses[F] = Addr;
+    updateStubSlot(Slot, Addr);
+  });
 }
 
 void MCJIT::generateCodeForModule(Module *M) {
@@ -185,25 +540,96 @@ void MCJIT::generateCodeForModule(Module *M) {
 
   // If the cache did not contain a suitable object, compile the object
   if (!ObjectToLoad) {
-    ObjectToLoad = emitObject(M);
+    ObjectToLoad = usesLazyStubs() ? emitLazyStubs(M) : emitObject(M);
     assert(ObjectToLoad && "Compilation did not produce an object.");
   }
 
-  // Load the object into the dynamic linker.
-  // MCJIT now owns the ObjectImage pointer (via its LoadedObjects list).
-  std::unique_ptr<ObjectImage> LoadedObject =
-      Dyld.loadObject(std::move(ObjectToLoad));
-  if (!LoadedObject)
-    report_fatal_error(Dyld.getErrorString());
+  loadModuleObject(M, std::move(ObjectToLoad));
+}
 
-  // FIXME: Make this optional, maybe even move it to a JIT event listener
-  LoadedObject->registerWithDebugger();
+void MCJIT::generateCodeForPendingModules(unsigned ThreadCount) {
+  MutexGuard locked(lock);
 
-  NotifyObjectEmitted(*LoadedObject);
+  SmallVector<Module*, 16> Pending;
+  for (auto M : OwnedModules.added())
+    Pending.push_back(M);
 
-  LoadedObjects.push_back(std::move(LoadedObject));
+  // Stubs are cheap to generate. The functions are compiled on first call.
+  if (usesLazyStubs()) {
+    for (auto M : Pending)
+      generateCodeForModule(M);
+    return;
+  }
 
-  OwnedModules.markModuleAsLoaded(M);
+  // Take what we can from the object cache. Only one thread may use an
+  // LLVMContext at a time, so of the modules to compile that share a context,
+  // only the first one is compiled in place. The others are handed to their
+  // threads as bitcode and read back into a context of their own.
+  std::vector<std::unique_ptr<ObjectBuffer>> Objects(Pending.size());
+  std::vector<std::string> Bitcode(Pending.size());
+  SmallVector<unsigned, 16> ToCompile;
+  SmallPtrSet<LLVMContext *, 4> ContextsInUse;
+  for (unsigned i = 0, e = Pending.size(); i != e; ++i) {
+    Module *M = Pending[i];
+    if (ObjCache) {
+      if (std::unique_ptr<MemoryBuffer> PreCompiledObject =
+              ObjCache->getObject(M)) {
+        Objects[i] =
+            llvm::make_unique<ObjectBuffer>(std::move(PreCompiledObject));
+        continue;
+      }
+    }
+    ToCompile.push_back(i);
+    if (ContextsInUse.insert(&M->getContext()))
+      continue;
+    if (std::error_code EC = M->materializeAll())
+      report_fatal_error("Cannot materialize " + M->getModuleIdentifier() +
+                         ": " + EC.message());
+    M->setDataLayout(TM->getSubtargetImpl()->getDataLayout());
+    raw_string_ostream OS(Bitcode[i]);
+    WriteBitcodeToFile(M, OS);
+    ++NumModulesCopied;
+  }
+
+  if (ToCompile.size() == 1) {
+    Objects[ToCompile.front()] = compileModule(Pending[ToCompile.front()],
+                                               *TM, Ctx);
+  } else if (!ToCompile.empty()) {
+    // Every task gets its own TargetMachine, which is not thread safe either.
+    if (!ThreadCount)
+      ThreadCount = std::max(1U, std::thread::hardware_concurrency());
+    ThreadPool Pool(std::min<unsigned>(ThreadCount, ToCompile.size()));
+    for (unsigned i : ToCompile)
+      Pool.async([this, i, &Pending, &Bitcode, &Objects] {
+        std::unique_ptr<TargetMachine> TaskTM =
+            cloneTargetMachine(TM->getOptLevel());
+        MCContext *TaskCtx = nullptr;
+        if (Bitcode[i].empty()) {
+          Objects[i] = compileModule(Pending[i], *TaskTM, TaskCtx);
+          return;
+        }
+
+        LLVMContext Context;
+        std::unique_ptr<MemoryBuffer> Buffer = MemoryBuffer::getMemBuffer(
+            Bitcode[i], Pending[i]->getModuleIdentifier(), false);
+        ErrorOr<Module *> ModuleOrErr =
+            parseBitcodeFile(Buffer->getMemBufferRef(), Context);
+        if (std::error_code EC = ModuleOrErr.getError())
+          report_fatal_error("Cannot read back " +
+                             Pending[i]->getModuleIdentifier() + ": " +
+                             EC.message());
+        std::unique_ptr<Module> Copy(ModuleOrErr.get());
+        Objects[i] = compileModule(Copy.get(), *TaskTM, TaskCtx);
+      });
+    Pool.wait();
+  }
+
+  // Tell the cache about the new objects, then load everything on this thread.
+  if (ObjCache)
+    for (unsigned i : ToCompile)
+      ObjCache->notifyObjectCompiled(Pending[i], Objects[i]->getMemBuffer());
+  for (unsigned i = 0, e = Pending.size(); i != e; ++i)
+    loadModuleObject(Pending[i], std::move(Objects[i]));
 }
 
 void MCJIT::finalizeLoadedModules() {
@@ -21,6 +21,7 @@
 
 namespace llvm {
 class MCJIT;
+class ThreadPool;
 
 // This is a helper class that the MCJIT execution engine uses for linking
 // functions across modules that it owns.  It aggregates the memory manager
@@ -228,6 +229,19 @@ class MCJIT : public ExecutionEngine {
   // perform lookup of pre-compiled code to avoid re-compilation.
   ObjectCache *ObjCache;
 
+  // When compiling lazily, the number of modules whose local symbols have been
+  // renamed so far, and the addresses of the functions compiled through their
+  // stubs.
+  unsigned NumLazyModules;
+  DenseMap<const Function *, void *> LazyFunctionAddresses;
+
+  // In tiered mode, the number of calls after which a function compiled
+  // lazily is compiled again with optimization, the TargetMachine compiling
+  // the first version of the functions, and the thread compiling the second.
+  unsigned TierUpCallCount;
+  std::unique_ptr<TargetMachine> FastTM;
+  std::unique_ptr<ThreadPool> TierUpPool;
+
   Function *FindFunctionNamedInModulePtrSet(const char *FnName,
                                             ModulePtrSet::iterator I,
                                             ModulePtrSet::iterator E);
@@ -255,11 +269,14 @@ public:
   /// Sets the object manager that MCJIT should use to avoid compilation.
   void setObjectCache(ObjectCache *manager) override;
 
+  void setTieredCompilation(unsigned HotCallCount) override;
+
   void setProcessAllSections(bool ProcessAllSections) override {
     Dyld.setProcessAllSections(ProcessAllSections);
   }
 
   void generateCodeForModule(Module *M) override;
+  void generateCodeForPendingModules(unsigned ThreadCount = 0) override;
 
   /// finalizeObject - ensure the module is fully processed and is usable.
   ///
@@ -335,6 +352,19 @@ public:
   uint64_t getSymbolAddress(const std::string &Name,
                           bool CheckFunctionsOnly);
 
+  /// compileLazyFunction - Compile \p F on its own, store its address in the
+  /// pointer \p Slot used by its stub, and return it. This is called by the
+  /// stub on the first call to \p F; concurrent first calls compile \p F
+  /// only once. It runs on the calling thread, under the lock of the engine,
+  /// in the LLVMContext of the module of \p F, which no other thread may use
+  /// without holding the lock.
+  void *compileLazyFunction(Function *F, void **Slot);
+
+  /// tierUpFunction - Called by the unoptimized version of \p F once it has
+  /// been called often enough. Compile \p F again with the optimization level
+  /// of the engine on a background thread, then store its address in \p Slot.
+  void tierUpFunction(Function *F, void **Slot);
+
 protected:
   /// emitObject -- Generate a JITed object in memory from the specified module
   /// Currently, MCJIT only supports a single module and the module passed to
@@ -343,6 +373,47 @@ protected:
   /// the future.
   std::unique_ptr<ObjectBufferStream> emitObject(Module *M);
 
+  /// compileModule - Generate an object for \p M with \p TM, without taking
+  /// the lock of the engine or telling the object cache about the object.
+  /// Modules of different contexts may be compiled concurrently as long as
+  /// each thread uses its own TargetMachine.
+  std::unique_ptr<ObjectBufferStream> compileModule(Module *M,
+                                                    TargetMachine &TM,
+                                                    MCContext *&Ctx);
+
+  /// loadModuleObject - Load the object generated for \p M into the dynamic
+  /// linker and mark the module as loaded.
+  void loadModuleObject(Module *M, std::unique_ptr<ObjectBuffer> Object);
+  void loadCompiledObject(std::unique_ptr<ObjectBuffer> Object);
+
+  /// cloneTargetMachine - Create a TargetMachine like the one of the engine,
+  /// with the optimization level \p OptLevel.
+  std::unique_ptr<TargetMachine> cloneTargetMachine(CodeGenOpt::Level OptLevel);
+
+  /// compileFunctionBody - Compile \p F in a module of its own, under the
+  /// name \p Name, and return its address. If \p Slot is not null, the code
+  /// counts its calls and tiers up once they reach TierUpCallCount.
+  void *compileFunctionBody(Function *F, const Twine &Name,
+                            TargetMachine &FuncTM, void **Slot);
+  void insertCallCounter(Function *NewF, Function *F, void **Slot);
+
+  /// usesLazyStubs - Return true if modules are compiled through stubs. Stub
+  /// objects hold addresses of the process, so an engine with an object cache
+  /// compiles eagerly to have objects to cache. So does the small code model:
+  /// the functions compiled later refer to the globals of the stub object with
+  /// absolute addresses, which it cannot hold wherever the memory manager puts
+  /// them.
+  bool usesLazyStubs() const {
+    return hasLazyFunctionStubs() && !ObjCache &&
+           TM->getCodeModel() != CodeModel::Small;
+  }
+
+  /// emitLazyStubs - Generate the object standing for \p M when compiling
+  /// lazily. It defines the global variables of the module, and a stub for
+  /// each of its functions that calls the function through a pointer. The
+  /// pointer initially leads to compileLazyFunction.
+  std::unique_ptr<ObjectBufferStream> emitLazyStubs(Module *M);
+
   void NotifyObjectEmitted(const ObjectImage& Obj);
   void NotifyFreeingObject(const ObjectImage& Obj);
 
@@ -15,6 +15,7 @@
 #include "llvm/Config/config.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
 
 namespace llvm {
 
@@ -58,34 +59,28 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
       // Store cutted free memory block.
       MemGroup.FreeMem[i] = sys::MemoryBlock((void*)(Addr + Size),
                                              EndOfBlock - Addr - Size);
+      AllocationSets[CurrentSet].SectionBytes += Size;
+      Stats.SectionBytes += Size;
       return (uint8_t*)Addr;
     }
   }
 
-  // No pre-allocated free block was large enough. Allocate a new memory region.
-  // Note that all sections get allocated as read-write.  The permissions will
-  // be updated later based on memory group.
-  //
-  // FIXME: It would be useful to define a default allocation size (or add
-  // it as a constructor parameter) to minimize the number of allocations.
-  //
-  // FIXME: Initialize the Near member for each memory group to avoid
-  // interleaving.
-  std::error_code ec;
-  sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(RequiredSize,
-                                                          &MemGroup.Near,
-                                                          sys::Memory::MF_READ |
-                                                            sys::Memory::MF_WRITE,
-                                                          ec);
-  if (ec) {
+  // No pre-allocated free block was large enough. Take new pages for the
+  // current allocation set. Note that all sections get allocated as
+  // read-write.  The permissions will be updated later based on memory group.
+  sys::MemoryBlock MB = allocatePages(MemGroup, RequiredSize);
+  if (!MB.base()) {
     // FIXME: Add error propagation to the interface.
     return nullptr;
   }
 
-  // Save this address as the basis for our next request
-  MemGroup.Near = MB;
+  MemGroup.PendingMem.push_back(MB);
+  AllocationSet &Set = AllocationSets[CurrentSet];
+  Set.Pages.push_back(std::make_pair(&MemGroup, MB));
+  Set.SectionBytes += Size;
+  Stats.PageBytes += MB.size();
+  Stats.SectionBytes += Size;
 
-  MemGroup.AllocatedMem.push_back(MB);
   Addr = (uintptr_t)MB.base();
   uintptr_t EndOfBlock = Addr + MB.size();
 
@@ -102,6 +97,118 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
   return (uint8_t*)Addr;
 }
 
+sys::MemoryBlock SectionMemoryManager::allocatePages(MemoryGroup &MemGroup,
+                                                    uintptr_t Size) {
+  static const uintptr_t PageSize = sys::process::get_self()->page_size();
+  Size = RoundUpToAlignment(Size, PageSize);
+
+  // Reuse the first run of free pages that is large enough.
+  for (std::map<uintptr_t, uintptr_t>::iterator I = MemGroup.FreePages.begin(),
+                                                E = MemGroup.FreePages.end();
+       I != E; ++I) {
+    if (I->second < Size)
+      continue;
+    uintptr_t Start = I->first;
+    uintptr_t FreeSize = I->second;
+    MemGroup.FreePages.erase(I);
+    if (FreeSize > Size)
+      MemGroup.FreePages[Start + Size] = FreeSize - Size;
+    return sys::MemoryBlock((void*)Start, Size);
+  }
+
+  // Map a new slab, keeping the slabs of each group close to each other.
+  unsigned Flags = sys::Memory::MF_READ | sys::Memory::MF_WRITE;
+  if (HugePagesForCode && &MemGroup == &CodeMem)
+    Flags |= sys::Memory::MF_HUGE_HINT;
+  std::error_code ec;
+  sys::MemoryBlock Slab = sys::Memory::allocateMappedMemory(
+      std::max(Size, SlabSize), &MemGroup.Near, Flags, ec);
+  if (ec)
+    return sys::MemoryBlock();
+
+  // Save this address as the basis for our next request
+  MemGroup.Near = Slab;
+
+  MemGroup.AllocatedMem.push_back(Slab);
+  ++Stats.NumSlabs;
+  Stats.SlabBytes += Slab.size();
+
+  uintptr_t Start = (uintptr_t)Slab.base();
+  if (Slab.size() > Size)
+    releasePages(MemGroup, sys::MemoryBlock((void*)(Start + Size),
+                                            Slab.size() - Size));
+  return sys::MemoryBlock(Slab.base(), Size);
+}
+
+void SectionMemoryManager::releasePages(MemoryGroup &MemGroup,
+                                        sys::MemoryBlock Pages) {
+  uintptr_t Start = (uintptr_t)Pages.base();
+  uintptr_t Size = Pages.size();
+
+  // Merge the pages with the free runs that surround them.
+  std::map<uintptr_t, uintptr_t>::iterator Next =
+      MemGroup.FreePages.lower_bound(Start);
+  if (Next != MemGroup.FreePages.end() && Start + Size == Next->first) {
+    Size += Next->second;
+    MemGroup.FreePages.erase(Next++);
+  }
+  if (Next != MemGroup.FreePages.begin()) {
+    std::map<uintptr_t, uintptr_t>::iterator Prev = std::prev(Next);
+    if (Prev->first + Prev->second == Start) {
+      Prev->second += Size;
+      return;
+    }
+  }
+  MemGroup.FreePages[Start] = Size;
+}
+
+SectionMemoryManager::AllocationSetID
+SectionMemoryManager::startAllocationSet() {
+  // The free space left in the pages of the previous set must not be used for
+  // the new one.
+  CodeMem.FreeMem.clear();
+  RWDataMem.FreeMem.clear();
+  RODataMem.FreeMem.clear();
+  CurrentSet = NextSet++;
+  return CurrentSet;
+}
+
+void SectionMemoryManager::releaseAllocationSet(AllocationSetID ID) {
+  DenseMap<AllocationSetID, AllocationSet>::iterator I =
+      AllocationSets.find(ID);
+  if (I == AllocationSets.end())
+    return;
+
+  if (ID == CurrentSet) {
+    CodeMem.FreeMem.clear();
+    RWDataMem.FreeMem.clear();
+    RODataMem.FreeMem.clear();
+  }
+
+  for (unsigned i = 0, e = I->second.Pages.size(); i != e; ++i) {
+    MemoryGroup &MemGroup = *I->second.Pages[i].first;
+    sys::MemoryBlock &Pages = I->second.Pages[i].second;
+    Stats.PageBytes -= Pages.size();
+
+    // The pages may not have been finalized yet.
+    for (unsigned j = 0, je = MemGroup.PendingMem.size(); j != je; ++j)
+      if (MemGroup.PendingMem[j].base() == Pages.base()) {
+        MemGroup.PendingMem.erase(MemGroup.PendingMem.begin() + j);
+        break;
+      }
+
+    // Free pages are kept read-write. If that fails, the pages are simply
+    // not reused.
+    if (sys::Memory::protectMappedMemory(Pages, sys::Memory::MF_READ |
+                                                    sys::Memory::MF_WRITE))
+      continue;
+    releasePages(MemGroup, Pages);
+    Stats.ReleasedBytes += Pages.size();
+  }
+  Stats.SectionBytes -= I->second.SectionBytes;
+  AllocationSets.erase(I);
+}
+
 bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
 {
   // FIXME: Should in-progress permissions be reverted if an error occurs?
@@ -140,6 +247,11 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
   // relocations) will get to the data cache but not to the instruction cache.
   invalidateInstructionCache();
 
+  // Permissions of finalized pages are left alone from now on.
+  CodeMem.PendingMem.clear();
+  RWDataMem.PendingMem.clear();
+  RODataMem.PendingMem.clear();
+
   return false;
 }
 
@@ -147,10 +259,10 @@ std::error_code
 SectionMemoryManager::applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                                   unsigned Permissions) {
 
-  for (int i = 0, e = MemGroup.AllocatedMem.size(); i != e; ++i) {
+  for (int i = 0, e = MemGroup.PendingMem.size(); i != e; ++i) {
     std::error_code ec;
     ec =
-        sys::Memory::protectMappedMemory(MemGroup.AllocatedMem[i], Permissions);
+        sys::Memory::protectMappedMemory(MemGroup.PendingMem[i], Permissions);
     if (ec) {
       return ec;
     }
@@ -160,9 +272,9 @@ SectionMemoryManager::applyMemoryGroupPermissions(MemoryGroup &MemGroup,
 }
 
 void SectionMemoryManager::invalidateInstructionCache() {
-  for (int i = 0, e = CodeMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::InvalidateInstructionCache(CodeMem.AllocatedMem[i].base(),
-                                            CodeMem.AllocatedMem[i].size());
+  for (int i = 0, e = CodeMem.PendingMem.size(); i != e; ++i)
+    sys::Memory::InvalidateInstructionCache(CodeMem.PendingMem[i].base(),
+                                            CodeMem.PendingMem[i].size());
 }
 
 SectionMemoryManager::~SectionMemoryManager() {
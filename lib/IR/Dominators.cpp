@@ -38,6 +38,11 @@ static cl::opt<bool,true>
 VerifyDomInfoX("verify-dom-info", cl::location(VerifyDomInfo),
                cl::desc("Verify dominator info (time consuming)"));
 
+static cl::opt<bool>
+VerifyDomUpdates("verify-dom-updates",
+                 cl::desc("Verify incremental dominator tree updates against "
+                          "a recalculated tree (time consuming)"));
+
 bool BasicBlockEdge::isSingleEdge() const {
   const TerminatorInst *TI = Start->getTerminator();
   unsigned NumEdgesToEnd = 0;
@@ -280,23 +285,49 @@ bool DominatorTree::isReachableFromEntry(const Use &U) const {
   return isReachableFromEntry(I->getParent());
 }
 
-void DominatorTree::verifyDomTree() const {
-  if (!VerifyDomInfo)
-    return;
-
-  Function &F = *getRoot()->getParent();
+static void verifyAgainstRecalculation(const DominatorTree &DT,
+                                       const char *Problem) {
+  Function &F = *DT.getRoot()->getParent();
 
   DominatorTree OtherDT;
   OtherDT.recalculate(F);
-  if (compare(OtherDT)) {
-    errs() << "DominatorTree is not up to date!\nComputed:\n";
-    print(errs());
+  if (DT.compare(OtherDT)) {
+    errs() << Problem << "\nComputed:\n";
+    DT.print(errs());
     errs() << "\nActual:\n";
     OtherDT.print(errs());
     abort();
   }
 }
 
+void DominatorTree::verifyDomTree() const {
+  if (!VerifyDomInfo)
+    return;
+  verifyAgainstRecalculation(*this, "DominatorTree is not up to date!");
+}
+
+void DominatorTree::insertEdge(BasicBlock *From, BasicBlock *To) {
+  Base::insertEdge(From, To);
+  verifyUpdates();
+}
+
+void DominatorTree::deleteEdge(BasicBlock *From, BasicBlock *To) {
+  Base::deleteEdge(From, To);
+  verifyUpdates();
+}
+
+void DominatorTree::applyUpdates(ArrayRef<UpdateType> Updates) {
+  Base::applyUpdates(Updates);
+  verifyUpdates();
+}
+
+void DominatorTree::verifyUpdates() const {
+  if (!VerifyDomUpdates)
+    return;
+  verifyAgainstRecalculation(*this,
+                             "DominatorTree was not updated correctly!");
+}
+
 //===----------------------------------------------------------------------===//
 //  DominatorTreeWrapperPass Implementation
 //===----------------------------------------------------------------------===//
@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/LTO/LTOCodeGenerator.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Bitcode/ReaderWriter.h"
@@ -42,6 +43,7 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetLibraryInfo.h"
@@ -52,6 +54,7 @@
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/ObjCARC.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 #include <system_error>
 using namespace llvm;
 
@@ -67,7 +70,7 @@ LTOCodeGenerator::LTOCodeGenerator()
     : Context(getGlobalContext()), IRLinker(new Module("ld-temp.o", Context)),
       TargetMach(nullptr), EmitDwarfDebugInfo(false),
       ScopeRestrictionsDone(false), CodeModel(LTO_CODEGEN_PIC_MODEL_DEFAULT),
-      DiagHandler(nullptr), DiagContext(nullptr) {
+      Parallelism(1), DiagHandler(nullptr), DiagContext(nullptr) {
   initializeLTOPasses();
 }
 
@@ -222,6 +225,61 @@ bool LTOCodeGenerator::compile_to_file(const char** name,
   return true;
 }
 
+bool LTOCodeGenerator::compile_to_files(const char ***names,
+                                        unsigned *count,
+                                        bool disableOpt,
+                                        bool disableInline,
+                                        bool disableGVNLoadPRE,
+                                        std::string &errMsg) {
+  unsigned NumUnits = std::max(Parallelism, 1U);
+
+  // make unique temp .o files to put the generated object files. Until they
+  // are kept, the files are removed again when their tool_output_file goes
+  // away.
+  std::vector<std::unique_ptr<tool_output_file>> ObjFiles;
+  std::vector<raw_ostream *> Outs;
+  std::vector<std::string> Filenames;
+  for (unsigned I = 0; I != NumUnits; ++I) {
+    SmallString<128> Filename;
+    int FD;
+    std::error_code EC =
+        sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
+    if (EC) {
+      errMsg = EC.message();
+      return false;
+    }
+    ObjFiles.push_back(
+        make_unique<tool_output_file>(Filename.c_str(), FD));
+    Outs.push_back(&ObjFiles.back()->os());
+    Filenames.push_back(Filename.str());
+  }
+
+  // generate object files
+  bool genResult = compileParallel(Outs, disableOpt, disableInline,
+                                   disableGVNLoadPRE, errMsg);
+  bool writeResult = true;
+  for (auto &ObjFile : ObjFiles) {
+    ObjFile->os().close();
+    if (ObjFile->os().has_error()) {
+      ObjFile->os().clear_error();
+      writeResult = false;
+    }
+  }
+  if (!genResult || !writeResult)
+    return false;
+
+  for (auto &ObjFile : ObjFiles)
+    ObjFile->keep();
+
+  NativeObjectPaths = std::move(Filenames);
+  NativeObjectPathPtrs.clear();
+  for (const std::string &Path : NativeObjectPaths)
+    NativeObjectPathPtrs.push_back(Path.c_str());
+  *names = NativeObjectPathPtrs.data();
+  *count = NativeObjectPathPtrs.size();
+  return true;
+}
+
 const void* LTOCodeGenerator::compile(size_t* length,
                                       bool disableOpt,
                                       bool disableInline,
@@ -437,11 +495,10 @@ void LTOCodeGenerator::applyScopeRestrictions() {
 }
 
 /// Optimize merged modules using various IPO passes
-bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
-                                          bool DisableOpt,
-                                          bool DisableInline,
-                                          bool DisableGVNLoadPRE,
-                                          std::string &errMsg) {
+bool LTOCodeGenerator::optimize(bool DisableOpt,
+                                bool DisableInline,
+                                bool DisableGVNLoadPRE,
+                                std::string &errMsg) {
   if (!this->determineTarget(errMsg))
     return false;
 
@@ -469,9 +526,19 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
 
   PMB.populateLTOPassManager(passes, TargetMach);
 
+  // Run our queue of passes all at once now, efficiently.
+  passes.run(*mergedModule);
+
+  return true;
+}
+
+/// Run the code generator for TM on the optimized module M, and write the
+/// object file to out.
+static bool emitObjectFile(Module &M, TargetMachine &TM, raw_ostream &out,
+                           std::string &errMsg) {
   PassManager codeGenPasses;
 
-  codeGenPasses.add(new DataLayoutPass(mergedModule));
+  codeGenPasses.add(new DataLayoutPass(&M));
 
   formatted_raw_ostream Out(out);
 
@@ -479,21 +546,101 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   // the ObjCARCContractPass must be run, so do it unconditionally here.
   codeGenPasses.add(createObjCARCContractPass());
 
-  if (TargetMach->addPassesToEmitFile(codeGenPasses, Out,
-                                      TargetMachine::CGFT_ObjectFile)) {
+  if (TM.addPassesToEmitFile(codeGenPasses, Out,
+                             TargetMachine::CGFT_ObjectFile)) {
     errMsg = "target file type not supported";
     return false;
   }
 
-  // Run our queue of passes all at once now, efficiently.
-  passes.run(*mergedModule);
-
   // Run the code generator, and write assembly file
-  codeGenPasses.run(*mergedModule);
+  codeGenPasses.run(M);
 
   return true;
 }
 
+bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
+                                          bool DisableOpt,
+                                          bool DisableInline,
+                                          bool DisableGVNLoadPRE,
+                                          std::string &errMsg) {
+  if (!optimize(DisableOpt, DisableInline, DisableGVNLoadPRE, errMsg))
+    return false;
+
+  return emitObjectFile(*IRLinker.getModule(), *TargetMach, out, errMsg);
+}
+
+/// Read back one code generation unit into a fresh LLVMContext and compile it
+/// with a TargetMachine of its own. This is run on a separate thread for each
+/// unit, so it must not touch the merged module or TargetMach beyond reading
+/// its configuration.
+bool LTOCodeGenerator::compilePartition(StringRef Bitcode, raw_ostream &out,
+                                        std::string &errMsg) {
+  LLVMContext PartContext;
+  if (DiagHandler)
+    PartContext.setDiagnosticHandler(PartitionDiagnosticHandler, this);
+
+  std::unique_ptr<MemoryBuffer> Buffer =
+      MemoryBuffer::getMemBuffer(Bitcode, "ld-temp.o", false);
+  ErrorOr<Module *> ModuleOrErr =
+      parseBitcodeFile(Buffer->getMemBufferRef(), PartContext);
+  if (std::error_code EC = ModuleOrErr.getError()) {
+    errMsg = EC.message();
+    return false;
+  }
+  std::unique_ptr<Module> PartModule(ModuleOrErr.get());
+
+  std::unique_ptr<TargetMachine> PartTM(
+      TargetMach->getTarget().createTargetMachine(
+          TargetMach->getTargetTriple(), TargetMach->getTargetCPU(),
+          TargetMach->getTargetFeatureString(), Options,
+          TargetMach->getRelocationModel(), TargetMach->getCodeModel(),
+          TargetMach->getOptLevel()));
+
+  return emitObjectFile(*PartModule, *PartTM, out, errMsg);
+}
+
+bool LTOCodeGenerator::compileParallel(ArrayRef<raw_ostream *> Outs,
+                                       bool DisableOpt,
+                                       bool DisableInline,
+                                       bool DisableGVNLoadPRE,
+                                       std::string &errMsg) {
+  assert(!Outs.empty() && "No output streams given");
+  if (Outs.size() == 1)
+    return generateObjectFile(*Outs[0], DisableOpt, DisableInline,
+                              DisableGVNLoadPRE, errMsg);
+
+  if (!optimize(DisableOpt, DisableInline, DisableGVNLoadPRE, errMsg))
+    return false;
+
+  // An LLVMContext must not be used from several threads at once, so every
+  // code generation unit is handed to its thread as bitcode.
+  std::vector<std::string> Partitions;
+  Partitions.reserve(Outs.size());
+  SplitModule(*IRLinker.getModule(), Outs.size(),
+              [&](std::unique_ptr<Module> PartModule) {
+    Partitions.push_back(std::string());
+    raw_string_ostream OS(Partitions.back());
+    WriteBitcodeToFile(PartModule.get(), OS);
+  });
+
+  std::vector<std::string> Errors(Outs.size());
+  std::vector<char> Succeeded(Outs.size(), false);
+  ThreadPool CodegenPool(Outs.size());
+  for (unsigned I = 0, E = Outs.size(); I != E; ++I)
+    CodegenPool.async([&, I]() {
+      Succeeded[I] = compilePartition(Partitions[I], *Outs[I], Errors[I]);
+    });
+  CodegenPool.wait();
+
+  for (unsigned I = 0, E = Outs.size(); I != E; ++I) {
+    if (!Succeeded[I]) {
+      errMsg = Errors[I];
+      return false;
+    }
+  }
+  return true;
+}
+
 /// setCodeGenDebugOptions - Set codegen debugging options to aid in debugging
 /// LTO problems.
 void LTOCodeGenerator::setCodeGenDebugOptions(const char *options) {
@@ -549,6 +696,15 @@ void LTOCodeGenerator::DiagnosticHandler2(const DiagnosticInfo &DI) {
   (*DiagHandler)(Severity, MsgStorage.c_str(), DiagContext);
 }
 
+void LTOCodeGenerator::PartitionDiagnosticHandler(const DiagnosticInfo &DI,
+                                                  void *Context) {
+  // Code generation units report their diagnostics from several threads, but
+  // the external handler is not expected to be reentrant.
+  LTOCodeGenerator *CodeGen = (LTOCodeGenerator *)Context;
+  sys::ScopedLock Lock(CodeGen->DiagMutex);
+  CodeGen->DiagnosticHandler2(DI);
+}
+
 void
 LTOCodeGenerator::setDiagnosticHandler(lto_diagnostic_handler_t DiagHandler,
                                        void *Ctxt) {
@@ -13,9 +13,12 @@
 
 #include "llvm/Linker/Linker.h"
 #include "llvm-c/Linker.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/TypeFinder.h"
@@ -27,13 +30,85 @@
 #include <tuple>
 using namespace llvm;
 
+#define DEBUG_TYPE "linker"
+
+STATISTIC(NumNeededGlobals, "Number of source globals found to be needed");
+STATISTIC(NumBodiesMaterialized,
+          "Number of function bodies materialized by the linker");
+STATISTIC(NumModulesSkipped,
+          "Number of source modules providing no needed definition");
+STATISTIC(NumShapeCandidates,
+          "Number of struct types tried because their shape hashes match");
+STATISTIC(NumShapeMappings,
+          "Number of struct types mapped to a type found by shape");
+
 
 //===----------------------------------------------------------------------===//
 // TypeMap implementation.
 //===----------------------------------------------------------------------===//
 
+/// Number of levels of nested identified structs that contribute to the shape
+/// hash of a struct type.
+static const unsigned ShapeHashDepth = 2;
+
+static hash_code hashTypeShape(Type *Ty, unsigned Depth) {
+  hash_code Hash = hash_value(unsigned(Ty->getTypeID()));
+  if (StructType *STy = dyn_cast<StructType>(Ty)) {
+    if (!STy->isLiteral()) {
+      // Opaque structs may be isomorphic to anything; past the depth limit,
+      // only the kind of the type is known.
+      if (STy->isOpaque())
+        return hash_combine(Hash, true);
+      if (Depth == 0)
+        return Hash;
+      --Depth;
+    }
+    Hash = hash_combine(Hash, STy->isPacked());
+  } else if (IntegerType *ITy = dyn_cast<IntegerType>(Ty)) {
+    Hash = hash_combine(Hash, ITy->getBitWidth());
+  } else if (PointerType *PTy = dyn_cast<PointerType>(Ty)) {
+    Hash = hash_combine(Hash, PTy->getAddressSpace());
+  } else if (FunctionType *FTy = dyn_cast<FunctionType>(Ty)) {
+    Hash = hash_combine(Hash, FTy->isVarArg());
+  } else if (SequentialType *SeqTy = dyn_cast<SequentialType>(Ty)) {
+    if (ArrayType *ATy = dyn_cast<ArrayType>(SeqTy))
+      Hash = hash_combine(Hash, ATy->getNumElements());
+    else if (VectorType *VTy = dyn_cast<VectorType>(SeqTy))
+      Hash = hash_combine(Hash, VTy->getNumElements());
+  }
+
+  Hash = hash_combine(Hash, Ty->getNumContainedTypes());
+  for (unsigned i = 0, e = Ty->getNumContainedTypes(); i != e; ++i)
+    Hash = hash_combine(Hash, hashTypeShape(Ty->getContainedType(i), Depth));
+  return Hash;
+}
+
+unsigned Linker::IdentifiedStructTypeSet::getShapeHash(StructType *Ty) {
+  assert(!Ty->isLiteral() && !Ty->isOpaque() && "Expected a defined struct");
+  return hashTypeShape(Ty, ShapeHashDepth);
+}
+
+void Linker::IdentifiedStructTypeSet::insert(StructType *Ty) {
+  if (Types.insert(Ty) && !Ty->isOpaque())
+    TypesByShape[getShapeHash(Ty)].push_back(Ty);
+}
+
+void Linker::IdentifiedStructTypeSet::addBody(StructType *Ty) {
+  assert(Types.count(Ty) && "Not a type of the composite");
+  TypesByShape[getShapeHash(Ty)].push_back(Ty);
+}
+
+ArrayRef<StructType *>
+Linker::IdentifiedStructTypeSet::lookup(unsigned Hash) const {
+  DenseMap<unsigned, TinyPtrVector<StructType*> >::const_iterator I =
+      TypesByShape.find(Hash);
+  if (I == TypesByShape.end())
+    return None;
+  return I->second;
+}
+
 namespace {
-  typedef SmallPtrSet<StructType*, 32> TypeSet;
+  typedef Linker::IdentifiedStructTypeSet TypeSet;
 
 class TypeMapTy : public ValueMapTypeRemapper {
   /// MappedTypes - This is a mapping from a source type to a destination type
@@ -67,6 +142,10 @@ public:
   /// module from a type definition in the source module.
   void linkDefinedTypeBodies();
 
+  /// hasMapping - Return true if the specified type from the source module
+  /// has been mapped already.
+  bool hasMapping(Type *SrcTy) const { return MappedTypes.lookup(SrcTy); }
+
   /// get - Return the mapped type to use for the specified input type from the
   /// source module.
   Type *get(Type *SrcTy);
@@ -205,6 +284,7 @@ bool TypeMapTy::areTypesIsomorphic(Type *DstTy, Type *SrcTy) {
 /// module from a type definition in the source module.
 void TypeMapTy::linkDefinedTypeBodies() {
   SmallVector<Type*, 16> Elements;
+  SmallVector<StructType*, 16> NewBodies;
   SmallString<16> TmpName;
 
   // Note that processing entries in this loop (calling 'get') can add new
@@ -225,6 +305,7 @@ void TypeMapTy::linkDefinedTypeBodies() {
       Elements[i] = getImpl(SrcSTy->getElementType(i));
 
     DstSTy->setBody(Elements, SrcSTy->isPacked());
+    NewBodies.push_back(DstSTy);
 
     // If DstSTy has no name or has a longer name than STy, then viciously steal
     // STy's name.
@@ -239,6 +320,10 @@ void TypeMapTy::linkDefinedTypeBodies() {
     }
   }
 
+  // Index the types only now that the types they contain have a body too.
+  for (unsigned i = 0, e = NewBodies.size(); i != e; ++i)
+    DstStructTypesSet.addBody(NewBodies[i]);
+
   DstResolvedOpaqueTypes.clear();
 }
 
@@ -366,16 +451,34 @@ namespace {
     TypeMapTy &TypeMap;
     Module *DstM;
     std::vector<Function*> &LazilyLinkFunctions;
+    const SmallPtrSetImpl<const GlobalValue*> *NeededGlobals;
   public:
     ValueMaterializerTy(TypeMapTy &TypeMap, Module *DstM,
-                        std::vector<Function*> &LazilyLinkFunctions) :
+                        std::vector<Function*> &LazilyLinkFunctions,
+                        const SmallPtrSetImpl<const GlobalValue*> *Needed) :
       ValueMaterializer(), TypeMap(TypeMap), DstM(DstM),
-      LazilyLinkFunctions(LazilyLinkFunctions) {
+      LazilyLinkFunctions(LazilyLinkFunctions), NeededGlobals(Needed) {
     }
 
     Value *materializeValueFor(Value *V) override;
   };
 
+  /// LeftOutGlobalMaterializerTy - Maps to null the globals that are left out
+  /// of the link, so that the named metadata linked with them can refer to
+  /// the others only.
+  class LeftOutGlobalMaterializerTy : public ValueMaterializer {
+    TypeMapTy &TypeMap;
+  public:
+    explicit LeftOutGlobalMaterializerTy(TypeMapTy &TypeMap)
+        : ValueMaterializer(), TypeMap(TypeMap) {}
+
+    Value *materializeValueFor(Value *V) override {
+      if (GlobalValue *GV = dyn_cast<GlobalValue>(V))
+        return Constant::getNullValue(TypeMap.get(GV->getType()));
+      return nullptr;
+    }
+  };
+
   /// ModuleLinker - This is an implementation class for the LinkModules
   /// function, which is the entrypoint for this file.
   class ModuleLinker {
@@ -406,20 +509,31 @@ namespace {
     // Vector of functions to lazily link in.
     std::vector<Function*> LazilyLinkFunctions;
 
+    // If not null, the only globals to link in from source. The others are
+    // only referenced, by declarations if needed.
+    const SmallPtrSetImpl<const GlobalValue*> *NeededGlobals;
+
     bool SuppressWarnings;
 
   public:
     std::string ErrorMsg;
 
     ModuleLinker(Module *dstM, TypeSet &Set, Module *srcM, unsigned mode,
-                 bool SuppressWarnings=false)
+                 bool SuppressWarnings=false,
+                 const SmallPtrSetImpl<const GlobalValue*> *Needed = nullptr)
         : DstM(dstM), SrcM(srcM), TypeMap(Set),
-          ValMaterializer(TypeMap, DstM, LazilyLinkFunctions), Mode(mode),
+          ValMaterializer(TypeMap, DstM, LazilyLinkFunctions, Needed),
+          Mode(mode), NeededGlobals(Needed),
           SuppressWarnings(SuppressWarnings) {}
 
     bool run();
 
   private:
+    /// isNeeded - Return true if SGV is to be linked in from source.
+    bool isNeeded(const GlobalValue *SGV) const {
+      return !NeededGlobals || NeededGlobals->count(SGV);
+    }
+
     /// emitError - Helper method for setting a message and returning an error
     /// code.
     bool emitError(const Twine &Message) {
@@ -538,6 +652,30 @@ static bool isLessConstraining(GlobalValue::VisibilityTypes a,
 }
 
 Value *ValueMaterializerTy::materializeValueFor(Value *V) {
+  // A global that is not needed from the source is defined elsewhere, or not
+  // at all: refer to it through a declaration.
+  GlobalValue *SGV = dyn_cast<GlobalValue>(V);
+  if (SGV && NeededGlobals && !SGV->hasLocalLinkage() &&
+      !NeededGlobals->count(SGV)) {
+    Type *Ty = TypeMap.get(SGV->getType());
+    GlobalValue *DGV = DstM->getNamedValue(SGV->getName());
+    if (DGV && !DGV->hasLocalLinkage())
+      return ConstantExpr::getBitCast(DGV, Ty);
+
+    Type *ElemTy = cast<PointerType>(Ty)->getElementType();
+    if (FunctionType *FTy = dyn_cast<FunctionType>(ElemTy))
+      DGV = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                             SGV->getName(), DstM);
+    else
+      DGV = new GlobalVariable(*DstM, ElemTy, /*isConstant*/false,
+                               GlobalValue::ExternalLinkage, /*init*/nullptr,
+                               SGV->getName(), /*insertbefore*/nullptr,
+                               SGV->getThreadLocalMode(),
+                               SGV->getType()->getAddressSpace());
+    forceRenaming(DGV, SGV->getName());
+    return ConstantExpr::getBitCast(DGV, Ty);
+  }
+
   Function *SF = dyn_cast<Function>(V);
   if (!SF)
     return nullptr;
@@ -774,12 +912,13 @@ void ModuleLinker::computeTypeMapping() {
       TypeMap.addTypeMapping(DGV->getType(), I->getType());
   }
 
-  // Incorporate types by name, scanning all the types in the source module.
+  // Incorporate types by name, scanning all the types in the source module;
+  // the unnamed ones are left to the matching by shape below.
   // At this point, the destination module may have a type "%foo = { i32 }" for
   // example.  When the source module got loaded into the same LLVMContext, if
   // it had the same type, it would have been renamed to "%foo.42 = { i32 }".
   TypeFinder SrcStructTypes;
-  SrcStructTypes.run(*SrcM, true);
+  SrcStructTypes.run(*SrcM, false);
   SmallPtrSet<StructType*, 32> SrcStructTypesSet(SrcStructTypes.begin(),
                                                  SrcStructTypes.end());
 
@@ -817,6 +956,29 @@ void ModuleLinker::computeTypeMapping() {
         TypeMap.addTypeMapping(DST, ST);
   }
 
+  // Incorporate the remaining types by structure. Rather than creating a copy
+  // of every such type in the destination module, reuse an isomorphic type it
+  // already has. Only the types with the same shape hash can be isomorphic,
+  // barring opaque types, so they are the only ones tried.
+  for (unsigned i = 0, e = SrcStructTypes.size(); i != e; ++i) {
+    StructType *ST = SrcStructTypes[i];
+    if (ST->isLiteral() || ST->isOpaque() || TypeMap.hasMapping(ST))
+      continue;
+
+    ArrayRef<StructType*> Candidates =
+        TypeMap.DstStructTypesSet.lookup(TypeSet::getShapeHash(ST));
+    for (unsigned j = 0, je = Candidates.size(); j != je; ++j) {
+      if (SrcStructTypesSet.count(Candidates[j]))
+        continue;
+      ++NumShapeCandidates;
+      TypeMap.addTypeMapping(Candidates[j], ST);
+      if (TypeMap.hasMapping(ST)) {
+        ++NumShapeMappings;
+        break;
+      }
+    }
+  }
+
   // Don't bother incorporating aliases, they aren't generally typed well.
 
   // Now that we have discovered all of the type equivalences, get a body for
@@ -972,6 +1134,11 @@ bool ModuleLinker::linkAppendingVarProto(GlobalVariable *DstGV,
 /// linkGlobalProto - Loop through the global variables in the src module and
 /// merge them into the dest module.
 bool ModuleLinker::linkGlobalProto(GlobalVariable *SGV) {
+  if (!isNeeded(SGV)) {
+    DoNotLinkFromSource.insert(SGV);
+    return false;
+  }
+
   GlobalValue *DGV = getLinkedToGlobal(SGV);
   llvm::Optional<GlobalValue::VisibilityTypes> NewVisibility;
   bool HasUnnamedAddr = SGV->hasUnnamedAddr();
@@ -1065,6 +1232,11 @@ bool ModuleLinker::linkGlobalProto(GlobalVariable *SGV) {
 /// linkFunctionProto - Link the function in the source module into the
 /// destination module if needed, setting up mapping information.
 bool ModuleLinker::linkFunctionProto(Function *SF) {
+  if (!isNeeded(SF)) {
+    DoNotLinkFromSource.insert(SF);
+    return false;
+  }
+
   GlobalValue *DGV = getLinkedToGlobal(SF);
   llvm::Optional<GlobalValue::VisibilityTypes> NewVisibility;
   bool HasUnnamedAddr = SF->hasUnnamedAddr();
@@ -1108,9 +1280,11 @@ bool ModuleLinker::linkFunctionProto(Function *SF) {
   }
 
   // If the function is to be lazily linked, don't create it just yet.
-  // The ValueMaterializerTy will deal with creating it if it's used.
-  if (!DGV && (SF->hasLocalLinkage() || SF->hasLinkOnceLinkage() ||
-               SF->hasAvailableExternallyLinkage())) {
+  // The ValueMaterializerTy will deal with creating it if it's used. Needed
+  // functions are linked right away, as their users may be in other modules.
+  if (!DGV && !NeededGlobals &&
+      (SF->hasLocalLinkage() || SF->hasLinkOnceLinkage() ||
+       SF->hasAvailableExternallyLinkage())) {
     DoNotLinkFromSource.insert(SF);
     return false;
   }
@@ -1146,6 +1320,11 @@ bool ModuleLinker::linkFunctionProto(Function *SF) {
 /// LinkAliasProto - Set up prototypes for any aliases that come over from the
 /// source module.
 bool ModuleLinker::linkAliasProto(GlobalAlias *SGA) {
+  if (!isNeeded(SGA)) {
+    DoNotLinkFromSource.insert(SGA);
+    return false;
+  }
+
   GlobalValue *DGV = getLinkedToGlobal(SGA);
   llvm::Optional<GlobalValue::VisibilityTypes> NewVisibility;
   bool HasUnnamedAddr = SGA->hasUnnamedAddr();
@@ -1332,6 +1511,29 @@ void ModuleLinker::linkAliasBodies() {
 /// linkNamedMDNodes - Insert all of the named MDNodes in Src into the Dest
 /// module.
 void ModuleLinker::linkNamedMDNodes() {
+  // When only the needed globals are linked in, map the named metadata with
+  // those globals alone, and the references to the others become null.
+  ValueToValueMapTy NeededMap;
+  LeftOutGlobalMaterializerTy LeftOutMaterializer(TypeMap);
+  ValueToValueMapTy &VM = NeededGlobals ? NeededMap : ValueMap;
+  ValueMaterializer *Materializer = &ValMaterializer;
+  if (NeededGlobals) {
+    Materializer = &LeftOutMaterializer;
+    auto Seed = [&](const GlobalValue &SGV) {
+      if (!isNeeded(&SGV))
+        return;
+      ValueToValueMapTy::iterator I = ValueMap.find(&SGV);
+      if (I != ValueMap.end() && I->second)
+        NeededMap[&SGV] = I->second;
+    };
+    for (const GlobalVariable &SGV : SrcM->globals())
+      Seed(SGV);
+    for (const Function &SF : *SrcM)
+      Seed(SF);
+    for (const GlobalAlias &SGA : SrcM->aliases())
+      Seed(SGA);
+  }
+
   const NamedMDNode *SrcModFlags = SrcM->getModuleFlagsMetadata();
   for (Module::const_named_metadata_iterator I = SrcM->named_metadata_begin(),
        E = SrcM->named_metadata_end(); I != E; ++I) {
@@ -1340,8 +1542,8 @@ void ModuleLinker::linkNamedMDNodes() {
     NamedMDNode *DestNMD = DstM->getOrInsertNamedMetadata(I->getName());
     // Add Src elements into Dest node.
     for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i)
-      DestNMD->addOperand(MapValue(I->getOperand(i), ValueMap,
-                                   RF_None, &TypeMap, &ValMaterializer));
+      DestNMD->addOperand(MapValue(I->getOperand(i), VM, RF_None, &TypeMap,
+                                   Materializer));
   }
 }
 
@@ -1606,6 +1808,7 @@ bool ModuleLinker::run() {
         continue;
       if (SF->Materialize(&ErrorMsg))
         return true;
+      ++NumBodiesMaterialized;
     }
 
     linkFunctionBody(DF, SF);
@@ -1655,6 +1858,7 @@ bool ModuleLinker::run() {
           continue;
         if (SF->Materialize(&ErrorMsg))
           return true;
+        ++NumBodiesMaterialized;
       }
 
       // Erase from vector *before* the function body is linked - linkFunctionBody could
@@ -1681,9 +1885,12 @@ bool ModuleLinker::run() {
 
 Linker::Linker(Module *M, bool SuppressWarnings)
     : Composite(M), SuppressWarnings(SuppressWarnings) {
+  // Unnamed types are indexed too, as they can only be matched by shape.
   TypeFinder StructTypes;
-  StructTypes.run(*M, true);
-  IdentifiedStructTypes.insert(StructTypes.begin(), StructTypes.end());
+  StructTypes.run(*M, false);
+  for (StructType *Ty : StructTypes)
+    if (!Ty->isLiteral())
+      IdentifiedStructTypes.insert(Ty);
 }
 
 Linker::~Linker() {
@@ -1705,6 +1912,191 @@ bool Linker::linkInModule(Module *Src, unsigned Mode, std::string *ErrorMsg) {
   return false;
 }
 
+namespace {
+  /// NeededGlobalsFinder - Computes the source globals reachable from the
+  /// declarations of the destination module, materializing the bodies of the
+  /// needed functions on the way.
+  class NeededGlobalsFinder {
+    Module *DstM;
+    ArrayRef<Module*> SrcMs;
+
+    /// Definitions - The definition each external name resolves to.
+    StringMap<GlobalValue*> Definitions;
+
+    /// ComdatMembers - The globals of each comdat of the pulled modules.
+    DenseMap<const Comdat*, SmallVector<GlobalValue*, 2> > ComdatMembers;
+
+    SmallVector<GlobalValue*, 64> Worklist;
+    SmallPtrSet<const Constant*, 64> VisitedConstants;
+
+  public:
+    SmallPtrSet<const GlobalValue*, 64> Needed;
+    SmallPtrSet<const Module*, 16> PulledModules;
+    std::string ErrorMsg;
+
+    NeededGlobalsFinder(Module *DstM, ArrayRef<Module*> SrcMs)
+        : DstM(DstM), SrcMs(SrcMs) {}
+
+    bool run();
+
+  private:
+    void addDefinition(GlobalValue *GV);
+    void need(GlobalValue *GV);
+    void needReferencedGlobals(const Constant *C);
+    void pullModule(Module *M);
+  };
+}
+
+static bool isStrongDefinition(const GlobalValue *GV) {
+  return !GV->isWeakForLinker() && !GV->hasAvailableExternallyLinkage();
+}
+
+void NeededGlobalsFinder::addDefinition(GlobalValue *GV) {
+  if (!GV->hasName() || GV->hasLocalLinkage() || GV->hasAppendingLinkage())
+    return;
+  if (GV->isDeclaration() && !GV->isMaterializable())
+    return;
+
+  // Prefer the first strong definition, and else the first one.
+  GlobalValue *&Def = Definitions[GV->getName()];
+  if (!Def || (!isStrongDefinition(Def) && isStrongDefinition(GV)))
+    Def = GV;
+}
+
+void NeededGlobalsFinder::need(GlobalValue *GV) {
+  if (!GV->hasLocalLinkage() && !GV->hasAppendingLinkage())
+    if (GlobalValue *Def = Definitions.lookup(GV->getName()))
+      GV = Def;
+
+  if (GV->getParent() != DstM && Needed.insert(GV))
+    Worklist.push_back(GV);
+}
+
+void NeededGlobalsFinder::needReferencedGlobals(const Constant *C) {
+  SmallVector<const Constant*, 16> Constants;
+  Constants.push_back(C);
+  while (!Constants.empty()) {
+    C = Constants.pop_back_val();
+    if (const GlobalValue *GV = dyn_cast<GlobalValue>(C)) {
+      need(const_cast<GlobalValue*>(GV));
+      continue;
+    }
+    if (!VisitedConstants.insert(C))
+      continue;
+    for (const Value *Op : C->operands())
+      if (const Constant *OpC = dyn_cast<Constant>(Op))
+        Constants.push_back(OpC);
+  }
+}
+
+/// pullModule - Take note that M provides needed definitions. Its appending
+/// variables come along, as for an archive member.
+void NeededGlobalsFinder::pullModule(Module *M) {
+  if (!PulledModules.insert(M))
+    return;
+
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I) {
+    if (I->hasAppendingLinkage())
+      need(I);
+    if (const Comdat *C = I->getComdat())
+      ComdatMembers[C].push_back(I);
+  }
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (const Comdat *C = I->getComdat())
+      ComdatMembers[C].push_back(I);
+  for (Module::alias_iterator I = M->alias_begin(), E = M->alias_end();
+       I != E; ++I)
+    if (const Comdat *C = I->getComdat())
+      ComdatMembers[C].push_back(I);
+}
+
+bool NeededGlobalsFinder::run() {
+  for (Module *SrcM : SrcMs) {
+    for (Module::global_iterator I = SrcM->global_begin(),
+         E = SrcM->global_end(); I != E; ++I)
+      addDefinition(I);
+    for (Module::iterator I = SrcM->begin(), E = SrcM->end(); I != E; ++I)
+      addDefinition(I);
+    for (Module::alias_iterator I = SrcM->alias_begin(),
+         E = SrcM->alias_end(); I != E; ++I)
+      addDefinition(I);
+  }
+
+  // The roots are the definitions of what the destination module declares.
+  for (Module::global_iterator I = DstM->global_begin(),
+       E = DstM->global_end(); I != E; ++I)
+    if (I->isDeclaration() && !I->hasLocalLinkage())
+      need(I);
+  for (Module::iterator I = DstM->begin(), E = DstM->end(); I != E; ++I)
+    if (I->isDeclaration() && !I->hasLocalLinkage())
+      need(I);
+
+  while (!Worklist.empty()) {
+    GlobalValue *GV = Worklist.pop_back_val();
+    ++NumNeededGlobals;
+    pullModule(GV->getParent());
+
+    // A comdat is linked or dropped as a whole.
+    if (const Comdat *C = GV->getComdat())
+      for (GlobalValue *Member : ComdatMembers[C])
+        need(Member);
+
+    if (GlobalVariable *Var = dyn_cast<GlobalVariable>(GV)) {
+      if (Var->hasInitializer())
+        needReferencedGlobals(Var->getInitializer());
+      continue;
+    }
+    if (GlobalAlias *GA = dyn_cast<GlobalAlias>(GV)) {
+      if (const Constant *Aliasee = GA->getAliasee())
+        needReferencedGlobals(Aliasee);
+      continue;
+    }
+
+    Function *F = cast<Function>(GV);
+    if (F->isMaterializable()) {
+      if (F->Materialize(&ErrorMsg))
+        return true;
+      ++NumBodiesMaterialized;
+    }
+    if (F->hasPrefixData())
+      needReferencedGlobals(F->getPrefixData());
+    for (Function::const_iterator BB = F->begin(), BE = F->end(); BB != BE;
+         ++BB)
+      for (BasicBlock::const_iterator I = BB->begin(), IE = BB->end();
+           I != IE; ++I)
+        for (const Value *Op : I->operands())
+          if (const Constant *C = dyn_cast<Constant>(Op))
+            needReferencedGlobals(C);
+  }
+  return false;
+}
+
+bool Linker::linkInNeededDefinitions(ArrayRef<Module *> Srcs,
+                                     std::string *ErrorMsg) {
+  NeededGlobalsFinder Finder(Composite, Srcs);
+  if (Finder.run()) {
+    if (ErrorMsg)
+      *ErrorMsg = Finder.ErrorMsg;
+    return true;
+  }
+
+  for (Module *Src : Srcs) {
+    if (!Finder.PulledModules.count(Src)) {
+      ++NumModulesSkipped;
+      continue;
+    }
+    ModuleLinker TheLinker(Composite, IdentifiedStructTypes, Src,
+                           DestroySource, SuppressWarnings, &Finder.Needed);
+    if (TheLinker.run()) {
+      if (ErrorMsg)
+        *ErrorMsg = TheLinker.ErrorMsg;
+      return true;
+    }
+  }
+  return false;
+}
+
 //===----------------------------------------------------------------------===//
 // LinkModules entrypoint.
 //===----------------------------------------------------------------------===//
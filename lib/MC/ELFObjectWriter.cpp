@@ -34,6 +34,7 @@
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/ELF.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ThreadPool.h"
 #include <vector>
 using namespace llvm;
 
@@ -291,7 +292,7 @@ class ELFObjectWriter : public MCObjectWriter {
 
     void WriteRelocationsFragment(const MCAssembler &Asm,
                                   MCDataFragment *F,
-                                  const MCSectionData *SD);
+                                  std::vector<ELFRelocationEntry> &Relocs);
 
     bool
     IsSymbolRefDifferenceFullyResolvedImpl(const MCAssembler &Asm,
@@ -1291,6 +1292,8 @@ void ELFObjectWriter::CompressDebugSections(MCAssembler &Asm,
 
 void ELFObjectWriter::WriteRelocations(MCAssembler &Asm, MCAsmLayout &Layout,
                                        const RelMapTy &RelMap) {
+  std::vector<std::pair<MCDataFragment *, std::vector<ELFRelocationEntry> *>>
+      Work;
   for (MCAssembler::const_iterator it = Asm.begin(),
          ie = Asm.end(); it != ie; ++it) {
     const MCSectionData &SD = *it;
@@ -1303,9 +1306,25 @@ void ELFObjectWriter::WriteRelocations(MCAssembler &Asm, MCAsmLayout &Layout,
     MCSectionData &RelaSD = Asm.getOrCreateSectionData(*RelaSection);
     RelaSD.setAlignment(is64Bit() ? 8 : 4);
 
-    MCDataFragment *F = new MCDataFragment(&RelaSD);
-    WriteRelocationsFragment(Asm, F, &*it);
+    auto RelocsIt = Relocations.find(&SD);
+    assert(RelocsIt != Relocations.end() &&
+           "Relocation section without relocations!");
+    Work.push_back(std::make_pair(new MCDataFragment(&RelaSD),
+                                  &RelocsIt->second));
   }
+
+  // The relocation sections are independent of each other once the symbol
+  // table is known, so they can be sorted and encoded concurrently.
+  unsigned Threads = Asm.getRelocationThreads();
+  if (Threads == 1 || Work.size() < 2) {
+    for (auto &W : Work)
+      WriteRelocationsFragment(Asm, W.first, *W.second);
+    return;
+  }
+  ThreadPool Pool(Threads);
+  for (auto &W : Work)
+    Pool.async([&] { WriteRelocationsFragment(Asm, W.first, *W.second); });
+  Pool.wait();
 }
 
 void ELFObjectWriter::WriteSecHdrEntry(uint32_t Name, uint32_t Type,
@@ -1344,13 +1363,18 @@ static void sortRelocs(const MCAssembler &Asm,
   array_pod_sort(Relocs.begin(), Relocs.end(), cmpRel);
 }
 
-void ELFObjectWriter::WriteRelocationsFragment(const MCAssembler &Asm,
-                                               MCDataFragment *F,
-                                               const MCSectionData *SD) {
-  std::vector<ELFRelocationEntry> &Relocs = Relocations[SD];
-
+void ELFObjectWriter::WriteRelocationsFragment(
+    const MCAssembler &Asm, MCDataFragment *F,
+    std::vector<ELFRelocationEntry> &Relocs) {
   sortRelocs(Asm, Relocs);
 
+  unsigned EntrySize;
+  if (hasRelocationAddend())
+    EntrySize = is64Bit() ? sizeof(ELF::Elf64_Rela) : sizeof(ELF::Elf32_Rela);
+  else
+    EntrySize = is64Bit() ? sizeof(ELF::Elf64_Rel) : sizeof(ELF::Elf32_Rel);
+  F->getContents().reserve(Relocs.size() * EntrySize);
+
   for (unsigned i = 0, e = Relocs.size(); i != e; ++i) {
     const ELFRelocationEntry &Entry = Relocs[e - i - 1];
 
@@ -53,6 +53,11 @@ STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
+STATISTIC(SectionRelaxationSteps,
+          "Number of relaxation steps over a single section");
+STATISTIC(RelaxationCandidates,
+          "Number of fragments initially considered for relaxation");
+STATISTIC(RelaxationChecks, "Number of fragments checked for relaxation");
 }
 }
 
@@ -349,8 +354,8 @@ MCAssembler::MCAssembler(MCContext &Context_, MCAsmBackend &Backend_,
                          MCCodeEmitter &Emitter_, MCObjectWriter &Writer_,
                          raw_ostream &OS_)
   : Context(Context_), Backend(Backend_), Emitter(Emitter_), Writer(Writer_),
-    OS(OS_), BundleAlignSize(0), RelaxAll(false), NoExecStack(false),
-    SubsectionsViaSymbols(false), ELFHeaderEFlags(0) {
+    OS(OS_), BundleAlignSize(0), RelocationThreads(1), RelaxAll(false),
+    NoExecStack(false), SubsectionsViaSymbols(false), ELFHeaderEFlags(0) {
   VersionMinInfo.Major = 0; // Major version == 0 for "none specified"
 }
 
@@ -885,8 +890,12 @@ void MCAssembler::Finish() {
       iFrag->setLayoutOrder(FragmentIndex++);
   }
 
-  // Layout until everything fits.
-  while (layoutOnce(Layout))
+  // Layout until everything fits. Only the fragments that may still change
+  // size are revisited.
+  std::vector<RelaxationWorklist> Worklists(size());
+  for (MCAssembler::iterator it = begin(), ie = end(); it != ie; ++it)
+    buildRelaxationWorklist(*it, Worklists[it->getOrdinal()]);
+  while (layoutOnce(Layout, Worklists))
     continue;
 
   DEBUG_WITH_TYPE("mc-dump", {
@@ -1035,41 +1044,71 @@ bool MCAssembler::relaxDwarfCallFrameFragment(MCAsmLayout &Layout,
   return OldSize != Data.size();
 }
 
-bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD) {
-  // Holds the first fragment which needed relaxing during this layout. It will
-  // remain NULL if none were relaxed.
-  // When a fragment is relaxed, all the fragments following it should get
-  // invalidated because their offset is going to change.
-  MCFragment *FirstRelaxedFragment = nullptr;
-
-  // Attempt to relax all the fragments in the section.
+void MCAssembler::buildRelaxationWorklist(MCSectionData &SD,
+                                          RelaxationWorklist &Worklist) const {
   for (MCSectionData::iterator I = SD.begin(), IE = SD.end(); I != IE; ++I) {
-    // Check if this is a fragment that needs relaxation.
-    bool RelaxedFrag = false;
-    switch(I->getKind()) {
+    switch (I->getKind()) {
     default:
-      break;
+      continue;
     case MCFragment::FT_Relaxable:
       assert(!getRelaxAll() &&
              "Did not expect a MCRelaxableFragment in RelaxAll mode");
-      RelaxedFrag = relaxInstruction(Layout, *cast<MCRelaxableFragment>(I));
+      if (!getBackend().mayNeedRelaxation(
+              cast<MCRelaxableFragment>(I)->getInst()))
+        continue;
       break;
     case MCFragment::FT_Dwarf:
-      RelaxedFrag = relaxDwarfLineAddr(Layout,
-                                       *cast<MCDwarfLineAddrFragment>(I));
-      break;
     case MCFragment::FT_DwarfFrame:
-      RelaxedFrag =
-        relaxDwarfCallFrameFragment(Layout,
-                                    *cast<MCDwarfCallFrameFragment>(I));
-      break;
     case MCFragment::FT_LEB:
-      RelaxedFrag = relaxLEB(Layout, *cast<MCLEBFragment>(I));
       break;
     }
-    if (RelaxedFrag && !FirstRelaxedFragment)
-      FirstRelaxedFragment = I;
+    Worklist.push_back(I);
+  }
+  stats::RelaxationCandidates += Worklist.size();
+}
+
+bool MCAssembler::relaxFragment(MCAsmLayout &Layout, MCFragment &F) {
+  switch(F.getKind()) {
+  default:
+    return false;
+  case MCFragment::FT_Relaxable:
+    return relaxInstruction(Layout, cast<MCRelaxableFragment>(F));
+  case MCFragment::FT_Dwarf:
+    return relaxDwarfLineAddr(Layout, cast<MCDwarfLineAddrFragment>(F));
+  case MCFragment::FT_DwarfFrame:
+    return relaxDwarfCallFrameFragment(Layout,
+                                       cast<MCDwarfCallFrameFragment>(F));
+  case MCFragment::FT_LEB:
+    return relaxLEB(Layout, cast<MCLEBFragment>(F));
+  }
+}
+
+bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout,
+                                    RelaxationWorklist &Worklist) {
+  ++stats::SectionRelaxationSteps;
+
+  // Holds the first fragment which needed relaxing during this layout. It will
+  // remain NULL if none were relaxed.
+  // When a fragment is relaxed, all the fragments following it should get
+  // invalidated because their offset is going to change. Their offsets are
+  // only recomputed when they are next queried.
+  MCFragment *FirstRelaxedFragment = nullptr;
+
+  // Attempt to relax all the candidates of the section. An instruction that
+  // was relaxed into one that can never need relaxation keeps its size from
+  // now on, so it is not looked at again.
+  RelaxationWorklist::iterator Kept = Worklist.begin();
+  for (MCFragment *F : Worklist) {
+    ++stats::RelaxationChecks;
+    if (relaxFragment(Layout, *F) && !FirstRelaxedFragment)
+      FirstRelaxedFragment = F;
+
+    MCRelaxableFragment *RF = dyn_cast<MCRelaxableFragment>(F);
+    if (!RF || getBackend().mayNeedRelaxation(RF->getInst()))
+      *Kept++ = F;
   }
+  Worklist.erase(Kept, Worklist.end());
+
   if (FirstRelaxedFragment) {
     Layout.invalidateFragmentsFrom(FirstRelaxedFragment);
     return true;
@@ -1077,15 +1116,14 @@ bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD) {
   return false;
 }
 
-bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
+bool MCAssembler::layoutOnce(MCAsmLayout &Layout,
+                             std::vector<RelaxationWorklist> &Worklists) {
   ++stats::RelaxationSteps;
 
   bool WasRelaxed = false;
-  for (iterator it = begin(), ie = end(); it != ie; ++it) {
-    MCSectionData &SD = *it;
-    while (layoutSectionOnce(Layout, SD))
+  for (RelaxationWorklist &Worklist : Worklists)
+    while (!Worklist.empty() && layoutSectionOnce(Layout, Worklist))
       WasRelaxed = true;
-  }
 
   return WasRelaxed;
 }
@@ -185,7 +185,8 @@ ErrorOr<std::unique_ptr<Archive>> Archive::create(MemoryBufferRef Source) {
 }
 
 Archive::Archive(MemoryBufferRef Source, std::error_code &ec)
-    : Binary(Binary::ID_Archive, Source), SymbolTable(child_end()) {
+    : Binary(Binary::ID_Archive, Source), SymbolTable(child_end()),
+      HasSymbolIndex(false) {
   // Check for sufficient magic.
   if (Data.getBufferSize() < 8 ||
       StringRef(Data.getBufferStart(), 8) != Magic) {
@@ -321,7 +322,7 @@ StringRef Archive::Symbol::getName() const {
   return Parent->SymbolTable->getBuffer().begin() + StringIndex;
 }
 
-ErrorOr<Archive::child_iterator> Archive::Symbol::getMember() const {
+ErrorOr<uint32_t> Archive::Symbol::getMemberOffset() const {
   const char *Buf = Parent->SymbolTable->getBuffer().begin();
   const char *Offsets = Buf + 4;
   uint32_t Offset = 0;
@@ -367,7 +368,14 @@ ErrorOr<Archive::child_iterator> Archive::Symbol::getMember() const {
                + OffsetIndex);
   }
 
-  const char *Loc = Parent->getData().begin() + Offset;
+  return Offset;
+}
+
+ErrorOr<Archive::child_iterator> Archive::Symbol::getMember() const {
+  ErrorOr<uint32_t> OffsetOrErr = getMemberOffset();
+  if (std::error_code EC = OffsetOrErr.getError())
+    return EC;
+  const char *Loc = Parent->getData().begin() + *OffsetOrErr;
   child_iterator Iter(Child(Parent, Loc));
   return Iter;
 }
@@ -475,6 +483,17 @@ Archive::symbol_iterator Archive::symbol_end() const {
 }
 
 Archive::child_iterator Archive::findSym(StringRef name) const {
+  if (HasSymbolIndex) {
+    StringMap<ErrorOr<uint32_t>>::const_iterator I = SymbolIndex.find(name);
+    if (I == SymbolIndex.end())
+      return child_end();
+    ErrorOr<uint32_t> OffsetOrErr = I->getValue();
+    // FIXME: Should we really eat the error?
+    if (OffsetOrErr.getError())
+      return child_end();
+    return Child(this, getData().begin() + *OffsetOrErr);
+  }
+
   Archive::symbol_iterator bs = symbol_begin();
   Archive::symbol_iterator es = symbol_end();
 
@@ -491,6 +510,18 @@ Archive::child_iterator Archive::findSym(StringRef name) const {
   return child_end();
 }
 
+void Archive::buildSymbolIndex() {
+  if (HasSymbolIndex)
+    return;
+
+  // Like the linear search, resolve a symbol defined by several members to
+  // the first one in the symbol table, even when the offset of that member
+  // cannot be read.
+  for (symbol_iterator I = symbol_begin(), E = symbol_end(); I != E; ++I)
+    SymbolIndex.insert(std::make_pair(I->getName(), I->getMemberOffset()));
+  HasSymbolIndex = true;
+}
+
 bool Archive::hasSymbolTable() const {
   return SymbolTable != child_end();
 }
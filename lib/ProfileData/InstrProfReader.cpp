@@ -322,22 +322,44 @@ std::error_code IndexedInstrProfReader::readHeader() {
   uint64_t HashOffset = endian::readNext<uint64_t, little, unaligned>(Cur);
 
   // The rest of the file is an on disk hash table.
-  Index.reset(InstrProfReaderIndex::Create(Start + HashOffset, Cur, Start,
-                                           InstrProfLookupTrait(HashType)));
+  Index.reset(InstrProfReaderIndex::Create(
+      Start + HashOffset, Cur, Start,
+      InstrProfLookupTrait(HashType, FormatVersion, Start)));
   // Set up our iterator for readNextRecord.
   RecordIterator = Index->data_begin();
 
   return success();
 }
 
-std::error_code IndexedInstrProfReader::getFunctionCounts(
-    StringRef FuncName, uint64_t FuncHash, std::vector<uint64_t> &Counts) {
+ArrayRef<uint64_t> IndexedInstrProfReader::getFunctionData(StringRef FuncName) {
+  auto Cached = FunctionDataCache.find(FuncName);
+  if (Cached != FunctionDataCache.end())
+    return Cached->getValue();
+
+  ArrayRef<uint64_t> Data;
   auto Iter = Index->find(FuncName);
-  if (Iter == Index->end())
+  if (Iter != Index->end()) {
+    Data = (*Iter).Data;
+    // Copy the data if it was decoded into a temporary buffer.
+    const char *Begin = reinterpret_cast<const char *>(Data.data());
+    if (Begin < DataBuffer->getBufferStart() ||
+        Begin >= DataBuffer->getBufferEnd()) {
+      uint64_t *Copy = FunctionDataAllocator.Allocate<uint64_t>(Data.size());
+      std::copy(Data.begin(), Data.end(), Copy);
+      Data = makeArrayRef(Copy, Data.size());
+    }
+  }
+  FunctionDataCache[FuncName] = Data;
+  return Data;
+}
+
+std::error_code IndexedInstrProfReader::getFunctionCounts(
+    StringRef FuncName, uint64_t FuncHash, ArrayRef<uint64_t> &Counts) {
+  ArrayRef<uint64_t> Data = getFunctionData(FuncName);
+  if (Data.empty())
     return error(instrprof_error::unknown_function);
 
   // Found it. Look for counters with the right hash.
-  ArrayRef<uint64_t> Data = (*Iter).Data;
   uint64_t NumCounts;
   for (uint64_t I = 0, E = Data.size(); I != E; I += NumCounts) {
     // The function hash comes first.
@@ -349,7 +371,7 @@ std::error_code IndexedInstrProfReader::getFunctionCounts(
     // If we have more counts than data, this is bogus.
     if (I + NumCounts > E)
       return error(instrprof_error::malformed);
-    // Check for a match and fill the vector if there is one.
+    // Check for a match and return a view of the counts if there is one.
     if (FoundHash == FuncHash) {
       Counts = Data.slice(I, NumCounts);
       return success();
@@ -358,6 +380,15 @@ std::error_code IndexedInstrProfReader::getFunctionCounts(
   return error(instrprof_error::hash_mismatch);
 }
 
+std::error_code IndexedInstrProfReader::getFunctionCounts(
+    StringRef FuncName, uint64_t FuncHash, std::vector<uint64_t> &Counts) {
+  ArrayRef<uint64_t> CountsRef;
+  if (std::error_code EC = getFunctionCounts(FuncName, FuncHash, CountsRef))
+    return EC;
+  Counts = CountsRef;
+  return success();
+}
+
 std::error_code
 IndexedInstrProfReader::readNextRecord(InstrProfRecord &Record) {
   // Are we out of records?
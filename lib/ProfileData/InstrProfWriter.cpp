@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ProfileData/InstrProfWriter.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/EndianStream.h"
 #include "llvm/Support/OnDiskHashTable.h"
@@ -37,6 +38,13 @@ public:
     return IndexedInstrProf::ComputeHash(IndexedInstrProf::HashType, K);
   }
 
+  /// The number of bytes needed after the key, which is written at Offset, for
+  /// the data to start at an aligned offset. This lets readers refer to the
+  /// data in place.
+  static offset_type getDataPadding(uint64_t Offset) {
+    return -Offset % sizeof(uint64_t);
+  }
+
   static std::pair<offset_type, offset_type>
   EmitKeyDataLength(raw_ostream &Out, key_type_ref K, data_type_ref V) {
     using namespace llvm::support;
@@ -45,7 +53,7 @@ public:
     offset_type N = K.size();
     LE.write<offset_type>(N);
 
-    offset_type M = 0;
+    offset_type M = getDataPadding(Out.tell() + sizeof(offset_type) + N);
     for (const auto &Counts : *V)
       M += (2 + Counts.second.size()) * sizeof(uint64_t);
     LE.write<offset_type>(M);
@@ -62,6 +70,8 @@ public:
     using namespace llvm::support;
     endian::Writer<little> LE(Out);
 
+    for (offset_type I = 0, E = getDataPadding(Out.tell()); I != E; ++I)
+      LE.write<uint8_t>(0);
     for (const auto &Counts : *V) {
       LE.write<uint64_t>(Counts.first);
       LE.write<uint64_t>(Counts.second.size());
@@ -75,7 +85,18 @@ public:
 std::error_code
 InstrProfWriter::addFunctionCounts(StringRef FunctionName,
                                    uint64_t FunctionHash,
-                                   ArrayRef<uint64_t> Counters) {
+                                   ArrayRef<uint64_t> Counters,
+                                   uint64_t Weight) {
+  SmallVector<uint64_t, 16> WeightedCounters;
+  if (Weight != 1) {
+    for (uint64_t Count : Counters) {
+      if (Count > UINT64_MAX / Weight)
+        return instrprof_error::counter_overflow;
+      WeightedCounters.push_back(Count * Weight);
+    }
+    Counters = WeightedCounters;
+  }
+
   auto &CounterData = FunctionData[FunctionName];
 
   auto Where = CounterData.find(FunctionHash);
@@ -107,6 +128,19 @@ InstrProfWriter::addFunctionCounts(StringRef FunctionName,
   return instrprof_error::success;
 }
 
+void InstrProfWriter::mergeRecordsFromWriter(
+    InstrProfWriter &IPW,
+    function_ref<void(StringRef FunctionName, uint64_t FunctionHash,
+                      std::error_code EC)> Warn) {
+  for (const auto &I : IPW.FunctionData)
+    for (const auto &Func : I.getValue())
+      if (std::error_code EC =
+              addFunctionCounts(I.getKey(), Func.first, Func.second))
+        Warn(I.getKey(), Func.first, EC);
+  IPW.FunctionData.clear();
+  IPW.MaxFunctionCount = 0;
+}
+
 void InstrProfWriter::write(raw_fd_ostream &OS) {
   OnDiskChainedHashTableGenerator<InstrProfRecordTrait> Generator;
 
@@ -0,0 +1,210 @@
+//===-- llvm/Support/ThreadPool.cpp - A work-stealing thread pool ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ThreadPool and TaskGroup classes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include <algorithm>
+
+using namespace llvm;
+
+#if LLVM_ENABLE_THREADS != 0
+
+ThreadPool::ThreadPool(unsigned ThreadCount)
+    : ThreadCount(ThreadCount
+                      ? ThreadCount
+                      : std::max(1U, std::thread::hardware_concurrency())),
+      WaitingHelpers(0), QueuedTasks(0), ActiveTasks(0), NextWorker(0),
+      EnableFlag(true) {
+  Workers.reserve(this->ThreadCount);
+  for (unsigned I = 0; I != this->ThreadCount; ++I) {
+    Workers.push_back(std::unique_ptr<Worker>(new Worker));
+    Workers.back()->Index = I + 1;
+  }
+  Threads.reserve(this->ThreadCount);
+  for (unsigned I = 0; I != this->ThreadCount; ++I) {
+    Worker *Self = Workers[I].get();
+    Threads.push_back(std::thread([this, Self] { work(*Self); }));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> Guard(QueueLock);
+    EnableFlag = false;
+  }
+  QueueCondition.notify_all();
+  for (std::thread &Thread : Threads)
+    Thread.join();
+}
+
+void ThreadPool::enqueue(TaskTy Task) {
+  // Tasks spawned by a worker go to its own queue; the others are spread over
+  // all the workers.
+  unsigned Self = getThreadIndex();
+  Worker &Target = *Workers[Self ? Self - 1 : NextWorker++ % ThreadCount];
+
+  // The counters go up before the task becomes visible, so that it can never
+  // be popped while QueuedTasks does not account for it.
+  {
+    std::unique_lock<std::mutex> Guard(QueueLock);
+    ++QueuedTasks;
+    ++ActiveTasks;
+  }
+  {
+    std::unique_lock<std::mutex> Guard(Target.Lock);
+    Target.Tasks.push_back(std::move(Task));
+  }
+  QueueCondition.notify_one();
+
+  // A thread waiting for a task group may run the new task, which may be the
+  // one it waits for.
+  bool Helpers;
+  {
+    std::unique_lock<std::mutex> Guard(QueueLock);
+    Helpers = WaitingHelpers != 0;
+  }
+  if (Helpers)
+    ProgressCondition.notify_all();
+}
+
+bool ThreadPool::popTask(unsigned Self, TaskTy &Task) {
+  if (QueuedTasks == 0)
+    return false;
+
+  // Take the newest task of our own queue first...
+  if (Self != 0) {
+    Worker &Own = *Workers[Self - 1];
+    std::unique_lock<std::mutex> Guard(Own.Lock);
+    if (!Own.Tasks.empty()) {
+      Task = std::move(Own.Tasks.back());
+      Own.Tasks.pop_back();
+      --QueuedTasks;
+      return true;
+    }
+  }
+
+  // ...then steal the oldest task of another worker.
+  for (unsigned I = 0; I != ThreadCount; ++I) {
+    Worker &Victim = *Workers[(Self + I) % ThreadCount];
+    if (Victim.Index == Self)
+      continue;
+    std::unique_lock<std::mutex> Guard(Victim.Lock);
+    if (!Victim.Tasks.empty()) {
+      Task = std::move(Victim.Tasks.front());
+      Victim.Tasks.pop_front();
+      --QueuedTasks;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::finishTask() {
+  bool Idle, Helpers;
+  {
+    std::unique_lock<std::mutex> Guard(QueueLock);
+    Idle = --ActiveTasks == 0;
+    Helpers = WaitingHelpers != 0;
+  }
+  if (Idle)
+    CompletionCondition.notify_all();
+  if (Helpers)
+    ProgressCondition.notify_all();
+}
+
+void ThreadPool::work(Worker &Self) {
+  CurrentWorker.set(&Self);
+  for (;;) {
+    TaskTy Task;
+    if (popTask(Self.Index, Task)) {
+      Task();
+      finishTask();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> Guard(QueueLock);
+    QueueCondition.wait(Guard,
+                        [&] { return !EnableFlag || QueuedTasks != 0; });
+    if (!EnableFlag && QueuedTasks == 0)
+      return;
+  }
+}
+
+bool ThreadPool::runPendingTask() {
+  TaskTy Task;
+  if (!popTask(getThreadIndex(), Task))
+    return false;
+  Task();
+  finishTask();
+  return true;
+}
+
+void ThreadPool::runTasksUntil(const std::function<bool()> &Done) {
+  while (!Done()) {
+    // Help with the work of the pool rather than blocking one of its workers.
+    if (runPendingTask())
+      continue;
+
+    // Everything is running on other threads. Sleep until one of them
+    // finishes a task or queues a new one this thread may run.
+    std::unique_lock<std::mutex> Guard(QueueLock);
+    ++WaitingHelpers;
+    ProgressCondition.wait(Guard, [&] { return Done() || QueuedTasks != 0; });
+    --WaitingHelpers;
+  }
+}
+
+void ThreadPool::wait() {
+  assert(getThreadIndex() == 0 && "ThreadPool::wait() called from a worker");
+  std::unique_lock<std::mutex> Guard(QueueLock);
+  CompletionCondition.wait(Guard, [&] { return ActiveTasks == 0; });
+}
+
+unsigned ThreadPool::getThreadIndex() {
+  const Worker *Current = CurrentWorker.get();
+  return Current ? Current->Index : 0;
+}
+
+#else // LLVM_ENABLE_THREADS == 0
+
+// Without thread support, tasks run as soon as they are submitted.
+ThreadPool::ThreadPool(unsigned ThreadCount) : ThreadCount(1) {}
+
+ThreadPool::~ThreadPool() {}
+
+void ThreadPool::enqueue(TaskTy Task) { Task(); }
+
+bool ThreadPool::runPendingTask() { return false; }
+
+void ThreadPool::runTasksUntil(const std::function<bool()> &Done) {
+  assert(Done() && "Tasks run when they are submitted");
+}
+
+void ThreadPool::wait() {}
+
+unsigned ThreadPool::getThreadIndex() { return 0; }
+
+#endif
+
+void TaskGroup::spawn(std::function<void()> F) {
+  ++PendingTasks;
+  Pool.async([this, F] {
+    F();
+    --PendingTasks;
+  });
+}
+
+void TaskGroup::sync() {
+  // The last task of the group finishes before the pool counts it as done
+  // and wakes up the threads blocked in runTasksUntil.
+  Pool.runTasksUntil([this] { return PendingTasks == 0; });
+}
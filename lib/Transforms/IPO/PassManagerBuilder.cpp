@@ -168,11 +168,22 @@ void PassManagerBuilder::populateModulePassManager(PassManagerBase &MPM) {
     return;
   }
 
+  populateAnalysisPasses(MPM);
+  populateModuleSimplificationPasses(MPM);
+  populateCGSCCPasses(MPM);
+  populateFunctionSimplificationPasses(MPM);
+  populateModuleOptimizationPasses(MPM);
+}
+
+void PassManagerBuilder::populateAnalysisPasses(PassManagerBase &PM) {
   // Add LibraryInfo if we have some.
-  if (LibraryInfo) MPM.add(new TargetLibraryInfo(*LibraryInfo));
+  if (LibraryInfo) PM.add(new TargetLibraryInfo(*LibraryInfo));
 
-  addInitialAliasAnalysisPasses(MPM);
+  addInitialAliasAnalysisPasses(PM);
+}
 
+void PassManagerBuilder::populateModuleSimplificationPasses(
+    PassManagerBase &MPM) {
   if (!DisableUnitAtATime) {
     addExtensionsToPM(EP_ModuleOptimizerEarly, MPM);
 
@@ -185,7 +196,9 @@ void PassManagerBuilder::populateModulePassManager(PassManagerBase &MPM) {
     addExtensionsToPM(EP_Peephole, MPM);
     MPM.add(createCFGSimplificationPass());   // Clean up after IPCP & DAE
   }
+}
 
+void PassManagerBuilder::populateCGSCCPasses(PassManagerBase &MPM) {
   // Start of CallGraph SCC passes.
   if (!DisableUnitAtATime)
     MPM.add(createPruneEHPass());             // Remove dead EH info
@@ -197,7 +210,10 @@ void PassManagerBuilder::populateModulePassManager(PassManagerBase &MPM) {
     MPM.add(createFunctionAttrsPass());       // Set readonly/readnone attrs
   if (OptLevel > 2)
     MPM.add(createArgumentPromotionPass());   // Scalarize uninlined fn args
+}
 
+void PassManagerBuilder::populateFunctionSimplificationPasses(
+    PassManagerBase &MPM) {
   // Start of function pass.
   // Break up aggregate allocas, using SSAUpdater.
   if (UseNewSROA)
@@ -272,7 +288,10 @@ void PassManagerBuilder::populateModulePassManager(PassManagerBase &MPM) {
   MPM.add(createCFGSimplificationPass()); // Merge & remove BBs
   MPM.add(createInstructionCombiningPass());  // Clean up after everything.
   addExtensionsToPM(EP_Peephole, MPM);
+}
 
+void PassManagerBuilder::populateModuleOptimizationPasses(
+    PassManagerBase &MPM) {
   // FIXME: This is a HACK! The inliner pass above implicitly creates a CGSCC
   // pass manager that we are specifically trying to avoid. To prevent this
   // we must insert a no-op module pass to reset the pass manager.
@@ -23,6 +23,7 @@
 #include "llvm/Analysis/CaptureTracking.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/MemoryDependenceAnalysis.h"
+#include "llvm/Analysis/MemorySSA.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
@@ -32,6 +33,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Transforms/Utils/Local.h"
@@ -42,15 +44,23 @@ using namespace llvm;
 STATISTIC(NumFastStores, "Number of stores deleted");
 STATISTIC(NumFastOther , "Number of other instrs removed");
 
+static cl::opt<bool>
+UseMemorySSA("dse-use-memoryssa", cl::init(false), cl::Hidden,
+             cl::desc("Answer the local dependence queries of DSE with "
+                      "MemorySSA instead of MemoryDependenceAnalysis"));
+
 namespace {
   struct DSE : public FunctionPass {
     AliasAnalysis *AA;
     MemoryDependenceAnalysis *MD;
+    MemorySSA *MSSA;
     DominatorTree *DT;
     const TargetLibraryInfo *TLI;
 
     static char ID; // Pass identification, replacement for typeid
-    DSE() : FunctionPass(ID), AA(nullptr), MD(nullptr), DT(nullptr) {
+    DSE()
+        : FunctionPass(ID), AA(nullptr), MD(nullptr), MSSA(nullptr),
+          DT(nullptr) {
       initializeDSEPass(*PassRegistry::getPassRegistry());
     }
 
@@ -60,8 +70,10 @@ namespace {
 
       AA = &getAnalysis<AliasAnalysis>();
       MD = &getAnalysis<MemoryDependenceAnalysis>();
+      MSSA = UseMemorySSA ? &getAnalysis<MemorySSA>() : nullptr;
       DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
       TLI = AA->getTargetLibraryInfo();
+      AA->beginQueryCaching();
 
       bool Changed = false;
       for (Function::iterator I = F.begin(), E = F.end(); I != E; ++I)
@@ -70,12 +82,15 @@ namespace {
         if (DT->isReachableFromEntry(I))
           Changed |= runOnBasicBlock(*I);
 
-      AA = nullptr; MD = nullptr; DT = nullptr;
+      AA->endQueryCaching();
+      AA = nullptr; MD = nullptr; MSSA = nullptr; DT = nullptr;
       return Changed;
     }
 
     bool runOnBasicBlock(BasicBlock &BB);
     bool HandleFree(CallInst *F);
+    MemDepResult getMSSADependency(const AliasAnalysis::Location &Loc,
+                                   Instruction *From);
     bool handleEndBlock(BasicBlock &BB);
     void RemoveAccessedObjects(const AliasAnalysis::Location &LoadedLoc,
                                SmallSetVector<Value*, 16> &DeadStackObjects);
@@ -88,6 +103,10 @@ namespace {
       AU.addPreserved<AliasAnalysis>();
       AU.addPreserved<DominatorTreeWrapperPass>();
       AU.addPreserved<MemoryDependenceAnalysis>();
+      if (UseMemorySSA) {
+        AU.addRequired<MemorySSA>();
+        AU.addPreserved<MemorySSA>();
+      }
     }
   };
 }
@@ -96,6 +115,7 @@ char DSE::ID = 0;
 INITIALIZE_PASS_BEGIN(DSE, "dse", "Dead Store Elimination", false, false)
 INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(MemoryDependenceAnalysis)
+INITIALIZE_PASS_DEPENDENCY(MemorySSA)
 INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
 INITIALIZE_PASS_END(DSE, "dse", "Dead Store Elimination", false, false)
 
@@ -109,10 +129,12 @@ FunctionPass *llvm::createDeadStoreEliminationPass() { return new DSE(); }
 /// and zero out all the operands of this instruction.  If any of them become
 /// dead, delete them and the computation tree that feeds them.
 ///
-/// If ValueSet is non-null, remove any deleted instructions from it as well.
+/// If MSSA is non-null, the deleted instructions are removed from it too.  If
+/// ValueSet is non-null, remove any deleted instructions from it as well.
 ///
 static void DeleteDeadInstruction(Instruction *I,
                                MemoryDependenceAnalysis &MD,
+                               MemorySSA *MSSA,
                                const TargetLibraryInfo *TLI,
                                SmallSetVector<Value*, 16> *ValueSet = nullptr) {
   SmallVector<Instruction*, 32> NowDeadInsts;
@@ -129,6 +151,9 @@ static void DeleteDeadInstruction(Instruction *I,
     // MemDep, which needs to know the operands and needs it to be in the
     // function.
     MD.removeInstruction(DeadInst);
+    if (MSSA)
+      if (MemoryUseOrDef *MA = MSSA->getMemoryAccess(DeadInst))
+        MSSA->removeMemoryAccess(MA);
 
     for (unsigned op = 0, e = DeadInst->getNumOperands(); op != e; ++op) {
       Value *Op = DeadInst->getOperand(op);
@@ -507,7 +532,9 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
     if (!hasMemoryWrite(Inst, TLI))
       continue;
 
-    MemDepResult InstDep = MD->getDependency(Inst);
+    MemDepResult InstDep = MSSA ? getMSSADependency(getLocForWrite(Inst, *AA),
+                                                    Inst)
+                                : MD->getDependency(Inst);
 
     // Ignore any store where we can't find a local dependence.
     // FIXME: cross-block DSE would be fun. :)
@@ -527,7 +554,7 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
           // in case we need it.
           WeakVH NextInst(BBI);
 
-          DeleteDeadInstruction(SI, *MD, TLI);
+          DeleteDeadInstruction(SI, *MD, MSSA, TLI);
 
           if (!NextInst)  // Next instruction deleted.
             BBI = BB.begin();
@@ -574,7 +601,7 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
                 << *DepWrite << "\n  KILLER: " << *Inst << '\n');
 
           // Delete the store and now-dead instructions that feed it.
-          DeleteDeadInstruction(DepWrite, *MD, TLI);
+          DeleteDeadInstruction(DepWrite, *MD, MSSA, TLI);
           ++NumFastStores;
           MadeChange = true;
 
@@ -626,7 +653,8 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
       if (AA->getModRefInfo(DepWrite, Loc) & AliasAnalysis::Ref)
         break;
 
-      InstDep = MD->getPointerDependencyFrom(Loc, false, DepWrite, &BB);
+      InstDep = MSSA ? getMSSADependency(Loc, DepWrite)
+                     : MD->getPointerDependencyFrom(Loc, false, DepWrite, &BB);
     }
   }
 
@@ -638,6 +666,36 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
   return MadeChange;
 }
 
+/// getMSSADependency - Find the closest instruction above From in its block
+/// which may read or write Loc, the way MemDep's local queries do, but by
+/// walking the MemoryDefs above From and the MemoryUses hanging off them.
+MemDepResult DSE::getMSSADependency(const AliasAnalysis::Location &Loc,
+                                    Instruction *From) {
+  MemoryUseOrDef *MA = MSSA->getMemoryAccess(From);
+  if (!Loc.Ptr || !MA)
+    return MemDepResult::getUnknown();
+
+  BasicBlock *BB = From->getParent();
+  MemoryAccess *Cur = MA->getDefiningAccess();
+  while (1) {
+    // The uses of Cur in this block all lie between Cur, or the start of the
+    // block, and the write below them, so they are closer to From than Cur.
+    for (MemoryAccess *User : Cur->users())
+      if (MemoryUse *MU = dyn_cast<MemoryUse>(User))
+        if (MU->getBlock() == BB &&
+            (AA->getModRefInfo(MU->getMemoryInst(), Loc) & AliasAnalysis::Ref))
+          return MemDepResult::getClobber(MU->getMemoryInst());
+
+    MemoryDef *Def = dyn_cast<MemoryDef>(Cur);
+    if (!Def || MSSA->isLiveOnEntryDef(Def) || Def->getBlock() != BB)
+      return MemDepResult::getNonLocal();
+    Instruction *DefInst = Def->getMemoryInst();
+    if (AA->getModRefInfo(DefInst, Loc) != AliasAnalysis::NoModRef)
+      return MemDepResult::getClobber(DefInst);
+    Cur = Def->getDefiningAccess();
+  }
+}
+
 /// Find all blocks that will unconditionally lead to the block BB and append
 /// them to F.
 static void FindUnconditionalPreds(SmallVectorImpl<BasicBlock *> &Blocks,
@@ -684,7 +742,7 @@ bool DSE::HandleFree(CallInst *F) {
       Instruction *Next = std::next(BasicBlock::iterator(Dependency));
 
       // DCE instructions only used to calculate that store
-      DeleteDeadInstruction(Dependency, *MD, TLI);
+      DeleteDeadInstruction(Dependency, *MD, MSSA, TLI);
       ++NumFastStores;
       MadeChange = true;
 
@@ -768,7 +826,7 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
               dbgs() << '\n');
 
         // DCE instructions only used to calculate that store.
-        DeleteDeadInstruction(Dead, *MD, TLI, &DeadStackObjects);
+        DeleteDeadInstruction(Dead, *MD, MSSA, TLI, &DeadStackObjects);
         ++NumFastStores;
         MadeChange = true;
         continue;
@@ -778,7 +836,7 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
     // Remove any dead non-memory-mutating instructions.
     if (isInstructionTriviallyDead(BBI, TLI)) {
       Instruction *Inst = BBI++;
-      DeleteDeadInstruction(Inst, *MD, TLI, &DeadStackObjects);
+      DeleteDeadInstruction(Inst, *MD, MSSA, TLI, &DeadStackObjects);
       ++NumFastOther;
       MadeChange = true;
       continue;
@@ -31,6 +31,7 @@
 #include "llvm/Analysis/Loads.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/MemoryDependenceAnalysis.h"
+#include "llvm/Analysis/MemorySSA.h"
 #include "llvm/Analysis/PHITransAddr.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/DataLayout.h"
@@ -65,6 +66,10 @@ STATISTIC(NumPRELoad,   "Number of loads PRE'd");
 static cl::opt<bool> EnablePRE("enable-pre",
                                cl::init(true), cl::Hidden);
 static cl::opt<bool> EnableLoadPRE("enable-load-pre", cl::init(true));
+static cl::opt<bool>
+UseMemorySSA("gvn-use-memoryssa", cl::init(false), cl::Hidden,
+             cl::desc("Look for the clobbers of loads with MemorySSA before "
+                      "asking MemoryDependenceAnalysis"));
 
 // Maximum allowed recursion depth.
 static cl::opt<uint32_t>
@@ -589,6 +594,7 @@ namespace {
   class GVN : public FunctionPass {
     bool NoLoads;
     MemoryDependenceAnalysis *MD;
+    MemorySSA *MSSA;
     DominatorTree *DT;
     const DataLayout *DL;
     const TargetLibraryInfo *TLI;
@@ -609,6 +615,10 @@ namespace {
 
     SmallVector<Instruction*, 8> InstrsToErase;
 
+    /// MSSALoads - The loads seen in this iteration, keyed by the access
+    /// MemorySSA found clobbering them and by their pointer.
+    DenseMap<std::pair<MemoryAccess *, Value *>, WeakVH> MSSALoads;
+
     typedef SmallVector<NonLocalDepResult, 64> LoadDepVect;
     typedef SmallVector<AvailableValueInBlock, 64> AvailValInBlkVect;
     typedef SmallVector<BasicBlock*, 64> UnavailBlkVect;
@@ -616,7 +626,7 @@ namespace {
   public:
     static char ID; // Pass identification, replacement for typeid
     explicit GVN(bool noloads = false)
-        : FunctionPass(ID), NoLoads(noloads), MD(nullptr) {
+        : FunctionPass(ID), NoLoads(noloads), MD(nullptr), MSSA(nullptr) {
       initializeGVNPass(*PassRegistry::getPassRegistry());
     }
 
@@ -687,6 +697,8 @@ namespace {
       AU.addRequired<TargetLibraryInfo>();
       if (!NoLoads)
         AU.addRequired<MemoryDependenceAnalysis>();
+      if (!NoLoads && UseMemorySSA)
+        AU.addRequired<MemorySSA>();
       AU.addRequired<AliasAnalysis>();
 
       AU.addPreserved<DominatorTreeWrapperPass>();
@@ -696,6 +708,7 @@ namespace {
 
     // Helper fuctions of redundant load elimination 
     bool processLoad(LoadInst *L);
+    bool processLoadWithMemorySSA(LoadInst *L);
     bool processNonLocalLoad(LoadInst *L);
     void AnalyzeLoadAvailability(LoadInst *LI, LoadDepVect &Deps, 
                                  AvailValInBlkVect &ValuesPerBlock,
@@ -711,6 +724,7 @@ namespace {
     bool performPRE(Function &F);
     Value *findLeader(const BasicBlock *BB, uint32_t num);
     void cleanupGlobalSets();
+    void removeFromMemorySSA(Instruction *I);
     void verifyRemoved(const Instruction *I) const;
     bool splitCriticalEdges();
     BasicBlock *splitCriticalEdges(BasicBlock *Pred, BasicBlock *Succ);
@@ -733,6 +747,7 @@ FunctionPass *llvm::createGVNPass(bool NoLoads) {
 INITIALIZE_PASS_BEGIN(GVN, "gvn", "Global Value Numbering", false, false)
 INITIALIZE_PASS_DEPENDENCY(AssumptionTracker)
 INITIALIZE_PASS_DEPENDENCY(MemoryDependenceAnalysis)
+INITIALIZE_PASS_DEPENDENCY(MemorySSA)
 INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfo)
 INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
@@ -1642,6 +1657,7 @@ bool GVN::PerformLoadPRE(LoadInst *LI, AvailValInBlkVect &ValuesPerBlock,
     while (!NewInsts.empty()) {
       Instruction *I = NewInsts.pop_back_val();
       if (MD) MD->removeInstruction(I);
+      removeFromMemorySSA(I);
       I->eraseFromParent();
     }
     // HINT: Don't revert the edge-splitting as following transformation may
@@ -1821,6 +1837,9 @@ bool GVN::processLoad(LoadInst *L) {
     return true;
   }
 
+  if (MSSA && processLoadWithMemorySSA(L))
+    return true;
+
   // ... to a pointer that has been loaded from before...
   MemDepResult Dep = MD->getDependency(L);
 
@@ -2006,6 +2025,62 @@ bool GVN::processLoad(LoadInst *L) {
   return false;
 }
 
+/// processLoadWithMemorySSA - Attempt to eliminate a load using the access
+/// MemorySSA finds clobbering it: a store to a must-aliased pointer, whose
+/// value is forwarded, or the memory an earlier load of the same pointer saw.
+bool GVN::processLoadWithMemorySSA(LoadInst *L) {
+  MemoryAccess *Clobber = MSSA->getWalker()->getClobberingMemoryAccess(L);
+  if (!Clobber)
+    return false;
+
+  MemoryDef *Def = dyn_cast<MemoryDef>(Clobber);
+  StoreInst *DepSI = Def ? dyn_cast_or_null<StoreInst>(Def->getMemoryInst())
+                         : nullptr;
+  AliasAnalysis *AA = VN.getAliasAnalysis();
+  if (DepSI && AA->alias(AA->getLocation(DepSI), AA->getLocation(L)) ==
+                   AliasAnalysis::MustAlias) {
+    Value *StoredVal = DepSI->getValueOperand();
+    if (StoredVal->getType() != L->getType()) {
+      if (!DL)
+        return false;
+      StoredVal = CoerceAvailableValueToLoadType(StoredVal, L->getType(), L,
+                                                 *DL);
+      if (!StoredVal)
+        return false;
+    }
+
+    DEBUG(dbgs() << "GVN MEMORYSSA FORWARDED STORE:\n" << *DepSI << '\n'
+                 << *L << "\n\n\n");
+    L->replaceAllUsesWith(StoredVal);
+    if (StoredVal->getType()->getScalarType()->isPointerTy())
+      MD->invalidateCachedPointerInfo(StoredVal);
+    markInstructionForDeletion(L);
+    ++NumGVNLoad;
+    return true;
+  }
+
+  // Loads of the same pointer clobbered by the same access see the same
+  // memory, so an earlier one dominating L has its value.
+  WeakVH &Earlier = MSSALoads[std::make_pair(Clobber, L->getPointerOperand())];
+  Value *AvailVal = Earlier;
+  Instruction *AvailInst = dyn_cast_or_null<Instruction>(AvailVal);
+  if (!AvailVal || AvailVal->getType() != L->getType() ||
+      (AvailInst && !DT->dominates(AvailInst, L))) {
+    if (!AvailVal)
+      Earlier = L;
+    return false;
+  }
+
+  DEBUG(dbgs() << "GVN MEMORYSSA REMOVED LOAD:\n" << *AvailVal << '\n' << *L
+               << "\n\n\n");
+  patchAndReplaceAllUsesWith(L, AvailVal);
+  if (AvailVal->getType()->getScalarType()->isPointerTy())
+    MD->invalidateCachedPointerInfo(AvailVal);
+  markInstructionForDeletion(L);
+  ++NumGVNLoad;
+  return true;
+}
+
 // findLeader - In order to find a leader for a given value number at a
 // specific basic block, we first obtain the list of all Values for that number,
 // and then scan the list to find one whose block dominates the block in
@@ -2331,12 +2406,18 @@ bool GVN::runOnFunction(Function& F) {
 
   if (!NoLoads)
     MD = &getAnalysis<MemoryDependenceAnalysis>();
+  // MemorySSA only answers clobber queries here. The block merging and edge
+  // splitting below leave the blocks of its accesses stale, so it is not
+  // preserved.
+  MSSA = !NoLoads && UseMemorySSA ? &getAnalysis<MemorySSA>() : nullptr;
   DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
   DataLayoutPass *DLP = getAnalysisIfAvailable<DataLayoutPass>();
   DL = DLP ? &DLP->getDataLayout() : nullptr;
   AT = &getAnalysis<AssumptionTracker>();
   TLI = &getAnalysis<TargetLibraryInfo>();
-  VN.setAliasAnalysis(&getAnalysis<AliasAnalysis>());
+  AliasAnalysis *AA = &getAnalysis<AliasAnalysis>();
+  AA->beginQueryCaching();
+  VN.setAliasAnalysis(AA);
   VN.setMemDep(MD);
   VN.setDomTree(DT);
 
@@ -2383,6 +2464,7 @@ bool GVN::runOnFunction(Function& F) {
   // iteration. 
   DeadBlocks.clear();
 
+  AA->endQueryCaching();
   return Changed;
 }
 
@@ -2417,6 +2499,7 @@ bool GVN::processBlock(BasicBlock *BB) {
          E = InstrsToErase.end(); I != E; ++I) {
       DEBUG(dbgs() << "GVN removed: " << **I << '\n');
       if (MD) MD->removeInstruction(*I);
+      removeFromMemorySSA(*I);
       DEBUG(verifyRemoved(*I));
       (*I)->eraseFromParent();
     }
@@ -2597,6 +2680,7 @@ bool GVN::performPRE(Function &F) {
 
       DEBUG(dbgs() << "GVN PRE removed: " << *CurInst << '\n');
       if (MD) MD->removeInstruction(CurInst);
+      removeFromMemorySSA(CurInst);
       DEBUG(verifyRemoved(CurInst));
       CurInst->eraseFromParent();
       Changed = true;
@@ -2664,6 +2748,22 @@ void GVN::cleanupGlobalSets() {
   VN.clear();
   LeaderTable.clear();
   TableAllocator.Reset();
+  MSSALoads.clear();
+}
+
+/// removeFromMemorySSA - Remove the access of an instruction about to be
+/// erased from MemorySSA, if it is in use.
+void GVN::removeFromMemorySSA(Instruction *I) {
+  if (!MSSA)
+    return;
+  MemoryUseOrDef *MA = MSSA->getMemoryAccess(I);
+  if (!MA)
+    return;
+  // The loads remembered under a removed definition must not be matched
+  // against a new access allocated at the same address.
+  if (isa<MemoryDef>(MA))
+    MSSALoads.clear();
+  MSSA->removeMemoryAccess(MA);
 }
 
 /// verifyRemoved - Verify that the specified instruction does not occur in our
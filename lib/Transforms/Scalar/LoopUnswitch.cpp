@@ -205,7 +205,7 @@ namespace {
     void EmitPreheaderBranchOnCondition(Value *LIC, Constant *Val,
                                         BasicBlock *TrueDest,
                                         BasicBlock *FalseDest,
-                                        Instruction *InsertPt);
+                                        BranchInst *OldBranch);
 
     void SimplifyCode(std::vector<Instruction*> &Worklist, Loop *L);
     bool IsTrivialUnswitchCondition(Value *Cond, Constant **Val = nullptr,
@@ -392,7 +392,6 @@ bool LoopUnswitch::runOnLoop(Loop *L, LPPassManager &LPM_Ref) {
       getAnalysisIfAvailable<DominatorTreeWrapperPass>();
   DT = DTWP ? &DTWP->getDomTree() : nullptr;
   currentLoop = L;
-  Function *F = currentLoop->getHeader()->getParent();
   bool Changed = false;
   do {
     assert(currentLoop->isLCSSAForm(*DT));
@@ -400,11 +399,6 @@ bool LoopUnswitch::runOnLoop(Loop *L, LPPassManager &LPM_Ref) {
     Changed |= processCurrentLoop();
   } while(redoLoop);
 
-  if (Changed) {
-    // FIXME: Reconstruct dom info, because it is not preserved properly.
-    if (DT)
-      DT->recalculate(*F);
-  }
   return Changed;
 }
 
@@ -684,12 +678,14 @@ static Loop *CloneLoop(Loop *L, Loop *PL, ValueToValueMapTy &VM,
 }
 
 /// EmitPreheaderBranchOnCondition - Emit a conditional branch on two values
-/// if LIC == Val, branch to TrueDst, otherwise branch to FalseDest.  Insert the
-/// code immediately before InsertPt.
+/// if LIC == Val, branch to TrueDst, otherwise branch to FalseDest.  The branch
+/// replaces OldBranch, an unconditional branch to one of the destinations.
 void LoopUnswitch::EmitPreheaderBranchOnCondition(Value *LIC, Constant *Val,
                                                   BasicBlock *TrueDest,
                                                   BasicBlock *FalseDest,
-                                                  Instruction *InsertPt) {
+                                                  BranchInst *OldBranch) {
+  assert(OldBranch->isUnconditional() && "Preheader is not split correctly");
+  Instruction *InsertPt = OldBranch;
   // Insert a conditional branch on LIC to the two preheaders.  The original
   // code is the true version and the new code is the false version.
   Value *BranchVal = LIC;
@@ -704,9 +700,31 @@ void LoopUnswitch::EmitPreheaderBranchOnCondition(Value *LIC, Constant *Val,
   BranchInst *BI = BranchInst::Create(TrueDest, FalseDest, BranchVal, InsertPt);
 
   // If either edge is critical, split it. This helps preserve LoopSimplify
-  // form for enclosing loops.
-  SplitCriticalEdge(BI, 0, this, false, false, true);
-  SplitCriticalEdge(BI, 1, this, false, false, true);
+  // form for enclosing loops. The edge to the successor of the old branch is
+  // split while the old branch is still there, as its destination only has
+  // that predecessor once the old branch is gone.
+  BasicBlock *BB = BI->getParent();
+  BasicBlock *OldSucc = OldBranch->getSuccessor(0);
+  unsigned OldSuccNum = OldSucc == TrueDest ? 0 : 1;
+  BasicBlock *SplitBB =
+      SplitCriticalEdge(BI, OldSuccNum, this, false, false, true);
+
+  // Remove the old branch, and tell the dominator tree about the edges which
+  // changed. The new edge leads to a block of the cloned loop when unswitching
+  // a non-trivial condition, and the whole cloned loop joins the tree.
+  LPM->deleteSimpleAnalysisValue(OldBranch, currentLoop);
+  OldBranch->eraseFromParent();
+  if (DT) {
+    SmallVector<DominatorTree::UpdateType, 2> Updates;
+    if (SplitBB)
+      Updates.push_back(
+          DominatorTree::UpdateType(DominatorTree::Delete, BB, OldSucc));
+    Updates.push_back(DominatorTree::UpdateType(
+        DominatorTree::Insert, BB, BI->getSuccessor(1 - OldSuccNum)));
+    DT->applyUpdates(Updates);
+  }
+
+  SplitCriticalEdge(BI, 1 - OldSuccNum, this, false, false, true);
 }
 
 /// UnswitchTrivialCondition - Given a loop that has a trivial unswitchable
@@ -741,9 +759,7 @@ void LoopUnswitch::UnswitchTrivialCondition(Loop *L, Value *Cond,
   // Okay, now we have a position to branch from and a position to branch to,
   // insert the new conditional branch.
   EmitPreheaderBranchOnCondition(Cond, Val, NewExit, NewPH,
-                                 loopPreheader->getTerminator());
-  LPM->deleteSimpleAnalysisValue(loopPreheader->getTerminator(), L);
-  loopPreheader->getTerminator()->eraseFromParent();
+                       cast<BranchInst>(loopPreheader->getTerminator()));
 
   // We need to reprocess this loop, it could be unswitched again.
   redoLoop = true;
@@ -899,8 +915,6 @@ void LoopUnswitch::UnswitchNontrivialCondition(Value *LIC, Constant *Val,
 
   // Emit the new branch that selects between the two versions of this loop.
   EmitPreheaderBranchOnCondition(LIC, Val, NewBlocks[0], LoopBlocks[0], OldBR);
-  LPM->deleteSimpleAnalysisValue(OldBR, L);
-  OldBR->eraseFromParent();
 
   LoopProcessWorklist.push_back(NewLoop);
   redoLoop = true;
@@ -1063,10 +1077,8 @@ void LoopUnswitch::RewriteLoopBodyWithConditionConstant(Loop *L, Value *LIC,
          PHINode *PN = dyn_cast<PHINode>(II); ++II)
       PN->setIncomingValue(PN->getBasicBlockIndex(Switch),
                            UndefValue::get(PN->getType()));
-    // Tell the domtree about the new block. We don't fully update the
-    // domtree here -- instead we force it to do a full recomputation
-    // after the pass is complete -- but we do need to inform it of
-    // new blocks.
+    // Tell the domtree about the new block. The edge to OldSISucc is kept,
+    // so it is the only change.
     if (DT)
       DT->addNewBlock(Abort, NewSISucc);
   }
@@ -1141,6 +1153,16 @@ void LoopUnswitch::SimplifyCode(std::vector<Instruction*> &Worklist, Loop *L) {
         BI->eraseFromParent();
         RemoveFromWorklist(BI, Worklist);
 
+        // Pred, the immediate dominator of Succ, now dominates its children.
+        if (DT)
+          if (DomTreeNode *SuccNode = DT->getNode(Succ)) {
+            DomTreeNode *PredNode = DT->getNode(Pred);
+            while (!SuccNode->getChildren().empty())
+              DT->changeImmediateDominator(SuccNode->getChildren().back(),
+                                           PredNode);
+            DT->eraseNode(Succ);
+          }
+
         // Remove Succ from the loop tree.
         LI->removeBlock(Succ);
         LPM->deleteSimpleAnalysisValue(Succ, L);
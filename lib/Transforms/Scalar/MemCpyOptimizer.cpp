@@ -18,6 +18,7 @@
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AssumptionTracker.h"
 #include "llvm/Analysis/MemoryDependenceAnalysis.h"
+#include "llvm/Analysis/MemorySSA.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Dominators.h"
@@ -26,6 +27,7 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetLibraryInfo.h"
@@ -40,6 +42,11 @@ STATISTIC(NumMemSetInfer, "Number of memsets inferred");
 STATISTIC(NumMoveToCpy,   "Number of memmoves converted to memcpy");
 STATISTIC(NumCpyToSet,    "Number of memcpys converted to memset");
 
+static cl::opt<bool>
+UseMemorySSA("memcpyopt-use-memoryssa", cl::init(false), cl::Hidden,
+             cl::desc("Find the memcpy feeding a memcpy with MemorySSA, and "
+                      "keep MemorySSA up to date"));
+
 static int64_t GetOffsetFromIndex(const GEPOperator *GEP, unsigned Idx,
                                   bool &VariableIdxFound, const DataLayout &TD){
   // Skip over the first indices.
@@ -313,6 +320,7 @@ void MemsetRanges::addRange(int64_t Start, int64_t Size, Value *Ptr,
 namespace {
   class MemCpyOpt : public FunctionPass {
     MemoryDependenceAnalysis *MD;
+    MemorySSA *MSSA;
     TargetLibraryInfo *TLI;
     const DataLayout *DL;
   public:
@@ -320,6 +328,7 @@ namespace {
     MemCpyOpt() : FunctionPass(ID) {
       initializeMemCpyOptPass(*PassRegistry::getPassRegistry());
       MD = nullptr;
+      MSSA = nullptr;
       TLI = nullptr;
       DL = nullptr;
     }
@@ -337,6 +346,10 @@ namespace {
       AU.addRequired<TargetLibraryInfo>();
       AU.addPreserved<AliasAnalysis>();
       AU.addPreserved<MemoryDependenceAnalysis>();
+      if (UseMemorySSA) {
+        AU.addRequired<MemorySSA>();
+        AU.addPreserved<MemorySSA>();
+      }
     }
 
     // Helper fuctions
@@ -351,6 +364,8 @@ namespace {
     bool processByValArgument(CallSite CS, unsigned ArgNo);
     Instruction *tryMergingIntoMemset(Instruction *I, Value *StartPtr,
                                       Value *ByteVal);
+    bool isSourceUnchangedSince(MemCpyInst *MDep, Instruction *I);
+    void eraseInstruction(Instruction *I);
 
     bool iterateOnFunction(Function &F);
   };
@@ -366,6 +381,7 @@ INITIALIZE_PASS_BEGIN(MemCpyOpt, "memcpyopt", "MemCpy Optimization",
 INITIALIZE_PASS_DEPENDENCY(AssumptionTracker)
 INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(MemoryDependenceAnalysis)
+INITIALIZE_PASS_DEPENDENCY(MemorySSA)
 INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfo)
 INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
 INITIALIZE_PASS_END(MemCpyOpt, "memcpyopt", "MemCpy Optimization",
@@ -478,13 +494,16 @@ Instruction *MemCpyOpt::tryMergingIntoMemset(Instruction *StartInst,
     if (!Range.TheStores.empty())
       AMemSet->setDebugLoc(Range.TheStores[0]->getDebugLoc());
 
+    // Nothing between the stores reads memory, so the memset can take the
+    // place of any of them in MemorySSA.
+    if (MSSA)
+      MSSA->replaceMemoryInstruction(Range.TheStores[0], AMemSet);
+
     // Zap all the stores.
     for (SmallVectorImpl<Instruction *>::const_iterator
          SI = Range.TheStores.begin(),
-         SE = Range.TheStores.end(); SI != SE; ++SI) {
-      MD->removeInstruction(*SI);
-      (*SI)->eraseFromParent();
-    }
+         SE = Range.TheStores.end(); SI != SE; ++SI)
+      eraseInstruction(*SI);
     ++NumMemSetInfer;
   }
 
@@ -536,10 +555,8 @@ bool MemCpyOpt::processStore(StoreInst *SI, BasicBlock::iterator &BBI) {
                         DL->getTypeStoreSize(SI->getOperand(0)->getType()),
                         std::min(storeAlign, loadAlign), C);
         if (changed) {
-          MD->removeInstruction(SI);
-          SI->eraseFromParent();
-          MD->removeInstruction(LI);
-          LI->eraseFromParent();
+          eraseInstruction(SI);
+          eraseInstruction(LI);
           ++NumMemCpyInstr;
           return true;
         }
@@ -795,10 +812,7 @@ bool MemCpyOpt::processMemCpyMemCpyDependence(MemCpyInst *M, MemCpyInst *MDep,
   //
   // NOTE: This is conservative, it will stop on any read from the source loc,
   // not just the defining memcpy.
-  MemDepResult SourceDep =
-    MD->getPointerDependencyFrom(AA.getLocationForSource(MDep),
-                                 false, M, M->getParent());
-  if (!SourceDep.isClobber() || SourceDep.getInst() != MDep)
+  if (!isSourceUnchangedSince(MDep, M))
     return false;
 
   // If the dest of the second might alias the source of the first, then the
@@ -818,16 +832,18 @@ bool MemCpyOpt::processMemCpyMemCpyDependence(MemCpyInst *M, MemCpyInst *MDep,
   unsigned Align = std::min(MDep->getAlignment(), M->getAlignment());
 
   IRBuilder<> Builder(M);
+  Instruction *NewM;
   if (UseMemMove)
-    Builder.CreateMemMove(M->getRawDest(), MDep->getRawSource(), M->getLength(),
-                          Align, M->isVolatile());
+    NewM = Builder.CreateMemMove(M->getRawDest(), MDep->getRawSource(),
+                                 M->getLength(), Align, M->isVolatile());
   else
-    Builder.CreateMemCpy(M->getRawDest(), MDep->getRawSource(), M->getLength(),
-                         Align, M->isVolatile());
+    NewM = Builder.CreateMemCpy(M->getRawDest(), MDep->getRawSource(),
+                                M->getLength(), Align, M->isVolatile());
+  if (MSSA)
+    MSSA->replaceMemoryInstruction(M, NewM);
 
   // Remove the instruction we're replacing.
-  MD->removeInstruction(M);
-  M->eraseFromParent();
+  eraseInstruction(M);
   ++NumMemCpyInstr;
   return true;
 }
@@ -844,8 +860,7 @@ bool MemCpyOpt::processMemCpy(MemCpyInst *M) {
 
   // If the source and destination of the memcpy are the same, then zap it.
   if (M->getSource() == M->getDest()) {
-    MD->removeInstruction(M);
-    M->eraseFromParent();
+    eraseInstruction(M);
     return false;
   }
 
@@ -854,10 +869,12 @@ bool MemCpyOpt::processMemCpy(MemCpyInst *M) {
     if (GV->isConstant() && GV->hasDefinitiveInitializer())
       if (Value *ByteVal = isBytewiseValue(GV->getInitializer())) {
         IRBuilder<> Builder(M);
-        Builder.CreateMemSet(M->getRawDest(), ByteVal, M->getLength(),
-                             M->getAlignment(), false);
-        MD->removeInstruction(M);
-        M->eraseFromParent();
+        Instruction *MSI = Builder.CreateMemSet(M->getRawDest(), ByteVal,
+                                                M->getLength(),
+                                                M->getAlignment(), false);
+        if (MSSA)
+          MSSA->replaceMemoryInstruction(M, MSI);
+        eraseInstruction(M);
         ++NumCpyToSet;
         return true;
       }
@@ -878,14 +895,25 @@ bool MemCpyOpt::processMemCpy(MemCpyInst *M) {
       if (performCallSlotOptzn(M, M->getDest(), M->getSource(),
                                CopySize->getZExtValue(), M->getAlignment(),
                                C)) {
-        MD->removeInstruction(M);
-        M->eraseFromParent();
+        eraseInstruction(M);
         return true;
       }
     }
   }
 
   AliasAnalysis::Location SrcLoc = AliasAnalysis::getLocationForSource(M);
+
+  // MemorySSA also finds the memcpy feeding M when it is in a block
+  // dominating M's.
+  if (MemoryUseOrDef *MA = MSSA ? MSSA->getMemoryAccess(M) : nullptr) {
+    MemoryAccess *Clobber = MSSA->getWalker()->getClobberingMemoryAccess(
+        MA->getDefiningAccess(), SrcLoc);
+    if (MemoryDef *Def = dyn_cast<MemoryDef>(Clobber))
+      if (MemCpyInst *MDep = dyn_cast_or_null<MemCpyInst>(Def->getMemoryInst()))
+        if (processMemCpyMemCpyDependence(M, MDep, CopySize->getZExtValue()))
+          return true;
+  }
+
   MemDepResult SrcDepInfo = MD->getPointerDependencyFrom(SrcLoc, true,
                                                          M, M->getParent());
   if (SrcDepInfo.isClobber()) {
@@ -905,8 +933,7 @@ bool MemCpyOpt::processMemCpy(MemCpyInst *M) {
     }
 
     if (hasUndefContents) {
-      MD->removeInstruction(M);
-      M->eraseFromParent();
+      eraseInstruction(M);
       ++NumMemCpyInstr;
       return true;
     }
@@ -1013,10 +1040,45 @@ bool MemCpyOpt::processByValArgument(CallSite CS, unsigned ArgNo) {
 
   // Otherwise we're good!  Update the byval argument.
   CS.setArgument(ArgNo, TmpCast);
+  if (MSSA)
+    MSSA->getWalker()->invalidateInfo();
   ++NumMemCpyInstr;
   return true;
 }
 
+/// isSourceUnchangedSince - Return true if nothing between MDep and I, which
+/// MDep dominates, may write the source of MDep.
+bool MemCpyOpt::isSourceUnchangedSince(MemCpyInst *MDep, Instruction *I) {
+  AliasAnalysis::Location SourceLoc = AliasAnalysis::getLocationForSource(MDep);
+  if (MSSA) {
+    // The source is unchanged if the same write clobbers it at I as at MDep.
+    MemoryUseOrDef *MDepAccess = MSSA->getMemoryAccess(MDep);
+    MemoryUseOrDef *IAccess = MSSA->getMemoryAccess(I);
+    if (!MDepAccess || !IAccess)
+      return false;
+    MemorySSAWalker *Walker = MSSA->getWalker();
+    return Walker->getClobberingMemoryAccess(MDepAccess->getDefiningAccess(),
+                                             SourceLoc) ==
+           Walker->getClobberingMemoryAccess(IAccess->getDefiningAccess(),
+                                             SourceLoc);
+  }
+
+  // NOTE: This is conservative, it will stop on any read from the source loc,
+  // not just the defining memcpy.
+  MemDepResult SourceDep =
+    MD->getPointerDependencyFrom(SourceLoc, false, I, I->getParent());
+  return SourceDep.isClobber() && SourceDep.getInst() == MDep;
+}
+
+/// eraseInstruction - Erase I, removing it from MemDep and MemorySSA first.
+void MemCpyOpt::eraseInstruction(Instruction *I) {
+  MD->removeInstruction(I);
+  if (MSSA)
+    if (MemoryUseOrDef *MA = MSSA->getMemoryAccess(I))
+      MSSA->removeMemoryAccess(MA);
+  I->eraseFromParent();
+}
+
 /// iterateOnFunction - Executes one iteration of MemCpyOpt.
 bool MemCpyOpt::iterateOnFunction(Function &F) {
   bool MadeChange = false;
@@ -1063,6 +1125,7 @@ bool MemCpyOpt::runOnFunction(Function &F) {
 
   bool MadeChange = false;
   MD = &getAnalysis<MemoryDependenceAnalysis>();
+  MSSA = UseMemorySSA ? &getAnalysis<MemorySSA>() : nullptr;
   DataLayoutPass *DLP = getAnalysisIfAvailable<DataLayoutPass>();
   DL = DLP ? &DLP->getDataLayout() : nullptr;
   TLI = &getAnalysis<TargetLibraryInfo>();
@@ -1080,5 +1143,6 @@ bool MemCpyOpt::runOnFunction(Function &F) {
   }
 
   MD = nullptr;
+  MSSA = nullptr;
   return MadeChange;
 }
@@ -0,0 +1,389 @@
+//===- SplitModule.cpp - Split a module into partitions -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the function llvm::SplitModule, which splits a module
+// into multiple linkable partitions. It can be used to implement parallel code
+// generation for link-time optimization.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+using namespace llvm;
+
+typedef EquivalenceClasses<const GlobalValue *> ClusterMapTy;
+
+/// isUsedList - Return true if GV is one of the arrays listing the globals that
+/// must be kept alive. They are rebuilt for every partition instead of being
+/// assigned to one.
+static bool isUsedList(const GlobalValue *GV) {
+  return GV->getName() == "llvm.used" || GV->getName() == "llvm.compiler.used";
+}
+
+/// refersToGlobal - Return true if the constant C refers to a global value,
+/// directly or through one of its operands.
+static bool refersToGlobal(const Constant *C,
+                           SmallPtrSetImpl<const Constant *> &Visited) {
+  if (isa<GlobalValue>(C) || isa<BlockAddress>(C))
+    return true;
+  if (!Visited.insert(C))
+    return false;
+  for (const Use &Op : C->operands())
+    if (refersToGlobal(cast<Constant>(Op), Visited))
+      return true;
+  return false;
+}
+
+/// isDuplicable - Return true if GV can be copied into every partition that
+/// uses it instead of being assigned to a single one. This is the case for
+/// local constants whose address is not significant and which do not drag any
+/// other global along, such as string literals.
+static bool isDuplicable(const GlobalValue *GV) {
+  const GlobalVariable *Var = dyn_cast<GlobalVariable>(GV);
+  if (!Var || !Var->hasLocalLinkage() || !Var->isConstant() ||
+      !Var->hasUnnamedAddr() || !Var->hasInitializer() || Var->hasComdat())
+    return false;
+  SmallPtrSet<const Constant *, 8> Visited;
+  return !refersToGlobal(Var->getInitializer(), Visited);
+}
+
+/// addUsersToCluster - Put Root into the same cluster as every definition that
+/// uses V, looking through constants.
+static void addUsersToCluster(const GlobalValue *Root, const Value *V,
+                              ClusterMapTy &Clusters) {
+  SmallVector<const User *, 16> Worklist(V->user_begin(), V->user_end());
+  SmallPtrSet<const User *, 16> Visited;
+  while (!Worklist.empty()) {
+    const User *U = Worklist.pop_back_val();
+    if (!Visited.insert(U))
+      continue;
+
+    if (const Instruction *I = dyn_cast<Instruction>(U)) {
+      Clusters.unionSets(Root, I->getParent()->getParent());
+      continue;
+    }
+
+    if (const GlobalValue *GV = dyn_cast<GlobalValue>(U)) {
+      if (!isUsedList(GV))
+        Clusters.unionSets(Root, GV);
+      continue;
+    }
+
+    Worklist.append(U->user_begin(), U->user_end());
+  }
+}
+
+/// addAliaseesToCluster - Put the alias GA into the same cluster as every
+/// definition its aliasee C refers to, looking through constants. An alias
+/// must point to a definition, which the base object alone does not cover
+/// when the aliasee is an arbitrary constant expression.
+static void addAliaseesToCluster(const GlobalAlias *GA, const Constant *C,
+                                 ClusterMapTy &Clusters) {
+  SmallVector<const Constant *, 8> Worklist(1, C);
+  SmallPtrSet<const Constant *, 8> Visited;
+  while (!Worklist.empty()) {
+    const Constant *Op = Worklist.pop_back_val();
+    if (!Visited.insert(Op))
+      continue;
+    if (const GlobalValue *Aliasee = dyn_cast<GlobalValue>(Op)) {
+      if (Clusters.findValue(Aliasee) != Clusters.end())
+        Clusters.unionSets(GA, Aliasee);
+      continue;
+    }
+    for (const Use &U : Op->operands())
+      Worklist.push_back(cast<Constant>(U));
+  }
+}
+
+/// isUsedOutside - Return true if V is used, looking through constants, by a
+/// definition that is not assigned to partition P.
+static bool isUsedOutside(const Value *V, unsigned P,
+                          const DenseMap<const GlobalValue *, unsigned> &Parts) {
+  SmallVector<const User *, 16> Worklist(V->user_begin(), V->user_end());
+  SmallPtrSet<const User *, 16> Visited;
+  while (!Worklist.empty()) {
+    const User *U = Worklist.pop_back_val();
+    if (!Visited.insert(U))
+      continue;
+
+    const GlobalValue *Owner = nullptr;
+    if (const Instruction *I = dyn_cast<Instruction>(U))
+      Owner = I->getParent()->getParent();
+    else if (!(Owner = dyn_cast<GlobalValue>(U))) {
+      Worklist.append(U->user_begin(), U->user_end());
+      continue;
+    }
+
+    auto OwnerPart = Parts.find(Owner);
+    if (OwnerPart != Parts.end() && OwnerPart->second != P)
+      return true;
+  }
+  return false;
+}
+
+/// getSize - Return an estimate of the code generation cost of GV.
+static unsigned getSize(const GlobalValue *GV) {
+  const Function *F = dyn_cast<Function>(GV);
+  if (!F)
+    return 1;
+  unsigned Size = 1;
+  for (const BasicBlock &BB : *F)
+    Size += BB.size();
+  return Size;
+}
+
+/// replaceWithDeclaration - Replace the alias GA with a declaration of the
+/// same name and type.
+static void replaceWithDeclaration(GlobalAlias *GA) {
+  Module *M = GA->getParent();
+  PointerType *PTy = GA->getType();
+  GlobalValue *Decl;
+  if (FunctionType *FTy = dyn_cast<FunctionType>(PTy->getElementType()))
+    Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", M);
+  else
+    Decl = new GlobalVariable(*M, PTy->getElementType(), false,
+                              GlobalValue::ExternalLinkage, nullptr, "",
+                              nullptr, GA->getThreadLocalMode(),
+                              PTy->getAddressSpace());
+  Decl->takeName(GA);
+  Decl->setVisibility(GA->getVisibility());
+  Decl->setDLLStorageClass(GA->getDLLStorageClass());
+  GA->replaceAllUsesWith(Decl);
+  GA->eraseFromParent();
+}
+
+/// dropDefinition - Turn the global object GO into a declaration.
+static void dropDefinition(GlobalObject *GO) {
+  if (Function *F = dyn_cast<Function>(GO)) {
+    F->deleteBody();
+  } else {
+    GlobalVariable *Var = cast<GlobalVariable>(GO);
+    Var->setInitializer(nullptr);
+    Var->setLinkage(GlobalValue::ExternalLinkage);
+  }
+  GO->setComdat(nullptr);
+}
+
+/// filterUsedList - Remove the entries of the used list Name that do not refer
+/// to a definition in M.
+static void filterUsedList(Module &M, StringRef Name) {
+  GlobalVariable *GV = M.getNamedGlobal(Name);
+  if (!GV || !GV->hasInitializer())
+    return;
+  ConstantArray *Init = dyn_cast<ConstantArray>(GV->getInitializer());
+  if (!Init)
+    return;
+
+  SmallVector<Constant *, 16> Kept;
+  for (unsigned i = 0, e = Init->getNumOperands(); i != e; ++i) {
+    Constant *Op = Init->getOperand(i);
+    const GlobalValue *Used = dyn_cast<GlobalValue>(Op->stripPointerCasts());
+    if (!Used || !Used->isDeclaration())
+      Kept.push_back(Op);
+  }
+  if (Kept.size() == Init->getNumOperands())
+    return;
+
+  if (Kept.empty()) {
+    GV->eraseFromParent();
+    return;
+  }
+
+  ArrayType *ATy = ArrayType::get(Init->getType()->getElementType(),
+                                  Kept.size());
+  GlobalVariable *NewGV = new GlobalVariable(M, ATy, false, GV->getLinkage(),
+                                             ConstantArray::get(ATy, Kept), "");
+  NewGV->takeName(GV);
+  NewGV->setSection(GV->getSection());
+  GV->eraseFromParent();
+}
+
+void llvm::SplitModule(const Module &M, unsigned N,
+                       std::function<void(std::unique_ptr<Module> MPart)>
+                           ModuleCallback,
+                       bool PreserveLocals) {
+  assert(N != 0 && "Cannot split a module into zero partitions");
+
+  // Collect the definitions that have to be assigned to a partition, in
+  // module order so that the result is deterministic.
+  std::vector<const GlobalValue *> Defs;
+  ClusterMapTy Clusters;
+  auto AddDef = [&](const GlobalValue &GV) {
+    if (GV.isDeclaration() || isUsedList(&GV) || isDuplicable(&GV))
+      return;
+    Defs.push_back(&GV);
+    Clusters.insert(&GV);
+  };
+  for (const Function &F : M)
+    AddDef(F);
+  for (const GlobalVariable &GV : M.globals())
+    AddDef(GV);
+  for (const GlobalAlias &GA : M.aliases())
+    AddDef(GA);
+
+  // Group the definitions that must stay together.
+  DenseMap<const Comdat *, const GlobalValue *> ComdatLeaders;
+  for (const GlobalValue *GV : Defs) {
+    // An appending global cannot be declared in another partition, so it
+    // stays with its users. So does a local, unless it may be promoted.
+    if (GV->hasAppendingLinkage() ||
+        (PreserveLocals && GV->hasLocalLinkage()))
+      addUsersToCluster(GV, GV, Clusters);
+
+    if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(GV)) {
+      addAliaseesToCluster(GA, GA->getAliasee(), Clusters);
+      continue;
+    }
+
+    const GlobalObject *GO = cast<GlobalObject>(GV);
+    if (const Comdat *C = GO->getComdat()) {
+      const GlobalValue *&Leader = ComdatLeaders[C];
+      if (Leader)
+        Clusters.unionSets(Leader, GO);
+      else
+        Leader = GO;
+    }
+
+    // A blockaddress can only refer to a function defined in the same module.
+    if (const Function *F = dyn_cast<Function>(GO))
+      for (const User *U : F->users())
+        if (isa<BlockAddress>(U))
+          addUsersToCluster(F, U, Clusters);
+  }
+
+  // Number the clusters in module order and compute their sizes.
+  DenseMap<const GlobalValue *, unsigned> ClusterIDs;
+  std::vector<unsigned> DefClusters;
+  std::vector<std::pair<unsigned, unsigned> > ClusterSizes;
+  DefClusters.reserve(Defs.size());
+  for (const GlobalValue *GV : Defs) {
+    auto Entry = ClusterIDs.insert(
+        std::make_pair(Clusters.getLeaderValue(GV), ClusterSizes.size()));
+    if (Entry.second)
+      ClusterSizes.push_back(std::make_pair(0U, ClusterSizes.size()));
+    unsigned ID = Entry.first->second;
+    ClusterSizes[ID].first += getSize(GV);
+    DefClusters.push_back(ID);
+  }
+
+  // Hand out the clusters, largest first, to the partition that is currently
+  // the smallest. Ties are broken by module order.
+  std::stable_sort(ClusterSizes.begin(), ClusterSizes.end(),
+                   [](const std::pair<unsigned, unsigned> &A,
+                      const std::pair<unsigned, unsigned> &B) {
+    return A.first > B.first;
+  });
+  std::vector<unsigned> PartitionSizes(N, 0);
+  std::vector<unsigned> ClusterPartitions(ClusterSizes.size());
+  for (const auto &Cluster : ClusterSizes) {
+    unsigned P = std::min_element(PartitionSizes.begin(),
+                                  PartitionSizes.end()) -
+                 PartitionSizes.begin();
+    PartitionSizes[P] += Cluster.first;
+    ClusterPartitions[Cluster.second] = P;
+  }
+
+  // Promote the locals that are referenced from another partition. Their new
+  // names are picked once, so that every partition agrees on them, and are
+  // made unique in M, so that they cannot clash with one another either.
+  std::vector<std::pair<const GlobalValue *, std::string> > Promoted;
+  if (!PreserveLocals) {
+    DenseMap<const GlobalValue *, unsigned> DefPartitions;
+    for (unsigned i = 0, e = Defs.size(); i != e; ++i)
+      DefPartitions[Defs[i]] = ClusterPartitions[DefClusters[i]];
+
+    unsigned NextID = 0;
+    for (const GlobalValue *GV : Defs) {
+      if (!GV->hasLocalLinkage() ||
+          !isUsedOutside(GV, DefPartitions[GV], DefPartitions))
+        continue;
+      std::string Name;
+      do
+        Name = (GV->getName() + ".llvm.split." + Twine(NextID++)).str();
+      while (M.getNamedValue(Name));
+      Promoted.push_back(std::make_pair(GV, Name));
+    }
+  }
+
+  for (unsigned I = 0; I != N; ++I) {
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> MPart(CloneModule(&M, VMap));
+
+    // Module level inline asm may define symbols, so only keep it once.
+    if (I != 0)
+      MPart->setModuleInlineAsm("");
+
+    for (const auto &Entry : Promoted) {
+      GlobalValue *GV = cast<GlobalValue>(VMap[Entry.first]);
+      GV->setName(Entry.second);
+      GV->setLinkage(GlobalValue::ExternalLinkage);
+      GV->setVisibility(GlobalValue::HiddenVisibility);
+    }
+
+    // Turn the definitions that belong to other partitions into declarations.
+    // The remaining local and appending ones are only referenced by other
+    // dropped definitions; they are deleted once nothing refers to them
+    // anymore.
+    std::vector<GlobalValue *> DeadLocals;
+    for (unsigned i = 0, e = Defs.size(); i != e; ++i) {
+      if (ClusterPartitions[DefClusters[i]] == I)
+        continue;
+      GlobalValue *GV = cast<GlobalValue>(VMap[Defs[i]]);
+      if (GV->hasLocalLinkage() || GV->hasAppendingLinkage())
+        DeadLocals.push_back(GV);
+      if (GlobalAlias *GA = dyn_cast<GlobalAlias>(GV)) {
+        if (!GA->hasLocalLinkage())
+          replaceWithDeclaration(GA);
+        continue;
+      }
+      dropDefinition(cast<GlobalObject>(GV));
+    }
+
+    filterUsedList(*MPart, "llvm.used");
+    filterUsedList(*MPart, "llvm.compiler.used");
+
+    // Aliases come last in DeadLocals; delete them before their aliasees.
+    for (auto DI = DeadLocals.rbegin(), DE = DeadLocals.rend(); DI != DE;
+         ++DI) {
+      GlobalValue *GV = *DI;
+      GV->removeDeadConstantUsers();
+      assert(GV->use_empty() && "Local value used across partitions");
+      GV->eraseFromParent();
+    }
+
+    // Drop the local constants that no definition in this partition uses.
+    for (auto GI = MPart->global_begin(), GE = MPart->global_end();
+         GI != GE;) {
+      GlobalVariable *GV = GI++;
+      if (!isDuplicable(GV))
+        continue;
+      GV->removeDeadConstantUsers();
+      if (GV->use_empty())
+        GV->eraseFromParent();
+    }
+
+    ModuleCallback(std::move(MPart));
+  }
+}
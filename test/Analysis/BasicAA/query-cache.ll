@@ -0,0 +1,50 @@
+; RUN: opt < %s -basicaa -gvn -dse -S | FileCheck %s
+; RUN: opt < %s -basicaa -gvn -dse -stats -disable-output 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=STATS
+; REQUIRES: asserts
+
+; GVN and DSE ask BasicAA about the same pairs of pointers many times. They
+; enable query caching, which answers the repeated queries and reuses the
+; decompositions of the GEPs.
+
+target datalayout = "e-p:64:64:64-i32:32:32-i64:64:64"
+
+; STATS-DAG: {{[0-9]+}} basicaa - Number of GEP decompositions found in the cache
+; STATS-DAG: {{[0-9]+}} basicaa - Number of alias queries answered from the cache
+
+; The redundant loads are still removed, and the dead store too.
+; CHECK-LABEL: define i32 @f(
+; CHECK: entry:
+; CHECK-NOT: store i32 0
+; CHECK: join:
+; CHECK-NOT: load
+; CHECK: ret i32
+
+define i32 @f(i1 %c, [16 x i32]* %a, i32* %q, i64 %i) {
+entry:
+  %p0 = getelementptr [16 x i32]* %a, i64 0, i64 %i
+  %i1 = add i64 %i, 1
+  %p1 = getelementptr [16 x i32]* %a, i64 0, i64 %i1
+  %i2 = add i64 %i, 2
+  %p2 = getelementptr [16 x i32]* %a, i64 0, i64 %i2
+  store i32 0, i32* %p0
+  store i32 1, i32* %p0
+  store i32 2, i32* %p1
+  store i32 3, i32* %p2
+  %x0 = load i32* %p0
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 %x0, i32* %p1
+  br label %join
+
+else:
+  store i32 %x0, i32* %p2
+  br label %join
+
+join:
+  %y0 = load i32* %p0
+  %y1 = load i32* %p0
+  %s = add i32 %y0, %y1
+  ret i32 %s
+}
@@ -0,0 +1,20 @@
+; RUN: opt -disable-output -passes=print-cg %s 2>&1 | FileCheck %s
+;
+; A blockaddress is an edge to its function.
+
+; CHECK-LABEL: Call edges in function: target
+; CHECK-NOT: ->
+; CHECK-LABEL: Call edges in function: taker
+; CHECK-NEXT: -> target
+
+define i8* @taker() {
+  ret i8* blockaddress(@target, %dest)
+}
+
+define void @target(i8* %p) {
+entry:
+  indirectbr i8* %p, [label %dest]
+
+dest:
+  ret void
+}
@@ -0,0 +1,37 @@
+; RUN: opt -basicaa -memoryssa -analyze < %s | FileCheck %s
+
+; Every write is a MemoryDef of the closest write above it, every read a
+; MemoryUse of it, whatever they access.
+
+define i32 @straight(i32* noalias %p, i32* noalias %q) {
+; CHECK-LABEL: function 'straight'
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 1, i32* %p
+  store i32 1, i32* %p
+; CHECK: ; 2 = MemoryDef(1)
+; CHECK-NEXT: store i32 2, i32* %q
+  store i32 2, i32* %q
+; CHECK: ; MemoryUse(2)
+; CHECK-NEXT: %v = load i32* %p
+  %v = load i32* %p
+; CHECK-NOT: Memory
+; CHECK: ret i32 %v
+  ret i32 %v
+}
+
+declare void @clobber()
+declare i32 @pure(i32) readnone
+
+define void @calls(i32 %x) {
+; CHECK-LABEL: function 'calls'
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: call void @clobber()
+  call void @clobber()
+; CHECK-NOT: Memory
+; CHECK: call i32 @pure(i32 %x)
+  call i32 @pure(i32 %x)
+; CHECK: ; 2 = MemoryDef(1)
+; CHECK-NEXT: fence seq_cst
+  fence seq_cst
+  ret void
+}
@@ -0,0 +1,74 @@
+; RUN: opt -basicaa -memoryssa -analyze < %s | FileCheck %s
+
+; MemoryPhis merge the definitions reaching joins, with one incoming value
+; per predecessor in predecessor order.
+
+define i32 @diamond(i1 %c, i32* %p) {
+; CHECK-LABEL: function 'diamond'
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 1, i32* %p
+  store i32 1, i32* %p
+  br label %join
+
+else:
+; CHECK: ; 2 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 2, i32* %p
+  store i32 2, i32* %p
+  br label %join
+
+join:
+; CHECK: ; 3 = MemoryPhi({%else,2},{%then,1})
+; CHECK: ; MemoryUse(3)
+; CHECK-NEXT: %v = load i32* %p
+  %v = load i32* %p
+  ret i32 %v
+}
+
+define void @loop(i32* %p, i32 %n) {
+; CHECK-LABEL: function 'loop'
+entry:
+; CHECK: ; 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 0, i32* %p
+  store i32 0, i32* %p
+  br label %loop
+
+loop:
+; CHECK: ; 2 = MemoryPhi({%loop,3},{%entry,1})
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+; CHECK: ; MemoryUse(2)
+; CHECK-NEXT: %v = load i32* %p
+  %v = load i32* %p
+  %i.next = add i32 %v, 1
+; CHECK: ; 3 = MemoryDef(2)
+; CHECK-NEXT: store i32 %i.next, i32* %p
+  store i32 %i.next, i32* %p
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+; CHECK-NOT: MemoryPhi
+; CHECK: ret void
+  ret void
+}
+
+; A join that no write reaches through its predecessors needs no phi.
+define i32 @nophi(i1 %c, i32* %p) {
+; CHECK-LABEL: function 'nophi'
+entry:
+  store i32 1, i32* %p
+  br i1 %c, label %then, label %join
+
+then:
+  br label %join
+
+join:
+; CHECK-NOT: MemoryPhi
+; CHECK: ; MemoryUse(1)
+; CHECK-NEXT: %v = load i32* %p
+  %v = load i32* %p
+  ret i32 %v
+}
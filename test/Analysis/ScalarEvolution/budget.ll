@@ -0,0 +1,51 @@
+; RUN: opt < %s -analyze -scalar-evolution | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-expr-size=4 \
+; RUN:   | FileCheck %s -check-prefix=SIZE
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-depth=2 \
+; RUN:   | FileCheck %s -check-prefix=DEPTH
+
+; Expressions over the size budget, and values past the depth budget, are
+; left unknown.
+
+; CHECK-LABEL: @size
+; CHECK: %c = add i32 %b, %w
+; CHECK-NEXT: -->  (%x + %y + %z + %w)
+; SIZE-LABEL: @size
+; SIZE: %b = add i32 %a, %z
+; SIZE-NEXT: -->  (%x + %y + %z)
+; SIZE: %c = add i32 %b, %w
+; SIZE-NEXT: -->  %c
+define i32 @size(i32 %x, i32 %y, i32 %z, i32 %w) {
+  %a = add i32 %x, %y
+  %b = add i32 %a, %z
+  %c = add i32 %b, %w
+  ret i32 %c
+}
+
+; The uses come first in the function, so that %c is analyzed before the
+; values it depends on. The chain is in the second operands, which the
+; analysis of an add reaches through getSCEV rather than by flattening. The
+; unknown %a is not cached past the query for %c, so the query for %a itself
+; still analyzes it.
+
+; CHECK-LABEL: @depth
+; CHECK: %c = add i32 %w, %b
+; CHECK-NEXT: -->  (%x + %y + %z + %w)
+; DEPTH-LABEL: @depth
+; DEPTH: %c = add i32 %w, %b
+; DEPTH-NEXT: -->  (%z + %w + %a)
+; DEPTH: %a = add i32 %x, %y
+; DEPTH-NEXT: -->  (%x + %y)
+define i32 @depth(i32 %x, i32 %y, i32 %z, i32 %w) {
+entry:
+  br label %def
+
+use:
+  %c = add i32 %w, %b
+  ret i32 %c
+
+def:
+  %a = add i32 %x, %y
+  %b = add i32 %z, %a
+  br label %use
+}
@@ -0,0 +1,27 @@
+; RUN: opt < %s -analyze -scalar-evolution -stats 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; -stats reports how well the caches of ScalarEvolution do, and how large they
+; grow.
+
+; CHECK-DAG: scalar-evolution - Number of getSCEV queries answered from the cache
+; CHECK-DAG: scalar-evolution - Number of values analyzed by createSCEV
+; CHECK-DAG: scalar-evolution - Number of getSCEVAtScope queries computed
+; CHECK-DAG: scalar-evolution - Largest number of unique expressions built for a function
+; CHECK-DAG: scalar-evolution - Largest number of values with a cached expression in a function
+
+define i32 @sum(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %s.next = add i32 %s, %i
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %s.next
+}
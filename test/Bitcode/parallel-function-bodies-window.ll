@@ -0,0 +1,250 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: opt -S -threads=1 %t.bc > %t.serial.ll
+; RUN: opt -S -threads=2 -stats %t.bc 2> %t.stats > %t.parallel.ll
+; RUN: diff %t.serial.ll %t.parallel.ll
+; RUN: FileCheck %s < %t.stats
+; REQUIRES: asserts
+
+; With two threads, bodies are decoded 16 at a time while the previous ones
+; are materialized, so the 40 functions below take three windows.
+
+; CHECK: 3 bitcode-reader - Number of windows of function bodies decoded ahead
+
+define i32 @f0(i32 %x) {
+  %s = add i32 %x, 0
+  ret i32 %s
+}
+
+define i32 @f1(i32 %x) {
+  %s = add i32 %x, 1
+  %r = call i32 @f0(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f2(i32 %x) {
+  %s = add i32 %x, 2
+  %r = call i32 @f1(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f3(i32 %x) {
+  %s = add i32 %x, 3
+  %r = call i32 @f2(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f4(i32 %x) {
+  %s = add i32 %x, 4
+  %r = call i32 @f3(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f5(i32 %x) {
+  %s = add i32 %x, 5
+  %r = call i32 @f4(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f6(i32 %x) {
+  %s = add i32 %x, 6
+  %r = call i32 @f5(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f7(i32 %x) {
+  %s = add i32 %x, 7
+  %r = call i32 @f6(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f8(i32 %x) {
+  %s = add i32 %x, 8
+  %r = call i32 @f7(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f9(i32 %x) {
+  %s = add i32 %x, 9
+  %r = call i32 @f8(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f10(i32 %x) {
+  %s = add i32 %x, 10
+  %r = call i32 @f9(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f11(i32 %x) {
+  %s = add i32 %x, 11
+  %r = call i32 @f10(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f12(i32 %x) {
+  %s = add i32 %x, 12
+  %r = call i32 @f11(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f13(i32 %x) {
+  %s = add i32 %x, 13
+  %r = call i32 @f12(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f14(i32 %x) {
+  %s = add i32 %x, 14
+  %r = call i32 @f13(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f15(i32 %x) {
+  %s = add i32 %x, 15
+  %r = call i32 @f14(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f16(i32 %x) {
+  %s = add i32 %x, 16
+  %r = call i32 @f15(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f17(i32 %x) {
+  %s = add i32 %x, 17
+  %r = call i32 @f16(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f18(i32 %x) {
+  %s = add i32 %x, 18
+  %r = call i32 @f17(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f19(i32 %x) {
+  %s = add i32 %x, 19
+  %r = call i32 @f18(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f20(i32 %x) {
+  %s = add i32 %x, 20
+  %r = call i32 @f19(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f21(i32 %x) {
+  %s = add i32 %x, 21
+  %r = call i32 @f20(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f22(i32 %x) {
+  %s = add i32 %x, 22
+  %r = call i32 @f21(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f23(i32 %x) {
+  %s = add i32 %x, 23
+  %r = call i32 @f22(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f24(i32 %x) {
+  %s = add i32 %x, 24
+  %r = call i32 @f23(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f25(i32 %x) {
+  %s = add i32 %x, 25
+  %r = call i32 @f24(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f26(i32 %x) {
+  %s = add i32 %x, 26
+  %r = call i32 @f25(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f27(i32 %x) {
+  %s = add i32 %x, 27
+  %r = call i32 @f26(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f28(i32 %x) {
+  %s = add i32 %x, 28
+  %r = call i32 @f27(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f29(i32 %x) {
+  %s = add i32 %x, 29
+  %r = call i32 @f28(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f30(i32 %x) {
+  %s = add i32 %x, 30
+  %r = call i32 @f29(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f31(i32 %x) {
+  %s = add i32 %x, 31
+  %r = call i32 @f30(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f32(i32 %x) {
+  %s = add i32 %x, 32
+  %r = call i32 @f31(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f33(i32 %x) {
+  %s = add i32 %x, 33
+  %r = call i32 @f32(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f34(i32 %x) {
+  %s = add i32 %x, 34
+  %r = call i32 @f33(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f35(i32 %x) {
+  %s = add i32 %x, 35
+  %r = call i32 @f34(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f36(i32 %x) {
+  %s = add i32 %x, 36
+  %r = call i32 @f35(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f37(i32 %x) {
+  %s = add i32 %x, 37
+  %r = call i32 @f36(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f38(i32 %x) {
+  %s = add i32 %x, 38
+  %r = call i32 @f37(i32 %s)
+  ret i32 %r
+}
+
+define i32 @f39(i32 %x) {
+  %s = add i32 %x, 39
+  %r = call i32 @f38(i32 %s)
+  ret i32 %r
+}
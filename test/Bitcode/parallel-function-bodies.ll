@@ -0,0 +1,69 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: opt -S -threads=1 %t.bc > %t.serial.ll
+; RUN: opt -S -threads=4 %t.bc > %t.parallel.ll
+; RUN: diff %t.serial.ll %t.parallel.ll
+; RUN: FileCheck %s < %t.parallel.ll
+
+; Decoding the function bodies ahead of time must build the same IR as
+; reading them one at a time.
+
+@table = constant [2 x i8*] [i8* blockaddress(@indirect, %one),
+                             i8* blockaddress(@indirect, %two)]
+
+; CHECK-LABEL: define i32 @loop(i32 %n)
+; CHECK: %sum.next = add i32 %sum, %i
+define i32 @loop(i32 %n) {
+entry:
+  br label %body
+
+body:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %body ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %body ]
+  %sum.next = add i32 %sum, %i
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %body
+
+exit:
+  ret i32 %sum.next
+}
+
+; CHECK-LABEL: define double @constants(double %x)
+; CHECK: fmul double %x, 2.500000e+00
+; CHECK: fadd double %y, 1.000000e-01
+define double @constants(double %x) {
+  %y = fmul double %x, 2.5
+  %z = fadd double %y, 0.1
+  ret double %z
+}
+
+; CHECK-LABEL: define i32 @indirect(i32 %i)
+; CHECK: indirectbr i8* %dest, [label %one, label %two]
+define i32 @indirect(i32 %i) {
+entry:
+  %slot = getelementptr [2 x i8*]* @table, i32 0, i32 %i
+  %dest = load i8** %slot
+  indirectbr i8* %dest, [label %one, label %two]
+
+one:
+  ret i32 1
+
+two:
+  ret i32 2
+}
+
+; CHECK-LABEL: define void @metadata(i32 %x)
+; CHECK: store volatile i32 %x, i32* %p, !tbaa !0
+define void @metadata(i32 %x) {
+  %p = alloca i32
+  store volatile i32 %x, i32* %p, !tbaa !0
+  switch i32 %x, label %default [ i32 1, label %default
+                                  i32 7, label %default ]
+
+default:
+  ret void
+}
+
+!0 = metadata !{metadata !1, metadata !1, i64 0}
+!1 = metadata !{metadata !"int", metadata !2, i64 0}
+!2 = metadata !{metadata !"tbaa root"}
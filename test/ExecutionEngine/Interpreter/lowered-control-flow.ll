@@ -0,0 +1,88 @@
+; RUN: lli -O0 -force-interpreter %s > /dev/null
+
+; The interpreter runs functions lowered into an array of instructions, with
+; branch targets and operands resolved when the function is lowered. main
+; exits with 0 if every check passes.
+
+declare i32 @llvm.ctpop.i32(i32)
+
+; Lowers ctpop at the deepest level of the recursion, while the outer calls
+; of the same function wait for their result.
+define i32 @popsum(i32 %n) {
+entry:
+  %done = icmp eq i32 %n, 0
+  br i1 %done, label %base, label %recurse
+
+base:
+  ret i32 0
+
+recurse:
+  %m = sub i32 %n, 1
+  %rest = call i32 @popsum(i32 %m)
+  %pop = call i32 @llvm.ctpop.i32(i32 %n)
+  %sum = add i32 %rest, %pop
+  ret i32 %sum
+}
+
+define i32 @classify(i32 %x) {
+entry:
+  switch i32 %x, label %other [
+    i32 1, label %one
+    i32 7, label %seven
+  ]
+
+one:
+  br label %join
+
+seven:
+  br label %join
+
+other:
+  br label %join
+
+join:
+  %r = phi i32 [ 10, %one ], [ 70, %seven ], [ 0, %other ]
+  ret i32 %r
+}
+
+; Swaps a and b on every iteration, so the two phis have to be read before
+; either is written.
+define i32 @swap(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %a = phi i32 [ 1, %entry ], [ %b, %loop ]
+  %b = phi i32 [ 2, %entry ], [ %a, %loop ]
+  %i.next = add i32 %i, 1
+  %again = icmp ult i32 %i.next, %n
+  br i1 %again, label %loop, label %exit
+
+exit:
+  %r = mul i32 %a, 10
+  %s = add i32 %r, %b
+  ret i32 %s
+}
+
+define i32 @main() {
+entry:
+  ; popcounts of 1..5 are 1, 1, 2, 1, 2.
+  %p = call i32 @popsum(i32 5)
+  %p.ok = icmp eq i32 %p, 7
+  %p2 = call i32 @popsum(i32 3)
+  %p2.ok = icmp eq i32 %p2, 4
+  %c1 = call i32 @classify(i32 1)
+  %c7 = call i32 @classify(i32 7)
+  %c3 = call i32 @classify(i32 3)
+  %c.sum = add i32 %c1, %c7
+  %c.sum2 = add i32 %c.sum, %c3
+  %c.ok = icmp eq i32 %c.sum2, 80
+  %s = call i32 @swap(i32 2)
+  %s.ok = icmp eq i32 %s, 21
+  %ok1 = and i1 %p.ok, %p2.ok
+  %ok2 = and i1 %ok1, %c.ok
+  %ok3 = and i1 %ok2, %s.ok
+  %ret = select i1 %ok3, i32 0, i32 1
+  ret i32 %ret
+}
@@ -0,0 +1,44 @@
+; RUN: %lli -lazy-function-stubs %s > /dev/null
+
+; With -lazy-function-stubs, every function is compiled on its first call.
+; The local symbols of the module, and recursive and indirect calls, still
+; work once the functions are compiled on their own.
+
+@counter = internal global i32 0
+@table = internal constant [2 x i32 (i32)*] [i32 (i32)* @fib, i32 (i32)* @bump]
+
+define internal i32 @bump(i32 %x) {
+  %v = load i32* @counter
+  %n = add i32 %v, %x
+  store i32 %n, i32* @counter
+  ret i32 %n
+}
+
+define internal i32 @fib(i32 %n) {
+  %small = icmp slt i32 %n, 2
+  br i1 %small, label %done, label %rec
+
+rec:
+  %a = sub i32 %n, 1
+  %b = sub i32 %n, 2
+  %fa = call i32 @fib(i32 %a)
+  %fb = call i32 @fib(i32 %b)
+  %r = add i32 %fa, %fb
+  ret i32 %r
+
+done:
+  ret i32 %n
+}
+
+define i32 @main() {
+  %fp = getelementptr [2 x i32 (i32)*]* @table, i32 0, i32 0
+  %f = load i32 (i32)** %fp
+  %v = call i32 %f(i32 10)
+  %bp = getelementptr [2 x i32 (i32)*]* @table, i32 0, i32 1
+  %b = load i32 (i32)** %bp
+  %c = call i32 %b(i32 %v)
+  %d = call i32 @bump(i32 1)
+  %ok = icmp eq i32 %d, 56
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
@@ -0,0 +1,33 @@
+; RUN: %lli -lazy-function-stubs -tier-up-call-count=100 -stats %s 2>&1 \
+; RUN:   > /dev/null | FileCheck %s
+; REQUIRES: asserts
+
+; @square is called often enough to be compiled again in the background while
+; the loop keeps calling it. @main is only called once.
+
+; CHECK: 1 mcjit - Number of functions compiled again once hot
+; CHECK: 2 mcjit - Number of functions compiled through their stub
+
+define internal i32 @square(i32 %x) {
+  %r = mul i32 %x, %x
+  ret i32 %r
+}
+
+define i32 @main() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %sq = call i32 @square(i32 %i)
+  %sum.next = add i32 %sum, %sq
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, 10000
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %ok = icmp eq i32 %sum.next, -1724114088
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
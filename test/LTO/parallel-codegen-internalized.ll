@@ -0,0 +1,57 @@
+; RUN: llvm-as -o %t.bc %s
+; RUN: llvm-lto -j2 -exported-symbol=main -o %t.o %t.bc
+; RUN: llvm-nm %t.o.0 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-nm %t.o.1 | FileCheck --check-prefix=CHECK1 %s
+
+; Everything but main is internalized. Instead of keeping every local with
+; its users, which would put the whole module into the first unit, the locals
+; called from the other unit are promoted to hidden globals with new names.
+; The local that is only used from its own unit stays local.
+
+; CHECK0: U {{large\.llvm\.split\.[0-9]+}}
+; CHECK0: T main
+; CHECK0: U {{small\.llvm\.split\.[0-9]+}}
+; CHECK0-NOT: tiny
+
+; CHECK1: T {{large\.llvm\.split\.[0-9]+}}
+; CHECK1-NOT: main
+; CHECK1: T {{small\.llvm\.split\.[0-9]+}}
+; CHECK1: t tiny
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @main(i32 %a, i32 %b) {
+entry:
+  %0 = mul i32 %a, %b
+  %1 = add i32 %0, %a
+  %2 = xor i32 %1, %b
+  %3 = mul i32 %2, %2
+  %4 = sub i32 %3, %a
+  %5 = sdiv i32 %4, %b
+  %6 = srem i32 %5, %a
+  %7 = call i32 @large(i32 %6)
+  %8 = call i32 @small(i32 %7)
+  ret i32 %8
+}
+
+define internal i32 @large(i32 %a) noinline {
+entry:
+  %0 = mul i32 %a, %a
+  %1 = add i32 %0, %a
+  %2 = xor i32 %1, 7
+  %3 = call i32 @small(i32 %2)
+  ret i32 %3
+}
+
+define internal i32 @small(i32 %a) noinline {
+entry:
+  %0 = call i32 @tiny(i32 %a)
+  ret i32 %0
+}
+
+define internal i32 @tiny(i32 %a) noinline {
+entry:
+  %0 = add i32 %a, 1
+  ret i32 %0
+}
@@ -0,0 +1,49 @@
+; RUN: llvm-as -o %t.bc %s
+; RUN: llvm-lto -j2 -exported-symbol=foo -exported-symbol=bar -o %t.o %t.bc
+; RUN: llvm-nm %t.o.0 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-nm %t.o.1 | FileCheck --check-prefix=CHECK1 %s
+
+; The larger function goes into the first unit. The internal function baz
+; stays with its only user, bar, and the string constant used by both is
+; duplicated into both units.
+
+; CHECK0: U bar
+; CHECK0-NOT: baz
+; CHECK0: T foo
+
+; CHECK1: T bar
+; CHECK1: t baz
+; CHECK1-NOT: foo
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@.str = private unnamed_addr constant [7 x i8] c"hello\0A\00", align 1
+
+declare i32 @puts(i8*)
+
+define i32 @foo(i32 %a, i32 %b) {
+entry:
+  %0 = mul i32 %a, %b
+  %1 = add i32 %0, %a
+  %2 = xor i32 %1, %b
+  %3 = mul i32 %2, %2
+  %4 = sub i32 %3, %a
+  %5 = call i32 @puts(i8* getelementptr inbounds ([7 x i8]* @.str, i64 0, i64 0))
+  %6 = call i32 @bar(i32 %4)
+  %7 = add i32 %6, %5
+  ret i32 %7
+}
+
+define i32 @bar(i32 %a) noinline {
+entry:
+  %0 = call i32 @puts(i8* getelementptr inbounds ([7 x i8]* @.str, i64 0, i64 0))
+  %1 = call i32 @baz(i32 %a)
+  ret i32 %1
+}
+
+define internal i32 @baz(i32 %a) noinline {
+entry:
+  %0 = add i32 %a, 1
+  ret i32 %0
+}
@@ -0,0 +1,27 @@
+@llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @ctor_a, i8* null }]
+
+declare void @b()
+declare void @c()
+
+define void @a() {
+  call void @b()
+  call void @local_a()
+  ret void
+}
+
+define internal void @local_a() {
+  ret void
+}
+
+define void @a_back() {
+  ret void
+}
+
+define void @unused_a() {
+  call void @c()
+  ret void
+}
+
+define internal void @ctor_a() {
+  ret void
+}
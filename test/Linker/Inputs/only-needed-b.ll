@@ -0,0 +1,9 @@
+@counter = global i32 1
+
+declare void @a_back()
+
+define linkonce_odr void @b() {
+  store i32 2, i32* @counter
+  call void @a_back()
+  ret void
+}
@@ -0,0 +1,6 @@
+@c_var = global i32 0
+
+define void @c() {
+  store i32 1, i32* @c_var
+  ret void
+}
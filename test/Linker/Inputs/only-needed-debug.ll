@@ -0,0 +1,24 @@
+define i32 @dbg_used() {
+  ret i32 1, !dbg !8
+}
+
+define i32 @dbg_unused() {
+  ret i32 2, !dbg !9
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!10}
+!llvm.ident = !{!11}
+
+!0 = metadata !{i32 786449, metadata !1, i32 12, metadata !"clang", i1 true, metadata !"", i32 0, metadata !2, metadata !2, metadata !3, metadata !2, metadata !2, metadata !""} ; [ DW_TAG_compile_unit ]
+!1 = metadata !{metadata !"debug.c", metadata !"/tmp"}
+!2 = metadata !{}
+!3 = metadata !{metadata !4, metadata !7}
+!4 = metadata !{i32 786478, metadata !1, metadata !5, metadata !"dbg_used", metadata !"dbg_used", metadata !"", i32 1, metadata !6, i1 false, i1 true, i32 0, i32 0, null, i32 0, i1 false, i32 ()* @dbg_used, null, null, metadata !2, i32 1} ; [ DW_TAG_subprogram ]
+!5 = metadata !{i32 786473, metadata !1} ; [ DW_TAG_file_type ]
+!6 = metadata !{i32 786453, i32 0, null, metadata !"", i32 0, i64 0, i64 0, i64 0, i32 0, null, metadata !2, i32 0, null, null, null} ; [ DW_TAG_subroutine_type ]
+!7 = metadata !{i32 786478, metadata !1, metadata !5, metadata !"dbg_unused", metadata !"dbg_unused", metadata !"", i32 2, metadata !6, i1 false, i1 true, i32 0, i32 0, null, i32 0, i1 false, i32 ()* @dbg_unused, null, null, metadata !2, i32 2} ; [ DW_TAG_subprogram ]
+!8 = metadata !{i32 1, i32 0, metadata !4, null}
+!9 = metadata !{i32 2, i32 0, metadata !7, null}
+!10 = metadata !{i32 2, metadata !"Debug Info Version", i32 1}
+!11 = metadata !{metadata !"clang version 3.6"}
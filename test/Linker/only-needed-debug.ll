@@ -0,0 +1,25 @@
+; RUN: llvm-as %p/Inputs/only-needed-debug.ll -o %t.bc
+; RUN: llvm-link -only-needed %s %t.bc -S | FileCheck %s
+
+; The input providing @dbg_used keeps its compile unit and its other named
+; metadata. The subprogram of @dbg_unused, which is not linked in, refers to
+; no function.
+
+; CHECK: define i32 @dbg_used() {
+; CHECK-NEXT: ret i32 1, !dbg [[LOC:![0-9]+]]
+; CHECK-NOT: @dbg_unused
+; CHECK: !llvm.dbg.cu = !{[[CU:![0-9]+]]}
+; CHECK: !llvm.ident = !{[[IDENT:![0-9]+]]}
+; CHECK: [[CU]] = metadata !{i32 786449, {{.*}}, metadata [[SPS:![0-9]+]], metadata !{{[0-9]+}}, metadata !{{[0-9]+}}, metadata !""}
+; CHECK: [[SPS]] = metadata !{metadata [[SP:![0-9]+]], metadata [[UNUSED:![0-9]+]]}
+; CHECK: [[SP]] = {{.*}}metadata !"dbg_used", {{.*}}i32 ()* @dbg_used,
+; CHECK: [[UNUSED]] = {{.*}}metadata !"dbg_unused", {{.*}}i1 false, i32 ()* null, null,
+; CHECK: [[IDENT]] = metadata !{metadata !"clang version 3.6"}
+; CHECK-NOT: @dbg_unused
+
+declare i32 @dbg_used()
+
+define i32 @root() {
+  %r = call i32 @dbg_used()
+  ret i32 %r
+}
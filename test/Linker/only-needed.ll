@@ -0,0 +1,28 @@
+; RUN: llvm-as %p/Inputs/only-needed-a.ll -o %t.a.bc
+; RUN: llvm-as %p/Inputs/only-needed-b.ll -o %t.b.bc
+; RUN: llvm-as %p/Inputs/only-needed-c.ll -o %t.c.bc
+; RUN: llvm-link -only-needed %s %t.a.bc %t.b.bc %t.c.bc -S > %t.ll
+; RUN: FileCheck %s < %t.ll
+; RUN: FileCheck --check-prefix=UNNEEDED %s < %t.ll
+
+; @a is needed by @root. @a needs @b from the next input, which in turn needs
+; @a_back from the first one. Nothing from the last input is needed.
+
+; CHECK-DAG: @llvm.global_ctors = appending global {{.*}} @ctor_a
+; CHECK-DAG: @counter = global i32 1
+; CHECK-DAG: define void @root()
+; CHECK-DAG: define void @a()
+; CHECK-DAG: define internal void @local_a()
+; CHECK-DAG: define internal void @ctor_a()
+; CHECK-DAG: define void @a_back()
+; CHECK-DAG: define linkonce_odr void @b()
+; UNNEEDED-NOT: @unused_a
+; UNNEEDED-NOT: @c_var
+; UNNEEDED-NOT: @c()
+
+declare void @a()
+
+define void @root() {
+  call void @a()
+  ret void
+}
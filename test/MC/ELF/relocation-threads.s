@@ -0,0 +1,36 @@
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o %t.serial
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o %t.parallel -elf-relocation-threads=3
+// RUN: cmp %t.serial %t.parallel
+// RUN: llvm-readobj -r %t.parallel | FileCheck %s
+
+// Relocation sections encoded on several threads are identical to the ones
+// encoded serially, and keep the order of the sections they apply to.
+
+// CHECK:      Section ({{[0-9]+}}) .rela.data {
+// CHECK-NEXT:   0x0 R_X86_64_64 foo 0x0
+// CHECK-NEXT:   0x8 R_X86_64_64 bar 0x0
+// CHECK-NEXT: }
+// CHECK:      Section ({{[0-9]+}}) .rela.text.foo {
+// CHECK-NEXT:   0x1 R_X86_64_PC32 bar 0xFFFFFFFFFFFFFFFC
+// CHECK-NEXT:   0x6 R_X86_64_PC32 baz 0xFFFFFFFFFFFFFFFC
+// CHECK-NEXT: }
+// CHECK:      Section ({{[0-9]+}}) .rela.text.bar {
+// CHECK-NEXT:   0x1 R_X86_64_PC32 baz 0xFFFFFFFFFFFFFFFC
+// CHECK-NEXT: }
+
+        .section .text.foo,"ax",@progbits
+        .globl foo
+foo:
+        call    bar
+        call    baz
+        ret
+
+        .section .text.bar,"ax",@progbits
+        .globl bar
+bar:
+        call    baz
+        ret
+
+        .data
+        .quad   foo
+        .quad   bar
@@ -0,0 +1,25 @@
+// RUN: llvm-mc -filetype=obj -triple x86_64-unknown-linux %s -stats -o %t 2>&1 | FileCheck %s --check-prefix=STATS
+// RUN: llvm-objdump -d %t | FileCheck %s
+// REQUIRES: asserts
+
+// Relaxing the second jump pushes the target of the first one out of range.
+// The first jump is relaxed on the second pass over the section, after which
+// there is nothing left that could be relaxed, so no third pass is needed.
+
+// STATS-DAG: 2 assembler - Number of fragments initially considered for relaxation
+// STATS-DAG: 3 assembler - Number of fragments checked for relaxation
+// STATS-DAG: 2 assembler - Number of relaxed instructions
+// STATS-DAG: 2 assembler - Number of relaxation steps over a single section
+
+// CHECK: 0: e9 81 00 00 00 jmp
+// CHECK: 81: e9 80 00 00 00 jmp
+
+        .text
+foo:
+        jmp     L1
+        .space  124
+        jmp     L2
+L1:
+        .space  128
+L2:
+        ret
@@ -0,0 +1,23 @@
+; RUN: opt -S -O2 -threads=2 < %s | FileCheck %s
+
+; The address of a block of @target is taken by @taker, so the SCCs of the
+; module cannot be optimized apart and the call graph SCC passes run on one
+; thread.
+
+; CHECK-LABEL: define i8* @taker()
+; CHECK: ret i8* blockaddress(@target, %dest)
+
+; CHECK-LABEL: define i32 @target(
+; CHECK: ret i32 1
+
+define i8* @taker() {
+  ret i8* blockaddress(@target, %dest)
+}
+
+define i32 @target(i8* %p) {
+entry:
+  indirectbr i8* %p, [label %dest]
+
+dest:
+  ret i32 1
+}
@@ -0,0 +1,106 @@
+; RUN: opt -S -O2 < %s | FileCheck %s -check-prefix=SERIAL
+; RUN: opt -S -O2 -threads=2 < %s | FileCheck %s -check-prefix=PARALLEL
+
+; The local functions are external while the SCCs are optimized on several
+; threads, so the inliner does not know that a call is the last one to a
+; local function, and does not delete the callees it has inlined. A local
+; function too big to be inlined otherwise is kept and called.
+
+; SERIAL-NOT: @big()
+; SERIAL-LABEL: define void @caller()
+; SERIAL: store volatile i32 79, i32* @sink
+
+; PARALLEL-LABEL: define internal {{.*}}void @big()
+; PARALLEL-LABEL: define void @caller()
+; PARALLEL: call {{.*}}void @big()
+
+@sink = global i32 0
+
+define internal void @big() {
+  store volatile i32 0, i32* @sink
+  store volatile i32 1, i32* @sink
+  store volatile i32 2, i32* @sink
+  store volatile i32 3, i32* @sink
+  store volatile i32 4, i32* @sink
+  store volatile i32 5, i32* @sink
+  store volatile i32 6, i32* @sink
+  store volatile i32 7, i32* @sink
+  store volatile i32 8, i32* @sink
+  store volatile i32 9, i32* @sink
+  store volatile i32 10, i32* @sink
+  store volatile i32 11, i32* @sink
+  store volatile i32 12, i32* @sink
+  store volatile i32 13, i32* @sink
+  store volatile i32 14, i32* @sink
+  store volatile i32 15, i32* @sink
+  store volatile i32 16, i32* @sink
+  store volatile i32 17, i32* @sink
+  store volatile i32 18, i32* @sink
+  store volatile i32 19, i32* @sink
+  store volatile i32 20, i32* @sink
+  store volatile i32 21, i32* @sink
+  store volatile i32 22, i32* @sink
+  store volatile i32 23, i32* @sink
+  store volatile i32 24, i32* @sink
+  store volatile i32 25, i32* @sink
+  store volatile i32 26, i32* @sink
+  store volatile i32 27, i32* @sink
+  store volatile i32 28, i32* @sink
+  store volatile i32 29, i32* @sink
+  store volatile i32 30, i32* @sink
+  store volatile i32 31, i32* @sink
+  store volatile i32 32, i32* @sink
+  store volatile i32 33, i32* @sink
+  store volatile i32 34, i32* @sink
+  store volatile i32 35, i32* @sink
+  store volatile i32 36, i32* @sink
+  store volatile i32 37, i32* @sink
+  store volatile i32 38, i32* @sink
+  store volatile i32 39, i32* @sink
+  store volatile i32 40, i32* @sink
+  store volatile i32 41, i32* @sink
+  store volatile i32 42, i32* @sink
+  store volatile i32 43, i32* @sink
+  store volatile i32 44, i32* @sink
+  store volatile i32 45, i32* @sink
+  store volatile i32 46, i32* @sink
+  store volatile i32 47, i32* @sink
+  store volatile i32 48, i32* @sink
+  store volatile i32 49, i32* @sink
+  store volatile i32 50, i32* @sink
+  store volatile i32 51, i32* @sink
+  store volatile i32 52, i32* @sink
+  store volatile i32 53, i32* @sink
+  store volatile i32 54, i32* @sink
+  store volatile i32 55, i32* @sink
+  store volatile i32 56, i32* @sink
+  store volatile i32 57, i32* @sink
+  store volatile i32 58, i32* @sink
+  store volatile i32 59, i32* @sink
+  store volatile i32 60, i32* @sink
+  store volatile i32 61, i32* @sink
+  store volatile i32 62, i32* @sink
+  store volatile i32 63, i32* @sink
+  store volatile i32 64, i32* @sink
+  store volatile i32 65, i32* @sink
+  store volatile i32 66, i32* @sink
+  store volatile i32 67, i32* @sink
+  store volatile i32 68, i32* @sink
+  store volatile i32 69, i32* @sink
+  store volatile i32 70, i32* @sink
+  store volatile i32 71, i32* @sink
+  store volatile i32 72, i32* @sink
+  store volatile i32 73, i32* @sink
+  store volatile i32 74, i32* @sink
+  store volatile i32 75, i32* @sink
+  store volatile i32 76, i32* @sink
+  store volatile i32 77, i32* @sink
+  store volatile i32 78, i32* @sink
+  store volatile i32 79, i32* @sink
+  ret void
+}
+
+define void @caller() {
+  call void @big()
+  ret void
+}
@@ -0,0 +1,92 @@
+; RUN: opt -S -O2 -threads=4 < %s > %t.1.ll
+; RUN: opt -S -O2 -threads=4 < %s > %t.2.ll
+; RUN: diff %t.1.ll %t.2.ll
+; RUN: opt -S -O2 -threads=2 < %s > %t.3.ll
+; RUN: diff %t.1.ll %t.3.ll
+; RUN: FileCheck %s < %t.1.ll
+; RUN: FileCheck %s -check-prefix=MID < %t.1.ll
+; RUN: FileCheck %s -check-prefix=TOP < %t.1.ll
+
+; With several threads, the SCCs of the call graph are optimized bottom-up on
+; the threads, each in a module of its own. The callees are inlined with their
+; optimized bodies, loads from constants still fold, the local globals are not
+; duplicated, and the functions keep their linkage and comdat. The output
+; does not depend on the number of threads, even when there are fewer threads
+; than the six SCCs of the module.
+
+; CHECK: @counter = internal unnamed_addr global i32 0
+; CHECK-NOT: @counter{{.*}} = 
+
+$helper = comdat any
+
+@counter = internal global i32 0
+@table = private unnamed_addr constant [2 x i32] [i32 10, i32 20]
+
+define internal i32 @leaf(i32 %x) {
+  %v = load i32* @counter
+  %n = add i32 %v, %x
+  store i32 %n, i32* @counter
+  ret i32 %n
+}
+
+define i32 @mid(i32 %x) {
+  %a = call i32 @leaf(i32 %x)
+  %p = getelementptr [2 x i32]* @table, i32 0, i32 1
+  %t = load i32* %p
+  %r = add i32 %a, %t
+  ret i32 %r
+}
+
+define linkonce_odr i32 @helper(i32 %x) noinline comdat $helper {
+  %r = mul i32 %x, 7
+  ret i32 %r
+}
+
+define weak i32 @hook(i32 %x) {
+  ret i32 %x
+}
+
+define i32 @even(i32 %n) {
+  %z = icmp eq i32 %n, 0
+  br i1 %z, label %yes, label %no
+yes:
+  ret i32 1
+no:
+  %m = sub i32 %n, 1
+  %r = call i32 @odd(i32 %m)
+  ret i32 %r
+}
+
+define i32 @odd(i32 %n) {
+  %z = icmp eq i32 %n, 0
+  br i1 %z, label %yes, label %no
+yes:
+  ret i32 0
+no:
+  %m = sub i32 %n, 1
+  %r = call i32 @even(i32 %m)
+  ret i32 %r
+}
+
+define i32 @top(i32 %x) {
+  %a = call i32 @mid(i32 %x)
+  %h = call i32 @hook(i32 %a)
+  %e = call i32 @even(i32 %h)
+  %k = call i32 @helper(i32 %e)
+  ret i32 %k
+}
+
+; CHECK-NOT: define internal i32 @leaf
+; CHECK-DAG: define linkonce_odr i32 @helper(i32 %x) #{{[0-9]+}} comdat $helper
+; A function which may be overridden gets no attributes.
+; CHECK-DAG: define weak i32 @hook(i32 %x) {
+
+; MID-LABEL: define i32 @mid(i32 %x)
+; MID: load i32* @counter
+; MID: add i32 %{{.*}}, 20
+
+; TOP-LABEL: define i32 @top(i32 %x)
+; TOP-NOT: call i32 @mid
+; TOP: load i32* @counter
+; TOP: call i32 @hook
+; TOP: call i32 @helper
@@ -0,0 +1,40 @@
+; RUN: opt -S -O1 -threads=3 < %s | FileCheck %s
+
+; Aliases of aliases and of constant expressions, and appending globals used
+; by code, survive the split of the module into partitions.
+
+; CHECK-DAG: @table = appending global [1 x i32] [i32 7]
+; CHECK-DAG: @inner = alias void ()* @target
+; CHECK-DAG: @outer = alias void ()* @target
+; CHECK-DAG: @second = alias getelementptr inbounds ([2 x i32]* @pair, i32 0, i32 1)
+
+@table = appending global [1 x i32] [i32 7]
+@pair = global [2 x i32] [i32 1, i32 2]
+
+@inner = alias void ()* @target
+@outer = alias void ()* @inner
+@second = alias getelementptr inbounds ([2 x i32]* @pair, i32 0, i32 1)
+
+define void @target() {
+  ret void
+}
+
+; CHECK-LABEL: define i32 @read_table()
+; CHECK: load i32* getelementptr inbounds ([1 x i32]* @table, i32 0, i32 0)
+define i32 @read_table() {
+  %p = getelementptr [1 x i32]* @table, i32 0, i32 0
+  %v = load i32* %p
+  ret i32 %v
+}
+
+define void @call_outer() {
+  call void @outer()
+  ret void
+}
+
+; CHECK-LABEL: define i32 @read_second()
+; CHECK: load i32* @second
+define i32 @read_second() {
+  %v = load i32* @second
+  ret i32 %v
+}
@@ -0,0 +1,44 @@
+; RUN: opt -S -O1 -threads=2 < %s | FileCheck %s
+
+; The per-function passes of -O1 run on two threads. Every function is
+; optimized, and the special globals and metadata survive the round trip.
+
+; CHECK: @llvm.global_ctors = appending global
+; CHECK-SAME: @init
+; CHECK-NOT: @llvm.global_ctors
+; CHECK-DAG: define i32 @foo(i32 %a)
+; CHECK-DAG: define i32 @bar(i32 %a)
+; CHECK-NOT: alloca
+; CHECK: !llvm.ident = !{![[IDENT:[0-9]+]]}
+; CHECK-NOT: !llvm.ident
+; CHECK: ![[IDENT]] = metadata !{metadata !"test"}
+
+@llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @init, i8* null }]
+@g = global i32 0
+
+define internal void @init() {
+entry:
+  store i32 1, i32* @g
+  ret void
+}
+
+define i32 @foo(i32 %a) {
+entry:
+  %x = alloca i32
+  store i32 %a, i32* %x
+  %v = load i32* %x
+  %r = add i32 %v, 1
+  ret i32 %r
+}
+
+define i32 @bar(i32 %a) {
+entry:
+  %x = alloca i32
+  store i32 %a, i32* %x
+  %v = load i32* %x
+  %r = mul i32 %v, 3
+  ret i32 %r
+}
+
+!llvm.ident = !{!0}
+!0 = metadata !{metadata !"test"}
@@ -0,0 +1,58 @@
+; RUN: opt < %s -basicaa -dse -dse-use-memoryssa -S | FileCheck %s
+
+; DSE answering its dependence queries with MemorySSA.
+
+define void @overwrite(i32* %p, i32* noalias %q) {
+; CHECK-LABEL: @overwrite(
+; CHECK-NEXT: store i32 2, i32* %q
+; CHECK-NEXT: store i32 3, i32* %p
+; CHECK-NEXT: ret void
+  store i32 1, i32* %p
+  store i32 2, i32* %q
+  store i32 3, i32* %p
+  ret void
+}
+
+define i32 @read_between(i32* %p) {
+; CHECK-LABEL: @read_between(
+; CHECK-NEXT: store i32 1, i32* %p
+; CHECK-NEXT: %v = load i32* %p
+; CHECK-NEXT: store i32 3, i32* %p
+  store i32 1, i32* %p
+  %v = load i32* %p
+  store i32 3, i32* %p
+  ret i32 %v
+}
+
+define void @store_of_load(i32* %p, i32* noalias %q) {
+; CHECK-LABEL: @store_of_load(
+; CHECK-NEXT: store i32 1, i32* %q
+; CHECK-NEXT: ret void
+  %v = load i32* %p
+  store i32 1, i32* %q
+  store i32 %v, i32* %p
+  ret void
+}
+
+define void @store_of_clobbered_load(i32* %p, i32* %q) {
+; CHECK-LABEL: @store_of_clobbered_load(
+; CHECK-NEXT: %v = load i32* %p
+; CHECK-NEXT: store i32 1, i32* %q
+; CHECK-NEXT: store i32 %v, i32* %p
+  %v = load i32* %p
+  store i32 1, i32* %q
+  store i32 %v, i32* %p
+  ret void
+}
+
+; The chain of dead stores is removed one after the other, keeping MemorySSA
+; up to date.
+define void @chain(i32* %p) {
+; CHECK-LABEL: @chain(
+; CHECK-NEXT: store i32 3, i32* %p
+; CHECK-NEXT: ret void
+  store i32 1, i32* %p
+  store i32 2, i32* %p
+  store i32 3, i32* %p
+  ret void
+}
@@ -0,0 +1,83 @@
+; RUN: opt < %s -basicaa -gvn -gvn-use-memoryssa -S | FileCheck %s
+
+; GVN finding the clobbers of loads with MemorySSA.
+
+declare void @clobber()
+declare void @readonly() readonly
+
+define i32 @store_forward(i32* %p, i32* noalias %q) {
+; CHECK-LABEL: @store_forward(
+; CHECK-NOT: load
+; CHECK: ret i32 1
+  store i32 1, i32* %p
+  store i32 2, i32* %q
+  %v = load i32* %p
+  ret i32 %v
+}
+
+; The store dominates the load through a loop which does not write %p.
+define i32 @store_forward_loop(i32* %p, i32* noalias %q, i32 %n) {
+; CHECK-LABEL: @store_forward_loop(
+; CHECK: exit:
+; CHECK-NOT: load
+; CHECK: ret i32 7
+entry:
+  store i32 7, i32* %p
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  store i32 %i, i32* %q
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %v = load i32* %p
+  ret i32 %v
+}
+
+define i32 @load_load(i32* %p) {
+; CHECK-LABEL: @load_load(
+; CHECK: %a = load i32* %p
+; CHECK-NOT: load
+; CHECK: ret
+  %a = load i32* %p
+  call void @readonly()
+  %b = load i32* %p
+  %c = add i32 %a, %b
+  ret i32 %c
+}
+
+define i32 @clobbered(i32* %p) {
+; CHECK-LABEL: @clobbered(
+; CHECK: %a = load i32* %p
+; CHECK: call void @clobber()
+; CHECK: %b = load i32* %p
+  %a = load i32* %p
+  call void @clobber()
+  %b = load i32* %p
+  %c = add i32 %a, %b
+  ret i32 %c
+}
+
+define i32 @diamond(i1 %c, i32* %p) {
+; CHECK-LABEL: @diamond(
+; CHECK: join:
+; CHECK-NEXT: %v = phi i32
+; CHECK-NOT: load
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 1, i32* %p
+  br label %join
+
+else:
+  store i32 2, i32* %p
+  br label %join
+
+join:
+  %v = load i32* %p
+  ret i32 %v
+}
@@ -0,0 +1,91 @@
+; RUN: opt < %s -loop-unswitch -verify-dom-updates -verify-loop-info -S \
+; RUN:   | FileCheck %s
+; RUN: opt < %s -loop-unswitch -licm -verify-dom-info -disable-output
+
+; Loop unswitching updates the dominator tree as it changes the CFG, rather
+; than recalculating it. -verify-dom-updates checks every update.
+
+declare void @f()
+declare void @g()
+
+; The loop exits early on %c, which is hoisted out of the loop.
+; CHECK-LABEL: @trivial(
+; CHECK: entry:
+; CHECK: br i1 %c,
+define void @trivial(i1 %c, i32 %n) {
+entry:
+  br label %header
+
+header:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  br i1 %c, label %latch, label %exit
+
+latch:
+  call void @f()
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %header
+
+exit:
+  ret void
+}
+
+; The loop is duplicated for both values of %c.
+; CHECK-LABEL: @nontrivial(
+; CHECK: header.us:
+; CHECK: header:
+define void @nontrivial(i1 %c, i32 %n) {
+entry:
+  br label %header
+
+header:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  br i1 %c, label %then, label %else
+
+then:
+  call void @f()
+  br label %latch
+
+else:
+  call void @g()
+  br label %latch
+
+latch:
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %header
+
+exit:
+  ret void
+}
+
+; Unswitching a switch leaves a dead case behind an unreachable block.
+; CHECK-LABEL: @switch(
+; CHECK: us-unreachable
+define void @switch(i32 %x, i32 %n) {
+entry:
+  br label %header
+
+header:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  switch i32 %x, label %latch [
+    i32 1, label %one
+    i32 2, label %two
+  ]
+
+one:
+  call void @f()
+  br label %latch
+
+two:
+  call void @g()
+  br label %latch
+
+latch:
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %header
+
+exit:
+  ret void
+}
@@ -0,0 +1,52 @@
+; RUN: opt < %s -basicaa -memcpyopt -memcpyopt-use-memoryssa -S | FileCheck %s
+
+; MemCpyOpt finding the memcpy feeding a memcpy with MemorySSA, which also
+; looks across blocks.
+
+declare void @llvm.memcpy.p0i8.p0i8.i64(i8* nocapture, i8* nocapture readonly, i64, i32, i1)
+
+define void @memcpy_memcpy(i8* noalias %a, i8* noalias %b, i8* noalias %c) {
+; CHECK-LABEL: @memcpy_memcpy(
+; CHECK: call void @llvm.memcpy.p0i8.p0i8.i64(i8* %b, i8* %a, i64 16, i32 1, i1 false)
+; CHECK: call void @llvm.memcpy.p0i8.p0i8.i64(i8* %c, i8* %a, i64 16, i32 1, i1 false)
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %b, i8* %a, i64 16, i32 1, i1 false)
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %c, i8* %b, i64 16, i32 1, i1 false)
+  ret void
+}
+
+define void @across_blocks(i1 %cond, i8* noalias %a, i8* noalias %b,
+                           i8* noalias %c, i32* noalias %d) {
+; CHECK-LABEL: @across_blocks(
+; CHECK: next:
+; CHECK: call void @llvm.memcpy.p0i8.p0i8.i64(i8* %c, i8* %a, i64 16, i32 1, i1 false)
+entry:
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %b, i8* %a, i64 16, i32 1, i1 false)
+  br i1 %cond, label %then, label %next
+
+then:
+  store i32 0, i32* %d
+  br label %next
+
+next:
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %c, i8* %b, i64 16, i32 1, i1 false)
+  ret void
+}
+
+; The source of the first memcpy is written on one path to the second.
+define void @source_changed(i1 %cond, i8* noalias %a, i8* noalias %b,
+                            i8* noalias %c) {
+; CHECK-LABEL: @source_changed(
+; CHECK: next:
+; CHECK: call void @llvm.memcpy.p0i8.p0i8.i64(i8* %c, i8* %b, i64 16, i32 1, i1 false)
+entry:
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %b, i8* %a, i64 16, i32 1, i1 false)
+  br i1 %cond, label %then, label %next
+
+then:
+  store i8 0, i8* %a
+  br label %next
+
+next:
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %c, i8* %b, i64 16, i32 1, i1 false)
+  ret void
+}
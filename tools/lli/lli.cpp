@@ -20,6 +20,7 @@
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Interpreter.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
@@ -158,6 +159,18 @@ namespace {
                            "(must be user writable)"),
                   cl::init(""));
 
+  cl::opt<std::string>
+  CacheDir("cache-dir",
+           cl::desc("Reuse the objects compiled for identical modules by "
+                    "earlier runs, stored in this directory"),
+           cl::value_desc("directory"), cl::init(""));
+
+  cl::opt<unsigned long long>
+  CacheSizeLimit("cache-size-limit",
+                 cl::desc("Maximum size in bytes of the objects kept in "
+                          "-cache-dir (0 = no limit)"),
+                 cl::init(0));
+
   cl::opt<std::string>
   FakeArgv0("fake-argv0",
             cl::desc("Override the 'argv[0]' value passed into the executing"
@@ -172,6 +185,20 @@ namespace {
                   cl::desc("Disable JIT lazy compilation"),
                   cl::init(false));
 
+  cl::opt<bool>
+  LazyFunctionStubs("lazy-function-stubs",
+                    cl::desc("Compile every function of the program with "
+                             "MCJIT on its first call, through a stub"),
+                    cl::init(false));
+
+  cl::opt<unsigned>
+  TierUpCallCount("tier-up-call-count",
+                  cl::desc("With -lazy-function-stubs, compile functions "
+                           "without optimization first, and again in the "
+                           "background once called this many times "
+                           "(0 = off)"),
+                  cl::init(0));
+
   cl::opt<Reloc::Model>
   RelocModel("relocation-model",
              cl::desc("Choose relocation model"),
@@ -316,7 +343,7 @@ private:
 };
 
 static ExecutionEngine *EE = nullptr;
-static LLIObjectCache *CacheManager = nullptr;
+static ObjectCache *CacheManager = nullptr;
 
 static void do_shutdown() {
   // Cygwin-1.5 invokes DLL's dtors before atexit handler.
@@ -481,6 +508,12 @@ int main(int argc, char **argv, char * const *envp) {
 
   builder.setTargetOptions(Options);
 
+  if (LazyFunctionStubs && RemoteMCJIT) {
+    errs() << "warning: remote mcjit does not support lazy function stubs\n";
+    LazyFunctionStubs = false;
+  }
+  builder.setLazyFunctionStubs(LazyFunctionStubs);
+
   EE = builder.create();
   if (!EE) {
     if (!ErrorMsg.empty())
@@ -493,6 +526,16 @@ int main(int argc, char **argv, char * const *envp) {
   if (EnableCacheManager) {
     CacheManager = new LLIObjectCache(ObjectCacheDir);
     EE->setObjectCache(CacheManager);
+  } else if (!CacheDir.empty()) {
+    TargetMachine *TM = EE->getTargetMachine();
+    if (!TM) {
+      errs() << argv[0] << ": -cache-dir requires MCJIT\n";
+      exit(1);
+    }
+    FileObjectCache *Cache = new FileObjectCache(CacheDir, *TM);
+    Cache->setMaxSize(CacheSizeLimit);
+    CacheManager = Cache;
+    EE->setObjectCache(CacheManager);
   }
 
   // Load any additional modules specified on the command line.
@@ -561,6 +604,8 @@ int main(int argc, char **argv, char * const *envp) {
     NoLazyCompilation = true;
   }
   EE->DisableLazyCompilation(NoLazyCompilation);
+  if (LazyFunctionStubs)
+    EE->setTieredCompilation(TierUpCallCount);
 
   // If the user specifically requested an argv[0] to pass into the program,
   // do it now.
@@ -12,6 +12,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Object/Archive.h"
@@ -25,6 +26,7 @@
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -65,6 +67,11 @@ static void failIfError(std::error_code EC, Twine Context = "") {
   fail(Context + ": " + EC.message());
 }
 
+static cl::opt<unsigned>
+Threads("threads", cl::init(1),
+        cl::desc("Number of threads reading the symbols of new members "
+                 "(0 = all cores)"));
+
 // llvm-ar/llvm-ranlib remaining positional arguments.
 static cl::list<std::string>
 RestOfArgs(cl::Positional, cl::OneOrMore,
@@ -684,26 +691,117 @@ static void writeStringTable(raw_fd_ostream &Out,
   Out.seek(Pos);
 }
 
+namespace {
+/// The symbols a member contributes to the archive symbol table.
+struct MemberSymbols {
+  MemberSymbols() : IsSymbolic(false) {}
+  /// Whether the member is an object or bitcode file. Only those get entries,
+  /// but any of them makes the archive get a symbol table.
+  bool IsSymbolic;
+  std::vector<std::string> Names;
+  std::error_code Error;
+};
+}
+
+static void readMemberSymbols(MemoryBufferRef MemberBuffer,
+                              LLVMContext &Context, MemberSymbols &Result) {
+  ErrorOr<std::unique_ptr<object::SymbolicFile>> ObjOrErr =
+      object::SymbolicFile::createSymbolicFile(
+          MemberBuffer, sys::fs::file_magic::unknown, &Context);
+  if (!ObjOrErr)
+    return; // FIXME: check only for "not an object file" errors.
+  object::SymbolicFile &Obj = *ObjOrErr.get();
+  Result.IsSymbolic = true;
+
+  std::string NameBuf;
+  raw_string_ostream NameOS(NameBuf);
+  for (const object::BasicSymbolRef &S : Obj.symbols()) {
+    uint32_t Symflags = S.getFlags();
+    if (Symflags & object::SymbolRef::SF_FormatSpecific)
+      continue;
+    if (!(Symflags & object::SymbolRef::SF_Global))
+      continue;
+    if (Symflags & object::SymbolRef::SF_Undefined)
+      continue;
+    if ((Result.Error = S.printName(NameOS)))
+      return;
+    Result.Names.push_back(NameOS.str());
+    NameBuf.clear();
+  }
+}
+
+/// Compute the symbols of every member. Unchanged members take their entries
+/// from the symbol table of \p OldArchive, if it has one; the others are read,
+/// on several threads if requested.
+static std::vector<MemberSymbols>
+computeMemberSymbols(object::Archive *OldArchive,
+                     ArrayRef<NewArchiveIterator> Members,
+                     ArrayRef<MemoryBufferRef> Buffers) {
+  std::vector<MemberSymbols> Result(Members.size());
+
+  DenseMap<const char *, std::vector<std::string>> OldSymbols;
+  if (OldArchive && OldArchive->hasSymbolTable()) {
+    for (object::Archive::symbol_iterator I = OldArchive->symbol_begin(),
+                                          E = OldArchive->symbol_end();
+         I != E; ++I) {
+      ErrorOr<object::Archive::child_iterator> MemberOrErr = I->getMember();
+      if (MemberOrErr.getError())
+        continue;
+      const char *Key = (*MemberOrErr)->getBuffer().begin();
+      OldSymbols[Key].push_back(I->getName());
+    }
+  }
+
+  std::vector<unsigned> ToRead;
+  for (unsigned I = 0, N = Members.size(); I != N; ++I) {
+    if (!Members[I].isNewMember()) {
+      auto Old = OldSymbols.find(Members[I].getOld()->getBuffer().begin());
+      if (Old != OldSymbols.end()) {
+        Result[I].IsSymbolic = true;
+        Result[I].Names = std::move(Old->second);
+        continue;
+      }
+    }
+    ToRead.push_back(I);
+  }
+
+  if (Threads == 1 || ToRead.size() < 2) {
+    for (unsigned I : ToRead)
+      readMemberSymbols(Buffers[I], getGlobalContext(), Result[I]);
+    return Result;
+  }
+
+  // LLVMContext is not thread safe, so every thread reads bitcode members in
+  // a context of its own.
+  ThreadPool Pool(Threads);
+  std::vector<std::unique_ptr<LLVMContext>> Contexts(Pool.getThreadCount() +
+                                                     1);
+  for (unsigned I : ToRead)
+    Pool.async([&, I] {
+      std::unique_ptr<LLVMContext> &Context =
+          Contexts[Pool.getThreadIndex()];
+      if (!Context)
+        Context.reset(new LLVMContext());
+      readMemberSymbols(Buffers[I], *Context, Result[I]);
+    });
+  Pool.wait();
+  return Result;
+}
+
 static void
-writeSymbolTable(raw_fd_ostream &Out, ArrayRef<NewArchiveIterator> Members,
-                 ArrayRef<MemoryBufferRef> Buffers,
+writeSymbolTable(raw_fd_ostream &Out, ArrayRef<MemberSymbols> Symbols,
                  std::vector<std::pair<unsigned, unsigned>> &MemberOffsetRefs) {
   unsigned StartOffset = 0;
   unsigned MemberNum = 0;
   std::string NameBuf;
   raw_string_ostream NameOS(NameBuf);
   unsigned NumSyms = 0;
-  LLVMContext &Context = getGlobalContext();
-  for (ArrayRef<NewArchiveIterator>::iterator I = Members.begin(),
-                                              E = Members.end();
+  for (ArrayRef<MemberSymbols>::iterator I = Symbols.begin(),
+                                         E = Symbols.end();
        I != E; ++I, ++MemberNum) {
-    MemoryBufferRef MemberBuffer = Buffers[MemberNum];
-    ErrorOr<std::unique_ptr<object::SymbolicFile>> ObjOrErr =
-        object::SymbolicFile::createSymbolicFile(
-            MemberBuffer, sys::fs::file_magic::unknown, &Context);
-    if (!ObjOrErr)
-      continue;  // FIXME: check only for "not an object file" errors.
-    object::SymbolicFile &Obj = *ObjOrErr.get();
+    if (!I->IsSymbolic)
+      continue;
+    failIfError(I->Error);
 
     if (!StartOffset) {
       printMemberHeader(Out, "", sys::TimeValue::now(), 0, 0, 0, 0);
@@ -711,16 +809,8 @@ writeSymbolTable(raw_fd_ostream &Out, ArrayRef<NewArchiveIterator> Members,
       print32BE(Out, 0);
     }
 
-    for (const object::BasicSymbolRef &S : Obj.symbols()) {
-      uint32_t Symflags = S.getFlags();
-      if (Symflags & object::SymbolRef::SF_FormatSpecific)
-        continue;
-      if (!(Symflags & object::SymbolRef::SF_Global))
-        continue;
-      if (Symflags & object::SymbolRef::SF_Undefined)
-        continue;
-      failIfError(S.printName(NameOS));
-      NameOS << '\0';
+    for (const std::string &Name : I->Names) {
+      NameOS << Name << '\0';
       ++NumSyms;
       MemberOffsetRefs.push_back(std::make_pair(Out.tell(), MemberNum));
       print32BE(Out, 0);
@@ -785,7 +875,10 @@ static void performWriteOperation(ArchiveOperation Operation,
   }
 
   if (Symtab) {
-    writeSymbolTable(Out, NewMembers, Members, MemberOffsetRefs);
+    // A symbol table being created from scratch must not trust the old one.
+    std::vector<MemberSymbols> Symbols = computeMemberSymbols(
+        Operation == CreateSymTab ? nullptr : OldArchive, NewMembers, Members);
+    writeSymbolTable(Out, Symbols, MemberOffsetRefs);
   }
 
   std::vector<unsigned> StringMapIndexes;
@@ -28,6 +28,7 @@
 #include "llvm/Support/SystemUtils.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include <memory>
+#include <vector>
 using namespace llvm;
 
 static cl::list<std::string>
@@ -48,6 +49,11 @@ OutputAssembly("S",
 static cl::opt<bool>
 Verbose("v", cl::desc("Print information about actions taken"));
 
+static cl::opt<bool>
+OnlyNeeded("only-needed",
+           cl::desc("Link in from the other inputs only the definitions that "
+                    "the first one needs"));
+
 static cl::opt<bool>
 DumpAsm("d", cl::desc("Print assembly as linked"), cl::Hidden);
 
@@ -69,6 +75,46 @@ loadFile(const char *argv0, const std::string &FN, LLVMContext &Context) {
   return Result;
 }
 
+// Read the specified bitcode file in without its function bodies, which are
+// read later on if needed.
+static std::unique_ptr<Module>
+loadLazyFile(const char *argv0, const std::string &FN, LLVMContext &Context) {
+  SMDiagnostic Err;
+  if (Verbose) errs() << "Loading '" << FN << "' lazily\n";
+  std::unique_ptr<Module> Result = getLazyIRFileModule(FN, Err, Context);
+  if (!Result)
+    Err.print(argv0, errs());
+
+  return Result;
+}
+
+// Link into L the definitions it needs from all the inputs but the first.
+// Only the declarations of the inputs are read before it is known which
+// function bodies are needed.
+static bool linkNeededDefinitions(const char *argv0, Linker &L,
+                                  LLVMContext &Context) {
+  std::vector<std::unique_ptr<Module>> Modules;
+  std::vector<Module *> Srcs;
+  for (unsigned i = 1; i < InputFilenames.size(); ++i) {
+    Modules.push_back(loadLazyFile(argv0, InputFilenames[i], Context));
+    if (!Modules.back()) {
+      errs() << argv0 << ": error loading file '" << InputFilenames[i]
+             << "'\n";
+      return true;
+    }
+    Srcs.push_back(Modules.back().get());
+  }
+
+  if (Verbose) errs() << "Linking in the needed definitions\n";
+
+  std::string ErrorMessage;
+  if (L.linkInNeededDefinitions(Srcs, &ErrorMessage)) {
+    errs() << argv0 << ": link error: " << ErrorMessage << "\n";
+    return true;
+  }
+  return false;
+}
+
 int main(int argc, char **argv) {
   // Print a stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal();
@@ -90,19 +136,25 @@ int main(int argc, char **argv) {
   }
 
   Linker L(Composite.get(), SuppressWarnings);
-  for (unsigned i = BaseArg+1; i < InputFilenames.size(); ++i) {
-    std::unique_ptr<Module> M = loadFile(argv[0], InputFilenames[i], Context);
-    if (!M.get()) {
-      errs() << argv[0] << ": error loading file '" <<InputFilenames[i]<< "'\n";
-      return 1;
-    }
-
-    if (Verbose) errs() << "Linking in '" << InputFilenames[i] << "'\n";
-
-    if (L.linkInModule(M.get(), &ErrorMessage)) {
-      errs() << argv[0] << ": link error in '" << InputFilenames[i]
-             << "': " << ErrorMessage << "\n";
+  if (OnlyNeeded) {
+    if (linkNeededDefinitions(argv[0], L, Context))
       return 1;
+  } else {
+    for (unsigned i = BaseArg+1; i < InputFilenames.size(); ++i) {
+      std::unique_ptr<Module> M = loadFile(argv[0], InputFilenames[i], Context);
+      if (!M.get()) {
+        errs() << argv[0] << ": error loading file '" << InputFilenames[i]
+               << "'\n";
+        return 1;
+      }
+
+      if (Verbose) errs() << "Linking in '" << InputFilenames[i] << "'\n";
+
+      if (L.linkInModule(M.get(), &ErrorMessage)) {
+        errs() << argv[0] << ": link error in '" << InputFilenames[i]
+               << "': " << ErrorMessage << "\n";
+        return 1;
+      }
     }
   }
 
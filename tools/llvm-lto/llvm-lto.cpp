@@ -12,6 +12,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
@@ -38,6 +40,10 @@ static cl::opt<bool>
 DisableGVNLoadPRE("disable-gvn-loadpre", cl::init(false),
   cl::desc("Do not run the GVN load PRE pass"));
 
+static cl::opt<unsigned>
+Parallelism("j", cl::Prefix, cl::init(1),
+  cl::desc("Number of code generation units to compile in parallel"));
+
 static cl::list<std::string>
 InputFilenames(cl::Positional, cl::OneOrMore,
   cl::desc("<input bitcode files>"));
@@ -154,7 +160,31 @@ int main(int argc, char **argv) {
   if (!attrs.empty())
     CodeGen.setAttr(attrs.c_str());
 
-  if (!OutputFilename.empty()) {
+  if (!OutputFilename.empty() && Parallelism > 1) {
+    // Write the object file for code generation unit I to <output>.I.
+    std::vector<std::unique_ptr<raw_fd_ostream>> FileStreams;
+    std::vector<raw_ostream *> Outs;
+    for (unsigned I = 0; I != Parallelism; ++I) {
+      std::string PartFilename = OutputFilename + "." + utostr(I);
+      std::error_code EC;
+      FileStreams.push_back(
+          make_unique<raw_fd_ostream>(PartFilename, EC, sys::fs::F_None));
+      if (EC) {
+        errs() << argv[0] << ": error opening the file '" << PartFilename
+               << "': " << EC.message() << "\n";
+        return 1;
+      }
+      Outs.push_back(FileStreams.back().get());
+    }
+
+    std::string ErrorInfo;
+    if (!CodeGen.compileParallel(Outs, DisableOpt, DisableInline,
+                                 DisableGVNLoadPRE, ErrorInfo)) {
+      errs() << argv[0]
+             << ": error compiling the code: " << ErrorInfo << "\n";
+      return 1;
+    }
+  } else if (!OutputFilename.empty()) {
     size_t len = 0;
     std::string ErrorInfo;
     const void *Code = CodeGen.compile(&len, DisableOpt, DisableInline,
@@ -174,7 +204,7 @@ int main(int argc, char **argv) {
     }
 
     FileStream.write(reinterpret_cast<const char *>(Code), len);
-  } else {
+  } else if (Parallelism <= 1) {
     std::string ErrorInfo;
     const char *OutputName = nullptr;
     if (!CodeGen.compile_to_file(&OutputName, DisableOpt, DisableInline,
@@ -186,6 +216,23 @@ int main(int argc, char **argv) {
     }
 
     outs() << "Wrote native object file '" << OutputName << "'\n";
+  } else {
+    CodeGen.setCodeGenParallelism(Parallelism);
+
+    std::string ErrorInfo;
+    const char **OutputNames = nullptr;
+    unsigned NumOutputs = 0;
+    if (!CodeGen.compile_to_files(&OutputNames, &NumOutputs, DisableOpt,
+                                  DisableInline, DisableGVNLoadPRE,
+                                  ErrorInfo)) {
+      errs() << argv[0]
+             << ": error compiling the code: " << ErrorInfo
+             << "\n";
+      return 1;
+    }
+
+    for (unsigned I = 0; I != NumOutputs; ++I)
+      outs() << "Wrote native object file '" << OutputNames[I] << "'\n";
   }
 
   return 0;
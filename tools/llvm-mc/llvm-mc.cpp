@@ -19,6 +19,7 @@
 #include "llvm/MC/MCInstPrinter.h"
 #include "llvm/MC/MCInstrInfo.h"
 #include "llvm/MC/MCObjectFileInfo.h"
+#include "llvm/MC/MCObjectStreamer.h"
 #include "llvm/MC/MCParser/AsmLexer.h"
 #include "llvm/MC/MCRegisterInfo.h"
 #include "llvm/MC/MCSectionMachO.h"
@@ -474,6 +475,8 @@ int main(int argc, char **argv) {
     Str.reset(TheTarget->createMCObjectStreamer(TripleName, Ctx, *MAB,
                                                 FOS, CE, *STI, RelaxAll,
                                                 NoExecStack));
+    static_cast<MCObjectStreamer &>(*Str).getAssembler()
+        .setRelocationThreads(MCOptions.MCRelocationThreads);
   }
 
   int Res = 1;
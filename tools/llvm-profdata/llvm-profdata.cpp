@@ -11,17 +11,25 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/ProfileData/InstrProfWriter.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/LineIterator.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <queue>
 
 using namespace llvm;
 
@@ -33,18 +41,282 @@ static void exitWithError(const Twine &Message, StringRef Whence = "") {
   ::exit(1);
 }
 
+namespace {
+/// A profile to merge, with the factor its counts are multiplied by.
+struct WeightedFile {
+  std::string Filename;
+  uint64_t Weight;
+};
+
+/// The state of one of the threads of a merge.
+struct MergeContext {
+  std::unique_ptr<InstrProfWriter> Writer;
+  /// Temporary files holding the counts that did not fit in memory, in input
+  /// order. See spillWriter for their format.
+  std::vector<std::string> SpillFiles;
+  /// Diagnostics that do not stop the merge, in the order they were found.
+  std::string Warnings;
+  /// The error that stopped this thread, if any, and the file it came from.
+  std::error_code Error;
+  std::string ErrorWhence;
+  /// With several threads or spilling, the input each function record first
+  /// came from, so that the records that are merged later on and disagree are
+  /// reported against it.
+  bool TrackOrigins;
+  StringMap<SmallDenseMap<uint64_t, StringRef, 1>> Origins;
+
+  MergeContext() : Writer(new InstrProfWriter()), TrackOrigins(false) {}
+};
+} // end anonymous namespace
+
+static void removeSpillFiles(std::vector<MergeContext> &Contexts) {
+  for (MergeContext &Ctx : Contexts) {
+    for (const std::string &Path : Ctx.SpillFiles)
+      sys::fs::remove(Path);
+    Ctx.SpillFiles.clear();
+  }
+}
+
+/// Write the counts held by the writer of \p Ctx to a temporary file and empty
+/// it. The records are sorted by function name and hash, so that the spill
+/// files can be merged in a single pass, and each one is written as its name,
+/// hash, origin, number of counters and counters, one per line.
+static void spillWriter(MergeContext &Ctx) {
+  int FD;
+  SmallString<128> Path;
+  if ((Ctx.Error =
+           sys::fs::createTemporaryFile("llvm-profdata", "spill", FD, Path)))
+    return;
+  sys::RemoveFileOnSignal(Path);
+  Ctx.SpillFiles.push_back(Path.str());
+
+  typedef std::pair<StringRef, uint64_t> RecordKey;
+  std::vector<std::pair<RecordKey, const std::vector<uint64_t> *>> Records;
+  for (const auto &I : *Ctx.Writer)
+    for (const auto &Func : I.getValue())
+      Records.push_back(std::make_pair(RecordKey(I.getKey(), Func.first),
+                                       &Func.second));
+  std::sort(Records.begin(), Records.end(),
+            [](const std::pair<RecordKey, const std::vector<uint64_t> *> &A,
+               const std::pair<RecordKey, const std::vector<uint64_t> *> &B) {
+              return A.first < B.first;
+            });
+
+  raw_fd_ostream OS(FD, /*shouldClose=*/true);
+  for (const auto &Record : Records) {
+    StringRef Name = Record.first.first;
+    uint64_t Hash = Record.first.second;
+    OS << Name << "\n" << Hash << "\n" << Ctx.Origins[Name][Hash] << "\n"
+       << Record.second->size() << "\n";
+    for (uint64_t Count : *Record.second)
+      OS << Count << "\n";
+  }
+  Ctx.Writer.reset(new InstrProfWriter());
+  Ctx.Origins.clear();
+}
+
+namespace {
+/// Reads the records of a spill file one at a time.
+class SpillReader {
+  std::unique_ptr<MemoryBuffer> Buffer;
+  line_iterator Line;
+
+public:
+  StringRef Name;
+  uint64_t Hash;
+  StringRef Origin;
+  std::vector<uint64_t> Counts;
+
+  SpillReader(std::unique_ptr<MemoryBuffer> Buffer)
+      : Buffer(std::move(Buffer)), Line(*this->Buffer), Hash(0) {}
+
+  bool atEnd() const { return Line.is_at_end(); }
+
+  /// Read the next record. Return true if the file is malformed.
+  bool readNextRecord() {
+    uint64_t NumCounters;
+    Name = *Line++;
+    if (Line.is_at_end() || (Line++)->getAsInteger(10, Hash) ||
+        Line.is_at_end())
+      return true;
+    Origin = *Line++;
+    if (Line.is_at_end() || (Line++)->getAsInteger(10, NumCounters))
+      return true;
+    Counts.resize(NumCounters);
+    for (uint64_t &Count : Counts)
+      if (Line.is_at_end() || (Line++)->getAsInteger(10, Count))
+        return true;
+    return false;
+  }
+};
+} // end anonymous namespace
+
+/// Merge the spill files \p Paths, in order, into the writer of \p Ctx. The
+/// files are read side by side, so that only their current records are held
+/// in memory at any time.
+static void mergeSpillFiles(MergeContext &Ctx, ArrayRef<std::string> Paths) {
+  raw_string_ostream Warnings(Ctx.Warnings);
+  std::vector<SpillReader> Readers;
+  Readers.reserve(Paths.size());
+  for (const std::string &Path : Paths) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+        MemoryBuffer::getFile(Path);
+    if ((Ctx.Error = BufferOrErr.getError())) {
+      Ctx.ErrorWhence = Path;
+      return;
+    }
+    Readers.push_back(SpillReader(std::move(BufferOrErr.get())));
+  }
+
+  // Order the readers by their current record, then by the position of their
+  // file, so that the records of a function come out in input order.
+  auto Later = [&](unsigned A, unsigned B) {
+    const SpillReader &RA = Readers[A], &RB = Readers[B];
+    if (RA.Name != RB.Name)
+      return RA.Name > RB.Name;
+    if (RA.Hash != RB.Hash)
+      return RA.Hash > RB.Hash;
+    return A > B;
+  };
+  std::priority_queue<unsigned, std::vector<unsigned>, decltype(Later)> Heap(
+      Later);
+  auto Advance = [&](unsigned I) {
+    if (Readers[I].atEnd())
+      return;
+    if (Readers[I].readNextRecord()) {
+      Ctx.Error = instrprof_error::malformed;
+      Ctx.ErrorWhence = Paths[I];
+      return;
+    }
+    Heap.push(I);
+  };
+
+  for (unsigned I = 0, E = Readers.size(); I != E && !Ctx.Error; ++I)
+    Advance(I);
+  while (!Heap.empty() && !Ctx.Error) {
+    unsigned I = Heap.top();
+    Heap.pop();
+    SpillReader &Reader = Readers[I];
+    if (std::error_code EC = Ctx.Writer->addFunctionCounts(
+            Reader.Name, Reader.Hash, Reader.Counts))
+      Warnings << Reader.Origin << ": " << Reader.Name << ": " << EC.message()
+               << "\n";
+    Advance(I);
+  }
+}
+
+/// Merge \p Filename into the writer of \p Ctx. When origins are tracked,
+/// \p Filename must outlive \p Ctx.
+static void mergeFile(MergeContext &Ctx, StringRef Filename, uint64_t Weight) {
+  raw_string_ostream Warnings(Ctx.Warnings);
+  std::unique_ptr<InstrProfReader> Reader;
+  if ((Ctx.Error = InstrProfReader::create(Filename, Reader))) {
+    Ctx.ErrorWhence = Filename;
+    return;
+  }
+
+  for (const auto &I : *Reader) {
+    if (std::error_code EC =
+            Ctx.Writer->addFunctionCounts(I.Name, I.Hash, I.Counts, Weight))
+      Warnings << Filename << ": " << I.Name << ": " << EC.message() << "\n";
+    else if (Ctx.TrackOrigins)
+      Ctx.Origins[I.Name].insert(std::make_pair(I.Hash, Filename));
+  }
+  if (Reader->hasError()) {
+    Ctx.Error = Reader->getError();
+    Ctx.ErrorWhence = Filename;
+  }
+}
+
+/// Merge \p Inputs, in order, into \p Ctx. Whenever the writer holds more
+/// than \p MaxFunctions functions, its counts are spilled to disk.
+static void mergeInputs(MergeContext &Ctx, ArrayRef<WeightedFile> Inputs,
+                        size_t MaxFunctions) {
+  for (const WeightedFile &Input : Inputs) {
+    mergeFile(Ctx, Input.Filename, Input.Weight);
+    if (!Ctx.Error && MaxFunctions &&
+        Ctx.Writer->getNumFunctions() > MaxFunctions)
+      spillWriter(Ctx);
+    if (Ctx.Error)
+      return;
+  }
+}
+
+/// Merge the counts of \p Src into \p Dst.
+static void mergeContexts(MergeContext &Dst, MergeContext &Src) {
+  Dst.Warnings += Src.Warnings;
+  raw_string_ostream Warnings(Dst.Warnings);
+  Dst.Writer->mergeRecordsFromWriter(
+      *Src.Writer, [&](StringRef FunctionName, uint64_t FunctionHash,
+                       std::error_code EC) {
+        Warnings << Src.Origins[FunctionName][FunctionHash] << ": "
+                 << FunctionName << ": " << EC.message() << "\n";
+      });
+  for (const auto &I : Src.Origins) {
+    auto &DstOrigins = Dst.Origins[I.getKey()];
+    for (const auto &Origin : I.getValue())
+      DstOrigins.insert(Origin);
+  }
+  Src.Origins.clear();
+}
+
+static uint64_t parseWeight(StringRef Weight, StringRef Arg) {
+  uint64_t Result;
+  if (Weight.getAsInteger(10, Result) || Result == 0)
+    exitWithError("Input weight must be a positive integer.", Arg);
+  return Result;
+}
+
 int merge_main(int argc, const char *argv[]) {
-  cl::list<std::string> Inputs(cl::Positional, cl::Required, cl::OneOrMore,
+  cl::list<std::string> Inputs(cl::Positional, cl::ZeroOrMore,
                                cl::desc("<filenames...>"));
+  cl::list<std::string> WeightedInputs(
+      "weighted-input", cl::ZeroOrMore, cl::value_desc("weight,filename"),
+      cl::desc("<weight>,<filename>: merge <filename> with its counts "
+               "multiplied by <weight>"));
 
   cl::opt<std::string> OutputFilename("output", cl::value_desc("output"),
                                       cl::init("-"), cl::Required,
                                       cl::desc("Output file"));
   cl::alias OutputFilenameA("o", cl::desc("Alias for --output"),
                             cl::aliasopt(OutputFilename));
+  cl::opt<unsigned> Threads(
+      "threads", cl::init(1),
+      cl::desc("Number of threads reading the inputs (0 = all cores)"));
+  cl::opt<unsigned> MaxFunctionsInMemory(
+      "max-functions-in-memory", cl::init(0),
+      cl::desc("Spill the counts of a thread to a temporary file once they "
+               "cover more than this many functions (0 = never)"));
 
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
 
+  // Keep the inputs in command line order: when two of them disagree on the
+  // counts of a function, the first one wins.
+  std::vector<std::pair<unsigned, WeightedFile>> PositionedFiles;
+  for (unsigned I = 0, E = Inputs.size(); I != E; ++I)
+    PositionedFiles.push_back(
+        std::make_pair(Inputs.getPosition(I), WeightedFile{Inputs[I], 1}));
+  for (unsigned I = 0, E = WeightedInputs.size(); I != E; ++I) {
+    StringRef Arg = WeightedInputs[I];
+    StringRef Weight, Filename;
+    std::tie(Weight, Filename) = Arg.split(',');
+    if (Filename.empty())
+      exitWithError("Expected <weight>,<filename>.", Arg);
+    PositionedFiles.push_back(
+        std::make_pair(WeightedInputs.getPosition(I),
+                       WeightedFile{Filename, parseWeight(Weight, Arg)}));
+  }
+  std::stable_sort(PositionedFiles.begin(), PositionedFiles.end(),
+                   [](const std::pair<unsigned, WeightedFile> &A,
+                      const std::pair<unsigned, WeightedFile> &B) {
+                     return A.first < B.first;
+                   });
+  std::vector<WeightedFile> WeightedFiles;
+  for (const auto &PF : PositionedFiles)
+    WeightedFiles.push_back(PF.second);
+  if (WeightedFiles.empty())
+    exitWithError("No input files specified.");
+
   if (OutputFilename.compare("-") == 0)
     exitWithError("Cannot write indexed profdata format to stdout.");
 
@@ -53,20 +325,79 @@ int merge_main(int argc, const char *argv[]) {
   if (EC)
     exitWithError(EC.message(), OutputFilename);
 
-  InstrProfWriter Writer;
-  for (const auto &Filename : Inputs) {
-    std::unique_ptr<InstrProfReader> Reader;
-    if (std::error_code ec = InstrProfReader::create(Filename, Reader))
-      exitWithError(ec.message(), Filename);
+  // Give every thread a contiguous range of inputs, so that diagnostics come
+  // out in the same order as with a single thread.
+  std::unique_ptr<ThreadPool> Pool;
+  size_t NumContexts = 1;
+  if (Threads != 1) {
+    Pool.reset(new ThreadPool(Threads));
+    NumContexts = std::min<size_t>(Pool->getThreadCount(), WeightedFiles.size());
+  }
+  std::vector<MergeContext> Contexts(NumContexts);
+  size_t MaxFunctions = MaxFunctionsInMemory;
+  ArrayRef<WeightedFile> Remaining = WeightedFiles;
+  for (size_t I = 0; I != NumContexts; ++I) {
+    size_t Size = Remaining.size() / (NumContexts - I);
+    ArrayRef<WeightedFile> Range = Remaining.slice(0, Size);
+    Remaining = Remaining.slice(Size);
+    MergeContext &Ctx = Contexts[I];
+    Ctx.TrackOrigins = NumContexts > 1 || MaxFunctions;
+    if (Pool)
+      Pool->async([&Ctx, Range, MaxFunctions] {
+        mergeInputs(Ctx, Range, MaxFunctions);
+      });
+    else
+      mergeInputs(Ctx, Range, MaxFunctions);
+  }
+  if (Pool)
+    Pool->wait();
+
+  for (MergeContext &Ctx : Contexts) {
+    errs() << Ctx.Warnings;
+    Ctx.Warnings.clear();
+    if (Ctx.Error) {
+      removeSpillFiles(Contexts);
+      exitWithError(Ctx.Error.message(), Ctx.ErrorWhence);
+    }
+  }
 
-    for (const auto &I : *Reader)
-      if (std::error_code EC =
-              Writer.addFunctionCounts(I.Name, I.Hash, I.Counts))
-        errs() << Filename << ": " << I.Name << ": " << EC.message() << "\n";
-    if (Reader->hasError())
-      exitWithError(Reader->getError().message(), Filename);
+  // Once any thread has spilled, the counts of every thread are spilled too,
+  // and the spill files, which are in input order, are merged in one pass.
+  bool Spilled = false;
+  for (MergeContext &Ctx : Contexts)
+    Spilled |= !Ctx.SpillFiles.empty();
+
+  MergeContext &Result = Contexts[0];
+  if (Spilled) {
+    std::vector<std::string> SpillFiles;
+    for (MergeContext &Ctx : Contexts) {
+      if (Ctx.Writer->getNumFunctions())
+        spillWriter(Ctx);
+      if (Ctx.Error) {
+        removeSpillFiles(Contexts);
+        exitWithError(Ctx.Error.message());
+      }
+      SpillFiles.insert(SpillFiles.end(), Ctx.SpillFiles.begin(),
+                        Ctx.SpillFiles.end());
+    }
+    mergeSpillFiles(Result, SpillFiles);
+    removeSpillFiles(Contexts);
+    errs() << Result.Warnings;
+    if (Result.Error)
+      exitWithError(Result.Error.message(), Result.ErrorWhence);
+  } else {
+    // Reduce the writers of the threads pairwise.
+    for (size_t Stride = 1; Stride < NumContexts; Stride *= 2) {
+      for (size_t I = 0; I + Stride < NumContexts; I += 2 * Stride) {
+        MergeContext &Dst = Contexts[I], &Src = Contexts[I + Stride];
+        Pool->async([&Dst, &Src] { mergeContexts(Dst, Src); });
+      }
+      Pool->wait();
+    }
+    errs() << Result.Warnings;
   }
-  Writer.write(Output);
+
+  Result.Writer->write(Output);
 
   return 0;
 }
@@ -81,6 +412,10 @@ int show_main(int argc, const char *argv[]) {
                                  cl::desc("Details for every function"));
   cl::opt<std::string> ShowFunction("function",
                                     cl::desc("Details for matching functions"));
+  cl::opt<unsigned> BenchmarkLookups(
+      "benchmark-lookups", cl::init(0), cl::Hidden,
+      cl::desc("Look up every function of an indexed profile this many times "
+               "and report the lookup rate"));
 
   cl::opt<std::string> OutputFilename("output", cl::value_desc("output"),
                                       cl::init("-"),
@@ -107,7 +442,11 @@ int show_main(int argc, const char *argv[]) {
 
   uint64_t MaxFunctionCount = 0, MaxBlockCount = 0;
   size_t ShownFunctions = 0, TotalFunctions = 0;
+  std::vector<std::pair<std::string, uint64_t>> Functions;
   for (const auto &Func : *Reader) {
+    if (BenchmarkLookups)
+      Functions.push_back(std::make_pair(Func.Name.str(), Func.Hash));
+
     bool Show = ShowAllFunctions ||
                 (!ShowFunction.empty() &&
                  Func.Name.find(ShowFunction) != Func.Name.npos);
@@ -147,6 +486,28 @@ int show_main(int argc, const char *argv[]) {
   OS << "Total functions: " << TotalFunctions << "\n";
   OS << "Maximum function count: " << MaxFunctionCount << "\n";
   OS << "Maximum internal block count: " << MaxBlockCount << "\n";
+
+  if (BenchmarkLookups) {
+    std::unique_ptr<IndexedInstrProfReader> IndexedReader;
+    if (std::error_code EC =
+            IndexedInstrProfReader::create(Filename, IndexedReader))
+      exitWithError(EC.message(), Filename);
+    uint64_t Lookups = 0;
+    double Start = TimeRecord::getCurrentTime().getWallTime();
+    for (unsigned I = 0; I != BenchmarkLookups; ++I) {
+      for (const auto &Func : Functions) {
+        ArrayRef<uint64_t> Counts;
+        if (std::error_code EC = IndexedReader->getFunctionCounts(
+                Func.first, Func.second, Counts))
+          exitWithError(EC.message(), Func.first);
+        ++Lookups;
+      }
+    }
+    double Elapsed = TimeRecord::getCurrentTime().getWallTime() - Start;
+    OS << "Lookups: " << Lookups << "\n";
+    OS << "Lookups per second: "
+       << format("%.0f", Elapsed > 0 ? Lookups / Elapsed : 0.0) << "\n";
+  }
   return 0;
 }
 
@@ -19,10 +19,14 @@
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <sstream>
 #include <stdlib.h>
 
@@ -44,7 +48,7 @@ getDILineInfoSpecifier(const LLVMSymbolizer::Options &Opts) {
 }
 
 ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx)
-    : Module(Obj), DebugInfoContext(DICtx) {
+    : Module(Obj), DebugInfoContext(DICtx), CacheKey(0), CacheDirty(false) {
   for (const SymbolRef &Symbol : Module->symbols()) {
     addSymbol(Symbol);
   }
@@ -165,6 +169,86 @@ bool ModuleInfo::symbolizeData(uint64_t ModuleOffset, std::string &Name,
                                 Size);
 }
 
+// Cache files start with this magic, followed by the format version and the
+// cache key, as 32-bit little-endian integers. Each result then takes a 64-bit
+// module offset, an 8-bit data flag, a 32-bit length and the result string.
+static const char kCacheMagic[] = "LLVMSYMC";
+static const uint32_t kCacheVersion = 1;
+static const uint32_t kCacheHeaderSize = 16;
+
+void ModuleInfo::loadCache(StringRef Path, uint32_t Key) {
+  CachePath = Path;
+  CacheKey = Key;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MB = MemoryBuffer::getFile(Path);
+  if (!MB)
+    return;
+  StringRef Data = MB.get()->getBuffer();
+  if (!Data.startswith(StringRef(kCacheMagic, 8)))
+    return;
+  DataExtractor DE(Data, true, 8);
+  uint32_t Offset = 8;
+  if (!DE.isValidOffsetForDataOfSize(Offset, 8) ||
+      DE.getU32(&Offset) != kCacheVersion || DE.getU32(&Offset) != Key)
+    return;
+  while (DE.isValidOffsetForDataOfSize(Offset, 13)) {
+    uint64_t ModuleOffset = DE.getU64(&Offset);
+    bool IsData = DE.getU8(&Offset);
+    uint32_t Length = DE.getU32(&Offset);
+    if (!DE.isValidOffsetForDataOfSize(Offset, Length))
+      break;
+    CachedResults[std::make_pair(ModuleOffset, IsData)] =
+        Data.substr(Offset, Length);
+    Offset += Length;
+  }
+}
+
+bool ModuleInfo::getCachedResult(bool IsData, uint64_t ModuleOffset,
+                                 std::string &Result) const {
+  ResultMapTy::const_iterator I =
+      CachedResults.find(std::make_pair(ModuleOffset, IsData));
+  if (I == CachedResults.end())
+    return false;
+  Result = I->second;
+  return true;
+}
+
+void ModuleInfo::addCachedResult(bool IsData, uint64_t ModuleOffset,
+                                 const std::string &Result) {
+  if (CachePath.empty())
+    return;
+  CachedResults[std::make_pair(ModuleOffset, IsData)] = Result;
+  CacheDirty = true;
+}
+
+void ModuleInfo::saveCache() {
+  if (!CacheDirty)
+    return;
+  CacheDirty = false;
+  // Write to a temporary file first, so that concurrent readers never see a
+  // partial cache.
+  if (error(sys::fs::create_directories(sys::path::parent_path(CachePath))))
+    return;
+  int FD;
+  SmallString<128> TempPath;
+  if (error(sys::fs::createUniqueFile(CachePath + "-%%%%%%", FD, TempPath)))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    support::endian::Writer<support::little> W(OS);
+    OS.write(kCacheMagic, 8);
+    W.write<uint32_t>(kCacheVersion);
+    W.write<uint32_t>(CacheKey);
+    for (const auto &Entry : CachedResults) {
+      W.write<uint64_t>(Entry.first.first);
+      W.write<uint8_t>(Entry.first.second);
+      W.write<uint32_t>(Entry.second.size());
+      OS << Entry.second;
+    }
+  }
+  if (error(sys::fs::rename(TempPath.str(), CachePath)))
+    sys::fs::remove(TempPath.str());
+}
+
 const char LLVMSymbolizer::kBadString[] = "??";
 
 std::string LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
@@ -172,20 +256,24 @@ std::string LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
   ModuleInfo *Info = getOrCreateModuleInfo(ModuleName);
   if (!Info)
     return printDILineInfo(DILineInfo());
+  std::string Result;
+  if (Info->getCachedResult(false, ModuleOffset, Result))
+    return Result;
   if (Opts.PrintInlining) {
     DIInliningInfo InlinedContext =
         Info->symbolizeInlinedCode(ModuleOffset, Opts);
     uint32_t FramesNum = InlinedContext.getNumberOfFrames();
     assert(FramesNum > 0);
-    std::string Result;
     for (uint32_t i = 0; i < FramesNum; i++) {
       DILineInfo LineInfo = InlinedContext.getFrame(i);
       Result += printDILineInfo(LineInfo);
     }
-    return Result;
+  } else {
+    DILineInfo LineInfo = Info->symbolizeCode(ModuleOffset, Opts);
+    Result = printDILineInfo(LineInfo);
   }
-  DILineInfo LineInfo = Info->symbolizeCode(ModuleOffset, Opts);
-  return printDILineInfo(LineInfo);
+  Info->addCachedResult(false, ModuleOffset, Result);
+  return Result;
 }
 
 std::string LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
@@ -193,18 +281,65 @@ std::string LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
   std::string Name = kBadString;
   uint64_t Start = 0;
   uint64_t Size = 0;
+  ModuleInfo *Info = nullptr;
   if (Opts.UseSymbolTable) {
-    if (ModuleInfo *Info = getOrCreateModuleInfo(ModuleName)) {
+    if ((Info = getOrCreateModuleInfo(ModuleName))) {
+      std::string Result;
+      if (Info->getCachedResult(true, ModuleOffset, Result))
+        return Result;
       if (Info->symbolizeData(ModuleOffset, Name, Start, Size) && Opts.Demangle)
         Name = DemangleName(Name);
     }
   }
   std::stringstream ss;
   ss << Name << "\n" << Start << " " << Size << "\n";
+  if (Info)
+    Info->addCachedResult(true, ModuleOffset, ss.str());
   return ss.str();
 }
 
+std::vector<std::string>
+LLVMSymbolizer::symbolizeBatch(const std::vector<Request> &Requests,
+                               unsigned Threads) {
+  std::vector<std::string> Results(Requests.size());
+  typedef std::map<std::string, std::vector<unsigned> > RequestMapTy;
+  RequestMapTy RequestsForModule;
+  for (unsigned i = 0, e = Requests.size(); i != e; ++i)
+    RequestsForModule[Requests[i].ModuleName].push_back(i);
+
+  // Load all the modules up front: the maps of loaded binaries and modules
+  // are not thread safe, and are only read from now on. Sorting the requests
+  // of a module by address lets consecutive lookups hit the same compile
+  // unit.
+  for (auto &Entry : RequestsForModule) {
+    getOrCreateModuleInfo(Entry.first);
+    std::stable_sort(Entry.second.begin(), Entry.second.end(),
+                     [&](unsigned LHS, unsigned RHS) {
+      return Requests[LHS].ModuleOffset < Requests[RHS].ModuleOffset;
+    });
+  }
+
+  // Debug info contexts are not thread safe either, so every module is
+  // symbolized by a single task.
+  ThreadPool Pool(Threads);
+  for (const auto &Entry : RequestsForModule) {
+    const std::vector<unsigned> &Indices = Entry.second;
+    Pool.async([this, &Requests, &Results, &Indices] {
+      for (unsigned i : Indices) {
+        const Request &R = Requests[i];
+        Results[i] = R.IsData ? symbolizeData(R.ModuleName, R.ModuleOffset)
+                              : symbolizeCode(R.ModuleName, R.ModuleOffset);
+      }
+    });
+  }
+  Pool.wait();
+  return Results;
+}
+
 void LLVMSymbolizer::flush() {
+  for (const auto &Entry : Modules)
+    if (ModuleInfo *Info = Entry.second)
+      Info->saveCache();
   DeleteContainerSeconds(Modules);
   BinaryForPath.clear();
   ObjectFileForArch.clear();
@@ -293,6 +428,38 @@ static bool getGNUDebuglinkContents(const Binary *Bin, std::string &DebugName,
   return false;
 }
 
+static bool getGNUBuildID(const ObjectFile *Obj, std::string &BuildID) {
+  const unsigned NT_GNU_BUILD_ID = 3;
+  for (const SectionRef &Section : Obj->sections()) {
+    StringRef Name;
+    Section.getName(Name);
+    if (Name != ".note.gnu.build-id")
+      continue;
+    StringRef Data;
+    Section.getContents(Data);
+    DataExtractor DE(Data, Obj->isLittleEndian(), 0);
+    uint32_t Offset = 0;
+    if (!DE.isValidOffsetForDataOfSize(Offset, 12))
+      return false;
+    uint32_t NameSize = DE.getU32(&Offset);
+    uint32_t DescSize = DE.getU32(&Offset);
+    uint32_t Type = DE.getU32(&Offset);
+    // The name is padded to a multiple of 4 bytes.
+    Offset += (NameSize + 3) & ~0x3;
+    if (Type != NT_GNU_BUILD_ID || DescSize == 0 ||
+        !DE.isValidOffsetForDataOfSize(Offset, DescSize))
+      return false;
+    static const char Hex[] = "0123456789abcdef";
+    BuildID.clear();
+    for (unsigned char C : Data.substr(Offset, DescSize)) {
+      BuildID += Hex[C >> 4];
+      BuildID += Hex[C & 0xf];
+    }
+    return true;
+  }
+  return false;
+}
+
 LLVMSymbolizer::BinaryPair
 LLVMSymbolizer::getOrCreateBinary(const std::string &Path) {
   BinaryMapTy::iterator I = BinaryForPath.find(Path);
@@ -392,11 +559,23 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   }
   DIContext *Context = DIContext::getDWARFContext(*DbgObj);
   assert(Context);
+  Context->setMaxResidentUnits(Opts.MaxResidentUnits);
   ModuleInfo *Info = new ModuleInfo(Obj, Context);
+  std::string BuildID;
+  if (!Opts.CacheDir.empty() && getGNUBuildID(Obj, BuildID)) {
+    SmallString<128> CachePath(Opts.CacheDir);
+    sys::path::append(CachePath, BuildID + ".symcache");
+    Info->loadCache(CachePath, getCacheKey());
+  }
   Modules.insert(make_pair(ModuleName, Info));
   return Info;
 }
 
+uint32_t LLVMSymbolizer::getCacheKey() const {
+  return Opts.UseSymbolTable | static_cast<uint32_t>(Opts.PrintFunctions) << 1 |
+         Opts.PrintInlining << 3 | Opts.Demangle << 4;
+}
+
 std::string LLVMSymbolizer::printDILineInfo(DILineInfo LineInfo) const {
   // By default, DILineInfo contains "<invalid>" for function/filename it
   // cannot fetch. We replace it to "??" to make our output closer to addr2line.
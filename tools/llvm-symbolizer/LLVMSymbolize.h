@@ -21,6 +21,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace llvm {
 
@@ -39,13 +40,27 @@ public:
     bool PrintInlining : 1;
     bool Demangle : 1;
     std::string DefaultArch;
+    /// Directory where the results for binaries with a build ID are kept
+    /// across runs. Empty to disable the cache.
+    std::string CacheDir;
+    /// Number of compilation units per module whose debug info lookup data
+    /// stays in memory between queries, or 0 for no limit.
+    unsigned MaxResidentUnits;
     Options(bool UseSymbolTable = true,
             FunctionNameKind PrintFunctions = FunctionNameKind::LinkageName,
             bool PrintInlining = true, bool Demangle = true,
-            std::string DefaultArch = "")
+            std::string DefaultArch = "", std::string CacheDir = "",
+            unsigned MaxResidentUnits = 0)
         : UseSymbolTable(UseSymbolTable), PrintFunctions(PrintFunctions),
           PrintInlining(PrintInlining), Demangle(Demangle),
-          DefaultArch(DefaultArch) {}
+          DefaultArch(DefaultArch), CacheDir(CacheDir),
+          MaxResidentUnits(MaxResidentUnits) {}
+  };
+
+  struct Request {
+    bool IsData;
+    std::string ModuleName;
+    uint64_t ModuleOffset;
   };
 
   LLVMSymbolizer(const Options &Opts = Options()) : Opts(Opts) {}
@@ -59,6 +74,11 @@ public:
   symbolizeCode(const std::string &ModuleName, uint64_t ModuleOffset);
   std::string
   symbolizeData(const std::string &ModuleName, uint64_t ModuleOffset);
+  // Returns the results for all the requests, in the same order. Requests are
+  // grouped by module and sorted by address, and different modules are
+  // symbolized in parallel on Threads threads (0 means one per core).
+  std::vector<std::string> symbolizeBatch(const std::vector<Request> &Requests,
+                                          unsigned Threads);
   void flush();
   static std::string DemangleName(const std::string &Name);
 private:
@@ -72,6 +92,9 @@ private:
   ObjectFile *getObjectFileFromBinary(Binary *Bin, const std::string &ArchName);
 
   std::string printDILineInfo(DILineInfo LineInfo) const;
+  /// \brief Returns a value identifying the options that change the output,
+  /// stored in cache files to tell apart results printed differently.
+  uint32_t getCacheKey() const;
 
   // Owns all the parsed binaries and object files.
   SmallVector<std::unique_ptr<Binary>, 4> ParsedBinariesAndObjects;
@@ -105,6 +128,15 @@ public:
   bool symbolizeData(uint64_t ModuleOffset, std::string &Name, uint64_t &Start,
                      uint64_t &Size) const;
 
+  /// Reads the results saved in the cache file Path, if it was written with
+  /// the same CacheKey. Results added later are written back by saveCache().
+  void loadCache(StringRef Path, uint32_t CacheKey);
+  bool getCachedResult(bool IsData, uint64_t ModuleOffset,
+                       std::string &Result) const;
+  void addCachedResult(bool IsData, uint64_t ModuleOffset,
+                       const std::string &Result);
+  void saveCache();
+
 private:
   bool getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
                               std::string &Name, uint64_t &Addr,
@@ -125,6 +157,12 @@ private:
   typedef std::map<SymbolDesc, StringRef> SymbolMapTy;
   SymbolMapTy Functions;
   SymbolMapTy Objects;
+
+  std::string CachePath;
+  uint32_t CacheKey;
+  bool CacheDirty;
+  typedef std::map<std::pair<uint64_t, bool>, std::string> ResultMapTy;
+  ResultMapTy CachedResults;
 };
 
 } // namespace symbolize
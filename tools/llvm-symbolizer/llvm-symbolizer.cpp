@@ -61,6 +61,27 @@ ClBinaryName("obj", cl::init(""),
              cl::desc("Path to object file to be symbolized (if not provided, "
                       "object file should be specified for each input line)"));
 
+static cl::opt<bool>
+ClBatch("batch", cl::init(false),
+        cl::desc("Read all the input before printing any result, so that "
+                 "modules can be symbolized in parallel"));
+
+static cl::opt<unsigned>
+ClThreads("threads", cl::init(0),
+          cl::desc("Number of threads used in batch mode (0 = one per "
+                   "hardware thread)"));
+
+static cl::opt<std::string>
+ClCacheDir("cache-dir", cl::init(""),
+           cl::desc("Directory where results are cached across runs, for "
+                    "binaries that have a build ID"));
+
+static cl::opt<unsigned>
+ClMaxResidentUnits("max-resident-units", cl::init(0),
+                   cl::desc("Maximum number of compilation units per binary "
+                            "whose debug info is kept in memory (0 = no "
+                            "limit)"));
+
 static bool parseCommand(bool &IsData, std::string &ModuleName,
                          uint64_t &ModuleOffset) {
   const char *kDataCmd = "DATA ";
@@ -118,12 +139,25 @@ int main(int argc, char **argv) {
 
   cl::ParseCommandLineOptions(argc, argv, "llvm-symbolizer\n");
   LLVMSymbolizer::Options Opts(ClUseSymbolTable, ClPrintFunctions,
-                               ClPrintInlining, ClDemangle, ClDefaultArch);
+                               ClPrintInlining, ClDemangle, ClDefaultArch,
+                               ClCacheDir, ClMaxResidentUnits);
   LLVMSymbolizer Symbolizer(Opts);
 
   bool IsData = false;
   std::string ModuleName;
   uint64_t ModuleOffset;
+  if (ClBatch) {
+    std::vector<LLVMSymbolizer::Request> Requests;
+    while (parseCommand(IsData, ModuleName, ModuleOffset)) {
+      LLVMSymbolizer::Request R = { IsData, ModuleName, ModuleOffset };
+      Requests.push_back(R);
+    }
+    for (const std::string &Result :
+         Symbolizer.symbolizeBatch(Requests, ClThreads))
+      outs() << Result << "\n";
+    return 0;
+  }
+
   while (parseCommand(IsData, ModuleName, ModuleOffset)) {
     std::string Result =
         IsData ? Symbolizer.symbolizeData(ModuleName, ModuleOffset)
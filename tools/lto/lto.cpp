@@ -222,6 +222,10 @@ void lto_codegen_set_cpu(lto_code_gen_t cg, const char *cpu) {
   return unwrap(cg)->setCpu(cpu);
 }
 
+void lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned parallelism) {
+  return unwrap(cg)->setCodeGenParallelism(parallelism);
+}
+
 void lto_codegen_set_assembler_path(lto_code_gen_t cg, const char *path) {
   // In here only for backwards compatibility. We use MC now.
 }
@@ -265,6 +269,17 @@ bool lto_codegen_compile_to_file(lto_code_gen_t cg, const char **name) {
                                       DisableGVNLoadPRE, sLastErrorString);
 }
 
+bool lto_codegen_compile_to_files(lto_code_gen_t cg, const char ***names,
+                                  unsigned *count) {
+  if (!parsedOptions) {
+    unwrap(cg)->parseCodeGenDebugOptions();
+    lto_add_attrs(cg);
+    parsedOptions = true;
+  }
+  return !unwrap(cg)->compile_to_files(names, count, DisableOpt, DisableInline,
+                                       DisableGVNLoadPRE, sLastErrorString);
+}
+
 void lto_codegen_debug_options(lto_code_gen_t cg, const char *opt) {
   unwrap(cg)->setCodeGenDebugOptions(opt);
 }
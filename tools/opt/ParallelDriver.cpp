@@ -0,0 +1,645 @@
+//===- ParallelDriver.cpp - Run passes on several threads -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// The pieces of the module travel to their threads as bitcode, to be read
+/// into fresh LLVMContexts. The optimized pieces come back as bitcode too, and
+/// are linked back in the original context.
+///
+/// For the function passes, the pieces are partitions of the module made by
+/// SplitModule. For the CallGraph SCC passes, every SCC of the call graph is a
+/// piece, which is made of the functions of the SCC, of the optimized bodies
+/// of the functions it calls and of declarations for the rest of the module.
+///
+//===----------------------------------------------------------------------===//
+
+#include "ParallelDriver.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/CallGraphSCCPass.h"
+#include "llvm/Analysis/LazyCallGraph.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+static void writeBitcode(const Module &M, std::string &Bitcode) {
+  Bitcode.clear();
+  raw_string_ostream OS(Bitcode);
+  WriteBitcodeToFile(&M, OS);
+  OS.flush();
+}
+
+/// Remove the declarations of special globals such as llvm.global_ctors that
+/// SplitModule leaves in the partitions which do not own their definition.
+/// The linker refuses to merge them with the definition.
+static void removeSpecialDeclarations(Module &M) {
+  for (auto I = M.global_begin(), E = M.global_end(); I != E;) {
+    GlobalVariable *GV = I++;
+    if (GV->isDeclaration() && GV->getName().startswith("llvm.") &&
+        GV->use_empty())
+      GV->eraseFromParent();
+  }
+}
+
+/// Remove the named metadata but the module flags. It is the same in every
+/// partition, so that one copy is enough.
+static void removeNamedMetadata(Module &M) {
+  for (auto I = M.named_metadata_begin(), E = M.named_metadata_end(); I != E;) {
+    NamedMDNode *NMD = I++;
+    if (NMD->getName() != "llvm.module.flags")
+      M.eraseNamedMetadata(NMD);
+  }
+}
+
+std::unique_ptr<Module>
+llvm::runFunctionPassesInParallel(StringRef Arg0, std::unique_ptr<Module> M,
+                                  unsigned Threads,
+                                  std::function<void(Module &Part)>
+                                      OptimizePartition) {
+  LLVMContext &Context = M->getContext();
+  std::string ModuleID = M->getModuleIdentifier();
+  ThreadPool Pool(Threads);
+  unsigned N = Pool.getThreadCount();
+
+  // The linker matches globals up by name, so unnamed ones that are visible
+  // outside their partition are named until the partitions are linked.
+  std::vector<std::string> TempNames;
+  auto NameGlobal = [&](GlobalValue &GV) {
+    if (GV.hasName() || GV.hasLocalLinkage())
+      return;
+    GV.setName("opt.unnamed");
+    TempNames.push_back(GV.getName());
+  };
+  for (Function &F : *M)
+    NameGlobal(F);
+  for (GlobalVariable &GV : M->globals())
+    NameGlobal(GV);
+  for (GlobalAlias &GA : M->aliases())
+    NameGlobal(GA);
+
+  // The linker appends the globals of every partition in turn. Remember the
+  // order of the module, so that it does not depend on the partitioning.
+  std::vector<std::string> FunctionOrder, GlobalOrder;
+  for (Function &F : *M)
+    if (F.hasName())
+      FunctionOrder.push_back(F.getName());
+  for (GlobalVariable &GV : M->globals())
+    if (GV.hasName())
+      GlobalOrder.push_back(GV.getName());
+
+  // The partitions are linked back into a single module, so their locals
+  // have to stay local rather than be promoted.
+  std::vector<std::string> Bitcode;
+  SplitModule(*M, N, [&](std::unique_ptr<Module> MPart) {
+    if (!Bitcode.empty())
+      removeNamedMetadata(*MPart);
+    Bitcode.push_back(std::string());
+    writeBitcode(*MPart, Bitcode.back());
+  }, /*PreserveLocals=*/true);
+  M.reset();
+
+  std::vector<std::string> Errors(N);
+  for (unsigned I = 0; I != N; ++I) {
+    Pool.async([&, I] {
+      LLVMContext PartContext;
+      ErrorOr<Module *> PartOrErr =
+          parseBitcodeFile(MemoryBufferRef(Bitcode[I], ModuleID), PartContext);
+      if (std::error_code EC = PartOrErr.getError()) {
+        Errors[I] = EC.message();
+        return;
+      }
+      std::unique_ptr<Module> Part(PartOrErr.get());
+      OptimizePartition(*Part);
+      removeSpecialDeclarations(*Part);
+      writeBitcode(*Part, Bitcode[I]);
+    });
+  }
+  Pool.wait();
+
+  // Link the partitions in order, so that the result does not depend on the
+  // scheduling of the threads.
+  std::unique_ptr<Module> Linked;
+  for (unsigned I = 0; I != N; ++I) {
+    if (!Errors[I].empty()) {
+      errs() << Arg0 << ": error reading partition: " << Errors[I] << "\n";
+      return nullptr;
+    }
+    ErrorOr<Module *> PartOrErr =
+        parseBitcodeFile(MemoryBufferRef(Bitcode[I], ModuleID), Context);
+    if (std::error_code EC = PartOrErr.getError()) {
+      errs() << Arg0 << ": error reading partition: " << EC.message() << "\n";
+      return nullptr;
+    }
+    std::unique_ptr<Module> Part(PartOrErr.get());
+    if (!Linked) {
+      Linked = std::move(Part);
+      continue;
+    }
+    std::string ErrorMsg;
+    if (Linker::LinkModules(Linked.get(), Part.get(), Linker::DestroySource,
+                            &ErrorMsg)) {
+      errs() << Arg0 << ": error linking partitions: " << ErrorMsg << "\n";
+      return nullptr;
+    }
+  }
+
+  for (const std::string &Name : FunctionOrder)
+    if (Function *F = Linked->getFunction(Name))
+      Linked->getFunctionList().splice(Linked->end(),
+                                       Linked->getFunctionList(), F);
+  for (const std::string &Name : GlobalOrder)
+    if (GlobalVariable *GV = Linked->getGlobalVariable(Name, true))
+      Linked->getGlobalList().splice(Linked->global_end(),
+                                     Linked->getGlobalList(), GV);
+  for (const std::string &Name : TempNames)
+    if (GlobalValue *GV = Linked->getNamedValue(Name))
+      GV->setName("");
+  return Linked;
+}
+
+/// Return true if \p C is used, through constants, by an instruction outside
+/// \p F, or by a global value if \p GlobalUsers is set.
+static bool isUsedOutside(const Constant *C, const Function *F,
+                          bool GlobalUsers) {
+  SmallVector<const User *, 8> Worklist(C->user_begin(), C->user_end());
+  while (!Worklist.empty()) {
+    const User *U = Worklist.pop_back_val();
+    if (const Instruction *I = dyn_cast<Instruction>(U)) {
+      if (I->getParent()->getParent() != F)
+        return true;
+      continue;
+    }
+    if (isa<GlobalValue>(U)) {
+      if (GlobalUsers)
+        return true;
+      continue;
+    }
+    Worklist.append(U->user_begin(), U->user_end());
+  }
+  return false;
+}
+
+bool llvm::canRunCGSCCPassesInParallel(const Module &M) {
+  // An SCC is optimized without the bodies of the functions it does not call,
+  // so the blocks of a function must only be referred to from the function.
+  for (const Function &F : M)
+    for (const BasicBlock &BB : F)
+      if (BB.hasAddressTaken() &&
+          isUsedOutside(BlockAddress::get(const_cast<BasicBlock *>(&BB)), &F,
+                        /*GlobalUsers=*/true))
+        return false;
+
+  // An SCC can only declare the globals it uses, and an appending global
+  // cannot be declared.
+  for (const GlobalVariable &GV : M.globals())
+    if (GV.hasAppendingLinkage() &&
+        isUsedOutside(&GV, nullptr, /*GlobalUsers=*/false))
+      return false;
+  return true;
+}
+
+namespace {
+/// An SCC of the call graph, optimized by one task.
+struct SCCTask {
+  /// The names of the functions of the SCC.
+  std::vector<std::string> Functions;
+  /// Whether each function of the SCC may be inlined into its callers.
+  std::vector<bool> Inlinable;
+  /// The SCCs called by this one, in increasing order, and the SCCs calling
+  /// this one.
+  std::vector<unsigned> Callees, Callers;
+  /// The number of callees whose task has not finished yet.
+  unsigned PendingCallees;
+  /// The module the task starts from, then the optimized functions of the
+  /// SCC, as bitcode.
+  std::string Input, Output;
+  std::string Error;
+};
+
+/// Creates, in the module of an SCC, the declarations of the globals the
+/// functions of the SCC refer to. Constants keep their initializer, as
+/// available_externally definitions, so that loads from them still fold.
+class DeclarationMaterializer : public ValueMaterializer {
+public:
+  DeclarationMaterializer(Module &Dst, ValueToValueMapTy &VMap)
+      : Dst(Dst), VMap(VMap) {}
+
+  Value *materializeValueFor(Value *V) override;
+
+private:
+  Module &Dst;
+  ValueToValueMapTy &VMap;
+};
+}
+
+Value *DeclarationMaterializer::materializeValueFor(Value *V) {
+  if (Function *F = dyn_cast<Function>(V)) {
+    Function *NewF = Function::Create(F->getFunctionType(),
+                                      GlobalValue::ExternalLinkage,
+                                      F->getName(), &Dst);
+    NewF->copyAttributesFrom(F);
+    NewF->setPrefixData(nullptr);
+    return NewF;
+  }
+
+  if (GlobalVariable *GV = dyn_cast<GlobalVariable>(V)) {
+    GlobalVariable *NewGV = new GlobalVariable(
+        Dst, GV->getType()->getElementType(), GV->isConstant(),
+        GlobalValue::ExternalLinkage, nullptr, GV->getName(), nullptr,
+        GV->getThreadLocalMode(), GV->getType()->getAddressSpace(),
+        GV->isExternallyInitialized());
+    NewGV->copyAttributesFrom(GV);
+    if (GV->isConstant() && GV->hasDefinitiveInitializer()) {
+      // The initializer may refer back to the variable.
+      VMap[GV] = NewGV;
+      NewGV->setInitializer(
+          MapValue(GV->getInitializer(), VMap, RF_None, nullptr, this));
+      NewGV->setLinkage(GlobalValue::AvailableExternallyLinkage);
+    }
+    return NewGV;
+  }
+
+  if (GlobalAlias *GA = dyn_cast<GlobalAlias>(V)) {
+    Type *Ty = GA->getType()->getElementType();
+    if (FunctionType *FTy = dyn_cast<FunctionType>(Ty))
+      return Function::Create(FTy, GlobalValue::ExternalLinkage, GA->getName(),
+                              &Dst);
+    return new GlobalVariable(Dst, Ty, false, GlobalValue::ExternalLinkage,
+                              nullptr, GA->getName(), nullptr,
+                              GA->getThreadLocalMode(),
+                              GA->getType()->getAddressSpace());
+  }
+
+  return nullptr;
+}
+
+/// Return the linkage of a function of an SCC in the module of the SCC. The
+/// passes must neither delete the function nor change its signature, but
+/// they must still see whether it may be overridden.
+static GlobalValue::LinkageTypes getSCCLinkage(const Function &F) {
+  if (F.hasLinkOnceLinkage())
+    return F.hasLinkOnceODRLinkage() ? GlobalValue::WeakODRLinkage
+                                     : GlobalValue::WeakAnyLinkage;
+  if (F.hasLocalLinkage() || F.hasAvailableExternallyLinkage())
+    return GlobalValue::ExternalLinkage;
+  return F.getLinkage();
+}
+
+/// Write to \p Bitcode a module made of copies of the functions \p SCC of
+/// \p M, and of declarations for what they refer to.
+static void writeSCCModule(const Module &M, ArrayRef<Function *> SCC,
+                           std::string &Bitcode) {
+  Module Dst(M.getModuleIdentifier(), M.getContext());
+  Dst.setDataLayout(M.getDataLayout());
+  Dst.setTargetTriple(M.getTargetTriple());
+  if (NamedMDNode *Flags = M.getModuleFlagsMetadata()) {
+    NamedMDNode *DstFlags = Dst.getOrInsertModuleFlagsMetadata();
+    for (unsigned I = 0, E = Flags->getNumOperands(); I != E; ++I)
+      DstFlags->addOperand(Flags->getOperand(I));
+  }
+
+  ValueToValueMapTy VMap;
+  DeclarationMaterializer Materializer(Dst, VMap);
+  for (Function *F : SCC) {
+    Function *NewF = Function::Create(F->getFunctionType(), getSCCLinkage(*F),
+                                      F->getName(), &Dst);
+    NewF->copyAttributesFrom(F);
+    NewF->setPrefixData(nullptr);
+    VMap[F] = NewF;
+  }
+  for (Function *F : SCC) {
+    Function *NewF = cast<Function>(VMap[F]);
+    Function::arg_iterator NewArg = NewF->arg_begin();
+    for (const Argument &Arg : F->args()) {
+      NewArg->setName(Arg.getName());
+      VMap[&Arg] = NewArg++;
+    }
+    SmallVector<ReturnInst *, 8> Returns;
+    CloneFunctionInto(NewF, F, VMap, /*ModuleLevelChanges=*/true, Returns, "",
+                      nullptr, nullptr, &Materializer);
+    if (F->hasPrefixData())
+      NewF->setPrefixData(cast<Constant>(MapValue(
+          F->getPrefixData(), VMap, RF_None, nullptr, &Materializer)));
+  }
+
+  writeBitcode(Dst, Bitcode);
+}
+
+/// Prepare \p Callee, the optimized functions of the SCC of \p Task, to be
+/// linked into the module of a calling SCC: the functions that may be inlined
+/// become available_externally, and the others declarations.
+static void importCalleeSCC(Module &Callee, const SCCTask &Task) {
+  for (unsigned I = 0, E = Task.Functions.size(); I != E; ++I) {
+    Function *F = Callee.getFunction(Task.Functions[I]);
+    if (Task.Inlinable[I])
+      F->setLinkage(GlobalValue::AvailableExternallyLinkage);
+    else
+      F->deleteBody();
+  }
+}
+
+/// Reduce the optimized module \p M of an SCC to the functions \p SCC, to
+/// the local globals passes may have created for them, and to declarations
+/// for the rest of what they refer to.
+static void keepOnlySCC(Module &M, ArrayRef<Function *> SCC) {
+  SmallPtrSet<const Function *, 8> InSCC(SCC.begin(), SCC.end());
+  for (Function &F : M)
+    if (!F.isDeclaration() && !F.hasLocalLinkage() && !InSCC.count(&F))
+      F.deleteBody();
+  for (GlobalVariable &GV : M.globals())
+    if (GV.hasInitializer() && !GV.hasLocalLinkage()) {
+      GV.setInitializer(nullptr);
+      GV.setLinkage(GlobalValue::ExternalLinkage);
+    }
+
+  bool Changed;
+  do {
+    Changed = false;
+    for (auto I = M.begin(), E = M.end(); I != E;) {
+      Function *F = I++;
+      if (F->use_empty() && !InSCC.count(F) &&
+          (F->isDeclaration() || F->hasLocalLinkage())) {
+        F->eraseFromParent();
+        Changed = true;
+      }
+    }
+    for (auto I = M.global_begin(), E = M.global_end(); I != E;) {
+      GlobalVariable *GV = I++;
+      if (GV->use_empty() &&
+          (GV->isDeclaration() || GV->hasLocalLinkage())) {
+        GV->eraseFromParent();
+        Changed = true;
+      }
+    }
+  } while (Changed);
+
+  while (!M.named_metadata_empty())
+    M.eraseNamedMetadata(M.named_metadata_begin());
+}
+
+/// Optimize the SCC \p I of \p Tasks, whose callees are done. Returns an
+/// error message, empty on success.
+static std::string
+optimizeSCC(std::vector<SCCTask> &Tasks, unsigned I, StringRef ModuleID,
+            const std::function<void(Module &, ArrayRef<Function *>)> &
+                OptimizeSCC) {
+  SCCTask &Task = Tasks[I];
+  for (unsigned C : Task.Callees)
+    if (!Tasks[C].Error.empty())
+      return Tasks[C].Error;
+
+  LLVMContext Context;
+  ErrorOr<Module *> MOrErr =
+      parseBitcodeFile(MemoryBufferRef(Task.Input, ModuleID), Context);
+  if (std::error_code EC = MOrErr.getError())
+    return EC.message();
+  std::unique_ptr<Module> M(MOrErr.get());
+  std::string().swap(Task.Input);
+
+  // Link the callees in a fixed order, so that the result does not depend on
+  // the order in which they were optimized.
+  for (unsigned C : Task.Callees) {
+    ErrorOr<Module *> CalleeOrErr =
+        parseBitcodeFile(MemoryBufferRef(Tasks[C].Output, ModuleID), Context);
+    if (std::error_code EC = CalleeOrErr.getError())
+      return EC.message();
+    std::unique_ptr<Module> Callee(CalleeOrErr.get());
+    importCalleeSCC(*Callee, Tasks[C]);
+    std::string ErrorMsg;
+    if (Linker::LinkModules(M.get(), Callee.get(), Linker::DestroySource,
+                            &ErrorMsg))
+      return ErrorMsg;
+  }
+
+  std::vector<Function *> SCC;
+  for (const std::string &Name : Task.Functions)
+    SCC.push_back(M->getFunction(Name));
+  OptimizeSCC(*M, SCC);
+  keepOnlySCC(*M, SCC);
+  writeBitcode(*M, Task.Output);
+  return std::string();
+}
+
+namespace {
+/// Runs a CallGraph SCC pass on the SCCs which hold a function of a task.
+/// The PassManager does not know about the pass; it resolves the analyses the
+/// pass requires for this one, which are handed over before every run.
+class SCCTaskPass : public CallGraphSCCPass {
+public:
+  static char ID;
+
+  SCCTaskPass(CallGraphSCCPass *P, const SmallPtrSetImpl<const Function *> &SCC)
+      : CallGraphSCCPass(ID), P(P), SCC(SCC) {}
+
+  const char *getPassName() const override { return P->getPassName(); }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    P->getAnalysisUsage(AU);
+  }
+
+  bool doInitialization(CallGraph &CG) override {
+    P->setResolver(new AnalysisResolver(getResolver()->getPMDataManager()));
+    return P->doInitialization(CG);
+  }
+
+  bool runOnSCC(CallGraphSCC &CGSCC) override;
+
+  bool doFinalization(CallGraph &CG) override {
+    return P->doFinalization(CG);
+  }
+
+  void releaseMemory() override { P->releaseMemory(); }
+
+private:
+  std::unique_ptr<CallGraphSCCPass> P;
+  const SmallPtrSetImpl<const Function *> &SCC;
+};
+}
+
+char SCCTaskPass::ID = 0;
+
+bool SCCTaskPass::runOnSCC(CallGraphSCC &CGSCC) {
+  bool InTask = false;
+  for (CallGraphNode *Node : CGSCC)
+    if (SCC.count(Node->getFunction()))
+      InTask = true;
+  if (!InTask)
+    return false;
+
+  AnalysisUsage AU;
+  P->getAnalysisUsage(AU);
+  AnalysisResolver *Resolver = P->getResolver();
+  Resolver->clearAnalysisImpls();
+  for (AnalysisID ID : AU.getRequiredSet())
+    Resolver->addAnalysisImplsPair(ID, getResolver()->findImplPass(ID));
+  return P->runOnSCC(CGSCC);
+}
+
+void SCCTaskPassManager::add(Pass *P) {
+  if (P->getPassKind() == PT_CallGraphSCC)
+    P = new SCCTaskPass(static_cast<CallGraphSCCPass *>(P), SCC);
+  PM.add(P);
+}
+
+bool llvm::runCGSCCPassesInParallel(
+    StringRef Arg0, Module &M, unsigned Threads,
+    std::function<void(Module &Task, ArrayRef<Function *> SCC)> OptimizeSCC) {
+  std::string ModuleID = M.getModuleIdentifier();
+
+  // The pieces refer to the globals of the module by name.
+  std::vector<std::string> TempNames;
+  auto NameGlobal = [&](GlobalValue &GV) {
+    if (GV.hasName())
+      return;
+    GV.setName("opt.unnamed");
+    TempNames.push_back(GV.getName());
+  };
+  for (Function &F : M)
+    NameGlobal(F);
+  for (GlobalVariable &GV : M.globals())
+    NameGlobal(GV);
+  for (GlobalAlias &GA : M.aliases())
+    NameGlobal(GA);
+
+  // Number the SCCs bottom-up, so that every SCC comes after its callees.
+  std::vector<SCCTask> Tasks;
+  std::vector<std::vector<Function *>> SCCs;
+  {
+    LazyCallGraph CG(M);
+    DenseMap<const Function *, unsigned> SCCNumbers;
+    for (LazyCallGraph::SCC &C : CG.postorder_sccs()) {
+      unsigned I = Tasks.size();
+      Tasks.push_back(SCCTask());
+      SCCs.push_back(std::vector<Function *>());
+      SCCTask &Task = Tasks.back();
+      for (LazyCallGraph::Node *N : C) {
+        Function &F = N->getFunction();
+        SCCNumbers[&F] = I;
+        SCCs.back().push_back(&F);
+        Task.Functions.push_back(F.getName());
+        Task.Inlinable.push_back(!F.mayBeOverridden());
+      }
+      for (LazyCallGraph::Node *N : C)
+        for (LazyCallGraph::Node &Callee : *N) {
+          auto It = SCCNumbers.find(&Callee.getFunction());
+          if (It != SCCNumbers.end() && It->second != I)
+            Task.Callees.push_back(It->second);
+        }
+      std::sort(Task.Callees.begin(), Task.Callees.end());
+      Task.Callees.erase(std::unique(Task.Callees.begin(), Task.Callees.end()),
+                         Task.Callees.end());
+      Task.PendingCallees = Task.Callees.size();
+      for (unsigned C : Task.Callees)
+        Tasks[C].Callers.push_back(I);
+    }
+  }
+
+  // Give the local globals external linkage while the pieces are optimized,
+  // so that they refer to the same globals as the module, and remember what
+  // to restore afterwards. The functions of the SCCs are replaced by the linker,
+  // and also lose their comdat and their place in the module.
+  std::vector<std::pair<std::string, GlobalValue::LinkageTypes>> Linkages;
+  std::vector<std::pair<std::string, Comdat *>> Comdats;
+  std::vector<std::string> FunctionOrder;
+  auto Externalize = [&](GlobalValue &GV) {
+    Linkages.push_back(std::make_pair(GV.getName(), GV.getLinkage()));
+    if (GV.hasLocalLinkage())
+      GV.setLinkage(GlobalValue::ExternalLinkage);
+  };
+  for (Function &F : M) {
+    Externalize(F);
+    if (Comdat *C = F.getComdat())
+      Comdats.push_back(std::make_pair(F.getName(), C));
+    FunctionOrder.push_back(F.getName());
+  }
+  for (GlobalVariable &GV : M.globals())
+    if (GV.hasLocalLinkage())
+      Externalize(GV);
+  for (GlobalAlias &GA : M.aliases())
+    if (GA.hasLocalLinkage())
+      Externalize(GA);
+
+  for (unsigned I = 0, E = Tasks.size(); I != E; ++I)
+    writeSCCModule(M, SCCs[I], Tasks[I].Input);
+  SCCs.clear();
+
+  // Every task starts its callers that have no other callee left to wait for.
+  {
+    ThreadPool Pool(Threads);
+    sys::Mutex Lock;
+    std::function<void(unsigned)> Run = [&](unsigned I) {
+      Tasks[I].Error = optimizeSCC(Tasks, I, ModuleID, OptimizeSCC);
+      std::vector<unsigned> Ready;
+      {
+        MutexGuard Locked(Lock);
+        for (unsigned Caller : Tasks[I].Callers)
+          if (--Tasks[Caller].PendingCallees == 0)
+            Ready.push_back(Caller);
+      }
+      for (unsigned Caller : Ready)
+        Pool.async(Run, Caller);
+    };
+    for (unsigned I = 0, E = Tasks.size(); I != E; ++I)
+      if (Tasks[I].Callees.empty())
+        Pool.async(Run, I);
+    Pool.wait();
+  }
+
+  // Replace the functions of the SCCs by their optimized versions, in order.
+  LLVMContext &Context = M.getContext();
+  for (SCCTask &Task : Tasks) {
+    if (!Task.Error.empty()) {
+      errs() << Arg0 << ": error optimizing SCC: " << Task.Error << "\n";
+      return false;
+    }
+    ErrorOr<Module *> SCCOrErr =
+        parseBitcodeFile(MemoryBufferRef(Task.Output, ModuleID), Context);
+    if (std::error_code EC = SCCOrErr.getError()) {
+      errs() << Arg0 << ": error reading SCC: " << EC.message() << "\n";
+      return false;
+    }
+    std::unique_ptr<Module> SCC(SCCOrErr.get());
+    std::string().swap(Task.Output);
+    for (const std::string &Name : Task.Functions)
+      M.getFunction(Name)->deleteBody();
+    std::string ErrorMsg;
+    if (Linker::LinkModules(&M, SCC.get(), Linker::DestroySource, &ErrorMsg)) {
+      errs() << Arg0 << ": error linking SCC: " << ErrorMsg << "\n";
+      return false;
+    }
+  }
+
+  for (const auto &Linkage : Linkages)
+    M.getNamedValue(Linkage.first)->setLinkage(Linkage.second);
+  for (const auto &C : Comdats)
+    M.getFunction(C.first)->setComdat(C.second);
+  for (const std::string &Name : FunctionOrder)
+    M.getFunctionList().splice(M.end(), M.getFunctionList(),
+                               M.getFunction(Name));
+  for (const std::string &Name : TempNames)
+    if (GlobalValue *GV = M.getNamedValue(Name))
+      GV->setName("");
+  return true;
+}
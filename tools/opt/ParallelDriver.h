@@ -0,0 +1,87 @@
+//===- ParallelDriver.h - Run passes on several threads ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// Functions which run parts of the optimization pipeline over a module on
+/// several threads. An LLVMContext cannot be used by several threads at once,
+/// so the module is split into pieces that are optimized in contexts of their
+/// own and then linked back together.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_OPT_PARALLELDRIVER_H
+#define LLVM_TOOLS_OPT_PARALLELDRIVER_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include <functional>
+#include <memory>
+
+namespace llvm {
+class Function;
+class Module;
+
+/// \brief Optimize the functions of \p M on \p Threads threads (0 means one
+/// per hardware thread).
+///
+/// \p OptimizePartition is called concurrently on each partition, every one
+/// in an LLVMContext of its own. It may only change the bodies of the
+/// functions defined in the partition, as a pipeline of function passes does.
+///
+/// Returns the optimized module, in the context of \p M, or null after
+/// printing an error prefixed with \p Arg0.
+std::unique_ptr<Module>
+runFunctionPassesInParallel(StringRef Arg0, std::unique_ptr<Module> M,
+                            unsigned Threads,
+                            std::function<void(Module &Part)> OptimizePartition);
+
+/// \brief Return true if runCGSCCPassesInParallel can optimize \p M, which is
+/// not the case when the address of a block is taken outside its function, or
+/// when a function uses an appending global.
+bool canRunCGSCCPassesInParallel(const Module &M);
+
+/// \brief Run the CallGraph SCC stage of the optimization pipeline over \p M
+/// on \p Threads threads (0 means one per hardware thread).
+///
+/// The SCCs of the call graph are optimized bottom-up, each one as soon as
+/// all the SCCs it calls are done, so independent parts of the graph are
+/// optimized concurrently. \p OptimizeSCC is called on a module of its own
+/// for every SCC, in an LLVMContext of its own, with \p SCC holding the
+/// functions of the SCC. The module also defines, as available_externally
+/// functions, the optimized bodies of the functions the SCC calls that may be
+/// inlined. The functions of \p SCC are given a linkage that is neither local
+/// nor discardable in the module, so that passes neither delete them nor
+/// change their signatures; only their bodies and attributes are kept.
+///
+/// The result does not depend on the scheduling of the threads nor on their
+/// number. Returns false after printing an error prefixed with \p Arg0.
+bool runCGSCCPassesInParallel(
+    StringRef Arg0, Module &M, unsigned Threads,
+    std::function<void(Module &Task, ArrayRef<Function *> SCC)> OptimizeSCC);
+
+/// \brief A pass manager which adds the passes given to it to another one,
+/// with the CallGraph SCC passes among them only run on the SCCs holding one
+/// of the functions of an SCC task. They then leave alone the callees
+/// imported into the module of the task, which are already optimized.
+class SCCTaskPassManager : public legacy::PassManagerBase {
+public:
+  SCCTaskPassManager(legacy::PassManagerBase &PM, ArrayRef<Function *> SCC)
+      : PM(PM), SCC(SCC.begin(), SCC.end()) {}
+
+  void add(Pass *P) override;
+
+private:
+  legacy::PassManagerBase &PM;
+  SmallPtrSet<const Function *, 8> SCC;
+};
+}
+
+#endif
@@ -14,6 +14,7 @@
 
 #include "BreakpointPrinter.h"
 #include "NewPMDriver.h"
+#include "ParallelDriver.h"
 #include "PassPrinters.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/CallGraph.h"
@@ -181,6 +182,22 @@ DefaultDataLayout("default-data-layout",
           cl::desc("data layout string to use if not specified by module"),
           cl::value_desc("layout-string"), cl::init(""));
 
+static cl::opt<unsigned>
+Threads("threads", cl::init(1),
+        cl::desc("Number of threads decoding the function bodies of bitcode "
+                 "input and running the per-function passes and the call "
+                 "graph SCC passes of -O1, -O2, -O3, -Os and -Oz "
+                 "(0 = one per hardware thread)"));
+
+// The optimization and size levels for which function passes were added to
+// the function pass manager, so that it can be rebuilt for every thread.
+static std::vector<std::pair<unsigned, unsigned> > FunctionPassLevels;
+
+// Set when the module passes of the only optimization level run the CallGraph
+// SCC passes on several threads, in which case AddOptimizationPasses leaves
+// them to RunModulePassesInParallel.
+static bool ParallelModulePasses = false;
+
 
 
 static inline void addPass(PassManagerBase &PM, Pass *P) {
@@ -194,26 +211,13 @@ static inline void addPass(PassManagerBase &PM, Pass *P) {
   }
 }
 
-/// This routine adds optimization passes based on selected optimization level,
-/// OptLevel.
-///
-/// OptLevel - Optimization Level
-static void AddOptimizationPasses(PassManagerBase &MPM,FunctionPassManager &FPM,
-                                  unsigned OptLevel, unsigned SizeLevel) {
-  FPM.add(createVerifierPass());          // Verify that input is correct
-  MPM.add(createDebugInfoVerifierPass()); // Verify that debug info is correct
-
-  PassManagerBuilder Builder;
+/// Set up Builder for the optimization level OptLevel and size level
+/// SizeLevel, leaving out the inliner.
+static void SetupPassManagerBuilder(PassManagerBuilder &Builder,
+                                    unsigned OptLevel, unsigned SizeLevel) {
   Builder.OptLevel = OptLevel;
   Builder.SizeLevel = SizeLevel;
 
-  if (DisableInline) {
-    // No inlining pass
-  } else if (OptLevel > 1) {
-    Builder.Inliner = createFunctionInliningPass(OptLevel, SizeLevel);
-  } else {
-    Builder.Inliner = createAlwaysInlinerPass();
-  }
   Builder.DisableUnitAtATime = !UnitAtATime;
   Builder.DisableUnrollLoops = (DisableLoopUnrolling.getNumOccurrences() > 0) ?
                                DisableLoopUnrolling : OptLevel == 0;
@@ -228,9 +232,50 @@ static void AddOptimizationPasses(PassManagerBase &MPM,FunctionPassManager &FPM,
   // When #pragma vectorize is on for SLP, do the same as above
   Builder.SLPVectorize =
       DisableSLPVectorization ? false : OptLevel > 1 && SizeLevel < 2;
+}
+
+/// Give Builder the inliner of the optimization level OptLevel and size level
+/// SizeLevel.
+static void SetupInliner(PassManagerBuilder &Builder, unsigned OptLevel,
+                         unsigned SizeLevel) {
+  if (DisableInline) {
+    // No inlining pass
+  } else if (OptLevel > 1) {
+    Builder.Inliner = createFunctionInliningPass(OptLevel, SizeLevel);
+  } else {
+    Builder.Inliner = createAlwaysInlinerPass();
+  }
+}
 
+/// This routine adds optimization passes based on selected optimization level,
+/// OptLevel.
+///
+/// OptLevel - Optimization Level
+static void AddOptimizationPasses(PassManagerBase &MPM,FunctionPassManager &FPM,
+                                  unsigned OptLevel, unsigned SizeLevel) {
+  FPM.add(createVerifierPass());          // Verify that input is correct
+  MPM.add(createDebugInfoVerifierPass()); // Verify that debug info is correct
+
+  PassManagerBuilder Builder;
+  SetupPassManagerBuilder(Builder, OptLevel, SizeLevel);
+  Builder.populateFunctionPassManager(FPM);
+  if (!ParallelModulePasses) {
+    SetupInliner(Builder, OptLevel, SizeLevel);
+    Builder.populateModulePassManager(MPM);
+  }
+  FunctionPassLevels.push_back(std::make_pair(OptLevel, SizeLevel));
+}
+
+/// Add to FPM the function passes AddOptimizationPasses adds for OptLevel and
+/// SizeLevel.
+static void AddFunctionOptimizationPasses(FunctionPassManager &FPM,
+                                          unsigned OptLevel,
+                                          unsigned SizeLevel) {
+  FPM.add(createVerifierPass());
+
+  PassManagerBuilder Builder;
+  SetupPassManagerBuilder(Builder, OptLevel, SizeLevel);
   Builder.populateFunctionPassManager(FPM);
-  Builder.populateModulePassManager(MPM);
 }
 
 static void AddStandardCompilePasses(PassManagerBase &PM) {
@@ -305,6 +350,79 @@ static TargetMachine* GetTargetMachine(Triple TheTriple) {
                                         GetCodeGenOptLevel());
 }
 
+/// Run the module passes of the optimization level OptLevel and size level
+/// SizeLevel that come before the CallGraph SCC passes on M, then the SCC
+/// passes, with the function passes that follow them, on several threads, and
+/// add the remaining module passes to MPM. Returns false on error.
+static bool RunModulePassesInParallel(const char *Arg0, Module &M,
+                                      PassManagerBase &MPM,
+                                      const TargetLibraryInfo &TLI,
+                                      TargetMachine *TM, unsigned OptLevel,
+                                      unsigned SizeLevel) {
+  PassManagerBuilder Builder;
+  SetupPassManagerBuilder(Builder, OptLevel, SizeLevel);
+  const DataLayout *DL = M.getDataLayout();
+
+  PassManager Simplification;
+  Simplification.add(new TargetLibraryInfo(TLI));
+  if (DL)
+    Simplification.add(new DataLayoutPass(&M));
+  if (TM)
+    TM->addAnalysisPasses(Simplification);
+  Builder.populateAnalysisPasses(Simplification);
+  Builder.populateModuleSimplificationPasses(Simplification);
+  Simplification.run(M);
+
+  Builder.populateAnalysisPasses(MPM);
+  if (!canRunCGSCCPassesInParallel(M)) {
+    SetupInliner(Builder, OptLevel, SizeLevel);
+    Builder.populateCGSCCPasses(MPM);
+    Builder.populateFunctionSimplificationPasses(MPM);
+    Builder.populateModuleOptimizationPasses(MPM);
+    return true;
+  }
+
+  Triple ModuleTriple(M.getTargetTriple());
+  if (!runCGSCCPassesInParallel(Arg0, M, Threads,
+                                [&](Module &Task, ArrayRef<Function *> SCC) {
+    // Every task needs pass managers and a target machine of its own.
+    std::unique_ptr<TargetMachine> TaskTM;
+    if (ModuleTriple.getArch())
+      TaskTM.reset(GetTargetMachine(ModuleTriple));
+    PassManagerBuilder TaskBuilder;
+    SetupPassManagerBuilder(TaskBuilder, OptLevel, SizeLevel);
+    SetupInliner(TaskBuilder, OptLevel, SizeLevel);
+
+    PassManager TaskPasses;
+    TaskPasses.add(new TargetLibraryInfo(TLI));
+    if (DL)
+      TaskPasses.add(new DataLayoutPass(&Task));
+    if (TaskTM)
+      TaskTM->addAnalysisPasses(TaskPasses);
+    TaskBuilder.populateAnalysisPasses(TaskPasses);
+    SCCTaskPassManager TaskSCCPasses(TaskPasses, SCC);
+    TaskBuilder.populateCGSCCPasses(TaskSCCPasses);
+    TaskPasses.run(Task);
+
+    FunctionPassManager TaskFPasses(&Task);
+    TaskFPasses.add(new TargetLibraryInfo(TLI));
+    if (DL)
+      TaskFPasses.add(new DataLayoutPass(&Task));
+    if (TaskTM)
+      TaskTM->addAnalysisPasses(TaskFPasses);
+    TaskBuilder.populateAnalysisPasses(TaskFPasses);
+    TaskBuilder.populateFunctionSimplificationPasses(TaskFPasses);
+    TaskFPasses.doInitialization();
+    for (Function *F : SCC)
+      TaskFPasses.run(*F);
+    TaskFPasses.doFinalization();
+  }))
+    return false;
+
+  Builder.populateModuleOptimizationPasses(MPM);
+  return true;
+}
+
 #ifdef LINK_POLLY_INTO_TOOLS
 namespace polly {
 void initializePollyPasses(llvm::PassRegistry &Registry);
@@ -362,7 +480,8 @@ int main(int argc, char **argv) {
   SMDiagnostic Err;
 
   // Load the input module...
-  std::unique_ptr<Module> M = parseIRFile(InputFilename, Err, Context);
+  std::unique_ptr<Module> M =
+      parseIRFile(InputFilename, Err, Context, Threads);
 
   if (!M.get()) {
     Err.print(argv[0], errs());
@@ -484,6 +603,14 @@ int main(int argc, char **argv) {
   if (StripDebug && !StandardCompileOpts)
     addPass(Passes, createStripSymbolsPass(true));
 
+  // With several threads, a lone optimization level runs its CallGraph SCC
+  // passes on the threads too.
+  ParallelModulePasses = Threads != 1 && PassList.empty() &&
+                         !StandardCompileOpts && !StandardLinkOpts &&
+                         !StripDebug && !PrintBreakpoints &&
+                         OptLevelO1 + OptLevelO2 + OptLevelOs + OptLevelOz +
+                                 OptLevelO3 == 1;
+
   // Create a new optimization pass for each one specified on the command line
   for (unsigned i = 0; i < PassList.size(); ++i) {
     // Check to see if -std-compile-opts was specified before this option.  If
@@ -592,13 +719,44 @@ int main(int argc, char **argv) {
   if (OptLevelO3)
     AddOptimizationPasses(Passes, *FPasses, 3, 0);
 
-  if (OptLevelO1 || OptLevelO2 || OptLevelOs || OptLevelOz || OptLevelO3) {
+  if ((OptLevelO1 || OptLevelO2 || OptLevelOs || OptLevelOz || OptLevelO3) &&
+      Threads != 1) {
+    // Every thread needs a pass manager and a target machine of its own.
+    FPasses.reset();
+    M = runFunctionPassesInParallel(argv[0], std::move(M), Threads,
+                                    [&](Module &Part) {
+      std::unique_ptr<TargetMachine> PartTM;
+      if (ModuleTriple.getArch())
+        PartTM.reset(GetTargetMachine(ModuleTriple));
+      FunctionPassManager PartPasses(&Part);
+      if (DL)
+        PartPasses.add(new DataLayoutPass(&Part));
+      if (PartTM)
+        PartTM->addAnalysisPasses(PartPasses);
+      for (const auto &Level : FunctionPassLevels)
+        AddFunctionOptimizationPasses(PartPasses, Level.first, Level.second);
+
+      PartPasses.doInitialization();
+      for (Function &F : Part)
+        PartPasses.run(F);
+      PartPasses.doFinalization();
+    });
+    if (!M)
+      return 1;
+  } else if (OptLevelO1 || OptLevelO2 || OptLevelOs || OptLevelOz ||
+             OptLevelO3) {
     FPasses->doInitialization();
     for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F)
       FPasses->run(*F);
     FPasses->doFinalization();
   }
 
+  if (ParallelModulePasses &&
+      !RunModulePassesInParallel(argv[0], *M, Passes, *TLI, TM.get(),
+                                 FunctionPassLevels[0].first,
+                                 FunctionPassLevels[0].second))
+    return 1;
+
   // Check that the module is well formed on completion of optimization
   if (!NoVerify && !VerifyEach) {
     Passes.add(createVerifierPass());
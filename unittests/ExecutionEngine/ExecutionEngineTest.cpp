@@ -7,9 +7,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Interpreter.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "gtest/gtest.h"
@@ -128,4 +131,55 @@ TEST_F(ExecutionEngineTest, DestructionRemovesGlobalMapping) {
   EXPECT_EQ(nullptr, Engine->getGlobalValueAtAddress(&Mem1));
 }
 
+TEST_F(ExecutionEngineTest, LoweredIntrinsicsGetSlots) {
+  LLVMContext &Context = getGlobalContext();
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  FunctionType *FTy = FunctionType::get(Int32Ty, Int32Ty, false);
+  Function *CtPop = Intrinsic::getDeclaration(M, Intrinsic::ctpop, Int32Ty);
+
+  // pop(x) = ctpop(x) + x. The interpreter lowers ctpop into instructions
+  // that did not exist when pop was first called.
+  Function *Pop = Function::Create(FTy, Function::ExternalLinkage, "pop", M);
+  IRBuilder<> Builder(BasicBlock::Create(Context, "entry", Pop));
+  Value *X = Pop->arg_begin();
+  Builder.CreateRet(Builder.CreateAdd(Builder.CreateCall(CtPop, X), X));
+
+  // main(x) = pop(x) + pop(x) + ctpop(x), so the second call runs the lowered
+  // pop, and main lowers ctpop after its own values were numbered.
+  Function *Main = Function::Create(FTy, Function::ExternalLinkage, "main", M);
+  Builder.SetInsertPoint(BasicBlock::Create(Context, "entry", Main));
+  X = Main->arg_begin();
+  Value *Sum = Builder.CreateAdd(Builder.CreateCall(Pop, X),
+                                 Builder.CreateCall(Pop, X));
+  Builder.CreateRet(Builder.CreateAdd(Sum, Builder.CreateCall(CtPop, X)));
+
+  std::vector<GenericValue> Args(1);
+  Args[0].IntVal = APInt(32, 0xF0F);
+  EXPECT_EQ(2 * (8 + 0xF0F) + 8,
+            Engine->runFunction(Main, Args).IntVal.getZExtValue());
+  // The lowered code is numbered afresh in a new run.
+  EXPECT_EQ(2 * (8 + 0xF0F) + 8,
+            Engine->runFunction(Main, Args).IntVal.getZExtValue());
+}
+
+TEST_F(ExecutionEngineTest, ConstantsReevaluatedBetweenRuns) {
+  LLVMContext &Context = getGlobalContext();
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  GlobalVariable *G = NewExtGlobal(Int32Ty, "Global");
+  int32_t Mem1 = 3;
+  int32_t Mem2 = 4;
+  Engine->addGlobalMapping(G, &Mem1);
+
+  Function *Load = Function::Create(FunctionType::get(Int32Ty, false),
+                                    Function::ExternalLinkage, "load", M);
+  IRBuilder<> Builder(BasicBlock::Create(Context, "entry", Load));
+  Builder.CreateRet(Builder.CreateLoad(G));
+
+  std::vector<GenericValue> NoArgs;
+  EXPECT_EQ(3u, Engine->runFunction(Load, NoArgs).IntVal.getZExtValue());
+  // The address of the global is cached during a run, but not across runs.
+  Engine->updateGlobalMapping(G, &Mem2);
+  EXPECT_EQ(4u, Engine->runFunction(Load, NoArgs).IntVal.getZExtValue());
+}
+
 }
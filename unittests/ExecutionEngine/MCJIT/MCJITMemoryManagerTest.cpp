@@ -166,5 +166,66 @@ TEST(MCJITMemoryManagerTest, ManyVariedAllocations) {
   }
 }
 
+TEST(MCJITMemoryManagerTest, ReleasedSetsAreReused) {
+  std::unique_ptr<SectionMemoryManager> MemMgr(
+      new SectionMemoryManager(1 << 20));
+
+  SectionMemoryManager::AllocationSetID First = MemMgr->startAllocationSet();
+  uint8_t *code1 = MemMgr->allocateCodeSection(256, 0, 1, "");
+  uint8_t *data1 = MemMgr->allocateDataSection(256, 0, 2, "", false);
+  EXPECT_NE((uint8_t*)nullptr, code1);
+  EXPECT_NE((uint8_t*)nullptr, data1);
+  code1[0] = 1;
+  data1[0] = 2;
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+
+  // Sections of a new set never share pages with the finalized ones.
+  SectionMemoryManager::AllocationSetID Second = MemMgr->startAllocationSet();
+  EXPECT_NE(First, Second);
+  uint8_t *code2 = MemMgr->allocateCodeSection(256, 0, 3, "");
+  EXPECT_NE((uint8_t*)nullptr, code2);
+  EXPECT_NE(code1, code2);
+  code2[0] = 3;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+
+  SectionMemoryManager::Statistics Stats = MemMgr->getStatistics();
+  EXPECT_EQ(2U, Stats.NumSlabs);
+  EXPECT_EQ(768U, Stats.SectionBytes);
+  EXPECT_EQ(0U, Stats.ReleasedBytes);
+
+  // Releasing the first set lets the next one take its pages, without
+  // mapping new slabs.
+  MemMgr->releaseAllocationSet(First);
+  MemMgr->startAllocationSet();
+  uint8_t *code3 = MemMgr->allocateCodeSection(256, 0, 4, "");
+  uint8_t *data3 = MemMgr->allocateDataSection(256, 0, 5, "", false);
+  EXPECT_EQ(code1, code3);
+  EXPECT_EQ(data1, data3);
+  code3[0] = 4;
+  data3[0] = 5;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+
+  Stats = MemMgr->getStatistics();
+  EXPECT_EQ(2U, Stats.NumSlabs);
+  EXPECT_EQ(768U, Stats.SectionBytes);
+  EXPECT_LT(0U, Stats.ReleasedBytes);
+  EXPECT_EQ(3, code2[0]);
+}
+
+TEST(MCJITMemoryManagerTest, HugePageHint) {
+  std::unique_ptr<SectionMemoryManager> MemMgr(
+      new SectionMemoryManager(4 << 20, true));
+
+  uint8_t *code = MemMgr->allocateCodeSection(256, 0, 1, "");
+  EXPECT_NE((uint8_t*)nullptr, code);
+  code[0] = 1;
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+  EXPECT_EQ(1, code[0]);
+}
+
 } // Namespace
 
@@ -14,13 +14,39 @@
 
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "MCJITTestBase.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
 
 namespace {
 
-class MCJITMultipleModuleTest : public testing::Test, public MCJITTestBase {};
+// Returns the value of the statistic described by Desc, or 0 if it has not
+// been counted yet.
+unsigned getStatistic(StringRef Desc) {
+  std::string Stats;
+  raw_string_ostream OS(Stats);
+  PrintStatistics(OS);
+  StringRef Rest = OS.str();
+  while (!Rest.empty()) {
+    std::pair<StringRef, StringRef> Line = Rest.split('\n');
+    Rest = Line.second;
+    if (!Line.first.endswith(Desc))
+      continue;
+    unsigned Value = 0;
+    Line.first.ltrim().split(' ').first.getAsInteger(10, Value);
+    return Value;
+  }
+  return 0;
+}
+
+class MCJITMultipleModuleTest : public testing::Test, public MCJITTestBase {
+protected:
+  // A statistic only counts if statistics are enabled when it is first
+  // incremented.
+  MCJITMultipleModuleTest() { EnableStatistics(); }
+};
 
 // FIXME: ExecutionEngine has no support empty modules
 /*
@@ -305,6 +331,102 @@ TEST_F(MCJITMultipleModuleTest, three_module_chain_case) {
   checkAdd(ptr);
 }
 
+// Module A { Function FA },
+// Module B { Extern FA, Function FB which calls FA },
+// Module C { Extern FB, Function FC which calls FB },
+// compile all three modules at once, then execute FC, FB, FA
+TEST_F(MCJITMultipleModuleTest, three_module_chain_case_pending_modules) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  std::unique_ptr<Module> A, B, C;
+  Function *FA, *FB, *FC;
+  createThreeModuleChainedCallsCase(A, FA, B, FB, C, FC);
+
+  createJIT(std::move(A));
+  TheJIT->addModule(std::move(B));
+  TheJIT->addModule(std::move(C));
+  TheJIT->generateCodeForPendingModules(2);
+
+  uint64_t ptr = TheJIT->getFunctionAddress(FC->getName().str());
+  checkAdd(ptr);
+
+  ptr = TheJIT->getFunctionAddress(FB->getName().str());
+  checkAdd(ptr);
+
+  ptr = TheJIT->getFunctionAddress(FA->getName().str());
+  checkAdd(ptr);
+}
+
+// Modules A, B, C and D of one context { Function FA, FB, FC and FD },
+// compile them at once, then execute FA, FB, FC and FD
+TEST_F(MCJITMultipleModuleTest, pending_modules_of_one_context) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  const char *Names[] = { "A", "B", "C", "D" };
+  std::unique_ptr<Module> Modules[4];
+  Function *Fns[4];
+  for (unsigned i = 0; i != 4; ++i) {
+    Modules[i].reset(createEmptyModule(Names[i]));
+    Fns[i] = insertAddFunction(Modules[i].get(),
+                               (Twine("F") + Names[i]).str());
+  }
+
+  unsigned CopiedBefore =
+      getStatistic("Number of modules compiled in a context of their own");
+  createJIT(std::move(Modules[0]));
+  for (unsigned i = 1; i != 4; ++i)
+    TheJIT->addModule(std::move(Modules[i]));
+  TheJIT->generateCodeForPendingModules(4);
+
+  // All but the first module are compiled from a copy in a context of their
+  // own, so that no two threads share a context.
+#if !defined(NDEBUG) || defined(LLVM_ENABLE_STATS)
+  EXPECT_EQ(CopiedBefore + 3, getStatistic("Number of modules compiled in a "
+                                           "context of their own"));
+#else
+  (void)CopiedBefore;
+#endif
+
+  for (Function *F : Fns)
+    checkAdd(TheJIT->getFunctionAddress(F->getName().str()));
+}
+
+// Module A { Function FA },
+// Module B { Extern FA, Function FB which calls FA },
+// Module D in another context { Function FD returning 42 },
+// compile the two contexts in parallel, then execute FB and FD
+TEST_F(MCJITMultipleModuleTest, pending_modules_of_two_contexts) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  std::unique_ptr<Module> A, B;
+  Function *FA, *FB;
+  createTwoModuleExternCase(A, FA, B, FB);
+
+  LLVMContext OtherContext;
+  std::unique_ptr<Module> D(new Module("D", OtherContext));
+  Function *FD = Function::Create(
+      FunctionType::get(Type::getInt32Ty(OtherContext), false),
+      GlobalValue::ExternalLinkage, "other_context_main", D.get());
+  IRBuilder<> OtherBuilder(BasicBlock::Create(OtherContext, "", FD));
+  OtherBuilder.CreateRet(OtherBuilder.getInt32(42));
+
+  createJIT(std::move(A));
+  TheJIT->addModule(std::move(B));
+  TheJIT->addModule(std::move(D));
+  TheJIT->generateCodeForPendingModules(2);
+
+  uint64_t ptr = TheJIT->getFunctionAddress(FB->getName().str());
+  checkAdd(ptr);
+
+  ptr = TheJIT->getFunctionAddress("other_context_main");
+  ASSERT_TRUE(ptr != 0) << "Unable to get pointer to function.";
+  int32_t (*FDPtr)() = (int32_t (*)())(intptr_t)ptr;
+  EXPECT_EQ(42, FDPtr());
+
+  // The module of the other context goes before the context does.
+  TheJIT.reset();
+}
+
 // Module A { Function FA },
 // Module B { Extern FA, Function FB which calls FA },
 // Module C { Extern FB, Function FC which calls FB },
@@ -11,9 +11,11 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Support/FileSystem.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -76,6 +78,19 @@ private:
   bool                            DuplicateInserted;
 };
 
+class CountingFileObjectCache : public FileObjectCache {
+public:
+  CountingFileObjectCache(StringRef CacheDir, const TargetMachine &TM)
+      : FileObjectCache(CacheDir, TM), NumCompiled(0) {}
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override {
+    ++NumCompiled;
+    FileObjectCache::notifyObjectCompiled(M, Obj);
+  }
+
+  unsigned NumCompiled;
+};
+
 class MCJITObjectCacheTest : public testing::Test, public MCJITTestBase {
 protected:
 
@@ -228,5 +243,75 @@ TEST_F(MCJITObjectCacheTest, VerifyNonLoadFromCache) {
   EXPECT_FALSE(Cache->wereDuplicatesInserted());
 }
 
+TEST_F(MCJITObjectCacheTest, VerifyFileObjectCache) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("mcjit-cache-test", CacheDir));
+
+  // The first run compiles the module and stores the object.
+  createJIT(std::move(M));
+  std::unique_ptr<CountingFileObjectCache> Cache(
+      new CountingFileObjectCache(CacheDir, *TheJIT->getTargetMachine()));
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun();
+  EXPECT_EQ(1U, Cache->NumCompiled);
+  TheJIT.reset();
+
+  // An identical module is loaded from the disk by another cache instance.
+  MM = new SectionMemoryManager;
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), OriginalRC);
+  createJIT(std::move(M));
+  Cache.reset(
+      new CountingFileObjectCache(CacheDir, *TheJIT->getTargetMachine()));
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun();
+  EXPECT_EQ(0U, Cache->NumCompiled);
+  TheJIT.reset();
+
+  // A module with different contents is compiled again, even though it has
+  // the same identifier.
+  MM = new SectionMemoryManager;
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), ReplacementRC);
+  createJIT(std::move(M));
+  Cache.reset(
+      new CountingFileObjectCache(CacheDir, *TheJIT->getTargetMachine()));
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun(ReplacementRC);
+  EXPECT_EQ(1U, Cache->NumCompiled);
+  TheJIT.reset();
+
+  // With a limit smaller than one object, writing an entry evicts the others.
+  unsigned NumEntries = 0;
+  std::error_code EC;
+  for (sys::fs::directory_iterator I(CacheDir.str(), EC), E; I != E && !EC;
+       I.increment(EC))
+    ++NumEntries;
+  EXPECT_EQ(2U, NumEntries);
+
+  MM = new SectionMemoryManager;
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), OriginalRC + ReplacementRC);
+  createJIT(std::move(M));
+  Cache.reset(
+      new CountingFileObjectCache(CacheDir, *TheJIT->getTargetMachine()));
+  Cache->setMaxSize(1);
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun(OriginalRC + ReplacementRC);
+  TheJIT.reset();
+
+  std::vector<std::string> Remaining;
+  for (sys::fs::directory_iterator I(CacheDir.str(), EC), E; I != E && !EC;
+       I.increment(EC))
+    Remaining.push_back(I->path());
+  EXPECT_TRUE(Remaining.empty());
+
+  for (const std::string &Path : Remaining)
+    sys::fs::remove(Path);
+  sys::fs::remove(CacheDir.str());
+}
+
 } // Namespace
 
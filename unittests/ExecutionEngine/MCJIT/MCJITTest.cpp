@@ -15,6 +15,8 @@
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "MCJITTestBase.h"
 #include "gtest/gtest.h"
+#include <chrono>
+#include <thread>
 
 using namespace llvm;
 
@@ -113,6 +115,64 @@ TEST_F(MCJITTest, return_global) {
     << "Invalid value for global returned from JITted function";
 }
 
+TEST_F(MCJITTest, lazy_functions) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  GlobalVariable *Counter = insertGlobalInt32(M.get(), "counter", 0);
+  Function *Add = insertAddFunction(M.get(), "add");
+  Add->setLinkage(GlobalValue::InternalLinkage);
+
+  // int32_t count(int32_t x) { return counter = add(counter, x); }
+  Function *Count = startFunction<int32_t(int32_t)>(M.get(), "count");
+  Value *Sum = Builder.CreateCall2(Add, Builder.CreateLoad(Counter),
+                                   Count->arg_begin());
+  Builder.CreateStore(Sum, Counter);
+  endFunctionWithRet(Count, Sum);
+
+  createJIT(std::move(M));
+  TheJIT->setLazyFunctionStubs(true);
+  uint64_t ptr = TheJIT->getFunctionAddress("count");
+  EXPECT_TRUE(0 != ptr) << "Unable to get pointer to count() from JIT";
+
+  // The first call goes through the compiler, the next ones do not.
+  int32_t (*FuncPtr)(int32_t) = (int32_t (*)(int32_t))ptr;
+  EXPECT_EQ(2, FuncPtr(2));
+  EXPECT_EQ(5, FuncPtr(3));
+  EXPECT_EQ(9, FuncPtr(4));
+  EXPECT_EQ(ptr, TheJIT->getFunctionAddress("count"));
+}
+
+TEST_F(MCJITTest, tier_up) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  insertAddFunction(M.get(), "add");
+  createJIT(std::move(M));
+  TheJIT->setLazyFunctionStubs(true);
+  TheJIT->setTieredCompilation(3);
+  uint64_t ptr = TheJIT->getFunctionAddress("add");
+  EXPECT_TRUE(0 != ptr) << "Unable to get pointer to add() from JIT";
+  void *volatile *Slot =
+      (void *volatile *)TheJIT->getGlobalValueAddress("add.slot");
+  ASSERT_TRUE(Slot != nullptr) << "Unable to find the slot of add()";
+  auto ReadSlot = [Slot]() -> void * { return *Slot; };
+
+  // The first call compiles the version counting the calls.
+  int32_t (*FuncPtr)(int32_t, int32_t) = (int32_t (*)(int32_t, int32_t))ptr;
+  EXPECT_EQ(3, FuncPtr(1, 2));
+  void *Counting = ReadSlot();
+  EXPECT_EQ(7, FuncPtr(3, 4));
+  EXPECT_EQ(Counting, ReadSlot());
+
+  // The third call compiles the function again in the background, and the
+  // slot switches to the new code once it is ready.
+  EXPECT_EQ(11, FuncPtr(5, 6));
+  for (unsigned i = 0; i != 10000 && ReadSlot() == Counting; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_NE(Counting, ReadSlot());
+  EXPECT_EQ(15, FuncPtr(7, 8));
+  EXPECT_EQ(ptr, TheJIT->getFunctionAddress("add"));
+}
+
 // FIXME: This case fails due to a bug with getPointerToGlobal().
 // The bug is due to MCJIT not having an implementation of getPointerToGlobal()
 // which results in falling back on the ExecutionEngine implementation that
@@ -10,6 +10,7 @@
 #include "llvm/IR/Dominators.h"
 #include "llvm/Analysis/PostDominators.h"
 #include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -222,6 +223,135 @@ namespace llvm {
       Passes.add(P);
       Passes.run(*M);
     }
+
+    std::unique_ptr<Module> parseModule(const char *Source) {
+      SMDiagnostic Err;
+      return parseAssemblyString(Source, Err, getGlobalContext());
+    }
+
+    BasicBlock *getBlock(Function &F, StringRef Name) {
+      for (Function::iterator I = F.begin(), E = F.end(); I != E; ++I)
+        if (I->getName() == Name)
+          return I;
+      return nullptr;
+    }
+
+    // Replace the terminator of BB with a branch to Succs.
+    void setSuccessors(BasicBlock *BB, BasicBlock *Succ0,
+                       BasicBlock *Succ1 = nullptr) {
+      LLVMContext &C = BB->getContext();
+      BB->getTerminator()->eraseFromParent();
+      if (Succ1)
+        BranchInst::Create(Succ0, Succ1, UndefValue::get(Type::getInt1Ty(C)),
+                           BB);
+      else
+        BranchInst::Create(Succ0, BB);
+    }
+
+    bool matchesRecalculation(DominatorTree &DT, Function &F) {
+      DominatorTree Expected;
+      Expected.recalculate(F);
+      return !DT.compare(Expected);
+    }
+
+    const char *UpdateModuleString =
+      "define void @f(i1 %cond) {\n"
+      "entry:\n"
+      "  br i1 %cond, label %a, label %b\n"
+      "a:\n"
+      "  br label %c\n"
+      "b:\n"
+      "  br label %c\n"
+      "c:\n"
+      "  br label %d\n"
+      "d:\n"
+      "  br i1 %cond, label %c, label %exit\n"
+      "exit:\n"
+      "  ret void\n"
+      "dead:\n"
+      "  br label %dead2\n"
+      "dead2:\n"
+      "  br label %d\n"
+      "}\n";
+
+    TEST(DominatorTree, InsertEdge) {
+      std::unique_ptr<Module> M = parseModule(UpdateModuleString);
+      Function &F = *M->getFunction("f");
+      DominatorTree DT;
+      DT.recalculate(F);
+
+      // a -> d lets d be reached without going through c, so entry becomes
+      // the immediate dominator of d.
+      BasicBlock *Entry = getBlock(F, "entry");
+      BasicBlock *D = getBlock(F, "d");
+      setSuccessors(getBlock(F, "a"), getBlock(F, "c"), D);
+      DT.insertEdge(getBlock(F, "a"), D);
+      EXPECT_TRUE(matchesRecalculation(DT, F));
+      EXPECT_EQ(DT.getNode(D)->getIDom()->getBlock(), Entry);
+
+      // An edge to a block which was unreachable brings in the blocks it
+      // reaches.
+      setSuccessors(getBlock(F, "b"), getBlock(F, "c"), getBlock(F, "dead"));
+      DT.insertEdge(getBlock(F, "b"), getBlock(F, "dead"));
+      EXPECT_TRUE(matchesRecalculation(DT, F));
+      EXPECT_TRUE(DT.isReachableFromEntry(getBlock(F, "dead2")));
+    }
+
+    TEST(DominatorTree, DeleteEdge) {
+      std::unique_ptr<Module> M = parseModule(UpdateModuleString);
+      Function &F = *M->getFunction("f");
+      DominatorTree DT;
+      DT.recalculate(F);
+
+      // Without entry -> b, a dominates c.
+      BasicBlock *A = getBlock(F, "a");
+      setSuccessors(getBlock(F, "entry"), A);
+      DT.deleteEdge(getBlock(F, "entry"), getBlock(F, "b"));
+      EXPECT_TRUE(matchesRecalculation(DT, F));
+      EXPECT_EQ(DT.getNode(getBlock(F, "c"))->getIDom()->getBlock(), A);
+      EXPECT_FALSE(DT.isReachableFromEntry(getBlock(F, "b")));
+
+      // Deleting a back edge changes nothing.
+      setSuccessors(getBlock(F, "d"), getBlock(F, "exit"));
+      DT.deleteEdge(getBlock(F, "d"), getBlock(F, "c"));
+      EXPECT_TRUE(matchesRecalculation(DT, F));
+
+      // With c -> exit instead of c -> d, d becomes unreachable.
+      BasicBlock *C = getBlock(F, "c");
+      setSuccessors(C, getBlock(F, "exit"));
+      DominatorTree::UpdateType Updates[] = {
+        DominatorTree::UpdateType(DominatorTree::Delete, C, getBlock(F, "d")),
+        DominatorTree::UpdateType(DominatorTree::Insert, C,
+                                  getBlock(F, "exit"))
+      };
+      DT.applyUpdates(Updates);
+      EXPECT_TRUE(matchesRecalculation(DT, F));
+      EXPECT_FALSE(DT.isReachableFromEntry(getBlock(F, "d")));
+      EXPECT_EQ(DT.getNode(getBlock(F, "exit"))->getIDom()->getBlock(), C);
+    }
+
+    TEST(DominatorTree, BatchUpdates) {
+      std::unique_ptr<Module> M = parseModule(UpdateModuleString);
+      Function &F = *M->getFunction("f");
+      DominatorTree DT;
+      DT.recalculate(F);
+
+      // Route b through the dead blocks to d, and skip c from a.
+      BasicBlock *A = getBlock(F, "a"), *B = getBlock(F, "b");
+      BasicBlock *C = getBlock(F, "c"), *D = getBlock(F, "d");
+      BasicBlock *Dead = getBlock(F, "dead");
+      setSuccessors(A, D);
+      setSuccessors(B, Dead);
+      DominatorTree::UpdateType Updates[] = {
+        DominatorTree::UpdateType(DominatorTree::Delete, A, C),
+        DominatorTree::UpdateType(DominatorTree::Insert, A, D),
+        DominatorTree::UpdateType(DominatorTree::Delete, B, C),
+        DominatorTree::UpdateType(DominatorTree::Insert, B, Dead)
+      };
+      DT.applyUpdates(Updates);
+      EXPECT_TRUE(matchesRecalculation(DT, F));
+      EXPECT_EQ(DT.getNode(C)->getIDom()->getBlock(), D);
+    }
   }
 }
 
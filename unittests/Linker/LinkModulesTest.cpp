@@ -13,6 +13,7 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/TypeFinder.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -153,4 +154,33 @@ TEST_F(LinkModuleTest, EmptyModule) {
   delete InternalM;
 }
 
+TEST_F(LinkModuleTest, StructTypesMergedByShape) {
+  // Every module has its own unnamed identified types for a list node and for
+  // a struct holding a list, so they can't be matched by name. The composite
+  // should still end up with a single copy of each.
+  Module *Composite = new Module("Composite", Ctx);
+  Linker L(Composite);
+  for (unsigned i = 0; i != 8; ++i) {
+    Module *Src = new Module("Src", Ctx);
+    StructType *Node = StructType::create(Ctx);
+    Node->setBody(Type::getInt32Ty(Ctx), PointerType::getUnqual(Node),
+                  nullptr);
+    StructType *List = StructType::create(Ctx);
+    List->setBody(PointerType::getUnqual(Node), Type::getInt64Ty(Ctx),
+                  nullptr);
+    new GlobalVariable(*Src, List, false /*=isConstant*/,
+                       GlobalValue::InternalLinkage,
+                       Constant::getNullValue(List), "list");
+    EXPECT_FALSE(L.linkInModule(Src, nullptr));
+    delete Src;
+  }
+
+  TypeFinder StructTypes;
+  StructTypes.run(*Composite, false);
+  EXPECT_EQ(2U, StructTypes.size());
+  EXPECT_EQ(8U, Composite->getGlobalList().size());
+
+  delete Composite;
+}
+
 } // end anonymous namespace
@@ -0,0 +1,187 @@
+//===- llvm/unittest/Object/ArchiveTest.cpp - Archive symbol lookup tests -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Object/Archive.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <set>
+
+using namespace llvm;
+using namespace object;
+
+namespace {
+
+// Appends an archive member header and its padded contents to Out.
+void addMember(raw_ostream &Out, StringRef Name, StringRef Contents) {
+  Out << format("%-16s%-12d%-6d%-6d%-8o%-10u`\n", Name.str().c_str(), 0, 0, 0,
+                0644, static_cast<unsigned>(Contents.size()));
+  Out << Contents;
+  if (Contents.size() % 2)
+    Out << '\n';
+}
+
+void writeBE32(raw_ostream &Out, uint32_t V) {
+  Out << char(V >> 24) << char(V >> 16) << char(V >> 8) << char(V);
+}
+
+void writeLE32(raw_ostream &Out, uint32_t V) {
+  Out << char(V) << char(V >> 8) << char(V >> 16) << char(V >> 24);
+}
+
+void writeLE16(raw_ostream &Out, uint16_t V) {
+  Out << char(V) << char(V >> 8);
+}
+
+const uint32_t HeaderSize = 60;
+
+// A GNU archive with members a.o, b.o and c.o. foo is defined by a.o and
+// b.o, in that order in the symbol table.
+std::string makeGNUArchive() {
+  const char *Names[] = { "foo", "bar", "foo", "baz" };
+  const unsigned Members[] = { 0, 1, 1, 2 };
+  std::string SymTab;
+  raw_string_ostream SymOS(SymTab);
+  uint32_t SymTabSize = 4 + 4 * 4 + 16;
+  uint32_t MemberOffsets[3];
+  for (unsigned I = 0; I != 3; ++I)
+    MemberOffsets[I] = 8 + HeaderSize + SymTabSize + I * (HeaderSize + 2);
+  writeBE32(SymOS, 4);
+  for (unsigned M : Members)
+    writeBE32(SymOS, MemberOffsets[M]);
+  for (const char *Name : Names)
+    SymOS << Name << '\0';
+  SymOS.flush();
+  EXPECT_EQ(SymTabSize, SymTab.size());
+
+  std::string Buf;
+  raw_string_ostream OS(Buf);
+  OS << "!<arch>\n";
+  addMember(OS, "/", SymTab);
+  addMember(OS, "a.o/", "a\n");
+  addMember(OS, "b.o/", "b\n");
+  addMember(OS, "c.o/", "c\n");
+  return OS.str();
+}
+
+// A COFF archive with members a.o and b.o whose symbol table gives bad an
+// out of range member index before a valid one.
+std::string makeCOFFArchive() {
+  const char *Names[] = { "foo", "bad", "bad", "bar" };
+  const uint16_t Indices[] = { 1, 3, 2, 2 };
+  uint32_t FirstSize = 4;
+  uint32_t SecondSize = 4 + 2 * 4 + 4 + 4 * 2 + 16;
+  uint32_t FirstMember = 8 + 2 * HeaderSize + FirstSize + SecondSize;
+
+  std::string First;
+  raw_string_ostream FirstOS(First);
+  writeBE32(FirstOS, 0);
+  FirstOS.flush();
+
+  std::string Second;
+  raw_string_ostream SecondOS(Second);
+  writeLE32(SecondOS, 2);
+  writeLE32(SecondOS, FirstMember);
+  writeLE32(SecondOS, FirstMember + HeaderSize + 2);
+  writeLE32(SecondOS, 4);
+  for (uint16_t Index : Indices)
+    writeLE16(SecondOS, Index);
+  for (const char *Name : Names)
+    SecondOS << Name << '\0';
+  SecondOS.flush();
+  EXPECT_EQ(SecondSize, Second.size());
+
+  std::string Buf;
+  raw_string_ostream OS(Buf);
+  OS << "!<arch>\n";
+  addMember(OS, "/", First);
+  addMember(OS, "/", Second);
+  addMember(OS, "a.o/", "a\n");
+  addMember(OS, "b.o/", "b\n");
+  return OS.str();
+}
+
+std::unique_ptr<Archive> createArchive(StringRef Buf) {
+  ErrorOr<std::unique_ptr<Archive>> ArchiveOrErr =
+      Archive::create(MemoryBufferRef(Buf, "test.a"));
+  EXPECT_FALSE(ArchiveOrErr.getError());
+  return std::move(*ArchiveOrErr);
+}
+
+// Returns the name of the member findSym resolves Sym to, or "" if none.
+std::string findMember(const Archive &A, StringRef Sym) {
+  Archive::child_iterator C = A.findSym(Sym);
+  if (C == A.child_end())
+    return "";
+  ErrorOr<StringRef> NameOrErr = C->getName();
+  EXPECT_FALSE(NameOrErr.getError());
+  return *NameOrErr;
+}
+
+TEST(ArchiveTest, SymbolIndexMatchesLinearSearch) {
+  std::string Buf = makeGNUArchive();
+  std::unique_ptr<Archive> Linear = createArchive(Buf);
+  std::unique_ptr<Archive> Indexed = createArchive(Buf);
+  Indexed->buildSymbolIndex();
+
+  for (const Archive *A : { Linear.get(), Indexed.get() }) {
+    EXPECT_EQ("a.o", findMember(*A, "foo"));
+    EXPECT_EQ("b.o", findMember(*A, "bar"));
+    EXPECT_EQ("c.o", findMember(*A, "baz"));
+    EXPECT_EQ("", findMember(*A, "qux"));
+    EXPECT_EQ("", findMember(*A, ""));
+  }
+}
+
+TEST(ArchiveTest, SymbolIndexReturnsSameChild) {
+  std::string Buf = makeGNUArchive();
+  std::unique_ptr<Archive> A = createArchive(Buf);
+  A->buildSymbolIndex();
+
+  // The child built from an indexed offset is the one the first symbol table
+  // entry for the symbol points to, and iteration continues from it.
+  std::set<std::string> Seen;
+  for (Archive::symbol_iterator I = A->symbol_begin(), E = A->symbol_end();
+       I != E; ++I) {
+    if (!Seen.insert(I->getName()).second)
+      continue;
+    ErrorOr<Archive::child_iterator> MemberOrErr = I->getMember();
+    ASSERT_FALSE(MemberOrErr.getError());
+    Archive::child_iterator Found = A->findSym(I->getName());
+    EXPECT_TRUE(Found == *MemberOrErr);
+  }
+  EXPECT_EQ(3u, Seen.size());
+
+  Archive::child_iterator C = A->findSym("foo");
+  EXPECT_EQ("a\n", C->getBuffer());
+  ++C;
+  EXPECT_EQ("b\n", C->getBuffer());
+  ++C;
+  EXPECT_EQ("c\n", C->getBuffer());
+  ++C;
+  EXPECT_TRUE(C == A->child_end());
+}
+
+TEST(ArchiveTest, SymbolIndexKeepsMemberErrors) {
+  std::string Buf = makeCOFFArchive();
+  std::unique_ptr<Archive> Linear = createArchive(Buf);
+  std::unique_ptr<Archive> Indexed = createArchive(Buf);
+  ASSERT_EQ(Archive::K_COFF, Indexed->kind());
+  Indexed->buildSymbolIndex();
+
+  // The first entry for bad has no valid member, so bad is not found even
+  // though a later entry points to b.o.
+  for (const Archive *A : { Linear.get(), Indexed.get() }) {
+    EXPECT_EQ("a.o", findMember(*A, "foo"));
+    EXPECT_EQ("", findMember(*A, "bad"));
+    EXPECT_EQ("b.o", findMember(*A, "bar"));
+  }
+}
+
+}
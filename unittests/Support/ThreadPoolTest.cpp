@@ -0,0 +1,117 @@
+//===- llvm/unittest/Support/ThreadPoolTest.cpp - ThreadPool tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <set>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ThreadPoolTest, AsyncResults) {
+  ThreadPool Pool(4);
+  std::vector<std::future<int>> Futures;
+  for (int I = 0; I != 100; ++I)
+    Futures.push_back(Pool.async([](int X) { return X * X; }, I));
+  for (int I = 0; I != 100; ++I)
+    EXPECT_EQ(I * I, Futures[I].get());
+}
+
+TEST(ThreadPoolTest, Wait) {
+  std::atomic<int> Count(0);
+  ThreadPool Pool(4);
+  for (int I = 0; I != 1000; ++I)
+    Pool.async([&Count] { ++Count; });
+  Pool.wait();
+  EXPECT_EQ(1000, Count);
+
+  // The pool can be reused after a wait.
+  for (int I = 0; I != 1000; ++I)
+    Pool.async([&Count] { ++Count; });
+  Pool.wait();
+  EXPECT_EQ(2000, Count);
+}
+
+TEST(ThreadPoolTest, DestructorWaits) {
+  std::atomic<int> Count(0);
+  {
+    ThreadPool Pool(2);
+    for (int I = 0; I != 100; ++I)
+      Pool.async([&Count] { ++Count; });
+  }
+  EXPECT_EQ(100, Count);
+}
+
+TEST(ThreadPoolTest, DefaultThreadCount) {
+  ThreadPool Pool;
+  EXPECT_LE(1U, Pool.getThreadCount());
+}
+
+#if LLVM_ENABLE_THREADS != 0
+TEST(ThreadPoolTest, ThreadIndex) {
+  ThreadPool Pool(3);
+  EXPECT_EQ(0U, Pool.getThreadIndex());
+
+  std::mutex Lock;
+  std::set<unsigned> Indices;
+  for (int I = 0; I != 100; ++I)
+    Pool.async([&] {
+      unsigned Index = Pool.getThreadIndex();
+      std::unique_lock<std::mutex> Guard(Lock);
+      Indices.insert(Index);
+    });
+  Pool.wait();
+
+  for (unsigned Index : Indices) {
+    EXPECT_LE(1U, Index);
+    EXPECT_GE(Pool.getThreadCount(), Index);
+  }
+}
+#endif
+
+TEST(ThreadPoolTest, NestedTaskGroups) {
+  // Every outer task waits for inner tasks. With fewer workers than outer
+  // tasks this only finishes if sync() keeps the workers busy.
+  std::atomic<int> Count(0);
+  ThreadPool Pool(2);
+  TaskGroup Outer(Pool);
+  for (int I = 0; I != 8; ++I)
+    Outer.spawn([&] {
+      TaskGroup Inner(Pool);
+      for (int J = 0; J != 8; ++J)
+        Inner.spawn([&] { ++Count; });
+      Inner.sync();
+    });
+  Outer.sync();
+  EXPECT_EQ(64, Count);
+}
+
+TEST(ThreadPoolTest, PerThreadAllocator) {
+  ThreadPool Pool(4);
+  PerThreadAllocator<> Alloc(Pool);
+  std::vector<int *> Results(1000);
+  TaskGroup Group(Pool);
+  for (int I = 0; I != 1000; ++I)
+    Group.spawn([&, I] {
+      int *P = Alloc.Allocate<int>();
+      *P = I;
+      Results[I] = P;
+    });
+  Group.sync();
+
+  for (int I = 0; I != 1000; ++I)
+    EXPECT_EQ(I, *Results[I]);
+  EXPECT_LT(0U, Alloc.getTotalMemory());
+
+  Alloc.Reset();
+}
+
+} // end anonymous namespace